@@ -6,9 +6,50 @@
         "src/cpp/memory_accessor/memory_accessor_main.cpp",
         "src/cpp/memory_accessor/memory_accessor.cpp",
         "src/cpp/memory_accessor/memory_common.cpp",
-        "src/cpp/memory_accessor/mac_dolphin_process.cpp"
+        "src/cpp/memory_accessor/memory_search.cpp",
+        "src/cpp/memory_accessor/async_file_writer.cpp",
+        "src/cpp/memory_accessor/candidate_bitmap.cpp",
+        "src/cpp/memory_accessor/cheat_code.cpp",
+        "src/cpp/memory_accessor/cheat_engine.cpp",
+        "src/cpp/memory_accessor/dolphin_process.cpp",
+        "src/cpp/memory_accessor/executor.cpp",
+        "src/cpp/memory_accessor/executor_job.cpp",
+        "src/cpp/memory_accessor/hex_encode.cpp",
+        "src/cpp/memory_accessor/instance_group.cpp",
+        "src/cpp/memory_accessor/ipc_server.cpp",
+        "src/cpp/memory_accessor/live_mirror.cpp",
+        "src/cpp/memory_accessor/lz_decompress.cpp",
+        "src/cpp/memory_accessor/mapped_file.cpp",
+        "src/cpp/memory_accessor/mirror_table.cpp",
+        "src/cpp/memory_accessor/page_activity_profile.cpp",
+        "src/cpp/memory_accessor/page_activity_profiler.cpp",
+        "src/cpp/memory_accessor/pattern_search.cpp",
+        "src/cpp/memory_accessor/process_pauser.cpp",
+        "src/cpp/memory_accessor/ram_dump.cpp",
+        "src/cpp/memory_accessor/ram_history.cpp",
+        "src/cpp/memory_accessor/ram_history_ring.cpp",
+        "src/cpp/memory_accessor/region_classifier.cpp",
+        "src/cpp/memory_accessor/region_renderer.cpp",
+        "src/cpp/memory_accessor/savestate_image.cpp",
+        "src/cpp/memory_accessor/savestate_process.cpp",
+        "src/cpp/memory_accessor/scan_session.cpp",
+        "src/cpp/memory_accessor/scan_session_store.cpp",
+        "src/cpp/memory_accessor/shared_memory_service.cpp",
+        "src/cpp/memory_accessor/structure_walker.cpp",
+        "src/cpp/memory_accessor/symbol_index.cpp",
+        "src/cpp/memory_accessor/symbol_map.cpp",
+        "src/cpp/memory_accessor/telemetry_encoder.cpp",
+        "src/cpp/memory_accessor/telemetry_stream.cpp",
+        "src/cpp/memory_accessor/time_series_file.cpp",
+        "src/cpp/memory_accessor/time_series_recorder.cpp",
+        "src/cpp/memory_accessor/trigger_engine.cpp",
+        "src/cpp/memory_accessor/trigger_program.cpp"
       ],
-      "include_dirs": ["<!@(node -p \"require('node-addon-api').include\")"],
+      "conditions": [
+        ["OS=='mac'", {"sources": ["src/cpp/memory_accessor/mac_dolphin_process.cpp"]}],
+        ["OS=='linux'", {"sources": ["src/cpp/memory_accessor/linux_dolphin_process.cpp"]}]
+      ],
+      "include_dirs": ["<!@(node -p \"require('node-addon-api').include\")", "src/cpp/common"],
       "dependencies": ["<!(node -p \"require('node-addon-api').gyp\")"],
       "cflags!": ["-fno-exceptions"],
       "cflags_cc!": ["-fno-exceptions"],
@@ -22,11 +63,12 @@
     {
       "target_name": "offscreen_capture",
       "sources": [
-        "src/cpp/offscreen_capture/offscreen_capture_main.cpp",
+        "src/cpp/offscreen_capture/offscreen_capture_main.mm",
         "src/cpp/offscreen_capture/offscreen_capture.mm"
       ],
       "include_dirs": [
-        "<!@(node -p \"require('node-addon-api').include\")"
+        "<!@(node -p \"require('node-addon-api').include\")",
+        "src/cpp/common"
       ],
       "dependencies": [
         "<!(node -p \"require('node-addon-api').gyp\")"
@@ -53,7 +95,8 @@
       "target_name": "send_keys",
       "sources": [ "src/cpp/send_keys/send_keys.mm" ],
       "include_dirs": [
-        "<!@(node -p \"require('node-addon-api').include\")"
+        "<!@(node -p \"require('node-addon-api').include\")",
+        "src/cpp/common"
       ],
       "dependencies": [
         "<!(node -p \"require('node-addon-api').gyp\")"
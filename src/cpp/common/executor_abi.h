@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// The process-wide executor as seen from the addons that don't link executor.cpp. Each addon is a
+// separate shared library with its own copy of every static, so dolphin_memory owns the executor
+// and passes this table to offscreen_capture and send_keys as an External
+// (getExecutorHandle() => setExecutor(handle)). Plain C so any addon build can use it.
+#define DOLPHIN_EXECUTOR_ABI_VERSION 1
+
+// Highest first
+#define DOLPHIN_EXECUTOR_PRIORITY_INPUT 0
+#define DOLPHIN_EXECUTOR_PRIORITY_READ 1
+#define DOLPHIN_EXECUTOR_PRIORITY_CAPTURE 2
+#define DOLPHIN_EXECUTOR_PRIORITY_SCAN 3
+
+typedef struct DolphinExecutorAbi
+{
+  uint32_t version;
+  void* context;
+  // Runs run(argument) once on a worker at the given priority; never blocks the caller
+  void (*submit)(void* context, uint32_t priority, void (*run)(void* argument), void* argument);
+} DolphinExecutorAbi;
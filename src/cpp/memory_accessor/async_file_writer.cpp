@@ -0,0 +1,298 @@
+#include "async_file_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace Common
+{
+#ifdef HAVE_IO_URING
+namespace
+{
+// Also the most writes in flight; dumps are a few dozen large chunks
+constexpr unsigned RING_ENTRIES = 32;
+}  // namespace
+
+// A bare io_uring driven through the raw syscalls, so there is no liburing to link against
+struct AsyncFileWriter::Ring
+{
+  struct Pending
+  {
+    const u8* data;
+    size_t size;
+    u64 offset;
+  };
+
+  int fd = -1;
+  void* sqMapping = MAP_FAILED;
+  size_t sqMappingSize = 0;
+  void* cqMapping = MAP_FAILED;
+  size_t cqMappingSize = 0;
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t sqesSize = 0;
+
+  unsigned* sqTail = nullptr;
+  unsigned sqMask = 0;
+  unsigned* sqArray = nullptr;
+  unsigned* cqHead = nullptr;
+  unsigned* cqTail = nullptr;
+  unsigned cqMask = 0;
+  io_uring_cqe* cqes = nullptr;
+
+  // Indexed by user_data, so a short or refused write can be finished with pwrite
+  std::vector<Pending> pending;
+  std::vector<u32> freeSlots;
+
+  ~Ring()
+  {
+    if (sqes != MAP_FAILED)
+      munmap(sqes, sqesSize);
+    if (cqMapping != MAP_FAILED && cqMapping != sqMapping)
+      munmap(cqMapping, cqMappingSize);
+    if (sqMapping != MAP_FAILED)
+      munmap(sqMapping, sqMappingSize);
+    if (fd >= 0)
+      close(fd);
+  }
+
+  bool init()
+  {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, RING_ENTRIES, &params));
+    if (fd < 0)
+      return false;
+
+    sqMappingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    cqMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping)
+      sqMappingSize = cqMappingSize = std::max(sqMappingSize, cqMappingSize);
+
+    sqMapping = mmap(nullptr, sqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                     IORING_OFF_SQ_RING);
+    if (sqMapping == MAP_FAILED)
+      return false;
+    cqMapping = singleMapping ? sqMapping :
+                                mmap(nullptr, cqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     fd, IORING_OFF_CQ_RING);
+    if (cqMapping == MAP_FAILED)
+      return false;
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED)
+      return false;
+
+    u8* sq = static_cast<u8*>(sqMapping);
+    u8* cq = static_cast<u8*>(cqMapping);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Never more in flight than the SQ holds, so the CQ (twice as large) can't overflow
+    pending.resize(params.sq_entries);
+    for (u32 slot = params.sq_entries; slot-- > 0;)
+      freeSlots.push_back(slot);
+    return true;
+  }
+
+  bool full() const { return freeSlots.empty(); }
+  bool idle() const { return freeSlots.size() == pending.size(); }
+
+  bool submit(int fileFd, const u8* data, size_t size, u64 offset)
+  {
+    u32 slot = freeSlots.back();
+    freeSlots.pop_back();
+    pending[slot] = {data, size, offset};
+
+    // This thread (holding the writer's mutex) is the only producer
+    const unsigned tail = *sqTail;
+    const unsigned index = tail & sqMask;
+    io_uring_sqe& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = fileFd;
+    sqe.addr = reinterpret_cast<u64>(data);
+    sqe.len = static_cast<u32>(size);
+    sqe.off = offset;
+    sqe.user_data = slot;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    long submitted;
+    do
+      submitted = syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0);
+    while (submitted < 0 && (errno == EINTR || errno == EAGAIN));
+    if (submitted == 1)
+      return true;
+
+    // The kernel didn't take it; roll the entry back
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+    freeSlots.push_back(slot);
+    return false;
+  }
+
+  // Blocks for at least one completion; finished(pending, result) is called for each
+  template <typename Fn>
+  void reap(Fn finished)
+  {
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+    {
+      while (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno == EINTR)
+      {
+      }
+    }
+
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+      const io_uring_cqe& cqe = cqes[head & cqMask];
+      const u32 slot = static_cast<u32>(cqe.user_data);
+      finished(pending[slot], cqe.res);
+      freeSlots.push_back(slot);
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  }
+};
+#else
+struct AsyncFileWriter::Ring
+{
+};
+#endif
+
+AsyncFileWriter::AsyncFileWriter()
+{
+#ifdef HAVE_IO_URING
+  auto ring = std::make_unique<Ring>();
+  if (ring->init())
+    m_ring = std::move(ring);
+  else
+    std::cerr << "## io_uring unavailable (" << strerror(errno) << "), writing with pwrite\n";
+#endif
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+  finish();
+}
+
+bool AsyncFileWriter::open(const std::string& path, size_t size, bool direct)
+{
+  finish();
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  m_direct = false;
+#ifdef O_DIRECT
+  if (direct)
+  {
+    m_fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    m_direct = m_fd >= 0;
+  }
+#endif
+  if (m_fd < 0)
+    m_fd = ::open(path.c_str(), flags, 0644);
+  if (m_fd < 0)
+    return false;
+
+  // Sized up front so the parallel writes never extend the file
+  if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+  {
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+  m_failed = false;
+  return true;
+}
+
+bool AsyncFileWriter::writeSync(const u8* data, size_t size, u64 offset)
+{
+  while (size > 0)
+  {
+    ssize_t written = pwrite(m_fd, data, size, static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+void AsyncFileWriter::reap()
+{
+#ifdef HAVE_IO_URING
+  m_ring->reap([this](const Ring::Pending& write, int result) {
+    if (result == static_cast<int>(write.size))
+      return;
+    // Short writes are legal; finish them here. Kernels before 5.6 refuse IORING_OP_WRITE.
+    const size_t done = result > 0 ? static_cast<size_t>(result) : 0;
+    if (result < 0 && result != -EINVAL && result != -EAGAIN)
+      m_failed = true;
+    else if (!writeSync(write.data + done, write.size - done, write.offset + done))
+      m_failed = true;
+  });
+#endif
+}
+
+bool AsyncFileWriter::write(const u8* data, size_t size, u64 offset)
+{
+  if (m_fd < 0)
+    return false;
+  if (!m_ring)
+  {
+    if (writeSync(data, size, offset))
+      return true;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failed = true;
+    return false;
+  }
+
+#ifdef HAVE_IO_URING
+  std::lock_guard<std::mutex> lock(m_mutex);
+  while (m_ring->full())
+    reap();
+  if (m_ring->submit(m_fd, data, size, offset))
+    return true;
+  // Fall back for this write rather than fail the file
+  if (writeSync(data, size, offset))
+    return true;
+  m_failed = true;
+#endif
+  return false;
+}
+
+bool AsyncFileWriter::finish()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_fd < 0)
+    return false;
+#ifdef HAVE_IO_URING
+  while (m_ring && !m_ring->idle())
+    reap();
+#endif
+  bool success = !m_failed;
+  if (::close(m_fd) != 0)
+    success = false;
+  m_fd = -1;
+  return success;
+}
+}  // namespace Common
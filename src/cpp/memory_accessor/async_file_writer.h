@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "common_types.h"
+
+namespace Common
+{
+// Writes one file from several threads at once. On Linux the writes are queued on an io_uring, so
+// a caller only pays for the submission and goes back to work while the kernel copies; without
+// io_uring (other platforms, old kernels, seccomp profiles that block it) every write is a plain
+// pwrite on the calling thread. Data must stay untouched until finish() returns.
+class AsyncFileWriter
+{
+public:
+  // O_DIRECT needs buffers, sizes and offsets aligned to this
+  static constexpr size_t ALIGNMENT = 4096;
+
+  AsyncFileWriter();
+  ~AsyncFileWriter();
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+  // Creates or truncates the file at its final size. direct bypasses the page cache where the file
+  // system allows it and silently falls back to buffered writes where it doesn't.
+  bool open(const std::string& path, size_t size, bool direct);
+  // Thread safe; blocks only while the queue is full
+  bool write(const u8* data, size_t size, u64 offset);
+  // Waits for every queued write and closes the file; false if any write failed
+  bool finish();
+
+  bool usesIoUring() const { return m_ring != nullptr; }
+  bool isDirect() const { return m_direct; }
+
+private:
+  struct Ring;
+
+  bool writeSync(const u8* data, size_t size, u64 offset);
+  // With m_mutex held: waits for at least one completion and handles all that are ready
+  void reap();
+
+  std::unique_ptr<Ring> m_ring;
+  std::mutex m_mutex;
+  int m_fd = -1;
+  bool m_direct = false;
+  bool m_failed = false;
+};
+}  // namespace Common
@@ -0,0 +1,121 @@
+#include "candidate_bitmap.h"
+
+#include <algorithm>
+
+namespace DolphinComm
+{
+BitmapContainer BitmapContainer::range(u16 key, u32 count)
+{
+  if (count >= CONTAINER_KEYS)
+  {
+    BitmapContainer container;
+    container.key = key;
+    return container;
+  }
+  std::vector<u64> words(CONTAINER_WORDS, 0);
+  for (u32 w = 0; w < count / 64; ++w)
+    words[w] = ~0ull;
+  if (count % 64 != 0)
+    words[count / 64] = (1ull << (count % 64)) - 1;
+  return fromBits(key, words.data());
+}
+
+BitmapContainer BitmapContainer::fromSorted(u16 key, const u16* lows, u32 count)
+{
+  BitmapContainer container;
+  container.key = key;
+  container.cardinality = count;
+  if (count == CONTAINER_KEYS)
+  {
+    container.kind = ContainerKind::full;
+  }
+  else if (count <= ARRAY_CONTAINER_MAX)
+  {
+    container.kind = ContainerKind::array;
+    container.values.assign(lows, lows + count);
+  }
+  else
+  {
+    container.kind = ContainerKind::bitmap;
+    container.bits.assign(CONTAINER_WORDS, 0);
+    for (u32 i = 0; i < count; ++i)
+      container.bits[lows[i] / 64] |= 1ull << (lows[i] % 64);
+  }
+  return container;
+}
+
+BitmapContainer BitmapContainer::fromBits(u16 key, const u64* words)
+{
+  u32 count = 0;
+  for (u32 w = 0; w < CONTAINER_WORDS; ++w)
+    count += __builtin_popcountll(words[w]);
+
+  BitmapContainer container;
+  container.key = key;
+  container.cardinality = count;
+  if (count == CONTAINER_KEYS)
+  {
+    container.kind = ContainerKind::full;
+  }
+  else if (count <= ARRAY_CONTAINER_MAX)
+  {
+    container.kind = ContainerKind::array;
+    container.values.reserve(count);
+    for (u32 w = 0; w < CONTAINER_WORDS; ++w)
+    {
+      for (u64 word = words[w]; word != 0; word &= word - 1)
+        container.values.push_back(static_cast<u16>(w * 64 + __builtin_ctzll(word)));
+    }
+  }
+  else
+  {
+    container.kind = ContainerKind::bitmap;
+    container.bits.assign(words, words + CONTAINER_WORDS);
+  }
+  return container;
+}
+
+bool BitmapContainer::contains(u16 low) const
+{
+  switch (kind)
+  {
+  case ContainerKind::array:
+    return std::binary_search(values.begin(), values.end(), low);
+  case ContainerKind::bitmap:
+    return (bits[low / 64] >> (low % 64)) & 1;
+  default:
+    return true;
+  }
+}
+
+void BitmapContainer::toBits(u64* words) const
+{
+  switch (kind)
+  {
+  case ContainerKind::array:
+    std::fill(words, words + CONTAINER_WORDS, 0);
+    for (u16 low : values)
+      words[low / 64] |= 1ull << (low % 64);
+    break;
+  case ContainerKind::bitmap:
+    std::copy(bits.begin(), bits.end(), words);
+    break;
+  default:
+    std::fill(words, words + CONTAINER_WORDS, ~0ull);
+    break;
+  }
+}
+
+size_t BitmapContainer::dataSize() const
+{
+  switch (kind)
+  {
+  case ContainerKind::array:
+    return values.size() * sizeof(u16);
+  case ContainerKind::bitmap:
+    return CONTAINER_WORDS * sizeof(u64);
+  default:
+    return 0;
+  }
+}
+}  // namespace DolphinComm
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common_types.h"
+
+// Roaring-style set of 32-bit keys for scan candidates. Keys are grouped by their upper 16 bits
+// into containers, each stored in whichever form is smallest for what it holds: a sorted array of
+// the lower 16 bits (up to 4096 keys), a 65536-bit bitmap, or nothing at all when every key is in
+// the set, which is how a fresh unknown-value scan of all of RAM costs a few bytes per 64K
+// candidates.
+namespace DolphinComm
+{
+constexpr u32 CONTAINER_KEYS = 65536;
+constexpr u32 CONTAINER_WORDS = CONTAINER_KEYS / 64;
+// Past this many keys a bitmap is smaller than an array
+constexpr u32 ARRAY_CONTAINER_MAX = 4096;
+
+enum class ContainerKind : u8
+{
+  array,
+  bitmap,
+  full
+};
+
+struct BitmapContainer
+{
+  u16 key = 0;
+  ContainerKind kind = ContainerKind::full;
+  u32 cardinality = CONTAINER_KEYS;
+  // array: sorted lower bits
+  std::vector<u16> values;
+  // bitmap: CONTAINER_WORDS words, bit i of word w is key w * 64 + i
+  std::vector<u64> bits;
+
+  // Lower bits [0, count)
+  static BitmapContainer range(u16 key, u32 count);
+  static BitmapContainer fromSorted(u16 key, const u16* lows, u32 count);
+  // words holds CONTAINER_WORDS words
+  static BitmapContainer fromBits(u16 key, const u64* words);
+
+  bool contains(u16 low) const;
+  // Writes CONTAINER_WORDS words
+  void toBits(u64* words) const;
+  // Bytes of values or bits as saved
+  size_t dataSize() const;
+
+  // Calls fn(low) for every key in ascending order
+  template <typename Fn>
+  void forEach(Fn&& fn) const
+  {
+    switch (kind)
+    {
+    case ContainerKind::array:
+      for (u16 low : values)
+        fn(low);
+      break;
+    case ContainerKind::bitmap:
+      for (u32 w = 0; w < CONTAINER_WORDS; ++w)
+      {
+        for (u64 word = bits[w]; word != 0; word &= word - 1)
+          fn(static_cast<u16>(w * 64 + __builtin_ctzll(word)));
+      }
+      break;
+    default:
+      for (u32 low = 0; low < CONTAINER_KEYS; ++low)
+        fn(static_cast<u16>(low));
+      break;
+    }
+  }
+};
+}  // namespace DolphinComm
@@ -0,0 +1,718 @@
+#include "cheat_code.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <numeric>
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr size_t MAX_CODE_LINES = 4096;
+// Bytes one fill or string write may cover
+constexpr u32 MAX_WRITE_SIZE = 128 * 1024;
+constexpr u32 DEFAULT_REGISTER = 0x80000000;
+
+struct CodeLine
+{
+  u32 address;
+  u32 value;
+  u32 line;
+};
+
+bool parseHexWord(const std::string& text, u32& value)
+{
+  if (text.size() != 8)
+    return false;
+  value = 0;
+  for (char c : text)
+  {
+    if (!std::isxdigit(static_cast<unsigned char>(c)))
+      return false;
+    value = (value << 4) | static_cast<u32>(std::isdigit(static_cast<unsigned char>(c)) ?
+                                                c - '0' :
+                                                std::tolower(static_cast<unsigned char>(c)) - 'a' + 10);
+  }
+  return true;
+}
+
+// Splits the source into code lines, skipping blank lines, # comments and the $name and *note
+// lines of Dolphin's game ini files
+bool parseLines(const std::string& source, std::vector<CodeLine>& lines, std::string& error)
+{
+  u32 lineNumber = 0;
+  size_t position = 0;
+  while (position <= source.size())
+  {
+    size_t end = source.find('\n', position);
+    if (end == std::string::npos)
+      end = source.size();
+    std::string line = source.substr(position, end - position);
+    position = end + 1;
+    ++lineNumber;
+
+    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+    const size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '$' || line[first] == '*' || line[first] == '#')
+      continue;
+    line = line.substr(first);
+
+    if (line.find('-') != std::string::npos)
+    {
+      error = "Encrypted Action Replay codes must be decrypted first (line " + std::to_string(lineNumber) + ")";
+      return false;
+    }
+    const size_t space = line.find_first_of(" \t");
+    const size_t second = space == std::string::npos ? space : line.find_first_not_of(" \t", space);
+    const size_t secondEnd = second == std::string::npos ? second : line.find_first_of(" \t", second);
+    CodeLine code{0, 0, lineNumber};
+    if (second == std::string::npos || !parseHexWord(line.substr(0, space), code.address) ||
+        !parseHexWord(line.substr(second, secondEnd == std::string::npos ? std::string::npos : secondEnd - second),
+                      code.value) ||
+        (secondEnd != std::string::npos && line.find_first_not_of(" \t", secondEnd) != std::string::npos))
+    {
+      error = "Expected two 8-digit hex words on line " + std::to_string(lineNumber);
+      return false;
+    }
+    if (lines.size() == MAX_CODE_LINES)
+    {
+      error = "Code is too long";
+      return false;
+    }
+    lines.push_back(code);
+  }
+  if (lines.empty())
+  {
+    error = "Code is empty";
+    return false;
+  }
+  return true;
+}
+
+void appendBigEndian(std::vector<u8>& data, u32 value, u8 size)
+{
+  for (int shift = (size - 1) * 8; shift >= 0; shift -= 8)
+    data.push_back(static_cast<u8>(value >> shift));
+}
+
+// A write of the same size-byte value count times back to back, stored as one run of bytes
+CheatInstruction fillWrite(CheatProgram& program, u32 address, u32 value, u8 size, u32 count)
+{
+  CheatInstruction instruction{CheatOp::write};
+  instruction.address = address;
+  instruction.size = size;
+  instruction.dataOffset = static_cast<u32>(program.data.size());
+  instruction.length = size * count;
+  for (u32 i = 0; i < count; ++i)
+    appendBigEndian(program.data, value, size);
+  return instruction;
+}
+
+std::string lineError(const char* message, const CodeLine& line)
+{
+  return std::string(message) + " on line " + std::to_string(line.line);
+}
+
+bool compileGecko(const std::vector<CodeLine>& lines, CheatProgram& program, std::string& error)
+{
+  for (size_t i = 0; i < lines.size(); ++i)
+  {
+    const CodeLine& line = lines[i];
+    const u8 type = static_cast<u8>(line.address >> 24);
+    if (type < 0x40)
+    {
+      const CheatAddressMode mode = (type & 0x10) ? CheatAddressMode::pointer : CheatAddressMode::base;
+      const u32 address = line.address & 0x01FFFFFF;
+      CheatInstruction instruction{CheatOp::write};
+      switch (type & 0xEE)
+      {
+      case 0x00:
+        instruction = fillWrite(program, address, line.value & 0xFF, 1, (line.value >> 16) + 1);
+        break;
+      case 0x02:
+        instruction = fillWrite(program, address, line.value & 0xFFFF, 2, (line.value >> 16) + 1);
+        break;
+      case 0x04:
+        instruction = fillWrite(program, address, line.value, 4, 1);
+        break;
+      case 0x06:
+      {
+        const u32 length = line.value;
+        const size_t dataLines = (static_cast<size_t>(length) + 7) / 8;
+        if (length == 0 || length > MAX_WRITE_SIZE || i + dataLines >= lines.size())
+        {
+          error = lineError("String write is empty, too long or missing its data", line);
+          return false;
+        }
+        instruction.address = address;
+        instruction.dataOffset = static_cast<u32>(program.data.size());
+        for (size_t d = 1; d <= dataLines; ++d)
+        {
+          appendBigEndian(program.data, lines[i + d].address, 4);
+          appendBigEndian(program.data, lines[i + d].value, 4);
+        }
+        program.data.resize(instruction.dataOffset + length);
+        instruction.length = length;
+        i += dataLines;
+        break;
+      }
+      case 0x08:
+      {
+        if (i + 1 >= lines.size())
+        {
+          error = lineError("Serial write is missing its second line", line);
+          return false;
+        }
+        const CodeLine& next = lines[++i];
+        const u32 sizeCode = next.address >> 28;
+        if (sizeCode > 2)
+        {
+          error = lineError("Serial write size must be 0, 1 or 2", next);
+          return false;
+        }
+        const u8 size = static_cast<u8>(1 << sizeCode);
+        const u32 mask = size == 4 ? 0xFFFFFFFF : (1u << (size * 8)) - 1;
+        instruction = fillWrite(program, address, line.value & mask, size, 1);
+        instruction.count = ((next.address >> 16) & 0xFFF) + 1;
+        instruction.stride = next.address & 0xFFFF;
+        instruction.increment = next.value;
+        break;
+      }
+      case 0x20:
+      case 0x22:
+      case 0x24:
+      case 0x26:
+      case 0x28:
+      case 0x2A:
+      case 0x2C:
+      case 0x2E:
+      {
+        static const CheatCompare compares[] = {CheatCompare::equal, CheatCompare::notEqual, CheatCompare::greater,
+                                                CheatCompare::less};
+        instruction.op = CheatOp::ifCompare;
+        instruction.compare = compares[((type & 0xEE) >> 1) & 3];
+        instruction.endIfFirst = address & 1;
+        instruction.address = address & ~1u;
+        if ((type & 0xEE) >= 0x28)
+        {
+          instruction.size = 2;
+          instruction.mask = line.value >> 16;
+          instruction.value = line.value & 0xFFFF;
+        }
+        else
+        {
+          instruction.value = line.value;
+        }
+        break;
+      }
+      default:
+        error = lineError("Unsupported Gecko code type", line);
+        return false;
+      }
+      instruction.addressMode = mode;
+      program.code.push_back(instruction);
+      continue;
+    }
+
+    CheatInstruction instruction{CheatOp::nop};
+    switch (type)
+    {
+    case 0x40:
+    case 0x42:
+    case 0x44:
+    case 0x48:
+    case 0x4A:
+    case 0x4C:
+    {
+      const u32 accumulate = (line.address >> 20) & 0xF;
+      const u32 relative = (line.address >> 16) & 0xF;
+      if ((line.address >> 12) & 0xF)
+      {
+        error = lineError("Gecko registers are not supported", line);
+        return false;
+      }
+      if (accumulate > 1 || relative > 2)
+      {
+        error = lineError("Invalid base address or pointer code", line);
+        return false;
+      }
+      static const CheatOp ops[] = {CheatOp::loadRegister, CheatOp::setRegister, CheatOp::storeRegister};
+      instruction.op = ops[((type & 0x07) >> 1)];
+      instruction.target = type >= 0x48 ? CheatRegister::pointer : CheatRegister::base;
+      instruction.accumulate = accumulate == 1;
+      instruction.addressMode = static_cast<CheatAddressMode>(relative);
+      instruction.address = line.value;
+      instruction.value = line.value;
+      break;
+    }
+    case 0xCE:
+    case 0xDE:
+      instruction.op = CheatOp::ifRange;
+      instruction.target = type == 0xDE ? CheatRegister::pointer : CheatRegister::base;
+      instruction.endIfFirst = line.address & 1;
+      instruction.value = line.value & 0xFFFF0000;
+      instruction.offset = line.value << 16;
+      break;
+    case 0xE0:
+      instruction.op = CheatOp::reset;
+      instruction.setsRegisters = true;
+      instruction.value = line.value & 0xFFFF0000;
+      instruction.offset = line.value << 16;
+      break;
+    case 0xE2:
+      instruction.op = CheatOp::endIf;
+      instruction.isElse = ((line.address >> 20) & 0xF) == 1;
+      instruction.count = line.address & 0xFF;
+      instruction.setsRegisters = true;
+      instruction.value = line.value & 0xFFFF0000;
+      instruction.offset = line.value << 16;
+      break;
+    case 0xF0:
+      instruction.op = CheatOp::stop;
+      break;
+    case 0xC0:
+    case 0xC2:
+    case 0xC6:
+    case 0xD0:
+    case 0xD2:
+      error = lineError("Gecko code type runs PowerPC code and needs the in-game code handler", line);
+      return false;
+    default:
+      error = lineError("Unsupported Gecko code type", line);
+      return false;
+    }
+    program.code.push_back(instruction);
+  }
+  return true;
+}
+
+bool compileActionReplay(const std::vector<CodeLine>& lines, CheatProgram& program, std::string& error)
+{
+  for (const CodeLine& line : lines)
+  {
+    CheatInstruction instruction{CheatOp::nop};
+    if (line.address == 0)
+    {
+      switch (line.value >> 29)
+      {
+      case 0:
+        instruction.op = CheatOp::stop;
+        break;
+      case 2:
+        instruction.op = CheatOp::reset;
+        break;
+      default:
+        error = lineError("Unsupported Action Replay zero code", line);
+        return false;
+      }
+      program.code.push_back(instruction);
+      continue;
+    }
+
+    const u32 size = (line.address >> 25) & 3;
+    const u32 type = (line.address >> 27) & 7;
+    const u32 subtype = (line.address >> 30) & 3;
+    const u32 address = (line.address & 0x01FFFFFF) | 0x80000000;
+    const u8 bytes = static_cast<u8>(size == 3 ? 4 : 1 << size);
+    // Byte and halfword codes keep the value in the low bits and a count or offset above it
+    const u32 value = size == 0 ? line.value & 0xFF : size == 1 ? line.value & 0xFFFF : line.value;
+    const u32 upper = size == 0 ? line.value >> 8 : size == 1 ? line.value >> 16 : 0;
+
+    if (type == 0)
+    {
+      switch (subtype)
+      {
+      case 0:
+        if ((upper + 1) * bytes > MAX_WRITE_SIZE)
+        {
+          error = lineError("Fill is too long", line);
+          return false;
+        }
+        instruction = fillWrite(program, address, value, bytes, upper + 1);
+        break;
+      case 1:
+        instruction.op = CheatOp::pointerWrite;
+        instruction.address = address;
+        instruction.size = bytes;
+        instruction.value = value;
+        instruction.offset = size == 1 ? upper * 2 : upper;
+        break;
+      case 2:
+        instruction.op = CheatOp::add;
+        instruction.address = address;
+        instruction.size = bytes;
+        instruction.isFloat = size == 3;
+        instruction.value = line.value;
+        break;
+      default:
+        // Master codes only matter to the Action Replay's own hook
+        break;
+      }
+      program.code.push_back(instruction);
+      continue;
+    }
+
+    static const CheatCompare compares[] = {CheatCompare::equal,      CheatCompare::equal,
+                                            CheatCompare::notEqual,   CheatCompare::lessSigned,
+                                            CheatCompare::greaterSigned, CheatCompare::less,
+                                            CheatCompare::greater,    CheatCompare::anyBits};
+    instruction.op = CheatOp::skipUnless;
+    instruction.compare = compares[type];
+    instruction.address = address;
+    instruction.size = bytes;
+    instruction.isFloat = size == 3;
+    instruction.value = size == 3 ? line.value : value;
+    instruction.count = subtype == 0 ? 1 : subtype == 1 ? 2 : 0;
+    instruction.untilEnd = subtype == 3;
+    program.code.push_back(instruction);
+  }
+  return true;
+}
+
+// Guest memory is big endian; the cache hands back the bytes as an integer already
+CheatResult readValue(TriggerReadCache& cache, u32 address, u8 size, u32& value)
+{
+  u64 raw;
+  switch (cache.lookup(address, size, raw))
+  {
+  case TriggerReadCache::Lookup::miss:
+    cache.request(address, size);
+    return CheatResult::incomplete;
+  case TriggerReadCache::Lookup::failed:
+    return CheatResult::failed;
+  default:
+    value = static_cast<u32>(raw);
+    return CheatResult::done;
+  }
+}
+
+float toFloat(u32 bits)
+{
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+s32 signExtend(u32 value, u8 size)
+{
+  const int shift = 32 - size * 8;
+  return static_cast<s32>(value << shift) >> shift;
+}
+
+bool compareValues(const CheatInstruction& instruction, u32 current)
+{
+  const u32 value = instruction.value;
+  if (instruction.isFloat && instruction.compare != CheatCompare::anyBits)
+  {
+    const float a = toFloat(current), b = toFloat(value);
+    switch (instruction.compare)
+    {
+    case CheatCompare::equal:
+      return a == b;
+    case CheatCompare::notEqual:
+      return a != b;
+    case CheatCompare::greater:
+    case CheatCompare::greaterSigned:
+      return a > b;
+    default:
+      return a < b;
+    }
+  }
+
+  switch (instruction.compare)
+  {
+  case CheatCompare::equal:
+    return current == value;
+  case CheatCompare::notEqual:
+    return current != value;
+  case CheatCompare::greater:
+    return current > value;
+  case CheatCompare::less:
+    return current < value;
+  case CheatCompare::greaterSigned:
+    return signExtend(current, instruction.size) > signExtend(value, instruction.size);
+  case CheatCompare::lessSigned:
+    return signExtend(current, instruction.size) < signExtend(value, instruction.size);
+  default:
+    return (current & value) != 0;
+  }
+}
+
+void appendWrite(CheatFrame& frame, u32 address, const u8* bytes, u32 size)
+{
+  // The uncached mirrors of MEM1 and MEM2 are written through the cached addresses
+  if (address >= 0xC0000000 && address < 0xE0000000)
+    address -= 0x40000000;
+  frame.writes.push_back({address, size, static_cast<u32>(frame.data.size())});
+  frame.data.insert(frame.data.end(), bytes, bytes + size);
+}
+
+void appendValue(CheatFrame& frame, u32 address, u32 value, u8 size)
+{
+  u8 bytes[4];
+  for (u8 i = 0; i < size; ++i)
+    bytes[i] = static_cast<u8>(value >> ((size - 1 - i) * 8));
+  appendWrite(frame, address, bytes, size);
+}
+}  // namespace
+
+bool compileCheat(const std::string& source, CheatFormat format, CheatProgram& program, std::string& error)
+{
+  program = CheatProgram();
+  program.format = format;
+  std::vector<CodeLine> lines;
+  if (!parseLines(source, lines, error))
+    return false;
+  if (!(format == CheatFormat::gecko ? compileGecko(lines, program, error) :
+                                       compileActionReplay(lines, program, error)))
+    return false;
+
+  // Writes to fixed addresses only: evaluate once and reuse the result every frame. Gecko writes
+  // are relative to the base address, which stays at its default without register codes.
+  program.constant = std::all_of(program.code.begin(), program.code.end(), [](const CheatInstruction& instruction) {
+    return instruction.op == CheatOp::write || instruction.op == CheatOp::nop || instruction.op == CheatOp::stop;
+  });
+  return true;
+}
+
+CheatResult evaluateCheat(const CheatProgram& program, TriggerReadCache& cache, CheatFrame& frame, u32& writes)
+{
+  const size_t writeMark = frame.writes.size();
+  const size_t dataMark = frame.data.size();
+  auto abandon = [&](CheatResult result) {
+    frame.writes.resize(writeMark);
+    frame.data.resize(dataMark);
+    writes = 0;
+    return result;
+  };
+
+  u32 registers[2] = {DEFAULT_REGISTER, DEFAULT_REGISTER};
+  // Gecko blocks: one bit per open block, innermost lowest, set while it doesn't run
+  u32 blocks = 0;
+  // Action Replay skips
+  u32 skipLines = 0;
+  bool skipToReset = false;
+
+  auto resolve = [&](const CheatInstruction& instruction) {
+    switch (instruction.addressMode)
+    {
+    case CheatAddressMode::base:
+      return registers[0] + instruction.address;
+    case CheatAddressMode::pointer:
+      return registers[1] + instruction.address;
+    default:
+      return instruction.address;
+    }
+  };
+  auto setRegisters = [&](const CheatInstruction& instruction) {
+    if (instruction.value != 0)
+      registers[0] = instruction.value;
+    if (instruction.offset != 0)
+      registers[1] = instruction.offset;
+  };
+
+  for (const CheatInstruction& instruction : program.code)
+  {
+    if (skipLines > 0)
+    {
+      --skipLines;
+      continue;
+    }
+    if (skipToReset)
+    {
+      skipToReset = instruction.op != CheatOp::reset;
+      continue;
+    }
+
+    switch (instruction.op)
+    {
+    case CheatOp::ifCompare:
+    case CheatOp::ifRange:
+    {
+      if (instruction.endIfFirst)
+        blocks >>= 1;
+      if (blocks != 0)
+      {
+        blocks = (blocks << 1) | 1;
+        continue;
+      }
+      bool pass;
+      if (instruction.op == CheatOp::ifRange)
+      {
+        const u32 value = registers[static_cast<int>(instruction.target)];
+        pass = value >= instruction.value && value < instruction.offset;
+      }
+      else
+      {
+        u32 current;
+        const CheatResult result = readValue(cache, resolve(instruction), instruction.size, current);
+        if (result != CheatResult::done)
+          return abandon(result);
+        pass = compareValues(instruction, current & ~instruction.mask);
+      }
+      blocks = (blocks << 1) | (pass ? 0 : 1);
+      continue;
+    }
+    case CheatOp::endIf:
+      blocks >>= std::min<u32>(instruction.count, 31);
+      if (instruction.isElse)
+        blocks ^= 1;
+      if (blocks == 0)
+        setRegisters(instruction);
+      continue;
+    case CheatOp::reset:
+      blocks = 0;
+      if (instruction.setsRegisters)
+        setRegisters(instruction);
+      continue;
+    default:
+      break;
+    }
+    if (blocks != 0)
+      continue;
+
+    switch (instruction.op)
+    {
+    case CheatOp::write:
+    {
+      const u8* bytes = program.data.data() + instruction.dataOffset;
+      u32 address = resolve(instruction);
+      if (instruction.count == 1)
+      {
+        appendWrite(frame, address, bytes, instruction.length);
+        break;
+      }
+      // Serial write: value and address step together
+      u32 value = 0;
+      for (u8 i = 0; i < instruction.size; ++i)
+        value = (value << 8) | bytes[i];
+      for (u32 i = 0; i < instruction.count; ++i)
+      {
+        appendValue(frame, address, value, instruction.size);
+        address += instruction.stride;
+        value += instruction.increment;
+      }
+      break;
+    }
+    case CheatOp::add:
+    {
+      u32 current;
+      const u32 address = resolve(instruction);
+      const CheatResult result = readValue(cache, address, instruction.size, current);
+      if (result != CheatResult::done)
+        return abandon(result);
+      u32 sum = current + instruction.value;
+      if (instruction.isFloat)
+      {
+        const float value = toFloat(current) + static_cast<float>(instruction.value);
+        std::memcpy(&sum, &value, sizeof(sum));
+      }
+      appendValue(frame, address, sum, instruction.size);
+      break;
+    }
+    case CheatOp::pointerWrite:
+    {
+      u32 pointer;
+      const CheatResult result = readValue(cache, resolve(instruction), 4, pointer);
+      if (result != CheatResult::done)
+        return abandon(result);
+      appendValue(frame, pointer + instruction.offset, instruction.value, instruction.size);
+      break;
+    }
+    case CheatOp::skipUnless:
+    {
+      u32 current;
+      const CheatResult result = readValue(cache, resolve(instruction), instruction.size, current);
+      if (result != CheatResult::done)
+        return abandon(result);
+      if (compareValues(instruction, current))
+        break;
+      if (instruction.untilEnd)
+      {
+        writes = static_cast<u32>(frame.writes.size() - writeMark);
+        return CheatResult::done;
+      }
+      skipLines = instruction.count;
+      skipToReset = instruction.count == 0;
+      break;
+    }
+    case CheatOp::loadRegister:
+    {
+      u32 value;
+      const CheatResult result = readValue(cache, resolve(instruction), 4, value);
+      if (result != CheatResult::done)
+        return abandon(result);
+      u32& target = registers[static_cast<int>(instruction.target)];
+      target = instruction.accumulate ? target + value : value;
+      break;
+    }
+    case CheatOp::setRegister:
+    {
+      u32& target = registers[static_cast<int>(instruction.target)];
+      const u32 value = resolve(instruction);
+      target = instruction.accumulate ? target + value : value;
+      break;
+    }
+    case CheatOp::storeRegister:
+      appendValue(frame, resolve(instruction), registers[static_cast<int>(instruction.target)], 4);
+      break;
+    case CheatOp::stop:
+      writes = static_cast<u32>(frame.writes.size() - writeMark);
+      return CheatResult::done;
+    default:
+      break;
+    }
+  }
+
+  writes = static_cast<u32>(frame.writes.size() - writeMark);
+  return CheatResult::done;
+}
+
+void mergeCheatWrites(const CheatFrame& frame, std::vector<CheatSpan>& spans, std::vector<u8>& data)
+{
+  spans.clear();
+  data.clear();
+  const size_t count = frame.writes.size();
+  if (count == 0)
+    return;
+
+  std::vector<u32> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](u32 a, u32 b) { return frame.writes[a].address < frame.writes[b].address; });
+
+  u64 spanEnd = 0;
+  for (u32 index : order)
+  {
+    const CheatWrite& write = frame.writes[index];
+    const u64 end = static_cast<u64>(write.address) + write.size;
+    if (!spans.empty() && write.address <= spanEnd)
+    {
+      spanEnd = std::max(spanEnd, end);
+      spans.back().size = static_cast<u32>(spanEnd - spans.back().address);
+      continue;
+    }
+    spans.push_back({write.address, write.size, 0});
+    spanEnd = end;
+  }
+
+  u32 size = 0;
+  for (CheatSpan& span : spans)
+  {
+    span.dataOffset = size;
+    size += span.size;
+  }
+  data.resize(size);
+
+  // In frame order, so where writes overlap the later one wins
+  for (const CheatWrite& write : frame.writes)
+  {
+    auto span = std::upper_bound(spans.begin(), spans.end(), write.address,
+                                 [](u32 address, const CheatSpan& span) { return address < span.address; }) -
+                1;
+    std::memcpy(data.data() + span->dataOffset + (write.address - span->address),
+                frame.data.data() + write.dataOffset, write.size);
+  }
+}
+}  // namespace DolphinComm
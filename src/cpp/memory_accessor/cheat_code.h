@@ -0,0 +1,174 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+#include "trigger_program.h"
+
+// Action Replay and Gecko cheat codes compiled for a native per-frame loop. Codes are the usual
+// lines of two hex words ("04123456 00000063"); Action Replay codes must be decrypted (the form
+// Dolphin shows and saves), the encrypted XXXX-XXXX-XXXXX form is rejected.
+//
+// Gecko: 00/02/04 write and fill, 06 string write, 08 serial write, 20-2E 32/16-bit conditionals
+// (with the endif-first address bit), 40/42/44 and 48/4A/4C base address and pointer loads, sets
+// and stores (no Gecko registers), CE/DE base address and pointer range checks, E0 full
+// terminator, E2 endif/else, F0 end of codes. Types 00-3E are relative to the pointer instead of
+// the base address when bit 0x10 of the type is set.
+// Action Replay: RAM write and fill, write to pointer, add, the conditionals (equal through AND,
+// skipping one line, two lines, until 00000000 40000000, or all lines) and the end-of-codes and
+// normal-execution zero codes.
+//
+// Codes read memory as it is at the start of a frame; their writes are collected and go out
+// together at the end, so a code doesn't see what an earlier one wrote in the same frame.
+namespace DolphinComm
+{
+enum class CheatFormat : u8
+{
+  gecko,
+  actionReplay
+};
+
+enum class CheatOp : u8
+{
+  // data[dataOffset, +length) to the address; with count > 1 a serial write of the size-byte
+  // value, count times, stride bytes apart, adding increment each time
+  write,
+  // Adds value to the size-byte integer (or float with isFloat) at the address
+  add,
+  // Reads a pointer at the address and writes size bytes of value at pointer + offset
+  pointerWrite,
+  // Opens a block that runs only if the size-byte value at the address, with the bits in mask
+  // cleared, compares true with value
+  ifCompare,
+  // Opens a block that runs only if the target register is in [value, offset)
+  ifRange,
+  // Closes count blocks, then optionally flips the innermost one (isElse); see setsRegisters
+  endIf,
+  // Closes every block; see setsRegisters
+  reset,
+  // Action Replay conditional: when false, skips the next count instructions, or (count 0)
+  // everything up to the next reset, or (untilEnd) the rest of the code
+  skipUnless,
+  // Base address or pointer register from memory, a value, or into memory
+  loadRegister,
+  setRegister,
+  storeRegister,
+  // End of codes: nothing after it runs
+  stop,
+  // Lines that do nothing here (Action Replay master codes); kept so line skips stay aligned
+  nop
+};
+
+enum class CheatCompare : u8
+{
+  equal,
+  notEqual,
+  greater,
+  less,
+  greaterSigned,
+  lessSigned,
+  // (value & operand) != 0
+  anyBits
+};
+
+enum class CheatRegister : u8
+{
+  base,
+  pointer
+};
+
+// The register an address is relative to; absolute addresses are used as they are
+enum class CheatAddressMode : u8
+{
+  absolute,
+  base,
+  pointer
+};
+
+struct CheatInstruction
+{
+  CheatOp op;
+  CheatAddressMode addressMode = CheatAddressMode::absolute;
+  CheatCompare compare = CheatCompare::equal;
+  CheatRegister target = CheatRegister::base;
+  u8 size = 4;
+  bool isFloat = false;
+  // endIf: flip the innermost block afterwards. ifCompare: close one block first.
+  bool isElse = false;
+  bool endIfFirst = false;
+  // Register ops: add to the register instead of replacing it
+  bool accumulate = false;
+  // endIf and reset: base = value and pointer = offset, each only if non-zero
+  bool setsRegisters = false;
+  // skipUnless: skip the rest of the code
+  bool untilEnd = false;
+  u32 address = 0;
+  u32 value = 0;
+  u32 mask = 0;
+  u32 offset = 0;
+  u32 count = 1;
+  u32 length = 0;
+  u32 stride = 0;
+  u32 increment = 0;
+  u32 dataOffset = 0;
+};
+
+struct CheatProgram
+{
+  CheatFormat format = CheatFormat::gecko;
+  std::vector<CheatInstruction> code;
+  // Bytes of the write instructions, big endian
+  std::vector<u8> data;
+  // No conditions, loads or relative addresses: the same writes every frame
+  bool constant = false;
+};
+
+// False with the offending line (1-based) in the message if the code doesn't compile
+bool compileCheat(const std::string& source, CheatFormat format, CheatProgram& program, std::string& error);
+
+// Writes collected over a frame; bytes of write i are data[writes[i].dataOffset, +size)
+struct CheatWrite
+{
+  u32 address;
+  u32 size;
+  u32 dataOffset;
+};
+
+struct CheatFrame
+{
+  std::vector<CheatWrite> writes;
+  std::vector<u8> data;
+
+  void clear()
+  {
+    writes.clear();
+    data.clear();
+  }
+};
+
+enum class CheatResult
+{
+  done,
+  // A value wasn't in the cache yet; fetch and evaluate again. Nothing was added to the frame.
+  incomplete,
+  // A load hit unmapped or unreadable memory; nothing was added to the frame
+  failed
+};
+
+// Appends the code's writes for this frame; writes is how many it added
+CheatResult evaluateCheat(const CheatProgram& program, TriggerReadCache& cache, CheatFrame& frame, u32& writes);
+
+// One contiguous run of bytes to write, merged from a frame's writes
+struct CheatSpan
+{
+  u32 address;
+  u32 size;
+  u32 dataOffset;
+};
+
+// Merges the frame's writes into non-overlapping spans of address order (later writes win where
+// writes overlap, adjacent ones are joined) with their bytes in data
+void mergeCheatWrites(const CheatFrame& frame, std::vector<CheatSpan>& spans, std::vector<u8>& data);
+}  // namespace DolphinComm
@@ -0,0 +1,347 @@
+#include "cheat_engine.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "memory_accessor.h"
+#include "memory_layout.h"
+#include "napi_utils.h"
+
+namespace {
+constexpr u32 kDefaultRateHz = 60;
+constexpr u32 kMaxRateHz = 1000;
+// Read batches per frame; also bounds how many pointer hops a code can follow
+constexpr int kMaxRounds = 8;
+
+u64 nanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+Napi::FunctionReference CheatEngine::constructor;
+
+Napi::Object CheatEngine::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "CheatEngine", {
+    InstanceMethod("add", &CheatEngine::Add),
+    InstanceMethod("remove", &CheatEngine::Remove),
+    InstanceMethod("setEnabled", &CheatEngine::SetEnabled),
+    InstanceMethod("apply", &CheatEngine::Apply),
+    InstanceMethod("start", &CheatEngine::Start),
+    InstanceMethod("stop", &CheatEngine::Stop),
+    InstanceMethod("getStats", &CheatEngine::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("CheatEngine", func);
+  return exports;
+}
+
+// new CheatEngine(accessor, { rateHz? })
+CheatEngine::CheatEngine(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<CheatEngine>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "MemoryAccessor argument expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  u32 rateHz = kDefaultRateHz;
+  if (info.Length() >= 2 && info[1].IsObject())
+    rateHz = NapiUtils::getU32Or(info[1].As<Napi::Object>(), "rateHz", kDefaultRateHz);
+  if (rateHz == 0 || rateHz > kMaxRateHz) {
+    Napi::RangeError::New(env, "CheatEngine: rateHz must be between 1 and 1000").ThrowAsJavaScriptException();
+    return;
+  }
+  m_periodMicros = 1000000 / rateHz;
+}
+
+CheatEngine::~CheatEngine() {
+  stopThread();
+}
+
+CheatEngine::FrameResult CheatEngine::frame() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto start = std::chrono::steady_clock::now();
+  m_cache.clear();
+  m_pending.clear();
+  for (size_t i = 0; i < m_codes.size(); i++) {
+    Code& code = m_codes[i];
+    if (!code.enabled)
+      continue;
+    code.lastNanos = 0;
+    if (code.program.constant && code.evaluated) {
+      code.hits += code.frame.writes.empty() ? 0 : 1;
+      code.writes += code.frame.writes.size();
+      continue;
+    }
+    code.frame.clear();
+    m_pending.push_back(i);
+  }
+
+  for (int round = 0; round < kMaxRounds && !m_pending.empty(); round++) {
+    if (m_cache.hasMisses()) {
+      m_reads += m_cache.fetch(*m_process);
+      m_batches++;
+    }
+
+    m_next.clear();
+    for (size_t index : m_pending) {
+      Code& code = m_codes[index];
+      auto evaluateStart = std::chrono::steady_clock::now();
+      u32 writes = 0;
+      DolphinComm::CheatResult result = DolphinComm::evaluateCheat(code.program, m_cache, code.frame, writes);
+      code.lastNanos += nanosSince(evaluateStart);
+      if (result == DolphinComm::CheatResult::incomplete) {
+        m_next.push_back(index);
+        continue;
+      }
+      code.totalNanos += code.lastNanos;
+      if (result == DolphinComm::CheatResult::failed) {
+        code.failures++;
+        continue;
+      }
+      code.evaluated = true;
+      code.hits += writes == 0 ? 0 : 1;
+      code.writes += writes;
+    }
+    m_pending.swap(m_next);
+  }
+  // Still waiting on reads after the last round: more pointer hops than the engine follows
+  for (size_t index : m_pending) {
+    m_codes[index].failures++;
+    m_codes[index].totalNanos += m_codes[index].lastNanos;
+    m_codes[index].frame.clear();
+  }
+
+  // Codes in list order, so a later code's write to the same bytes wins
+  m_frame.clear();
+  for (const Code& code : m_codes) {
+    if (!code.enabled)
+      continue;
+    const u32 base = static_cast<u32>(m_frame.data.size());
+    for (const DolphinComm::CheatWrite& write : code.frame.writes)
+      m_frame.writes.push_back({write.address, write.size, base + write.dataOffset});
+    m_frame.data.insert(m_frame.data.end(), code.frame.data.begin(), code.frame.data.end());
+  }
+  DolphinComm::mergeCheatWrites(m_frame, m_spans, m_data);
+
+  // First and last byte of each span; a span that leaves guest RAM or runs from MEM1 into MEM2
+  // isn't written at all
+  m_addresses.clear();
+  for (const DolphinComm::CheatSpan& span : m_spans) {
+    m_addresses.push_back(span.address);
+    m_addresses.push_back(span.address + span.size - 1);
+  }
+  m_offsets.resize(m_addresses.size());
+  Common::dolphinAddrsToOffsets(m_addresses.data(), m_offsets.data(), m_addresses.size());
+
+  FrameResult result{0, 0, 0};
+  m_requests.clear();
+  for (size_t i = 0; i < m_spans.size(); i++) {
+    const u32 first = m_offsets[i * 2];
+    const u32 last = m_offsets[i * 2 + 1];
+    if (first == Common::INVALID_OFFSET || last == Common::INVALID_OFFSET || last - first != m_spans[i].size - 1) {
+      result.failedWrites++;
+      continue;
+    }
+    m_requests.push_back({first, m_spans[i].size, reinterpret_cast<char*>(m_data.data() + m_spans[i].dataOffset),
+                          false});
+  }
+  if (!m_requests.empty()) {
+    result.writes = static_cast<u32>(m_process->writeBatch(m_requests.data(), m_requests.size()));
+    result.failedWrites += static_cast<u32>(m_requests.size()) - result.writes;
+    m_batches++;
+  }
+
+  m_frames++;
+  m_writes += result.writes;
+  m_failedWrites += result.failedWrites;
+  result.nanos = nanosSince(start);
+  m_lastFrameNanos = result.nanos;
+  m_maxFrameNanos = std::max(m_maxFrameNanos, m_lastFrameNanos);
+  return result;
+}
+
+void CheatEngine::run() {
+  auto next = std::chrono::steady_clock::now();
+  while (m_running) {
+    frame();
+
+    next += std::chrono::microseconds(m_periodMicros);
+    // Don't try to catch up on frames missed while the machine was busy
+    next = std::max(next, std::chrono::steady_clock::now());
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void CheatEngine::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+// add(code, { format?: 'gecko' | 'actionReplay', name?, enabled? }) => id
+// Throws with the line of the problem if the code doesn't compile
+Napi::Value CheatEngine::Add(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Code string expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Code code{0, {}, {}, true, {}, false, 0, 0, 0, 0, 0};
+  DolphinComm::CheatFormat format = DolphinComm::CheatFormat::gecko;
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    Napi::Value formatValue = options.Get("format");
+    if (formatValue.IsString()) {
+      const std::string name = formatValue.As<Napi::String>().Utf8Value();
+      if (name != "gecko" && name != "actionReplay") {
+        Napi::TypeError::New(env, "CheatEngine: format must be 'gecko' or 'actionReplay'").ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      if (name == "actionReplay")
+        format = DolphinComm::CheatFormat::actionReplay;
+    }
+    Napi::Value name = options.Get("name");
+    if (name.IsString())
+      code.name = name.As<Napi::String>().Utf8Value();
+    Napi::Value enabled = options.Get("enabled");
+    code.enabled = !enabled.IsBoolean() || enabled.As<Napi::Boolean>().Value();
+  }
+
+  std::string error;
+  if (!DolphinComm::compileCheat(info[0].As<Napi::String>().Utf8Value(), format, code.program, error)) {
+    Napi::Error::New(env, "CheatEngine: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  code.id = m_nextId++;
+  m_codes.push_back(std::move(code));
+  return Napi::Number::New(env, m_codes.back().id);
+}
+
+// remove(id) => false if there was no such code
+Napi::Value CheatEngine::Remove(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "Code id expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const u32 id = info[0].As<Napi::Number>().Uint32Value();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_codes.begin(), m_codes.end(), [id](const Code& code) { return code.id == id; });
+  if (it == m_codes.end())
+    return Napi::Boolean::New(env, false);
+  m_codes.erase(it);
+  return Napi::Boolean::New(env, true);
+}
+
+// setEnabled(id, enabled) => false if there was no such code
+Napi::Value CheatEngine::SetEnabled(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean()) {
+    Napi::TypeError::New(env, "Code id and enabled flag expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const u32 id = info[0].As<Napi::Number>().Uint32Value();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_codes.begin(), m_codes.end(), [id](const Code& code) { return code.id == id; });
+  if (it == m_codes.end())
+    return Napi::Boolean::New(env, false);
+  it->enabled = info[1].As<Napi::Boolean>().Value();
+  return Napi::Boolean::New(env, true);
+}
+
+// apply() => { writes, failedWrites, micros }
+// Applies one frame on the calling thread; writes counts merged spans, not code lines
+Napi::Value CheatEngine::Apply(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  const FrameResult result = frame();
+  Napi::Object applied = Napi::Object::New(env);
+  applied.Set("writes", Napi::Number::New(env, result.writes));
+  applied.Set("failedWrites", Napi::Number::New(env, result.failedWrites));
+  applied.Set("micros", Napi::Number::New(env, result.nanos / 1000.0));
+  return applied;
+}
+
+Napi::Value CheatEngine::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  m_running = true;
+  m_thread = std::thread(&CheatEngine::run, this);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value CheatEngine::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+// getStats() => { frames, batches, reads, writes, failedWrites, lastFrameMicros, maxFrameMicros,
+// running, codes: [{ id, name, enabled, hits, writes, failures, lastMicros, totalMicros }] }
+// A code's hits are the frames it wrote anything in; its time is spent evaluating, not reading
+Napi::Value CheatEngine::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Array codes = Napi::Array::New(env, m_codes.size());
+  for (uint32_t i = 0; i < m_codes.size(); i++) {
+    const Code& code = m_codes[i];
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("id", Napi::Number::New(env, code.id));
+    entry.Set("name", Napi::String::New(env, code.name));
+    entry.Set("enabled", Napi::Boolean::New(env, code.enabled));
+    entry.Set("hits", Napi::Number::New(env, static_cast<double>(code.hits)));
+    entry.Set("writes", Napi::Number::New(env, static_cast<double>(code.writes)));
+    entry.Set("failures", Napi::Number::New(env, static_cast<double>(code.failures)));
+    entry.Set("lastMicros", Napi::Number::New(env, code.lastNanos / 1000.0));
+    entry.Set("totalMicros", Napi::Number::New(env, code.totalNanos / 1000.0));
+    codes.Set(i, entry);
+  }
+
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("frames", Napi::Number::New(env, static_cast<double>(m_frames)));
+  stats.Set("batches", Napi::Number::New(env, static_cast<double>(m_batches)));
+  stats.Set("reads", Napi::Number::New(env, static_cast<double>(m_reads)));
+  stats.Set("writes", Napi::Number::New(env, static_cast<double>(m_writes)));
+  stats.Set("failedWrites", Napi::Number::New(env, static_cast<double>(m_failedWrites)));
+  stats.Set("lastFrameMicros", Napi::Number::New(env, m_lastFrameNanos / 1000.0));
+  stats.Set("maxFrameMicros", Napi::Number::New(env, m_maxFrameNanos / 1000.0));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  stats.Set("codes", codes);
+  return stats;
+}
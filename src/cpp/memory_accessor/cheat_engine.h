@@ -0,0 +1,89 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cheat_code.h"
+#include "dolphin_process.h"
+
+// Applies Action Replay and Gecko codes (see cheat_code.h for the supported types) natively. Codes
+// compile once to instructions; each frame every enabled code runs against reads shared the way
+// TriggerEngine shares them, and all their writes go out merged as one batch. After start() a
+// background thread applies a frame at a fixed rate without calling into JS.
+class CheatEngine : public Napi::ObjectWrap<CheatEngine> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  CheatEngine(const Napi::CallbackInfo& info);
+  ~CheatEngine();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  struct Code {
+    u32 id;
+    std::string name;
+    DolphinComm::CheatProgram program;
+    bool enabled;
+    // This frame's writes; kept across frames for constant codes, which evaluate only once
+    DolphinComm::CheatFrame frame;
+    bool evaluated;
+    u64 hits;
+    u64 writes;
+    u64 failures;
+    u64 lastNanos;
+    u64 totalNanos;
+  };
+  struct FrameResult {
+    u32 writes;
+    u32 failedWrites;
+    u64 nanos;
+  };
+
+  FrameResult frame();
+  void run();
+  void stopThread();
+
+  Napi::Value Add(const Napi::CallbackInfo& info);
+  Napi::Value Remove(const Napi::CallbackInfo& info);
+  Napi::Value SetEnabled(const Napi::CallbackInfo& info);
+  Napi::Value Apply(const Napi::CallbackInfo& info);
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  u32 m_periodMicros = 0;
+
+  std::mutex m_mutex;
+  std::vector<Code> m_codes;
+  u32 m_nextId = 1;
+  DolphinComm::TriggerReadCache m_cache;
+  std::vector<size_t> m_pending;
+  std::vector<size_t> m_next;
+  // Reused between frames so applying codes doesn't allocate
+  DolphinComm::CheatFrame m_frame;
+  std::vector<DolphinComm::CheatSpan> m_spans;
+  std::vector<u8> m_data;
+  std::vector<u32> m_addresses;
+  std::vector<u32> m_offsets;
+  std::vector<DolphinComm::WriteRequest> m_requests;
+
+  u64 m_frames = 0;
+  u64 m_batches = 0;
+  u64 m_reads = 0;
+  u64 m_writes = 0;
+  u64 m_failedWrites = 0;
+  u64 m_lastFrameNanos = 0;
+  u64 m_maxFrameNanos = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+};
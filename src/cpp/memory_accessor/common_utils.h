@@ -12,6 +12,7 @@
 
 #include "common_types.h"
 #include "memory_common.h"
+#include "memory_layout.h"
 
 namespace Common
 {
@@ -28,107 +29,26 @@ inline u64 bSwap64(u64 data)
   return bswap_64(data);
 }
 
-constexpr u32 NextPowerOf2(u32 value)
-{
-  --value;
-  value |= value >> 1;
-  value |= value >> 2;
-  value |= value >> 4;
-  value |= value >> 8;
-  value |= value >> 16;
-  ++value;
-
-  return value;
-};
-
+// The layout-specialized translations of memory_layout.h for the current layout. Loops should
+// call withAddressTranslator once around the loop instead.
 inline u32 dolphinAddrToOffset(u32 addr, bool considerAram)
 {
-  // ARAM address
-  if (addr >= ARAM_START && addr < ARAM_END)
-  {
-    addr -= ARAM_START;
-  }
-  // MEM1 address
-  else if (addr >= MEM1_START && addr < GetMEM1End())
-  {
-    addr -= MEM1_START;
-    if (considerAram)
-      addr += ARAM_FAKESIZE;
-  }
-  // MEM2 address
-  else if (addr >= MEM2_START && addr < GetMEM2End())
-  {
-    addr -= MEM2_START;
-    addr += (MEM2_START - MEM1_START);
-  }
-  return addr;
+  return withAddressTranslator([&](auto translator) { return translator.toOffset(addr, considerAram); });
 }
 
 inline u32 offsetToDolphinAddr(u32 offset, bool considerAram)
 {
-  if (considerAram)
-  {
-    if (offset < ARAM_SIZE)
-    {
-      offset += ARAM_START;
-    }
-    else if (offset >= ARAM_FAKESIZE && offset < ARAM_FAKESIZE + GetMEM1SizeReal())
-    {
-      offset += MEM1_START;
-      offset -= ARAM_FAKESIZE;
-    }
-  }
-  else
-  {
-    if (offset < GetMEM1SizeReal())
-    {
-      offset += MEM1_START;
-    }
-    else if (offset >= MEM2_START - MEM1_START &&
-             offset < MEM2_START - MEM1_START + GetMEM2SizeReal())
-    {
-      offset += MEM2_START;
-      offset -= (MEM2_START - MEM1_START);
-    }
-  }
-  return offset;
+  return withAddressTranslator([&](auto translator) { return translator.toAddress(offset, considerAram); });
 }
 
 inline u32 offsetToCacheIndex(u32 offset, bool considerAram)
 {
-  if (considerAram)
-  {
-    if (offset >= ARAM_FAKESIZE && offset < GetMEM1SizeReal() + ARAM_FAKESIZE)
-    {
-      offset -= (ARAM_FAKESIZE - ARAM_SIZE);
-    }
-  }
-  else
-  {
-    if (offset >= MEM2_START - MEM1_START && offset < MEM2_START - MEM1_START + GetMEM2SizeReal())
-    {
-      offset -= (MEM2_START - GetMEM1End());
-    }
-  }
-  return offset;
+  return withAddressTranslator([&](auto translator) { return translator.toCacheIndex(offset, considerAram); });
 }
 
 inline u32 cacheIndexToOffset(u32 cacheIndex, bool considerAram)
 {
-  if (considerAram)
-  {
-    if (cacheIndex >= ARAM_SIZE && cacheIndex < GetMEM1SizeReal() + ARAM_SIZE)
-    {
-      cacheIndex += (ARAM_FAKESIZE - ARAM_SIZE);
-    }
-  }
-  else
-  {
-    if (cacheIndex >= GetMEM1SizeReal() && cacheIndex < GetMEM1SizeReal() + GetMEM2SizeReal())
-    {
-      cacheIndex += (MEM2_START - GetMEM1End());
-    }
-  }
-  return cacheIndex;
+  return withAddressTranslator(
+      [&](auto translator) { return translator.cacheIndexToOffset(cacheIndex, considerAram); });
 }
 }  // namespace Common
@@ -0,0 +1,293 @@
+#include "dolphin_process.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+#include "memory_common.h"
+
+#ifdef __APPLE__
+#include "mac_dolphin_process.h"
+#elif defined(__linux__)
+#include "linux_dolphin_process.h"
+#endif
+
+namespace DolphinComm {
+  std::unique_ptr<IDolphinProcess> IDolphinProcess::create() {
+#ifdef __APPLE__
+    return std::make_unique<MacDolphinProcess>();
+#elif defined(__linux__)
+    return std::make_unique<LinuxDolphinProcess>();
+#else
+    return nullptr;
+#endif
+  }
+
+  bool IDolphinProcess::findPID() {
+    std::unique_lock<std::shared_mutex> lock(m_hookMutex);
+    Common::UpdateMemoryValues();
+    // Dolphin may have restarted since the last hook; obtainEmuRAMInformation() starts from scratch
+    resetEmuRAMInformation();
+
+    std::vector<int> pids = findPIDs();
+    if (pids.empty()) {
+      m_PID = -1;
+      return false;
+    }
+
+    if (pids.size() > 1)
+      std::cerr << "## Found " << pids.size() << " Dolphin processes, using PID " << pids.front() << "\n";
+    m_PID = pids.front();
+    return true;
+  }
+
+  bool IDolphinProcess::hookPID(int pid) {
+    std::unique_lock<std::shared_mutex> lock(m_hookMutex);
+    Common::UpdateMemoryValues();
+
+    m_PID = pid;
+    resetEmuRAMInformation();
+    return obtainEmuRAMInformation();
+  }
+
+  void IDolphinProcess::resetEmuRAMInformation() {
+    m_emuRAMAddressStart = 0;
+    m_emuARAMAdressStart = 0;
+    m_MEM2AddressStart = 0;
+    m_ARAMAccessible = false;
+    m_MEM2Present = false;
+  }
+
+  bool IDolphinProcess::offsetToHost(u32 offset, size_t size, u64& hostAddress) const {
+    if (!hasEmuRAMInformation())
+      return false;
+    // Anything outside MEM1 and MEM2 would be some other part of Dolphin's address space
+    const u64 end = static_cast<u64>(offset) + size;
+    const u32 mem2Offset = Common::MEM2_START - Common::MEM1_START;
+    if (end <= Common::GetMEM1SizeReal()) {
+      hostAddress = m_emuRAMAddressStart + offset;
+      return true;
+    }
+    if (offset >= mem2Offset && end <= static_cast<u64>(mem2Offset) + Common::GetMEM2SizeReal() && m_MEM2Present) {
+      hostAddress = m_MEM2AddressStart + (offset - mem2Offset);
+      return true;
+    }
+    return false;
+  }
+
+  bool IDolphinProcess::readFromRAM(u32 offset, char* buffer, size_t size) {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    u64 RAMAddress;
+    if (!offsetToHost(offset, size, RAMAddress))
+      return false;
+    return readAtOffset(RAMAddress, 0, buffer, size);
+  }
+
+  size_t IDolphinProcess::readBatch(ReadRequest* requests, size_t count) {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    std::vector<HostRead> reads;
+    std::vector<size_t> indices;
+    reads.reserve(count);
+    indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      u64 hostAddress;
+      requests[i].ok = false;
+      if (!offsetToHost(requests[i].offset, requests[i].size, hostAddress))
+        continue;
+      reads.push_back({hostAddress, requests[i].size, requests[i].buffer, false});
+      indices.push_back(i);
+    }
+
+    size_t succeeded = readHostBatch(reads.data(), reads.size());
+    for (size_t i = 0; i < reads.size(); i++)
+      requests[indices[i]].ok = reads[i].ok;
+    return succeeded;
+  }
+
+  size_t IDolphinProcess::writeBatch(WriteRequest* requests, size_t count) {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    std::vector<HostWrite> writes;
+    std::vector<size_t> indices;
+    writes.reserve(count);
+    indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      u64 hostAddress;
+      requests[i].ok = false;
+      if (!offsetToHost(requests[i].offset, requests[i].size, hostAddress))
+        continue;
+      writes.push_back({hostAddress, requests[i].size, requests[i].buffer, false});
+      indices.push_back(i);
+    }
+
+    size_t succeeded = writeHostBatch(writes.data(), writes.size());
+    for (size_t i = 0; i < writes.size(); i++)
+      requests[indices[i]].ok = writes[i].ok;
+    return succeeded;
+  }
+
+  size_t IDolphinProcess::writeHostBatch(HostWrite* writes, size_t count) {
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; i++) {
+      writes[i].ok = writeAtOffset(writes[i].address, 0, writes[i].buffer, writes[i].size);
+      succeeded += writes[i].ok;
+    }
+    return succeeded;
+  }
+
+  size_t IDolphinProcess::readHostBatch(HostRead* reads, size_t count) {
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; i++) {
+      reads[i].ok = readAtOffset(reads[i].address, 0, reads[i].buffer, reads[i].size);
+      succeeded += reads[i].ok;
+    }
+    return succeeded;
+  }
+
+  bool IDolphinProcess::guestToHost(u32 address, u64& hostAddress, u32& bytesToEnd) const {
+    // 0xC0000000 and 0xD0000000 are the uncached mirrors of MEM1 and MEM2
+    if (address >= 0xC0000000 && address < 0xE0000000)
+      address -= 0x40000000;
+
+    if (address >= Common::MEM1_START && address < Common::GetMEM1End() && hasEmuRAMInformation()) {
+      hostAddress = m_emuRAMAddressStart + (address - Common::MEM1_START);
+      bytesToEnd = Common::GetMEM1End() - address;
+      return true;
+    }
+    if (address >= Common::MEM2_START && address < Common::GetMEM2End() && m_MEM2Present) {
+      hostAddress = m_MEM2AddressStart + (address - Common::MEM2_START);
+      bytesToEnd = Common::GetMEM2End() - address;
+      return true;
+    }
+    if (address >= Common::ARAM_START && address < Common::ARAM_END && m_ARAMAccessible) {
+      hostAddress = m_emuARAMAdressStart + (address - Common::ARAM_START);
+      bytesToEnd = Common::ARAM_END - address;
+      return true;
+    }
+    return false;
+  }
+
+  bool IDolphinProcess::splitGuestRange(u32 address, char* buffer, size_t size, std::vector<HostRead>& out,
+                                         u32& failedAddress) const {
+    size_t first = out.size();
+    size_t done = 0;
+    while (done < size) {
+      u32 current = address + static_cast<u32>(done);
+      u64 hostAddress;
+      u32 bytesToEnd;
+      // The second check catches ranges that wrap past 0xFFFFFFFF
+      if (!guestToHost(current, hostAddress, bytesToEnd) || current < address) {
+        failedAddress = current;
+        out.resize(first);
+        return false;
+      }
+      size_t chunk = std::min<size_t>(bytesToEnd, size - done);
+      out.push_back({hostAddress, chunk, buffer + done, false});
+      done += chunk;
+    }
+    return true;
+  }
+
+  GuestAccess IDolphinProcess::readGuest(u32 address, char* buffer, u32 size, u32* failedAddress) {
+    GuestRead read{address, size, buffer, GuestAccess::failed, address};
+    readGuestBatch(&read, 1);
+    if (failedAddress && read.result != GuestAccess::ok)
+      *failedAddress = read.failedAddress;
+    return read.result;
+  }
+
+  size_t IDolphinProcess::readGuestBatch(GuestRead* reads, size_t count) {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    std::vector<HostRead> hostReads;
+    std::vector<size_t> firstHostRead(count + 1);
+    for (size_t i = 0; i < count; i++) {
+      firstHostRead[i] = hostReads.size();
+      reads[i].result = splitGuestRange(reads[i].address, reads[i].buffer, reads[i].size, hostReads,
+                                         reads[i].failedAddress)
+                            ? GuestAccess::ok
+                            : GuestAccess::unmapped;
+    }
+    firstHostRead[count] = hostReads.size();
+
+    readHostBatch(hostReads.data(), hostReads.size());
+
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (reads[i].result != GuestAccess::ok)
+        continue;
+      u32 position = reads[i].address;
+      for (size_t j = firstHostRead[i]; j < firstHostRead[i + 1]; j++) {
+        if (!hostReads[j].ok) {
+          reads[i].result = GuestAccess::failed;
+          reads[i].failedAddress = position;
+          break;
+        }
+        position += static_cast<u32>(hostReads[j].size);
+      }
+      succeeded += reads[i].result == GuestAccess::ok;
+    }
+    return succeeded;
+  }
+
+  const u8* IDolphinProcess::mappedRAM(u32 offset, size_t size) {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    u64 hostAddress;
+    if (!offsetToHost(offset, size, hostAddress))
+      return nullptr;
+    return mappedHost(hostAddress, size);
+  }
+
+  GuestAccess IDolphinProcess::writeGuest(u32 address, const char* buffer, u32 size, u32* failedAddress) {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    std::vector<HostWrite> writes;
+    u32 unmappedAddress = address;
+    // Validate the whole range before writing anything so a bad range doesn't half-apply
+    if (!splitGuestRange(address, const_cast<char*>(buffer), size, writes, unmappedAddress)) {
+      if (failedAddress)
+        *failedAddress = unmappedAddress;
+      return GuestAccess::unmapped;
+    }
+
+    if (writeHostBatch(writes.data(), writes.size()) == writes.size())
+      return GuestAccess::ok;
+
+    u32 position = address;
+    for (const HostWrite& write : writes) {
+      if (!write.ok)
+        break;
+      position += static_cast<u32>(write.size);
+    }
+    if (failedAddress)
+      *failedAddress = position;
+    return GuestAccess::failed;
+  }
+
+  std::string IDolphinProcess::readGameId() {
+    if (!hasEmuRAMInformation())
+      return "";
+
+    char gameId[6];
+    if (!readFromRAM(0, gameId, sizeof(gameId)))
+      return "";
+
+    size_t length = 0;
+    while (length < sizeof(gameId) && gameId[length] != '\0')
+      length++;
+    return std::string(gameId, length);
+  }
+
+  std::vector<DolphinInstanceInfo> listDolphinInstances() {
+    std::vector<DolphinInstanceInfo> instances;
+    std::unique_ptr<IDolphinProcess> scanner = IDolphinProcess::create();
+    if (!scanner)
+      return instances;
+
+    for (int pid : scanner->findPIDs()) {
+      std::unique_ptr<IDolphinProcess> process = IDolphinProcess::create();
+      DolphinInstanceInfo info{pid, "", process->hookPID(pid)};
+      if (info.hooked)
+        info.gameId = process->readGameId();
+      instances.push_back(info);
+    }
+    return instances;
+  }
+}
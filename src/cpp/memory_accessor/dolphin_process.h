@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "common_types.h"
+
+namespace DolphinComm
+{
+struct DolphinInstanceInfo
+{
+  int pid;
+  // First 6 bytes of MEM1, empty if the instance couldn't be hooked or has no game running
+  std::string gameId;
+  bool hooked;
+};
+
+// One read of a batch. offset is a Common::dolphinAddrToOffset offset (MEM1 at 0, MEM2 at
+// 0x10000000); ok is filled in by readBatch.
+struct ReadRequest
+{
+  u32 offset;
+  u32 size;
+  char* buffer;
+  bool ok;
+};
+
+// One read of a batch at a host address, as handed to the backend
+struct HostRead
+{
+  u64 address;
+  size_t size;
+  char* buffer;
+  bool ok;
+};
+
+// Writes have the same shape; buffer is the source
+using WriteRequest = ReadRequest;
+using HostWrite = HostRead;
+
+enum class GuestAccess
+{
+  ok,
+  unmapped,
+  failed
+};
+
+// One read of a guest batch; result and failedAddress are filled in by readGuestBatch
+struct GuestRead
+{
+  u32 address;
+  u32 size;
+  char* buffer;
+  GuestAccess result;
+  u32 failedAddress;
+};
+
+class IDolphinProcess
+{
+public:
+  virtual ~IDolphinProcess() = default;
+
+  // Platform backend for the current OS
+  static std::unique_ptr<IDolphinProcess> create();
+
+  // PIDs of every running Dolphin process, in process table order
+  virtual std::vector<int> findPIDs() = 0;
+  virtual bool readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) = 0;
+  virtual bool writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) = 0;
+
+  // Picks the first running Dolphin process; hookPID(getPID()) then hooks it
+  bool findPID();
+  // Hooks a specific Dolphin process. Safe while other threads read through this object: they
+  // finish against the old hook or start against the new one.
+  bool hookPID(int pid);
+
+  // offset is a Common::dolphinAddrToOffset offset (without ARAM): MEM1 at 0, MEM2 at 0x10000000
+  bool readFromRAM(u32 offset, char* buffer, size_t size);
+  // Reads every request, returns how many succeeded
+  size_t readBatch(ReadRequest* requests, size_t count);
+  // Backends with vectored reads override this; the default reads one request at a time
+  virtual size_t readHostBatch(HostRead* reads, size_t count);
+  // Same for writes
+  size_t writeBatch(WriteRequest* requests, size_t count);
+  virtual size_t writeHostBatch(HostWrite* writes, size_t count);
+  // Stops every emulator thread so several accesses see one state. False if the backend can't,
+  // or the threads didn't all stop in time; nothing stays suspended then. Calls don't nest.
+  virtual bool suspend() { return false; }
+  virtual bool resume() { return false; }
+  // Write tracking. Every consumer registered here gets its own view of the writes; -1 if the
+  // backend can't track them.
+  virtual int addDirtyConsumer() { return -1; }
+  virtual void removeDirtyConsumer(int consumer) {}
+  // Appends the cache index (Common::offsetToCacheIndex without ARAM: MEM1, then MEM2) of every
+  // dirtyPageSize() page of MEM1/MEM2 written since the consumer's previous call; its first call,
+  // and the first after a re-hook, report every page. False if the writes couldn't be tracked this
+  // time, in which case read everything.
+  virtual bool dirtyPagesSince(int consumer, std::vector<u32>& cacheIndices) { return false; }
+  // Granularity of dirtyPagesSince
+  virtual u32 dirtyPageSize() const { return 0; }
+  // The emulated memory behind [hostAddress, hostAddress + size) when it is mapped into this
+  // process, so it can be read in place (and prefetched) without a system call; null otherwise
+  virtual const u8* mappedHost(u64 hostAddress, size_t size) { return nullptr; }
+
+  // Accesses a guest range, split at region ends; reads of several regions still go out as one
+  // batch. On failure, failedAddress (if given) is the first guest byte that wasn't accessed.
+  GuestAccess readGuest(u32 address, char* buffer, u32 size, u32* failedAddress = nullptr);
+  GuestAccess writeGuest(u32 address, const char* buffer, u32 size, u32* failedAddress = nullptr);
+  // All reads go out as a single host batch; returns how many succeeded
+  size_t readGuestBatch(GuestRead* reads, size_t count);
+  // mappedHost for a readFromRAM offset
+  const u8* mappedRAM(u32 offset, size_t size);
+  std::string readGameId();
+
+  int getPID() const { return m_PID; };
+  u64 getEmuRAMAddressStart() const { return m_emuRAMAddressStart; };
+  bool isMEM2Present() const { return m_MEM2Present; };
+  bool isARAMAccessible() const { return m_ARAMAccessible; };
+  bool hasEmuRAMInformation() const { return m_emuRAMAddressStart != 0; };
+  u64 getARAMAddressStart() const { return m_emuARAMAdressStart; };
+  u64 getMEM2AddressStart() const { return m_MEM2AddressStart; };
+  u64 getMEM1ToMEM2Distance() const
+  {
+    if (!m_MEM2Present)
+      return 0;
+    return m_MEM2AddressStart - m_emuRAMAddressStart;
+  };
+
+protected:
+  // Finds the host addresses of the hooked PID's emulated memory; hookPID calls it with
+  // m_hookMutex held exclusively
+  virtual bool obtainEmuRAMInformation() = 0;
+  // Forgets the host addresses of the last hook so a failed re-hook doesn't keep them
+  void resetEmuRAMInformation();
+
+  // The translation helpers below expect m_hookMutex to be held
+  // offset as for readFromRAM; false unless hooked and all of [offset, offset + size) is in MEM1
+  // or in MEM2
+  bool offsetToHost(u32 offset, size_t size, u64& hostAddress) const;
+  // Maps a guest address (MEM1 0x80.../0xC0..., MEM2 0x90.../0xD0..., ARAM 0x7E...) to the host.
+  // bytesToEnd is what is left of the region from there. False if the address isn't mapped.
+  bool guestToHost(u32 address, u64& hostAddress, u32& bytesToEnd) const;
+  // Splits a guest range at region ends into host accesses appended to out; false (nothing
+  // appended) if any of it is unmapped
+  bool splitGuestRange(u32 address, char* buffer, size_t size, std::vector<HostRead>& out,
+                        u32& failedAddress) const;
+
+  // Held exclusively while (re)hooking and shared by every access through the hook, so samplers
+  // and the IPC thread never translate against half-updated addresses or use a released handle.
+  // Shared holders must not take it again: a waiting re-hook would deadlock them.
+  mutable std::shared_mutex m_hookMutex;
+  int m_PID = -1;
+  u64 m_emuRAMAddressStart = 0;
+  u64 m_emuARAMAdressStart = 0;
+  u64 m_MEM2AddressStart = 0;
+  bool m_ARAMAccessible = false;
+  bool m_MEM2Present = false;
+};
+
+// Lists every running Dolphin instance with its game ID. Each instance is briefly hooked to read
+// the ID, so this is not free; cache the result.
+std::vector<DolphinInstanceInfo> listDolphinInstances();
+}  // namespace DolphinComm
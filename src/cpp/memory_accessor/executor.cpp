@@ -0,0 +1,282 @@
+#include "executor.h"
+
+#include <algorithm>
+
+namespace Common
+{
+namespace
+{
+// Lets post() from inside a job go to the current worker's own deque
+thread_local const Executor* t_executor = nullptr;
+thread_local size_t t_workerIndex = 0;
+
+u64 nanosSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+Executor& Executor::shared()
+{
+  static Executor executor(std::max(2u, std::thread::hardware_concurrency()));
+  return executor;
+}
+
+Executor::Executor(size_t threadCount)
+{
+  threadCount = std::max<size_t>(1, threadCount);
+  m_backgroundLimit = threadCount > 1 ? threadCount - 1 : 1;
+  m_abi = {DOLPHIN_EXECUTOR_ABI_VERSION, this, &Executor::abiSubmit};
+
+  // Workers steal from each other, so every deque exists before the first thread starts
+  for (size_t i = 0; i < threadCount; ++i)
+    m_workers.push_back(std::make_unique<Worker>());
+  for (size_t i = 0; i < threadCount; ++i)
+    m_workers[i]->thread = std::thread(&Executor::workerLoop, this, i);
+}
+
+Executor::~Executor()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  for (auto& worker : m_workers)
+    worker->thread.join();
+
+  // Jobs still held back by the background limit complete as cancelled
+  for (auto& worker : m_workers)
+  {
+    for (size_t priority = 0; priority < JOB_PRIORITY_COUNT; ++priority)
+    {
+      for (Job& job : worker->jobs[priority])
+      {
+        m_classes[priority].cancelled++;
+        job.task(true);
+      }
+    }
+  }
+}
+
+bool Executor::isBackground(size_t priority)
+{
+  return priority >= static_cast<size_t>(JobPriority::capture);
+}
+
+void Executor::abiSubmit(void* context, u32 priority, void (*run)(void* argument), void* argument)
+{
+  priority = std::min<u32>(priority, JOB_PRIORITY_COUNT - 1);
+  static_cast<Executor*>(context)->post(static_cast<JobPriority>(priority),
+                                        [run, argument](bool) { run(argument); });
+}
+
+void Executor::post(JobPriority priority, std::function<void(bool cancelled)> task, CancellationToken token)
+{
+  const size_t index = static_cast<size_t>(priority);
+  const size_t target = t_executor == this ? t_workerIndex :
+                                             m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+  Worker& worker = *m_workers[target];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    // Counted under the deque's lock, so a pop never sees the count behind the deque
+    m_classes[index].queued++;
+    worker.jobs[index].push_back({std::move(task), std::move(token), std::chrono::steady_clock::now()});
+  }
+  wakeOne();
+}
+
+void Executor::wakeOne()
+{
+  // Sleepers check their condition under this lock, so taking it orders the wake after the check
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+  }
+  m_wake.notify_one();
+}
+
+bool Executor::hasRunnableJob() const
+{
+  for (size_t priority = 0; priority < JOB_PRIORITY_COUNT; ++priority)
+  {
+    if (m_classes[priority].queued.load() == 0)
+      continue;
+    if (!isBackground(priority) || m_background.load() < m_backgroundLimit)
+      return true;
+  }
+  return false;
+}
+
+bool Executor::popJob(Worker& worker, size_t priority, bool newest, Job& job)
+{
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  std::deque<Job>& jobs = worker.jobs[priority];
+  if (jobs.empty())
+    return false;
+  if (newest)
+  {
+    job = std::move(jobs.back());
+    jobs.pop_back();
+  }
+  else
+  {
+    job = std::move(jobs.front());
+    jobs.pop_front();
+  }
+  m_classes[priority].queued--;
+  return true;
+}
+
+bool Executor::takeJob(size_t index, Job& job, size_t& priority)
+{
+  const size_t count = m_workers.size();
+  for (size_t p = 0; p < JOB_PRIORITY_COUNT; ++p)
+  {
+    if (m_classes[p].queued.load() == 0)
+      continue;
+    // Claim a background slot before looking, so two workers can't both take the last one
+    const bool background = isBackground(p);
+    if (background && m_background.fetch_add(1) >= m_backgroundLimit)
+    {
+      m_background--;
+      continue;
+    }
+
+    if (popJob(*m_workers[index], p, true, job))
+    {
+      priority = p;
+      return true;
+    }
+    for (size_t i = 1; i < count; ++i)
+    {
+      if (popJob(*m_workers[(index + i) % count], p, false, job))
+      {
+        m_steals++;
+        priority = p;
+        return true;
+      }
+    }
+    if (background)
+      m_background--;
+  }
+  return false;
+}
+
+void Executor::runJob(Job& job, size_t priority)
+{
+  ClassCounters& counters = m_classes[priority];
+  const u64 wait = nanosSince(job.posted);
+  counters.totalWaitNanos += wait;
+  u64 maxWait = counters.maxWaitNanos.load();
+  while (wait > maxWait && !counters.maxWaitNanos.compare_exchange_weak(maxWait, wait))
+  {
+  }
+
+  if (job.token.cancelled())
+  {
+    counters.cancelled++;
+    job.task(true);
+  }
+  else
+  {
+    counters.running++;
+    job.task(false);
+    counters.running--;
+    counters.completed++;
+  }
+  // Drop the task's captures before the next job, not whenever this slot is reused
+  job.task = nullptr;
+
+  if (isBackground(priority))
+  {
+    m_background--;
+    if (m_classes[static_cast<size_t>(JobPriority::capture)].queued.load() != 0 ||
+        m_classes[static_cast<size_t>(JobPriority::scan)].queued.load() != 0)
+      wakeOne();
+  }
+}
+
+void Executor::workerLoop(size_t index)
+{
+  t_executor = this;
+  t_workerIndex = index;
+  while (true)
+  {
+    Job job;
+    size_t priority;
+    if (takeJob(index, job, priority))
+    {
+      runJob(job, priority);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    if (m_stopping)
+      return;
+    m_wake.wait(lock, [this] { return m_stopping || hasRunnableJob(); });
+  }
+}
+
+void Executor::parallelFor(size_t count, const std::function<void(size_t)>& fn, JobPriority priority)
+{
+  if (count == 0)
+    return;
+  if (count == 1)
+  {
+    fn(0);
+    return;
+  }
+
+  // Helpers that start after all indices are claimed just exit, so the shared state has to outlive
+  // this call; fn itself is only touched for claimed indices, which we wait for below.
+  struct State
+  {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    size_t count;
+    const std::function<void(size_t)>* fn;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+  auto state = std::make_shared<State>();
+  state->count = count;
+  state->fn = &fn;
+
+  auto work = [](State& s) {
+    size_t index;
+    while ((index = s.next.fetch_add(1)) < s.count)
+    {
+      (*s.fn)(index);
+      if (s.done.fetch_add(1) + 1 == s.count)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.finished.notify_all();
+      }
+    }
+  };
+
+  const size_t helpers = std::min(count - 1, m_workers.size());
+  for (size_t i = 0; i < helpers; ++i)
+    post(priority, [state, work](bool) { work(*state); });
+
+  work(*state);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&] { return state->done.load() == count; });
+}
+
+ExecutorStats Executor::stats() const
+{
+  ExecutorStats stats;
+  stats.workers = m_workers.size();
+  stats.steals = m_steals.load();
+  for (size_t priority = 0; priority < JOB_PRIORITY_COUNT; ++priority)
+  {
+    const ClassCounters& counters = m_classes[priority];
+    stats.classes[priority] = {counters.queued.load(),         counters.running.load(),
+                               counters.completed.load(),      counters.cancelled.load(),
+                               counters.totalWaitNanos.load(), counters.maxWaitNanos.load()};
+  }
+  return stats;
+}
+}  // namespace Common
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common_types.h"
+#include "executor_abi.h"
+
+namespace Common
+{
+// Highest first. Workers always take the most urgent queued job, and capture and scan jobs never
+// occupy every worker, so inputs and reads start promptly however much bulk work is queued.
+enum class JobPriority : u8
+{
+  input = DOLPHIN_EXECUTOR_PRIORITY_INPUT,
+  read = DOLPHIN_EXECUTOR_PRIORITY_READ,
+  capture = DOLPHIN_EXECUTOR_PRIORITY_CAPTURE,
+  scan = DOLPHIN_EXECUTOR_PRIORITY_SCAN
+};
+constexpr size_t JOB_PRIORITY_COUNT = 4;
+
+// Shared flag between whoever queued a job and the job itself. Copies refer to the same flag.
+class CancellationToken
+{
+public:
+  CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+  void cancel() { m_cancelled->store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return m_cancelled->load(std::memory_order_relaxed); }
+
+private:
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+struct JobClassStats
+{
+  u64 queued;
+  u64 running;
+  u64 completed;
+  // Cancelled before a worker started them
+  u64 cancelled;
+  // Time from post to start
+  u64 totalWaitNanos;
+  u64 maxWaitNanos;
+};
+
+struct ExecutorStats
+{
+  size_t workers;
+  u64 steals;
+  std::array<JobClassStats, JOB_PRIORITY_COUNT> classes;
+};
+
+// Work-stealing executor shared by all native jobs: one worker per hardware thread (at least two),
+// each with its own deque per priority. Workers pop their own newest job and steal the oldest from
+// the others, so parallelFor helpers stay on warm caches while independent jobs still spread out.
+// The other addons reach the process-wide instance through abi(), see executor_abi.h.
+class Executor
+{
+public:
+  static Executor& shared();
+
+  explicit Executor(size_t threadCount);
+  ~Executor();
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  size_t size() const { return m_workers.size(); }
+
+  // Runs task on a worker. If token is cancelled before a worker gets to the job, task is called
+  // with cancelled = true instead so that whatever waits on it still completes; a running task
+  // polls the token itself.
+  void post(JobPriority priority, std::function<void(bool cancelled)> task,
+            CancellationToken token = CancellationToken());
+  // Runs fn(i) for every i in [0, count) and returns once all of them are done. The calling thread
+  // works through indices too, so nesting parallelFor inside a job can't deadlock.
+  void parallelFor(size_t count, const std::function<void(size_t)>& fn,
+                   JobPriority priority = JobPriority::scan);
+
+  ExecutorStats stats() const;
+  // C function table for the addons that don't link this file; valid for the process lifetime
+  const DolphinExecutorAbi* abi() const { return &m_abi; }
+
+private:
+  struct Job
+  {
+    std::function<void(bool cancelled)> task;
+    CancellationToken token;
+    std::chrono::steady_clock::time_point posted;
+  };
+  struct Worker
+  {
+    std::mutex mutex;
+    std::array<std::deque<Job>, JOB_PRIORITY_COUNT> jobs;
+    std::thread thread;
+  };
+  struct ClassCounters
+  {
+    std::atomic<u64> queued{0};
+    std::atomic<u64> running{0};
+    std::atomic<u64> completed{0};
+    std::atomic<u64> cancelled{0};
+    std::atomic<u64> totalWaitNanos{0};
+    std::atomic<u64> maxWaitNanos{0};
+  };
+
+  static bool isBackground(size_t priority);
+  static void abiSubmit(void* context, u32 priority, void (*run)(void* argument), void* argument);
+
+  void workerLoop(size_t index);
+  // Takes the most urgent job this worker may run: its own newest first, then the others' oldest
+  bool takeJob(size_t index, Job& job, size_t& priority);
+  bool popJob(Worker& worker, size_t priority, bool newest, Job& job);
+  bool hasRunnableJob() const;
+  void runJob(Job& job, size_t priority);
+  void wakeOne();
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::array<ClassCounters, JOB_PRIORITY_COUNT> m_classes;
+  std::atomic<u64> m_steals{0};
+  std::atomic<size_t> m_nextWorker{0};
+  // Capture and scan jobs running now, and how many of them may run at once
+  std::atomic<size_t> m_background{0};
+  size_t m_backgroundLimit = 1;
+
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+  bool m_stopping = false;
+  DolphinExecutorAbi m_abi;
+};
+}  // namespace Common
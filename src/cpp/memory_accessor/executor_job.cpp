@@ -0,0 +1,140 @@
+#include "executor_job.h"
+
+namespace {
+const char* const kPriorityNames[] = {"input", "read", "capture", "scan"};
+
+// getExecutorStats() => { workers, steals, classes: { input, read, capture, scan } } where each class
+// is { queued, running, completed, cancelled, meanWaitMicros, maxWaitMicros }; waits run from
+// queueing to start
+Napi::Value GetExecutorStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  const Common::ExecutorStats stats = Common::Executor::shared().stats();
+  Napi::Object classes = Napi::Object::New(env);
+  for (size_t i = 0; i < Common::JOB_PRIORITY_COUNT; i++) {
+    const Common::JobClassStats& counters = stats.classes[i];
+    const u64 started = counters.completed + counters.running + counters.cancelled;
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("queued", Napi::Number::New(env, static_cast<double>(counters.queued)));
+    entry.Set("running", Napi::Number::New(env, static_cast<double>(counters.running)));
+    entry.Set("completed", Napi::Number::New(env, static_cast<double>(counters.completed)));
+    entry.Set("cancelled", Napi::Number::New(env, static_cast<double>(counters.cancelled)));
+    entry.Set("meanWaitMicros",
+              Napi::Number::New(env, started == 0 ? 0.0 : counters.totalWaitNanos / 1000.0 / started));
+    entry.Set("maxWaitMicros", Napi::Number::New(env, counters.maxWaitNanos / 1000.0));
+    classes.Set(kPriorityNames[i], entry);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("workers", Napi::Number::New(env, static_cast<double>(stats.workers)));
+  result.Set("steals", Napi::Number::New(env, static_cast<double>(stats.steals)));
+  result.Set("classes", classes);
+  return result;
+}
+
+// getExecutorHandle() => External for setExecutor() of the offscreen_capture and send_keys addons
+Napi::Value GetExecutorHandle(const Napi::CallbackInfo& info) {
+  return Napi::External<DolphinExecutorAbi>::New(
+      info.Env(), const_cast<DolphinExecutorAbi*>(Common::Executor::shared().abi()));
+}
+}  // namespace
+
+struct ExecutorJob::Pending {
+  explicit Pending(Napi::Env env) : deferred(Napi::Promise::Deferred::New(env)) {}
+
+  std::unique_ptr<ExecutorJob> job;
+  Napi::Promise::Deferred deferred;
+  Napi::ThreadSafeFunction done;
+  bool cancelled = false;
+};
+
+Napi::Object ExecutorJob::Init(Napi::Env env, Napi::Object exports) {
+  exports.Set("getExecutorStats", Napi::Function::New(env, GetExecutorStats));
+  exports.Set("getExecutorHandle", Napi::Function::New(env, GetExecutorHandle));
+  return CancellationToken::Init(env, exports);
+}
+
+Napi::Promise ExecutorJob::queue(Napi::Env env, std::unique_ptr<ExecutorJob> job, Common::JobPriority priority,
+                                 Common::CancellationToken token) {
+  auto* pending = new Pending(env);
+  pending->job = std::move(job);
+  pending->job->m_token = token;
+  pending->done = Napi::ThreadSafeFunction::New(env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}),
+                                                "ExecutorJob", 0, 1);
+  Napi::Promise promise = pending->deferred.Promise();
+
+  Common::Executor::shared().post(priority, [pending](bool cancelled) {
+    pending->cancelled = cancelled;
+    if (!cancelled)
+      pending->job->execute();
+    // The JS thread may delete pending as soon as the call is queued
+    Napi::ThreadSafeFunction done = pending->done;
+    done.BlockingCall(pending, [](Napi::Env env, Napi::Function, Pending* pending) { settle(env, pending); });
+    done.Release();
+  }, std::move(token));
+  return promise;
+}
+
+void ExecutorJob::settle(Napi::Env env, Pending* pending) {
+  // No environment means it is being torn down; the job's references can't be released anymore
+  if (env == nullptr)
+    return;
+  std::unique_ptr<Pending> owner(pending);
+  Napi::HandleScope scope(env);
+
+  ExecutorJob& job = *pending->job;
+  if (pending->cancelled) {
+    pending->deferred.Reject(Napi::Error::New(env, "Cancelled").Value());
+  } else if (!job.m_error.empty()) {
+    pending->deferred.Reject(Napi::Error::New(env, job.m_error).Value());
+  } else {
+    Napi::Value value = job.result(env);
+    if (env.IsExceptionPending())
+      pending->deferred.Reject(env.GetAndClearPendingException().Value());
+    else
+      pending->deferred.Resolve(value);
+  }
+}
+
+Napi::FunctionReference CancellationToken::constructor;
+
+Napi::Object CancellationToken::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "CancellationToken", {
+    InstanceMethod("cancel", &CancellationToken::Cancel),
+    InstanceAccessor("cancelled", &CancellationToken::IsCancelled, nullptr),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("CancellationToken", func);
+  return exports;
+}
+
+CancellationToken::CancellationToken(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<CancellationToken>(info) {}
+
+bool CancellationToken::fromOptions(Napi::Value options, Common::CancellationToken& token) {
+  token = Common::CancellationToken();
+  if (!options.IsObject())
+    return true;
+  Napi::Value value = options.As<Napi::Object>().Get("token");
+  if (value.IsUndefined())
+    return true;
+  if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor.Value()))
+    return false;
+  token = Unwrap(value.As<Napi::Object>())->m_token;
+  return true;
+}
+
+Napi::Value CancellationToken::Cancel(const Napi::CallbackInfo& info) {
+  m_token.cancel();
+  return info.Env().Undefined();
+}
+
+Napi::Value CancellationToken::IsCancelled(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), m_token.cancelled());
+}
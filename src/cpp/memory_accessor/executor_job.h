@@ -0,0 +1,59 @@
+#pragma once
+#include <napi.h>
+
+#include <memory>
+#include <string>
+
+#include "executor.h"
+
+// Work for the shared executor that settles a promise, in the manner of Napi::AsyncWorker:
+// execute() runs on a worker, then result() or the error is delivered on the JS thread. Jobs keep
+// whatever JS objects they use alive with references taken when they are created.
+class ExecutorJob {
+public:
+  // Registers getExecutorStats(), getExecutorHandle() and the CancellationToken class
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  // Queues job and returns the promise it settles; rejected with "Cancelled" if token is
+  // cancelled before the job starts
+  static Napi::Promise queue(Napi::Env env, std::unique_ptr<ExecutorJob> job, Common::JobPriority priority,
+                             Common::CancellationToken token);
+
+  virtual ~ExecutorJob() = default;
+
+protected:
+  // On a worker. Long jobs poll cancelled() and may give up with setError("Cancelled").
+  virtual void execute() = 0;
+  // On the JS thread after execute() set no error
+  virtual Napi::Value result(Napi::Env env) = 0;
+
+  void setError(std::string error) { m_error = std::move(error); }
+  bool cancelled() const { return m_token.cancelled(); }
+  const Common::CancellationToken& token() const { return m_token; }
+
+private:
+  struct Pending;
+  static void settle(Napi::Env env, Pending* pending);
+
+  Common::CancellationToken m_token;
+  std::string m_error;
+};
+
+// new CancellationToken(); pass it as the token option of an async method and cancel() to drop the
+// job if it hasn't started, or to ask a running one to stop early
+class CancellationToken : public Napi::ObjectWrap<CancellationToken> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  CancellationToken(const Napi::CallbackInfo& info);
+
+  // The token in options.token, or a fresh one nobody else can cancel. False if token is set but
+  // isn't a CancellationToken.
+  static bool fromOptions(Napi::Value options, Common::CancellationToken& token);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Cancel(const Napi::CallbackInfo& info);
+  Napi::Value IsCancelled(const Napi::CallbackInfo& info);
+
+  Common::CancellationToken m_token;
+};
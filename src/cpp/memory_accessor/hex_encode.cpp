@@ -0,0 +1,102 @@
+#include "hex_encode.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HEX_ENCODE_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HEX_ENCODE_NEON
+#endif
+
+namespace Common
+{
+namespace
+{
+struct DigitPairs
+{
+  char pairs[256][2];
+
+  DigitPairs()
+  {
+    const char* digits = "0123456789ABCDEF";
+    for (int i = 0; i < 256; ++i)
+    {
+      pairs[i][0] = digits[i >> 4];
+      pairs[i][1] = digits[i & 0xF];
+    }
+  }
+};
+
+const DigitPairs DIGIT_PAIRS;
+
+// 16 bytes to 32 chars
+inline void encodeBlock(const u8* bytes, char* out)
+{
+#if defined(HEX_ENCODE_SSE2)
+  const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+  const __m128i lowMask = _mm_set1_epi8(0x0F);
+  const __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), lowMask);
+  const __m128i low = _mm_and_si128(value, lowMask);
+  // '0' + n, plus the gap between '9' and 'A' where n > 9
+  const auto toDigits = [](__m128i nibbles) {
+    const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+  };
+  const __m128i highDigits = toDigits(high);
+  const __m128i lowDigits = toDigits(low);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(highDigits, lowDigits));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(highDigits, lowDigits));
+#elif defined(HEX_ENCODE_NEON)
+  static const u8 digits[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+  const uint8x16_t table = vld1q_u8(digits);
+  const uint8x16_t value = vld1q_u8(bytes);
+  uint8x16x2_t pairs;
+  pairs.val[0] = vqtbl1q_u8(table, vshrq_n_u8(value, 4));
+  pairs.val[1] = vqtbl1q_u8(table, vandq_u8(value, vdupq_n_u8(0x0F)));
+  // Interleaving store: high digit, low digit, ...
+  vst2q_u8(reinterpret_cast<u8*>(out), pairs);
+#else
+  for (int i = 0; i < 16; ++i)
+    std::memcpy(out + i * 2, DIGIT_PAIRS.pairs[bytes[i]], 2);
+#endif
+}
+}  // namespace
+
+void hexEncode(const u8* bytes, size_t count, char* out)
+{
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+    encodeBlock(bytes + i, out + i * 2);
+  for (; i < count; ++i)
+    std::memcpy(out + i * 2, DIGIT_PAIRS.pairs[bytes[i]], 2);
+}
+
+void hexEncodeSeparated(const u8* bytes, size_t count, char separator, char* out)
+{
+  char block[32];
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    encodeBlock(bytes + i, block);
+    char* line = out + i * 3;
+    for (int b = 0; b < 15; ++b)
+    {
+      std::memcpy(line + b * 3, block + b * 2, 2);
+      line[b * 3 + 2] = separator;
+    }
+    std::memcpy(line + 45, block + 30, 2);
+    // No separator after the last byte
+    if (i + 16 < count)
+      line[47] = separator;
+  }
+  for (; i < count; ++i)
+  {
+    std::memcpy(out + i * 3, DIGIT_PAIRS.pairs[bytes[i]], 2);
+    if (i + 1 < count)
+      out[i * 3 + 2] = separator;
+  }
+}
+}  // namespace Common
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+#include "common_types.h"
+
+// Uppercase hex for runs of bytes. 16 bytes are encoded per step with SSE2 or NEON where the
+// target has them, whatever is left over through a table of digit pairs.
+namespace Common
+{
+// Writes 2 * count chars
+void hexEncode(const u8* bytes, size_t count, char* out);
+// Writes the bytes' digit pairs with separator between them (3 * count - 1 chars), "00 1A FF"
+void hexEncodeSeparated(const u8* bytes, size_t count, char separator, char* out);
+}  // namespace Common
@@ -0,0 +1,164 @@
+#include "instance_group.h"
+
+#include <iostream>
+#include <vector>
+
+#include "executor.h"
+#include "napi_utils.h"
+
+Napi::FunctionReference InstanceGroup::constructor;
+
+Napi::Object InstanceGroup::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "InstanceGroup", {
+    InstanceMethod("hook", &InstanceGroup::Hook),
+    InstanceMethod("unhook", &InstanceGroup::Unhook),
+    InstanceMethod("getInstances", &InstanceGroup::GetInstances),
+    InstanceMethod("readBatch", &InstanceGroup::ReadBatch),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("InstanceGroup", func);
+  return exports;
+}
+
+InstanceGroup::InstanceGroup(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<InstanceGroup>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+}
+
+// hook(pid) => boolean. Re-hooking a PID that is already in the group refreshes its RAM info.
+Napi::Value InstanceGroup::Hook(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "PID expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  int pid = info[0].As<Napi::Number>().Int32Value();
+  std::unique_ptr<DolphinComm::IDolphinProcess> process = DolphinComm::IDolphinProcess::create();
+  if (!process) {
+    Napi::Error::New(env, "No Dolphin process backend for this platform").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!process->hookPID(pid)) {
+    std::cerr << "## Failed to hook Dolphin PID " << pid << "\n";
+    return Napi::Boolean::New(env, false);
+  }
+
+  m_instances[pid] = std::move(process);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value InstanceGroup::Unhook(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "PID expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Boolean::New(env, m_instances.erase(info[0].As<Napi::Number>().Int32Value()) > 0);
+}
+
+// getInstances() => [{ pid, gameId }]
+Napi::Value InstanceGroup::GetInstances(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  Napi::Array result = Napi::Array::New(env, m_instances.size());
+  uint32_t index = 0;
+  for (auto& instance : m_instances) {
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("pid", Napi::Number::New(env, instance.first));
+    entry.Set("gameId", Napi::String::New(env, instance.second->readGameId()));
+    result.Set(index++, entry);
+  }
+  return result;
+}
+
+// readBatch([{ pid, offset, size }]) => Array<Uint8Array | null>, aligned with the requests. All
+// results are views into one ArrayBuffer; requests for unhooked PIDs or failed reads give null.
+Napi::Value InstanceGroup::ReadBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "Array of { pid, offset, size } requests expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  struct Group {
+    DolphinComm::IDolphinProcess* process;
+    std::vector<DolphinComm::ReadRequest> reads;
+    std::vector<uint32_t> indices;
+  };
+
+  Napi::Array requests = info[0].As<Napi::Array>();
+  std::map<int, Group> groups;
+  std::vector<u32> sizes(requests.Length());
+  std::vector<size_t> positions(requests.Length());
+  std::vector<bool> ok(requests.Length(), false);
+  size_t total = 0;
+
+  // Sizes first so the arena can be allocated before any buffer pointers are handed out
+  std::vector<std::pair<int, DolphinComm::ReadRequest>> parsed(requests.Length());
+  for (uint32_t i = 0; i < requests.Length(); i++) {
+    Napi::Value request = requests.Get(i);
+    u32 pid = 0;
+    DolphinComm::ReadRequest read{};
+    if (!request.IsObject() || !NapiUtils::getU32(request.As<Napi::Object>(), "pid", pid) ||
+        !NapiUtils::getU32(request.As<Napi::Object>(), "offset", read.offset) ||
+        !NapiUtils::getU32(request.As<Napi::Object>(), "size", read.size)) {
+      Napi::TypeError::New(env, "Each request needs a numeric pid, offset and size").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    parsed[i] = {static_cast<int>(pid), read};
+    sizes[i] = read.size;
+    positions[i] = total;
+    total += read.size;
+  }
+
+  Napi::ArrayBuffer arena = Napi::ArrayBuffer::New(env, total);
+  char* base = static_cast<char*>(arena.Data());
+  for (uint32_t i = 0; i < parsed.size(); i++) {
+    auto instance = m_instances.find(parsed[i].first);
+    if (instance == m_instances.end())
+      continue;
+    Group& group = groups[parsed[i].first];
+    group.process = instance->second.get();
+    parsed[i].second.buffer = base + positions[i];
+    group.reads.push_back(parsed[i].second);
+    group.indices.push_back(i);
+  }
+
+  std::vector<Group*> work;
+  for (auto& group : groups)
+    work.push_back(&group.second);
+
+  Common::Executor::shared().parallelFor(work.size(), [&](size_t i) {
+    work[i]->process->readBatch(work[i]->reads.data(), work[i]->reads.size());
+  }, Common::JobPriority::read);
+
+  for (Group* group : work) {
+    for (size_t i = 0; i < group->reads.size(); i++)
+      ok[group->indices[i]] = group->reads[i].ok;
+  }
+
+  Napi::Array result = Napi::Array::New(env, parsed.size());
+  for (uint32_t i = 0; i < parsed.size(); i++) {
+    if (ok[i])
+      result.Set(i, Napi::Uint8Array::New(env, sizes[i], arena, positions[i]));
+    else
+      result.Set(i, env.Null());
+  }
+  return result;
+}
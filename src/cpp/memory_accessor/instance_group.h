@@ -0,0 +1,25 @@
+#pragma once
+#include <napi.h>
+
+#include <map>
+#include <memory>
+
+#include "dolphin_process.h"
+
+// Holds one hooked process per Dolphin instance so several emulators can be read side by side.
+// readBatch() fans requests for different instances out over the shared executor at read priority.
+class InstanceGroup : public Napi::ObjectWrap<InstanceGroup> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  InstanceGroup(const Napi::CallbackInfo& info);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Hook(const Napi::CallbackInfo& info);
+  Napi::Value Unhook(const Napi::CallbackInfo& info);
+  Napi::Value GetInstances(const Napi::CallbackInfo& info);
+  Napi::Value ReadBatch(const Napi::CallbackInfo& info);
+
+  std::map<int, std::unique_ptr<DolphinComm::IDolphinProcess>> m_instances;
+};
@@ -0,0 +1,114 @@
+/*
+ * Shared-memory protocol of the memory accessor's IPC service (IpcServer).
+ *
+ * Plain C so non-Node clients (Python ctypes, Rust bindgen, ...) can use this header directly.
+ * All fields are little/native endian as laid out by the server's host. Fields marked "atomic"
+ * must be accessed with atomic loads/stores (acquire/release is enough unless stated otherwise).
+ *
+ * Layout of the POSIX shared memory object (shm_open name chosen by the server, "/dab-<pid>" by
+ * default):
+ *
+ *   DabIpcHeader                              at 0
+ *   slot i                                    at headerSize + i * slotStride
+ *     DabIpcSlot                              control block
+ *     DabIpcRequest  requests[ringEntries]    at slot + sizeof(DabIpcSlot)
+ *     DabIpcResponse responses[ringEntries]   after the requests
+ *     uint8_t        data[dataSize]           at slot + dataOffset
+ *
+ * Every slot is a pair of single-producer/single-consumer rings owned by one client:
+ *
+ *   1. Claim a free slot by compare-and-swapping owner from 0 to your pid.
+ *   2. For a write, copy the bytes into data[dataOffset ..]. Fill requests[head % ringEntries]
+ *      for each request, then store requestHead = head + n (release). At most ringEntries
+ *      requests may be outstanding (requestHead - responseTail <= ringEntries).
+ *   3. Ring the doorbell: atomically increment header.doorbell (sequentially consistent), then
+ *      if header.serverWaiting is non-zero, FUTEX_WAKE header.doorbell (Linux).
+ *   4. Wait until responseHead (acquire) moves past your requests. To sleep instead of spinning,
+ *      set responseWaiting = 1 (sequentially consistent), re-check responseHead, then FUTEX_WAIT
+ *      on responseHead with the value you saw; clear responseWaiting afterwards. Read results are
+ *      in data[dataOffset ..]. Responses come back in request order; store responseTail after
+ *      consuming them.
+ *   5. Release the slot by storing owner = 0.
+ *
+ * Futexes are only used on Linux. Elsewhere (macOS) there is no cross-process futex, so the
+ * server polls with a short backoff and clients should spin/sleep on responseHead likewise.
+ *
+ * Addresses are Dolphin virtual addresses (MEM1 0x80..., MEM2 0x90..., ARAM 0x7E...), read with
+ * the same routing as MemoryAccessor.readGuest. Consecutive reads in a batch are served with a
+ * single batched read of the hooked process.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define DAB_IPC_MAGIC "DABIPC01"
+#define DAB_IPC_VERSION 1
+
+enum DabIpcOp
+{
+  DAB_IPC_OP_READ = 1,
+  DAB_IPC_OP_WRITE = 2,
+  /* Answers immediately; useful to measure round trips */
+  DAB_IPC_OP_PING = 3
+};
+
+enum DabIpcStatus
+{
+  DAB_IPC_OK = 0,
+  /* Part of the range is not mapped guest memory; failedAddress is the first such byte */
+  DAB_IPC_UNMAPPED = 1,
+  /* The process access failed (Dolphin gone, not hooked, ...) */
+  DAB_IPC_FAILED = 2,
+  /* Unknown op, or dataOffset/size outside the slot's data area */
+  DAB_IPC_BAD_REQUEST = 3
+};
+
+typedef struct DabIpcHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t slotCount;
+  uint32_t ringEntries; /* power of two */
+  uint32_t dataSize;    /* per slot */
+  uint32_t dataOffset;  /* from the start of a slot */
+  uint64_t slotStride;
+  uint32_t serverPid;
+  uint32_t serverRunning; /* atomic; 0 once the server stops */
+  uint32_t doorbell;      /* atomic; futex word */
+  uint32_t serverWaiting; /* atomic */
+} DabIpcHeader;
+
+typedef struct DabIpcSlot
+{
+  uint32_t owner; /* atomic; pid of the client using the slot, 0 if free */
+  uint32_t reserved[15];
+  /* Written by the client */
+  uint32_t requestHead; /* atomic */
+  uint32_t responseTail; /* atomic */
+  uint32_t responseWaiting; /* atomic */
+  uint32_t clientReserved[13];
+  /* Written by the server */
+  uint32_t requestTail; /* atomic */
+  uint32_t responseHead; /* atomic; futex word */
+  uint32_t serverReserved[14];
+} DabIpcSlot;
+
+typedef struct DabIpcRequest
+{
+  uint32_t id; /* echoed in the response */
+  uint16_t op; /* DabIpcOp */
+  uint16_t flags;
+  uint32_t address;
+  uint32_t size;
+  uint32_t dataOffset; /* into the slot's data area */
+  uint32_t reserved[3];
+} DabIpcRequest;
+
+typedef struct DabIpcResponse
+{
+  uint32_t id;
+  int32_t status; /* DabIpcStatus */
+  uint32_t failedAddress;
+  uint32_t size;
+} DabIpcResponse;
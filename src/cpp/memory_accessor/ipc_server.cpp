@@ -0,0 +1,91 @@
+#include "ipc_server.h"
+
+#include <unistd.h>
+
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+Napi::FunctionReference IpcServer::constructor;
+
+Napi::Object IpcServer::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "IpcServer", {
+    InstanceMethod("start", &IpcServer::Start),
+    InstanceMethod("stop", &IpcServer::Stop),
+    InstanceMethod("getInfo", &IpcServer::GetInfo),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("IpcServer", func);
+  return exports;
+}
+
+IpcServer::IpcServer(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<IpcServer>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "MemoryAccessor argument expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+}
+
+// start({ name?, slots?, ringEntries?, dataSize? }) => shared memory name. name defaults to
+// "/dab-<pid>"; clients find the layout in the header (ipc_protocol.h).
+Napi::Value IpcServer::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  Napi::Object options = info.Length() >= 1 && info[0].IsObject() ? info[0].As<Napi::Object>() : Napi::Object::New(env);
+  std::string name = options.Get("name").IsString() ? options.Get("name").As<Napi::String>().Utf8Value()
+                                                    : "/dab-" + std::to_string(getpid());
+  if (name.empty() || name[0] != '/')
+    name = "/" + name;
+  u32 slots = NapiUtils::getU32Or(options, "slots", 8);
+  u32 ringEntries = NapiUtils::getU32Or(options, "ringEntries", 256);
+  u32 dataSize = NapiUtils::getU32Or(options, "dataSize", 1024 * 1024);
+
+  if (slots == 0 || slots > 64 || ringEntries == 0 || ringEntries > 65536 || dataSize == 0 || dataSize > 256 * 1024 * 1024) {
+    Napi::RangeError::New(env, "IpcServer: slots must be 1-64, ringEntries 1-65536 and dataSize at most 256 MB").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!m_service.start(m_process, name, slots, ringEntries, dataSize)) {
+    Napi::Error::New(env, "IpcServer: Failed to create shared memory " + name).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::String::New(env, name);
+}
+
+Napi::Value IpcServer::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  m_service.stop();
+  return env.Undefined();
+}
+
+Napi::Value IpcServer::GetInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  DolphinComm::SharedMemoryServiceStats stats = m_service.stats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("running", Napi::Boolean::New(env, m_service.isRunning()));
+  result.Set("name", Napi::String::New(env, m_service.name()));
+  result.Set("size", Napi::Number::New(env, static_cast<double>(m_service.mappingSize())));
+  result.Set("activeClients", Napi::Number::New(env, stats.activeClients));
+  result.Set("requests", Napi::Number::New(env, static_cast<double>(stats.requests)));
+  result.Set("batches", Napi::Number::New(env, static_cast<double>(stats.batches)));
+  result.Set("bytesRead", Napi::Number::New(env, static_cast<double>(stats.bytesRead)));
+  result.Set("bytesWritten", Napi::Number::New(env, static_cast<double>(stats.bytesWritten)));
+  return result;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <napi.h>
+
+#include "shared_memory_service.h"
+
+// JS handle on the shared-memory IPC service (see ipc_protocol.h), letting non-Node tools share
+// this process's Dolphin hook.
+class IpcServer : public Napi::ObjectWrap<IpcServer> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  IpcServer(const Napi::CallbackInfo& info);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value GetInfo(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  DolphinComm::SharedMemoryService m_service;
+};
@@ -0,0 +1,422 @@
+#include "linux_dolphin_process.h"
+#include "common_utils.h"
+#include "memory_common.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+  // UIO_MAXIOV; process_vm_readv rejects longer iovec arrays
+  constexpr size_t kMaxIovecs = 1024;
+  // How long suspend() waits for every thread to reach the group stop
+  constexpr auto kStopTimeout = std::chrono::milliseconds(20);
+  // Bit 55 of a /proc/<pid>/pagemap entry: the page was written since soft-dirty bits were last cleared
+  constexpr u64 kPagemapSoftDirty = u64(1) << 55;
+
+  bool isSharedMemoryName(const std::string& path) {
+    return (path.find("/dev/shm/") == 0 || path.find("/memfd:") == 0) &&
+           (path.find("dolphin-emu") != std::string::npos || path.find("dolphinmem") != std::string::npos);
+  }
+
+  // Moves a batch with as few process_vm_readv/writev calls as possible
+  size_t transferBatch(int pid, DolphinComm::HostRead* transfers, size_t count, bool write) {
+    iovec local[kMaxIovecs];
+    iovec remote[kMaxIovecs];
+    size_t succeeded = 0;
+    size_t next = 0;
+    while (next < count) {
+      size_t batch = std::min(count - next, kMaxIovecs);
+      for (size_t i = 0; i < batch; i++) {
+        local[i] = {transfers[next + i].buffer, transfers[next + i].size};
+        remote[i] = {reinterpret_cast<void*>(transfers[next + i].address), transfers[next + i].size};
+      }
+
+      ssize_t transferred = write ? process_vm_writev(pid, local, batch, remote, batch, 0)
+                                  : process_vm_readv(pid, local, batch, remote, batch, 0);
+      if (transferred < 0 && errno != EFAULT) {
+        // The process is gone or can't be accessed at all; no point trying the rest one by one
+        for (size_t i = next; i < count; i++)
+          transfers[i].ok = false;
+        return succeeded;
+      }
+
+      // Transfers stop at the first iovec that faults and never split one, so everything before
+      // it is complete and it is the failed transfer
+      size_t remaining = transferred < 0 ? 0 : static_cast<size_t>(transferred);
+      size_t done = 0;
+      while (done < batch && transfers[next + done].size <= remaining) {
+        remaining -= transfers[next + done].size;
+        transfers[next + done].ok = true;
+        done++;
+      }
+      succeeded += done;
+      next += done;
+      if (done < batch)
+        transfers[next++].ok = false;
+    }
+    return succeeded;
+  }
+}  // namespace
+
+namespace DolphinComm {
+  LinuxDolphinProcess::~LinuxDolphinProcess() {
+    std::lock_guard<std::mutex> lock(m_dirtyMutex);
+    closeDirtyTracking();
+  }
+
+  std::vector<int> LinuxDolphinProcess::findPIDs() {
+    std::vector<int> pids;
+    DIR* proc = opendir("/proc");
+    if (proc == nullptr)
+      return pids;
+
+    static const char* const s_dolphinProcessName{std::getenv("DME_DOLPHIN_PROCESS_NAME")};
+
+    while (dirent* entry = readdir(proc)) {
+      char* end;
+      long pid = std::strtol(entry->d_name, &end, 10);
+      if (*end != '\0' || pid <= 0)
+        continue;
+
+      std::ifstream comm("/proc/" + std::string(entry->d_name) + "/comm");
+      std::string name;
+      if (!std::getline(comm, name))
+        continue;
+      const bool match{s_dolphinProcessName ? name == s_dolphinProcessName
+                                            : (name == "dolphin-emu" || name == "dolphin-emu-qt2" ||
+                                               name == "dolphin-emu-wx" || name == "dolphin-emu-nog")};
+      if (match)
+        pids.push_back(static_cast<int>(pid));
+    }
+    closedir(proc);
+
+    std::sort(pids.begin(), pids.end());
+    return pids;
+  }
+
+  bool LinuxDolphinProcess::obtainEmuRAMInformation() {
+    resetEmuRAMInformation();
+    {
+      std::lock_guard<std::mutex> lock(m_dirtyMutex);
+      closeDirtyTracking();
+    }
+    m_views.clear();
+    m_MEM2FileOffset = 0;
+
+    std::ifstream maps("/proc/" + std::to_string(m_PID) + "/maps");
+    if (!maps) {
+      std::cerr << "## Failed to open the memory map of PID " << m_PID << "\n";
+      return false;
+    }
+
+    // Dolphin lays its physical regions out back to back in one shared memory object: MEM1 at
+    // offset 0, the L1 cache (0x40000), the fake VMEM backing ARAM (only without MMU), then MEM2.
+    struct SharedRegion {
+      u64 address;
+      u64 size;
+      u64 offset;
+      u64 inode;
+      bool writable;
+    };
+    std::vector<SharedRegion> candidates;
+
+    std::string line;
+    while (std::getline(maps, line)) {
+      unsigned long long start, end, offset, inode;
+      char perms[5] = {};
+      int pathStart = 0;
+      if (std::sscanf(line.c_str(), "%llx-%llx %4s %llx %*s %llu %n", &start, &end, perms, &offset, &inode,
+                      &pathStart) < 5 || pathStart == 0)
+        continue;
+      if (perms[3] != 's' || !isSharedMemoryName(line.substr(pathStart)))
+        continue;
+      candidates.push_back({start, end - start, offset, inode, perms[0] == 'r' && perms[1] == 'w'});
+    }
+
+    // if these are true, then it is very likely the correct region, but we cannot guarantee
+    u64 MEM1Inode = 0;
+    for (const SharedRegion& region : candidates) {
+      if (region.writable && region.offset == 0x0 && region.size == Common::GetMEM1Size()) {
+        m_emuRAMAddressStart = region.address;
+        MEM1Inode = region.inode;
+        break;
+      }
+    }
+
+    const u64 afterL1Cache = Common::GetMEM1Size() + 0x40000;
+    for (const SharedRegion& region : candidates) {
+      if (m_emuRAMAddressStart == 0 || region.inode != MEM1Inode)
+        continue;
+
+      m_views.push_back({region.address, region.size, region.offset});
+      if (!region.writable)
+        continue;
+
+      if (!m_ARAMAccessible && region.offset == afterL1Cache && region.size == Common::ARAM_FAKESIZE) {
+        m_emuARAMAdressStart = region.address;
+        m_ARAMAccessible = true;
+      }
+      else if (!m_MEM2Present && Common::GetMEM2Size() != 0 && region.size == Common::GetMEM2Size() &&
+               (region.offset == afterL1Cache || region.offset == afterL1Cache + Common::ARAM_FAKESIZE)) {
+        m_MEM2AddressStart = region.address;
+        m_MEM2FileOffset = region.offset;
+        m_MEM2Present = true;
+      }
+    }
+
+    if (m_MEM2Present)
+      std::cerr << "## Found MEM2 at address 0x" << std::hex << m_MEM2AddressStart << std::dec << "\n";
+
+    if (m_emuRAMAddressStart != 0) {
+      std::cerr << "## Found emulated RAM at address 0x" << std::hex << m_emuRAMAddressStart << std::dec << "\n";
+      return true;
+    }
+
+    std::cerr << "## Failed to find emulated RAM address\n";
+    return false;
+  }
+
+  bool LinuxDolphinProcess::readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) {
+    iovec local{buffer, size};
+    iovec remote{reinterpret_cast<void*>(baseAddr + offset), size};
+    return process_vm_readv(m_PID, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(size);
+  }
+
+  bool LinuxDolphinProcess::writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) {
+    iovec local{buffer, size};
+    iovec remote{reinterpret_cast<void*>(baseAddr + offset), size};
+    return process_vm_writev(m_PID, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(size);
+  }
+
+  size_t LinuxDolphinProcess::readHostBatch(HostRead* reads, size_t count) {
+    return transferBatch(m_PID, reads, count, false);
+  }
+
+  size_t LinuxDolphinProcess::writeHostBatch(HostWrite* writes, size_t count) {
+    return transferBatch(m_PID, writes, count, true);
+  }
+
+  bool LinuxDolphinProcess::allThreadsStopped() const {
+    const std::string taskDir = "/proc/" + std::to_string(m_PID) + "/task";
+    DIR* tasks = opendir(taskDir.c_str());
+    if (tasks == nullptr)
+      return false;
+
+    bool stopped = true;
+    while (dirent* entry = readdir(tasks)) {
+      if (entry->d_name[0] == '.')
+        continue;
+      std::ifstream statFile(taskDir + "/" + entry->d_name + "/stat");
+      std::string stat;
+      if (!std::getline(statFile, stat))
+        continue;  // The thread exited in between
+      // The state follows the command name, which may itself contain ')'
+      size_t nameEnd = stat.rfind(')');
+      char state = nameEnd != std::string::npos && nameEnd + 2 < stat.size() ? stat[nameEnd + 2] : '?';
+      if (state != 'T' && state != 't' && state != 'Z' && state != 'X') {
+        stopped = false;
+        break;
+      }
+    }
+    closedir(tasks);
+    return stopped;
+  }
+
+  // SIGSTOP rather than ptrace, which would conflict with a debugger attached to Dolphin and need
+  // every thread seized one by one. The group stop reaches the threads asynchronously, so wait until
+  // each of them reports it.
+  bool LinuxDolphinProcess::stopProcess(bool& wasStopped) {
+    if (m_PID <= 0)
+      return false;
+    wasStopped = allThreadsStopped();
+    if (wasStopped)
+      return true;
+    if (kill(m_PID, SIGSTOP) != 0)
+      return false;
+
+    auto deadline = std::chrono::steady_clock::now() + kStopTimeout;
+    while (!allThreadsStopped()) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        kill(m_PID, SIGCONT);
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+    return true;
+  }
+
+  bool LinuxDolphinProcess::continueProcess(bool wasStopped) {
+    if (wasStopped)
+      return true;
+    return m_PID > 0 && kill(m_PID, SIGCONT) == 0;
+  }
+
+  bool LinuxDolphinProcess::suspend() {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    return stopProcess(m_wasStopped);
+  }
+
+  bool LinuxDolphinProcess::resume() {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    bool wasStopped = m_wasStopped;
+    m_wasStopped = false;
+    return continueProcess(wasStopped);
+  }
+
+  u32 LinuxDolphinProcess::dirtyPageSize() const {
+    static const u32 s_pageSize = static_cast<u32>(sysconf(_SC_PAGESIZE));
+    return s_pageSize;
+  }
+
+  void LinuxDolphinProcess::closeDirtyTracking() {
+    if (m_pagemapFd >= 0)
+      close(m_pagemapFd);
+    if (m_clearRefsFd >= 0)
+      close(m_clearRefsFd);
+    m_pagemapFd = -1;
+    m_clearRefsFd = -1;
+    m_dirtyTrackingFailed = false;
+    m_dirtyTrackingStarted = false;
+    // Whatever the consumers hold is about the previous hook; their next call reports every page
+    for (auto& consumer : m_dirtyConsumers)
+      consumer.second.clear();
+  }
+
+  // Marks the pages of one region (fileStart/regionSize in the shared object, cacheStart in cache
+  // indices) that `view` maps and that are soft-dirty
+  bool LinuxDolphinProcess::readPagemap(const SharedView& view, u64 fileStart, u32 cacheStart, u32 regionSize,
+                                        std::vector<u8>& dirty) {
+    const u64 begin = std::max(view.fileOffset, fileStart);
+    const u64 end = std::min(view.fileOffset + view.size, fileStart + regionSize);
+    if (begin >= end)
+      return true;
+
+    const u32 pageSize = dirtyPageSize();
+    const u64 firstHostPage = (view.address + (begin - view.fileOffset)) / pageSize;
+    const size_t pages = static_cast<size_t>((end - begin + pageSize - 1) / pageSize);
+    m_pagemap.resize(pages);
+
+    size_t bytesRead = 0;
+    const size_t bytes = pages * sizeof(u64);
+    while (bytesRead < bytes) {
+      ssize_t result = pread(m_pagemapFd, reinterpret_cast<char*>(m_pagemap.data()) + bytesRead, bytes - bytesRead,
+                             static_cast<off_t>(firstHostPage * sizeof(u64) + bytesRead));
+      if (result <= 0)
+        return false;
+      bytesRead += static_cast<size_t>(result);
+    }
+
+    const size_t firstCachePage = (cacheStart + (begin - fileStart)) / pageSize;
+    for (size_t i = 0; i < pages; i++)
+      dirty[firstCachePage + i] |= (m_pagemap[i] & kPagemapSoftDirty) != 0;
+    return true;
+  }
+
+  int LinuxDolphinProcess::addDirtyConsumer() {
+    std::lock_guard<std::mutex> lock(m_dirtyMutex);
+    int consumer = m_nextDirtyConsumer++;
+    // Empty until the first scan, which fills it with every page
+    m_dirtyConsumers[consumer];
+    return consumer;
+  }
+
+  void LinuxDolphinProcess::removeDirtyConsumer(int consumer) {
+    std::lock_guard<std::mutex> lock(m_dirtyMutex);
+    m_dirtyConsumers.erase(consumer);
+  }
+
+  // Reads the soft-dirty bits into m_dirty and starts the next interval. Dolphin is stopped from
+  // the pagemap read to the clear, so no write can land in between and be lost; that is a few
+  // hundred microseconds for MEM1 and MEM2.
+  bool LinuxDolphinProcess::scanDirtyPages() {
+    if (m_pagemapFd < 0) {
+      const std::string proc = "/proc/" + std::to_string(m_PID);
+      m_pagemapFd = open((proc + "/pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+      m_clearRefsFd = open((proc + "/clear_refs").c_str(), O_WRONLY | O_CLOEXEC);
+      if (m_pagemapFd < 0 || m_clearRefsFd < 0) {
+        std::cerr << "## Soft-dirty tracking unavailable: " << strerror(errno) << "\n";
+        closeDirtyTracking();
+        m_dirtyTrackingFailed = true;
+        return false;
+      }
+    }
+
+    const u32 pageSize = dirtyPageSize();
+    const u32 MEM1Size = Common::GetMEM1SizeReal();
+    const u32 MEM2Size = m_MEM2Present ? Common::GetMEM2SizeReal() : 0;
+    m_dirty.assign((static_cast<size_t>(MEM1Size) + MEM2Size + pageSize - 1) / pageSize, 0);
+
+    // Dolphin couldn't be stopped in time; nothing was cleared, so the next scan still sees it all
+    bool wasStopped;
+    if (!stopProcess(wasStopped))
+      return false;
+    bool success = true;
+    for (const SharedView& view : m_views) {
+      success = success && readPagemap(view, 0, 0, MEM1Size, m_dirty);
+      if (m_MEM2Present)
+        success = success && readPagemap(view, m_MEM2FileOffset, MEM1Size, MEM2Size, m_dirty);
+    }
+    success = success && pwrite(m_clearRefsFd, "4", 1, 0) == 1;
+    int error = errno;
+    continueProcess(wasStopped);
+    if (!success) {
+      std::cerr << "## Soft-dirty tracking failed: " << strerror(error) << "\n";
+      closeDirtyTracking();
+      m_dirtyTrackingFailed = true;
+      return false;
+    }
+
+    if (!m_dirtyTrackingStarted) {
+      // New mappings report every page soft-dirty, so a clean first pass means the kernel was
+      // built without CONFIG_MEM_SOFT_DIRTY and the bit will never be set
+      if (std::find(m_dirty.begin(), m_dirty.end(), 1) == m_dirty.end()) {
+        std::cerr << "## Soft-dirty tracking unsupported by this kernel\n";
+        closeDirtyTracking();
+        m_dirtyTrackingFailed = true;
+        return false;
+      }
+      m_dirtyTrackingStarted = true;
+    }
+
+    for (auto& consumer : m_dirtyConsumers) {
+      std::vector<u8>& pages = consumer.second;
+      if (pages.size() != m_dirty.size())
+        pages.assign(m_dirty.size(), 1);
+      for (size_t page = 0; page < pages.size(); page++)
+        pages[page] |= m_dirty[page];
+    }
+    return true;
+  }
+
+  bool LinuxDolphinProcess::dirtyPagesSince(int consumer, std::vector<u32>& cacheIndices) {
+    // m_views and the PID belong to the hook
+    std::shared_lock<std::shared_mutex> hookLock(m_hookMutex);
+    std::lock_guard<std::mutex> lock(m_dirtyMutex);
+    auto found = m_dirtyConsumers.find(consumer);
+    if (found == m_dirtyConsumers.end() || m_dirtyTrackingFailed || !hasEmuRAMInformation() ||
+        !scanDirtyPages())
+      return false;
+
+    const u32 pageSize = dirtyPageSize();
+    std::vector<u8>& pages = found->second;
+    for (size_t page = 0; page < pages.size(); page++) {
+      if (pages[page])
+        cacheIndices.push_back(static_cast<u32>(page * pageSize));
+    }
+    std::fill(pages.begin(), pages.end(), 0);
+    return true;
+  }
+}
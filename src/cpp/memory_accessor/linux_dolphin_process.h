@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+
+namespace DolphinComm
+{
+class LinuxDolphinProcess : public IDolphinProcess
+{
+public:
+  LinuxDolphinProcess() {}
+  ~LinuxDolphinProcess() override;
+
+  std::vector<int> findPIDs() override;
+  bool readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) override;
+  bool writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) override;
+  size_t readHostBatch(HostRead* reads, size_t count) override;
+  size_t writeHostBatch(HostWrite* writes, size_t count) override;
+
+  bool suspend() override;
+  bool resume() override;
+  int addDirtyConsumer() override;
+  void removeDirtyConsumer(int consumer) override;
+  bool dirtyPagesSince(int consumer, std::vector<u32>& cacheIndices) override;
+  u32 dirtyPageSize() const override;
+
+protected:
+  bool obtainEmuRAMInformation() override;
+
+private:
+  // One mapping of Dolphin's shared memory object. Besides the views found for MEM1/MEM2, the
+  // fastmem arena maps the same pages again, and the JIT writes through those.
+  struct SharedView
+  {
+    u64 address;
+    u64 size;
+    u64 fileOffset;
+  };
+
+  // With m_dirtyMutex held
+  bool readPagemap(const SharedView& view, u64 fileStart, u32 cacheStart, u32 regionSize,
+                   std::vector<u8>& dirty);
+  bool scanDirtyPages();
+  void closeDirtyTracking();
+
+  bool allThreadsStopped() const;
+  // suspend()/resume() with the caller keeping wasStopped, so a scan can stop Dolphin briefly
+  // even while a pause is in progress
+  bool stopProcess(bool& wasStopped);
+  bool continueProcess(bool wasStopped);
+
+  std::vector<SharedView> m_views;
+  // Dolphin was already stopped (e.g. by a debugger) when suspend() was called; leave it that way
+  bool m_wasStopped = false;
+  u64 m_MEM2FileOffset = 0;
+
+  // Guards the write tracking state; every consumer samples from a thread of its own
+  std::mutex m_dirtyMutex;
+  int m_pagemapFd = -1;
+  int m_clearRefsFd = -1;
+  bool m_dirtyTrackingFailed = false;
+  bool m_dirtyTrackingStarted = false;
+  // The soft-dirty bits are one interval for the whole process, so every scan is ORed into each
+  // consumer's pages, which are cleared only when that consumer collects them
+  int m_nextDirtyConsumer = 0;
+  std::unordered_map<int, std::vector<u8>> m_dirtyConsumers;
+  std::vector<u8> m_dirty;
+  std::vector<u64> m_pagemap;
+};
+}  // namespace DolphinComm
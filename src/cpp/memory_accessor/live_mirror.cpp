@@ -0,0 +1,254 @@
+#include "live_mirror.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <numeric>
+
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+// Watches closer than this are merged into one read
+constexpr u32 kCoalesceGap = 64;
+constexpr u32 kDefaultRateHz = 60;
+constexpr u32 kMaxRateHz = 1000;
+constexpr std::align_val_t kMirrorAlignment{64};
+
+const char* const kTypeNames[] = {"byte", "halfword", "word", "float", "double", "string", "byteArray"};
+
+double nowMillis() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+             .count() /
+         1000.0;
+}
+}  // namespace
+
+Napi::FunctionReference LiveMirror::constructor;
+
+Napi::Object LiveMirror::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "LiveMirror", {
+    InstanceMethod("getBuffer", &LiveMirror::GetBuffer),
+    InstanceMethod("getLayout", &LiveMirror::GetLayout),
+    InstanceMethod("update", &LiveMirror::Update),
+    InstanceMethod("start", &LiveMirror::Start),
+    InstanceMethod("stop", &LiveMirror::Stop),
+    InstanceMethod("getStats", &LiveMirror::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("LiveMirror", func);
+  return exports;
+}
+
+// new LiveMirror(accessor, [{ offset, type, length? }], { rateHz? = 60 })
+LiveMirror::LiveMirror(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<LiveMirror>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray()) {
+    Napi::TypeError::New(env, "MemoryAccessor and watch list arguments expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  Napi::Array watches = info[1].As<Napi::Array>();
+  std::vector<DolphinComm::MirrorField> fields;
+  for (uint32_t i = 0; i < watches.Length(); i++) {
+    Napi::Value entry = watches.Get(i);
+    DolphinComm::MirrorField field{0, Common::MemType::type_word, 0, 0};
+    if (!entry.IsObject() || !NapiUtils::getU32(entry.As<Napi::Object>(), "offset", field.offset) ||
+        !NapiUtils::parseMemType(entry.As<Napi::Object>().Get("type"), field.type)) {
+      Napi::TypeError::New(env, "Each watch needs a numeric offset and a MemType").ThrowAsJavaScriptException();
+      return;
+    }
+    field.size = NapiUtils::getU32Or(entry.As<Napi::Object>(), "length", 0);
+    fields.push_back(field);
+  }
+
+  u32 rateHz = kDefaultRateHz;
+  if (info.Length() >= 3 && info[2].IsObject())
+    rateHz = NapiUtils::getU32Or(info[2].As<Napi::Object>(), "rateHz", kDefaultRateHz);
+  if (rateHz == 0 || rateHz > kMaxRateHz) {
+    Napi::RangeError::New(env, "LiveMirror: rateHz must be between 1 and 1000").ThrowAsJavaScriptException();
+    return;
+  }
+  m_periodMicros = 1000000 / rateHz;
+
+  if (!m_table.setFields(std::move(fields))) {
+    Napi::RangeError::New(env, "LiveMirror: Watch list is empty, too long or has a watch that is too large")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Sort watches by offset and merge neighbours into spans
+  const std::vector<DolphinComm::MirrorField>& resolved = m_table.fields();
+  std::vector<size_t> order(resolved.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return resolved[a].offset < resolved[b].offset; });
+
+  size_t bufferSize = 0;
+  m_copies.resize(resolved.size());
+  for (size_t index : order) {
+    const DolphinComm::MirrorField& field = resolved[index];
+    if (m_spans.empty() || field.offset > m_spans.back().offset + m_spans.back().size + kCoalesceGap) {
+      m_spans.push_back({field.offset, field.size, bufferSize});
+      bufferSize += field.size;
+    } else {
+      ReadSpan& span = m_spans.back();
+      u32 end = std::max(span.offset + span.size, field.offset + field.size);
+      bufferSize += end - (span.offset + span.size);
+      span.size = end - span.offset;
+    }
+    const ReadSpan& span = m_spans.back();
+    m_copies[index] = {m_spans.size() - 1, span.bufferOffset + (field.offset - span.offset),
+                       m_table.sampleOffsets()[index], field.size};
+  }
+
+  m_spanBuffer.resize(bufferSize);
+  m_sample.resize(m_table.sampleSize());
+  m_fieldOk.resize(resolved.size());
+  for (const ReadSpan& span : m_spans)
+    m_requests.push_back({span.offset, span.size, reinterpret_cast<char*>(m_spanBuffer.data() + span.bufferOffset), false});
+
+  m_memory.reset(static_cast<u8*>(::operator new(m_table.size(), kMirrorAlignment)),
+                 [](u8* memory) { ::operator delete(memory, kMirrorAlignment); });
+  m_table.attach(m_memory.get());
+  Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(
+      env, m_memory.get(), m_table.size(),
+      [](Napi::Env, void*, std::shared_ptr<u8>* owner) { delete owner; }, new std::shared_ptr<u8>(m_memory));
+  m_bufferRef = Napi::Persistent(buffer);
+}
+
+LiveMirror::~LiveMirror() {
+  stopThread();
+}
+
+u32 LiveMirror::update() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto start = std::chrono::steady_clock::now();
+  if (m_process->readBatch(m_requests.data(), m_requests.size()) != m_requests.size())
+    m_failedReads++;
+  for (size_t i = 0; i < m_copies.size(); i++) {
+    const FieldCopy& copy = m_copies[i];
+    m_fieldOk[i] = m_requests[copy.span].ok;
+    if (m_fieldOk[i])
+      std::memcpy(m_sample.data() + copy.sampleOffset, m_spanBuffer.data() + copy.spanBufferOffset, copy.size);
+  }
+  u32 frame = m_table.publish(m_sample.data(), m_fieldOk.data(), nowMillis());
+
+  m_frames++;
+  m_lastUpdateNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  m_maxUpdateNanos = std::max(m_maxUpdateNanos, m_lastUpdateNanos);
+  return frame;
+}
+
+void LiveMirror::run() {
+  auto next = std::chrono::steady_clock::now();
+  while (m_running) {
+    update();
+
+    next += std::chrono::microseconds(m_periodMicros);
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void LiveMirror::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+// getBuffer() => ArrayBuffer; the same one for the mirror's lifetime, laid out as in mirror_table.h
+Napi::Value LiveMirror::GetBuffer(const Napi::CallbackInfo& info) {
+  return m_bufferRef.Value();
+}
+
+// getLayout() => { headerSize, bufferSize, statusOffset, bytesOffset,
+//                  fields: [{ offset, type, length, bytesOffset }] }
+// The same numbers are in the buffer's header; bytesOffset is 0 for numeric fields.
+Napi::Value LiveMirror::GetLayout(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  const auto& fields = m_table.fields();
+  Napi::Array fieldArray = Napi::Array::New(env, fields.size());
+  for (uint32_t i = 0; i < fields.size(); i++) {
+    Napi::Object field = Napi::Object::New(env);
+    field.Set("offset", Napi::Number::New(env, fields[i].offset));
+    field.Set("type", Napi::String::New(env, kTypeNames[static_cast<int>(fields[i].type)]));
+    field.Set("length", Napi::Number::New(env, fields[i].size));
+    field.Set("bytesOffset", Napi::Number::New(env, fields[i].bytesOffset));
+    fieldArray.Set(i, field);
+  }
+
+  Napi::Object layout = Napi::Object::New(env);
+  layout.Set("headerSize", Napi::Number::New(env, DolphinComm::MIRROR_HEADER_SIZE));
+  layout.Set("bufferSize", Napi::Number::New(env, m_table.bufferSize()));
+  layout.Set("statusOffset", Napi::Number::New(env, m_table.statusOffset()));
+  layout.Set("bytesOffset", Napi::Number::New(env, m_table.bytesOffset()));
+  layout.Set("fields", fieldArray);
+  return layout;
+}
+
+// update() => frame number. Reads and publishes one frame now, running or not.
+Napi::Value LiveMirror::Update(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  return Napi::Number::New(env, update());
+}
+
+// start() keeps the buffer current at rateHz until stop()
+Napi::Value LiveMirror::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  m_running = true;
+  m_thread = std::thread(&LiveMirror::run, this);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value LiveMirror::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+// getStats() => { frames, failedReads, reads, lastUpdateMicros, maxUpdateMicros, running }
+Napi::Value LiveMirror::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("frames", Napi::Number::New(env, static_cast<double>(m_frames)));
+  stats.Set("failedReads", Napi::Number::New(env, static_cast<double>(m_failedReads)));
+  stats.Set("reads", Napi::Number::New(env, static_cast<double>(m_spans.size())));
+  stats.Set("lastUpdateMicros", Napi::Number::New(env, m_lastUpdateNanos / 1000.0));
+  stats.Set("maxUpdateMicros", Napi::Number::New(env, m_maxUpdateNanos / 1000.0));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  return stats;
+}
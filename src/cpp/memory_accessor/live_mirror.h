@@ -0,0 +1,78 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "mirror_table.h"
+
+// Keeps a fixed set of watched values current in an ArrayBuffer that JS reads directly (see
+// mirror_table.h for the layout). A native thread reads the watches at a fixed rate and publishes
+// each frame into the buffer; JS takes the latest consistent values with a few typed array reads
+// and no call into the addon, however often it looks.
+class LiveMirror : public Napi::ObjectWrap<LiveMirror> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  LiveMirror(const Napi::CallbackInfo& info);
+  ~LiveMirror();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  // Adjacent watches are read with a single request
+  struct ReadSpan {
+    u32 offset;
+    u32 size;
+    size_t bufferOffset;
+  };
+  struct FieldCopy {
+    size_t span;
+    size_t spanBufferOffset;
+    size_t sampleOffset;
+    u32 size;
+  };
+
+  // Reads the watches and publishes a frame; returns its number
+  u32 update();
+  void run();
+  void stopThread();
+
+  Napi::Value GetBuffer(const Napi::CallbackInfo& info);
+  Napi::Value GetLayout(const Napi::CallbackInfo& info);
+  Napi::Value Update(const Napi::CallbackInfo& info);
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  // The buffer and this object share the memory: JS may keep reading after the mirror is
+  // collected, and the buffer may be finalized first when the environment shuts down
+  std::shared_ptr<u8> m_memory;
+  Napi::Reference<Napi::ArrayBuffer> m_bufferRef;
+
+  std::mutex m_mutex;
+  DolphinComm::MirrorTable m_table;
+  std::vector<ReadSpan> m_spans;
+  std::vector<DolphinComm::ReadRequest> m_requests;
+  std::vector<FieldCopy> m_copies;
+  std::vector<u8> m_spanBuffer;
+  std::vector<u8> m_sample;
+  std::vector<u8> m_fieldOk;
+
+  u32 m_periodMicros = 0;
+  u64 m_frames = 0;
+  u64 m_failedReads = 0;
+  u64 m_lastUpdateNanos = 0;
+  u64 m_maxUpdateNanos = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+};
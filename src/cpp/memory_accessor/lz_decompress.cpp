@@ -0,0 +1,244 @@
+#include "lz_decompress.h"
+
+#include <cstring>
+
+namespace Common
+{
+namespace
+{
+class BlockDecoder
+{
+public:
+  BlockDecoder(const u8* src, size_t srcSize, u8* dst, size_t dstCapacity)
+      : m_src(src), m_srcSize(srcSize), m_dst(dst), m_dstCapacity(dstCapacity)
+  {
+  }
+
+  bool atEnd() const { return m_ip == m_srcSize; }
+  size_t written() const { return m_op; }
+
+  bool readByte(size_t& value)
+  {
+    if (m_ip >= m_srcSize)
+      return false;
+    value = m_src[m_ip++];
+    return true;
+  }
+
+  bool readLE16(size_t& value)
+  {
+    if (m_srcSize - m_ip < 2)
+      return false;
+    value = m_src[m_ip] | (m_src[m_ip + 1] << 8);
+    m_ip += 2;
+    return true;
+  }
+
+  bool peekByte(u8& value) const
+  {
+    if (m_ip >= m_srcSize)
+      return false;
+    value = m_src[m_ip];
+    return true;
+  }
+
+  void skip() { ++m_ip; }
+
+  bool copyLiterals(size_t count)
+  {
+    if (m_srcSize - m_ip < count || m_dstCapacity - m_op < count)
+      return false;
+    std::memcpy(m_dst + m_op, m_src + m_ip, count);
+    m_ip += count;
+    m_op += count;
+    return true;
+  }
+
+  bool copyMatch(size_t distance, size_t length)
+  {
+    if (distance == 0 || distance > m_op || m_dstCapacity - m_op < length)
+      return false;
+    u8* out = m_dst + m_op;
+    const u8* match = out - distance;
+    if (distance >= length)
+    {
+      std::memcpy(out, match, length);
+    }
+    else
+    {
+      // Overlapping matches repeat the last `distance` bytes, so they must go byte by byte
+      for (size_t i = 0; i < length; ++i)
+        out[i] = match[i];
+    }
+    m_op += length;
+    return true;
+  }
+
+private:
+  const u8* m_src;
+  size_t m_srcSize;
+  u8* m_dst;
+  size_t m_dstCapacity;
+  size_t m_ip = 0;
+  size_t m_op = 0;
+};
+
+// LZ4 lengths continue with bytes added on while they are 255
+bool readLZ4Length(BlockDecoder& decoder, size_t& length)
+{
+  size_t byte;
+  do
+  {
+    if (!decoder.readByte(byte))
+      return false;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// LZO lengths of zero continue with a run of zero bytes (255 each) and a final byte
+bool readLZOLength(BlockDecoder& decoder, size_t base, size_t& length)
+{
+  size_t zeros = 0;
+  u8 byte;
+  while (decoder.peekByte(byte) && byte == 0)
+  {
+    decoder.skip();
+    ++zeros;
+  }
+  size_t last;
+  if (!decoder.readByte(last))
+    return false;
+  length = base + zeros * 255 + last;
+  return true;
+}
+}  // namespace
+
+bool decompressLZ4Block(const u8* src, size_t srcSize, u8* dst, size_t dstCapacity, size_t& written)
+{
+  BlockDecoder decoder(src, srcSize, dst, dstCapacity);
+  if (srcSize == 0)
+    return false;
+
+  while (!decoder.atEnd())
+  {
+    size_t token;
+    decoder.readByte(token);
+    size_t literals = token >> 4;
+    if (literals == 15 && !readLZ4Length(decoder, literals))
+      return false;
+    if (!decoder.copyLiterals(literals))
+      return false;
+    // The last sequence is literals only
+    if (decoder.atEnd())
+      break;
+
+    size_t distance;
+    size_t length = token & 15;
+    if (!decoder.readLE16(distance) || (length == 15 && !readLZ4Length(decoder, length)))
+      return false;
+    if (!decoder.copyMatch(distance, length + 4))
+      return false;
+  }
+  written = decoder.written();
+  return true;
+}
+
+bool decompressLZO1X(const u8* src, size_t srcSize, u8* dst, size_t dstCapacity, size_t& written)
+{
+  BlockDecoder decoder(src, srcSize, dst, dstCapacity);
+  // Literals copied after the previous instruction: 0-3 from a match, 4 for a literal run. It
+  // decides what a small instruction byte means.
+  size_t state = 0;
+
+  u8 first;
+  if (!decoder.peekByte(first))
+    return false;
+  // A first byte above 17 starts the stream with a literal run of first - 17 bytes
+  if (first > 17)
+  {
+    decoder.skip();
+    if (!decoder.copyLiterals(first - 17u))
+      return false;
+    state = first - 17u < 4 ? first - 17u : 4;
+  }
+
+  while (true)
+  {
+    size_t t;
+    if (!decoder.readByte(t))
+      return false;
+
+    size_t distance;
+    size_t length;
+    size_t next;
+    if (t < 16)
+    {
+      if (state == 0)
+      {
+        // Literal run of t + 3 bytes
+        size_t run = t;
+        if (t == 0 && !readLZOLength(decoder, 15, run))
+          return false;
+        if (!decoder.copyLiterals(run + 3))
+          return false;
+        state = 4;
+        continue;
+      }
+      size_t high;
+      if (!decoder.readByte(high))
+        return false;
+      next = t & 3;
+      if (state != 4)
+      {
+        distance = 1 + (t >> 2) + (high << 2);
+        length = 2;
+      }
+      else
+      {
+        distance = 1 + 0x800 + (t >> 2) + (high << 2);
+        length = 3;
+      }
+    }
+    else if (t >= 64)
+    {
+      size_t high;
+      if (!decoder.readByte(high))
+        return false;
+      next = t & 3;
+      distance = 1 + ((t >> 2) & 7) + (high << 3);
+      length = (t >> 5) + 1;
+    }
+    else
+    {
+      // 32-63: distance up to 16 KB; 16-31: up to 48 KB, or the end of the stream
+      const bool far = t < 32;
+      length = (t & (far ? 7 : 31)) + 2;
+      if (length == 2 && !readLZOLength(decoder, far ? 9 : 33, length))
+        return false;
+      size_t value;
+      if (!decoder.readLE16(value))
+        return false;
+      next = value & 3;
+      if (far)
+      {
+        distance = ((t & 8) << 11) + (value >> 2);
+        if (distance == 0)
+        {
+          written = decoder.written();
+          return length == 3 && decoder.atEnd();
+        }
+        distance += 0x4000;
+      }
+      else
+      {
+        distance = 1 + (value >> 2);
+      }
+    }
+
+    if (!decoder.copyMatch(distance, length) || !decoder.copyLiterals(next))
+      return false;
+    state = next;
+  }
+}
+}  // namespace Common
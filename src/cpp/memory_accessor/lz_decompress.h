@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+#include "common_types.h"
+
+namespace Common
+{
+// Decoders for the block formats Dolphin compresses savestates with. Both are bounds checked on
+// input and output, so corrupt data fails instead of reading or writing out of range. `written` is
+// the decompressed size on success.
+
+// One LZ4 block (the LZ4_compress_default format, no frame header)
+bool decompressLZ4Block(const u8* src, size_t srcSize, u8* dst, size_t dstCapacity, size_t& written);
+// One LZO1X block (lzo1x_1_compress output)
+bool decompressLZO1X(const u8* src, size_t srcSize, u8* dst, size_t dstCapacity, size_t& written);
+}  // namespace Common
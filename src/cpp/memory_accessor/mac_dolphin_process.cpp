@@ -12,35 +12,38 @@
 #include <sys/ptrace.h>
 
 namespace DolphinComm {
-  bool MacDolphinProcess::findPID() {
-    Common::UpdateMemoryValues();
+  MacDolphinProcess::~MacDolphinProcess() {
+    if (m_task != MACH_PORT_NULL)
+      mach_port_deallocate(mach_task_self(), m_task);
+  }
+
+  std::vector<int> MacDolphinProcess::findPIDs() {
     static const int mib[4] = {CTL_KERN, KERN_PROC, KERN_PROC_ALL, 0};
+    std::vector<int> pids;
 
     size_t procSize = 0;
     if (sysctl((int*)mib, 4, NULL, &procSize, NULL, 0) == -1)
-      return false;
+      return pids;
 
     auto procs = std::make_unique<kinfo_proc[]>(procSize / sizeof(kinfo_proc));
     if (sysctl((int*)mib, 4, procs.get(), &procSize, NULL, 0) == -1)
-      return false;
+      return pids;
 
     static const char* const s_dolphinProcessName{std::getenv("DME_DOLPHIN_PROCESS_NAME")};
 
-    m_PID = -1;
     for (int i = 0; i < procSize / sizeof(kinfo_proc); i++) {
       const std::string_view name{procs[i].kp_proc.p_comm};
       const bool match{s_dolphinProcessName ? name == s_dolphinProcessName : (name == "Dolphin" || name == "dolphin-emu")};
       if (match) {
-        m_PID = procs[i].kp_proc.p_pid;
+        pids.push_back(procs[i].kp_proc.p_pid);
       }
     }
 
-    if (m_PID == -1)
-      return false;
-    return true;
+    return pids;
   }
 
   bool MacDolphinProcess::obtainEmuRAMInformation() {
+    resetEmuRAMInformation();
     if (ptrace(PT_ATTACH, m_PID, 0, 0) == 0) {
       int status;
       waitpid(m_PID, &status, 0);
@@ -56,6 +59,10 @@ namespace DolphinComm {
     std::cerr << "## Current task: " << m_currentTask << "\n";
     
     // Try task_for_pid first, then fall back to task_name_for_pid if needed
+    if (m_task != MACH_PORT_NULL) {
+      mach_port_deallocate(m_currentTask, m_task);
+      m_task = MACH_PORT_NULL;
+    }
     kern_return_t error = task_for_pid(m_currentTask, m_PID, &m_task);
     if (error != KERN_SUCCESS) {
       std::cerr << "## task_for_pid failed with code: " << error << "\n";
@@ -71,6 +78,16 @@ namespace DolphinComm {
     
     std::cerr << "## Successfully got task port: " << m_task << "\n";
     
+    // Dolphin lays its physical regions out back to back in one shared memory object: MEM1 at
+    // offset 0, the L1 cache (0x40000), the fake VMEM backing ARAM (only without MMU), then MEM2.
+    struct SharedRegion {
+      mach_vm_address_t address;
+      mach_vm_size_t size;
+      u64 offset;
+      unsigned int objectId;
+    };
+    std::vector<SharedRegion> candidates;
+
     mach_vm_address_t regionAddr = 0;
     mach_vm_size_t size = 0;
     vm_region_extended_info_data_t regInfo;
@@ -78,8 +95,6 @@ namespace DolphinComm {
     vm_region_top_info_data_t topInfo;
     mach_msg_type_number_t cnt = VM_REGION_EXTENDED_INFO_COUNT;
     mach_port_t obj;
-    bool MEM1Found = false;
-    unsigned int MEM1Obj = 0;
     while (mach_vm_region(m_task, &regionAddr, &size, VM_REGION_EXTENDED_INFO, (int*)&regInfo, &cnt, &obj) == KERN_SUCCESS) {
       cnt = VM_REGION_BASIC_INFO_COUNT_64;
       if (mach_vm_region(m_task, &regionAddr, &size, VM_REGION_BASIC_INFO_64, (int*)&basInfo, &cnt, &obj) != KERN_SUCCESS)
@@ -88,27 +103,42 @@ namespace DolphinComm {
       if (mach_vm_region(m_task, &regionAddr, &size, VM_REGION_TOP_INFO, (int*)&topInfo, &cnt, &obj) != 0)
         break;
 
-      // if these are true, then it is very likely the correct region, but we cannot guarantee
-      if ((!MEM1Found || (MEM1Found && MEM1Obj == topInfo.obj_id)) && size == Common::GetMEM1Size() &&
-          regInfo.share_mode == SM_TRUESHARED &&
-          basInfo.max_protection == (VM_PROT_READ | VM_PROT_WRITE)) {
-        if (basInfo.offset == 0x0) {
-          m_emuRAMAddressStart = regionAddr;
-          MEM1Found = true;
-        }
-        else if (basInfo.offset == Common::GetMEM1Size() + 0x40000) {
-          m_emuARAMAdressStart = regionAddr;
-          m_ARAMAccessible = true;
-        }
-
-        MEM1Found = true;
-        MEM1Obj = topInfo.obj_id;
-      }
+      if (regInfo.share_mode == SM_TRUESHARED && basInfo.max_protection == (VM_PROT_READ | VM_PROT_WRITE))
+        candidates.push_back({regionAddr, size, basInfo.offset, topInfo.obj_id});
 
       regionAddr += size;
       cnt = VM_REGION_EXTENDED_INFO_COUNT;
     }
 
+    // if these are true, then it is very likely the correct region, but we cannot guarantee
+    unsigned int MEM1Obj = 0;
+    for (const SharedRegion& region : candidates) {
+      if (region.offset == 0x0 && region.size == Common::GetMEM1Size()) {
+        m_emuRAMAddressStart = region.address;
+        MEM1Obj = region.objectId;
+        break;
+      }
+    }
+
+    const u64 afterL1Cache = Common::GetMEM1Size() + 0x40000;
+    for (const SharedRegion& region : candidates) {
+      if (m_emuRAMAddressStart == 0 || region.objectId != MEM1Obj)
+        continue;
+
+      if (!m_ARAMAccessible && region.offset == afterL1Cache && region.size == Common::ARAM_FAKESIZE) {
+        m_emuARAMAdressStart = region.address;
+        m_ARAMAccessible = true;
+      }
+      else if (!m_MEM2Present && Common::GetMEM2Size() != 0 && region.size == Common::GetMEM2Size() &&
+               (region.offset == afterL1Cache || region.offset == afterL1Cache + Common::ARAM_FAKESIZE)) {
+        m_MEM2AddressStart = region.address;
+        m_MEM2Present = true;
+      }
+    }
+
+    if (m_MEM2Present)
+      std::cerr << "## Found MEM2 at address 0x" << std::hex << m_MEM2AddressStart << std::dec << "\n";
+
     if (m_emuRAMAddressStart != 0) {
       std::cerr << "## Found emulated RAM at address 0x" << std::hex << m_emuRAMAddressStart << std::dec << "\n";
       return true;
@@ -118,7 +148,7 @@ namespace DolphinComm {
     return false;
   }
 
-  bool MacDolphinProcess::readAtOffset(mach_vm_address_t baseAddr, uint32_t offset, char* buffer, size_t size) {
+  bool MacDolphinProcess::readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) {
     vm_size_t bytesRead;
     kern_return_t result = vm_read_overwrite(m_task, baseAddr + offset, size, (vm_address_t)buffer, &bytesRead);
 
@@ -128,7 +158,7 @@ namespace DolphinComm {
     return true;
   }
 
-  bool MacDolphinProcess::writeAtOffset(mach_vm_address_t baseAddr, uint32_t offset, char* buffer, size_t size) {
+  bool MacDolphinProcess::writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) {
     char* bufferCopy = new char[size];
     std::memcpy(bufferCopy, buffer, size);
 
@@ -141,4 +171,16 @@ namespace DolphinComm {
     delete[] bufferCopy;
     return true;
   }
+
+  // task_suspend returns once no thread of the task runs user code any more. A name port from
+  // task_name_for_pid can't suspend, so this fails cleanly in that case.
+  bool MacDolphinProcess::suspend() {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    return m_task != MACH_PORT_NULL && task_suspend(m_task) == KERN_SUCCESS;
+  }
+
+  bool MacDolphinProcess::resume() {
+    std::shared_lock<std::shared_mutex> lock(m_hookMutex);
+    return m_task != MACH_PORT_NULL && task_resume(m_task) == KERN_SUCCESS;
+  }
 }
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "common_types.h"
+#include "dolphin_process.h"
 
 struct MemoryRegionInfo {
   mach_vm_address_t address;
@@ -13,46 +14,23 @@ struct MemoryRegionInfo {
 
 namespace DolphinComm
 {
-  class IDolphinProcess
-{
-public:
-  
-
-protected:
-  
-};
-
 class MacDolphinProcess : public IDolphinProcess
 {
 public:
   MacDolphinProcess() {}
+  ~MacDolphinProcess() override;
 
-  int getPID() const { return m_PID; };
-  u64 getEmuRAMAddressStart() const { return m_emuRAMAddressStart; };
-  bool isMEM2Present() const { return m_MEM2Present; };
-  bool isARAMAccessible() const { return m_ARAMAccessible; };
-  bool hasEmuRAMInformation() const { return m_emuRAMAddressStart != 0; };
-  u64 getARAMAddressStart() const { return m_emuARAMAdressStart; };
-  u64 getMEM2AddressStart() const { return m_MEM2AddressStart; };
-  u64 getMEM1ToMEM2Distance() const
-  {
-    if (!m_MEM2Present)
-      return 0;
-    return m_MEM2AddressStart - m_emuRAMAddressStart;
-  };
-  bool findPID();
-  bool obtainEmuRAMInformation();
-  bool readAtOffset(mach_vm_address_t baseAddr, uint32_t offset, char* buffer, size_t size);
-  bool writeAtOffset(mach_vm_address_t baseAddr, uint32_t offset, char* buffer, size_t size);
+  std::vector<int> findPIDs() override;
+  bool readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) override;
+  bool writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) override;
+  bool suspend() override;
+  bool resume() override;
+
+protected:
+  bool obtainEmuRAMInformation() override;
 
 private:
-  task_t m_task;
-  task_t m_currentTask;
-  int m_PID = -1;
-  u64 m_emuRAMAddressStart = 0;
-  u64 m_emuARAMAdressStart = 0;
-  u64 m_MEM2AddressStart = 0;
-  bool m_ARAMAccessible = false;
-  bool m_MEM2Present = false;
+  task_t m_task = MACH_PORT_NULL;
+  task_t m_currentTask = MACH_PORT_NULL;
 };
 }  // namespace DolphinComm
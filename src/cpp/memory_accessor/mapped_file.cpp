@@ -0,0 +1,134 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Common
+{
+bool MappedFile::openReadOnly(const std::string& path)
+{
+  close();
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+  {
+    close();
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    std::cerr << "## mmap of " << path << " failed: " << strerror(errno) << "\n";
+    close();
+    return false;
+  }
+
+  m_data = static_cast<u8*>(mapping);
+  m_size = st.st_size;
+  m_mappedSize = m_size;
+  m_writable = false;
+  return true;
+}
+
+bool MappedFile::openReadWrite(const std::string& path, size_t minSize, bool truncate)
+{
+  close();
+  m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+  if (m_fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0)
+  {
+    close();
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size) > minSize ? st.st_size : minSize;
+  if (static_cast<size_t>(st.st_size) < size && ftruncate(m_fd, size) != 0)
+  {
+    close();
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    std::cerr << "## mmap of " << path << " failed: " << strerror(errno) << "\n";
+    close();
+    return false;
+  }
+
+  m_data = static_cast<u8*>(mapping);
+  m_size = size;
+  m_mappedSize = size;
+  m_writable = true;
+  return true;
+}
+
+bool MappedFile::grow(size_t newSize)
+{
+  if (!m_writable)
+    return false;
+  if (newSize <= m_size)
+    return true;
+
+  if (ftruncate(m_fd, newSize) != 0)
+    return false;
+
+  munmap(m_data, m_mappedSize);
+  void* mapping = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    m_data = nullptr;
+    m_size = 0;
+    m_mappedSize = 0;
+    return false;
+  }
+
+  m_data = static_cast<u8*>(mapping);
+  m_size = newSize;
+  m_mappedSize = newSize;
+  return true;
+}
+
+bool MappedFile::truncate(size_t finalSize)
+{
+  if (!m_writable || finalSize > m_size)
+    return false;
+  // Dropping the tail of a MAP_SHARED mapping is fine as long as nothing touches it afterwards
+  if (ftruncate(m_fd, finalSize) != 0)
+    return false;
+  m_size = finalSize;
+  return true;
+}
+
+bool MappedFile::sync()
+{
+  if (!m_writable || m_data == nullptr)
+    return false;
+  return msync(m_data, m_size, MS_ASYNC) == 0;
+}
+
+void MappedFile::close()
+{
+  if (m_data != nullptr)
+    munmap(m_data, m_mappedSize);
+  if (m_fd >= 0)
+    ::close(m_fd);
+  m_data = nullptr;
+  m_size = 0;
+  m_mappedSize = 0;
+  m_fd = -1;
+  m_writable = false;
+}
+}  // namespace Common
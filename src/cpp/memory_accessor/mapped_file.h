@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "common_types.h"
+
+namespace Common
+{
+// Thin RAII wrapper around an mmap'ed file. Writable mappings can be grown in place; growing
+// remaps the file, so pointers obtained from data() before a grow() are invalidated.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool openReadOnly(const std::string& path);
+  // Opens (creating if needed) a file for read/write and maps at least minSize bytes of it
+  bool openReadWrite(const std::string& path, size_t minSize, bool truncate);
+  // Extends a writable mapping to at least newSize bytes
+  bool grow(size_t newSize);
+  // Shrinks the file on disk to its final size; the mapping stays valid up to that size
+  bool truncate(size_t finalSize);
+  bool sync();
+  void close();
+
+  bool isOpen() const { return m_data != nullptr; }
+  u8* data() { return m_data; }
+  const u8* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  int m_fd = -1;
+  u8* m_data = nullptr;
+  size_t m_size = 0;
+  size_t m_mappedSize = 0;
+  bool m_writable = false;
+};
+}  // namespace Common
@@ -1,6 +1,101 @@
 #include "memory_accessor.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+
+#include "executor.h"
+#include "executor_job.h"
+#include "memory_layout.h"
+#include "napi_utils.h"
+#include "region_classifier.h"
+#include "region_renderer.h"
+#include "savestate_process.h"
+#include "structure_walker.h"
+#include "symbol_map.h"
+
+namespace {
+constexpr u32 CLASSIFY_CHUNK_SIZE = 1024 * 1024;
+// Default and upper bound on how long withPaused/readConsistent may keep Dolphin suspended
+constexpr u32 MAX_PAUSE_MS = 50;
+constexpr u32 MAX_PAUSE_LIMIT_MS = 10000;
+constexpr u32 MAX_RENDER_SIZE = 16 * 1024 * 1024;
+// Hex and numbers tokenize worse than prose; budgets assume this many chars per token
+constexpr u32 RENDER_CHARS_PER_TOKEN = 3;
+
+// Reads { maxPauseMs } from info[index] if present; throws and returns false if it is out of range
+bool getMaxPauseMicros(const Napi::CallbackInfo& info, size_t index, u32& maxPauseMicros) {
+  u32 maxPauseMs = info.Length() > index && info[index].IsObject()
+                       ? NapiUtils::getU32Or(info[index].As<Napi::Object>(), "maxPauseMs", MAX_PAUSE_MS)
+                       : MAX_PAUSE_MS;
+  if (maxPauseMs == 0 || maxPauseMs > MAX_PAUSE_LIMIT_MS) {
+    Napi::RangeError::New(info.Env(), "maxPauseMs must be between 1 and 10000").ThrowAsJavaScriptException();
+    return false;
+  }
+  maxPauseMicros = maxPauseMs * 1000;
+  return true;
+}
+
+void throwGuestAccessError(Napi::Env env, const char* operation, DolphinComm::GuestAccess result, u32 address) {
+  std::ostringstream message;
+  message << operation << ": " << (result == DolphinComm::GuestAccess::unmapped ? "Unmapped" : "Failed to access")
+          << " guest address 0x" << std::hex << std::setw(8) << std::setfill('0') << address;
+  if (result == DolphinComm::GuestAccess::unmapped)
+    Napi::RangeError::New(env, message.str()).ThrowAsJavaScriptException();
+  else
+    Napi::Error::New(env, message.str()).ThrowAsJavaScriptException();
+}
+
+void parseDumpOptions(const Napi::CallbackInfo& info, bool& includeMEM2, bool& direct) {
+  includeMEM2 = true;
+  direct = false;
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    if (options.Get("includeMEM2").IsBoolean())
+      includeMEM2 = options.Get("includeMEM2").As<Napi::Boolean>().Value();
+    direct = options.Get("direct").IsBoolean() && options.Get("direct").As<Napi::Boolean>().Value();
+  }
+}
+
+Napi::Object dumpResultToJS(Napi::Env env, const DolphinComm::RamDumpStats& stats, double millis) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+  result.Set("chunks", Napi::Number::New(env, stats.chunks));
+  result.Set("millis", Napi::Number::New(env, millis));
+  result.Set("ioUring", Napi::Boolean::New(env, stats.ioUring));
+  result.Set("direct", Napi::Boolean::New(env, stats.direct));
+  return result;
+}
+
+class DumpJob : public ExecutorJob {
+public:
+  DumpJob(const Napi::Object& accessor, std::string path, bool includeMEM2, bool direct)
+    : m_accessorRef(Napi::Persistent(accessor)), m_accessor(MemoryAccessor::Unwrap(accessor)),
+      m_path(std::move(path)), m_includeMEM2(includeMEM2), m_direct(direct) {}
+
+protected:
+  void execute() override {
+    auto start = std::chrono::steady_clock::now();
+    std::string error;
+    if (!m_accessor->dumpRam(m_path, m_includeMEM2, m_direct, m_stats, error))
+      setError("DumpToFile: " + error);
+    m_millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  Napi::Value result(Napi::Env env) override { return dumpResultToJS(env, m_stats, m_millis); }
+
+private:
+  Napi::ObjectReference m_accessorRef;
+  MemoryAccessor* m_accessor;
+  std::string m_path;
+  bool m_includeMEM2;
+  bool m_direct;
+  DolphinComm::RamDumpStats m_stats{};
+  double m_millis = 0;
+};
+}  // namespace
 
 Napi::FunctionReference MemoryAccessor::constructor;
 
@@ -13,6 +108,25 @@ Napi::Object MemoryAccessor::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("hook", &MemoryAccessor::Hook),
     InstanceMethod("isHooked", &MemoryAccessor::IsHooked),
     InstanceMethod("getPID", &MemoryAccessor::GetPID),
+    InstanceMethod("readBatch", &MemoryAccessor::ReadBatch),
+    InstanceMethod("readInto", &MemoryAccessor::ReadInto),
+    InstanceMethod("readBatchInto", &MemoryAccessor::ReadBatchInto),
+    InstanceMethod("readGuest", &MemoryAccessor::ReadGuest),
+    InstanceMethod("writeGuest", &MemoryAccessor::WriteGuest),
+    InstanceMethod("readGuestBatch", &MemoryAccessor::ReadGuestBatch),
+    InstanceMethod("withPaused", &MemoryAccessor::WithPaused),
+    InstanceMethod("readConsistent", &MemoryAccessor::ReadConsistent),
+    InstanceMethod("getPauseStats", &MemoryAccessor::GetPauseStats),
+    InstanceMethod("classifyRegions", &MemoryAccessor::ClassifyRegions),
+    InstanceMethod("walkStructure", &MemoryAccessor::WalkStructure),
+    InstanceMethod("renderRegion", &MemoryAccessor::RenderRegion),
+    InstanceMethod("dumpToFile", &MemoryAccessor::DumpToFile),
+    InstanceMethod("dumpToFileAsync", &MemoryAccessor::DumpToFileAsync),
+    InstanceMethod("restoreFromFile", &MemoryAccessor::RestoreFromFile),
+    StaticMethod("listInstances", &MemoryAccessor::ListInstances),
+    StaticMethod("setMemoryLayout", &MemoryAccessor::SetMemoryLayout),
+    StaticMethod("getMemoryLayout", &MemoryAccessor::GetMemoryLayout),
+    StaticMethod("translateAddresses", &MemoryAccessor::TranslateAddresses),
   });
 
   constructor = Napi::Persistent(func);
@@ -26,6 +140,38 @@ MemoryAccessor::MemoryAccessor(const Napi::CallbackInfo& info)
   : Napi::ObjectWrap<MemoryAccessor>(info) {
   Napi::Env env = info.Env();
   Napi::HandleScope scope(env);
+
+  // new MemoryAccessor({ savestate, mem1Offset?, mem2Offset?, aramOffset? }) reads a savestate file
+  // instead of a running Dolphin; the offsets locate sections the search can't find
+  if (info.Length() >= 1 && info[0].IsObject() && info[0].As<Napi::Object>().Get("savestate").IsString()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    DolphinComm::SavestateImage::Sections overrides;
+    u32 offset;
+    if (NapiUtils::getU32(options, "mem1Offset", offset))
+      overrides.mem1 = offset;
+    if (NapiUtils::getU32(options, "mem2Offset", offset))
+      overrides.mem2 = offset;
+    if (NapiUtils::getU32(options, "aramOffset", offset))
+      overrides.aram = offset;
+
+    auto savestate = std::make_unique<DolphinComm::SavestateProcess>();
+    std::string path = options.Get("savestate").As<Napi::String>().Utf8Value();
+    std::string error;
+    if (!savestate->open(path, overrides, error)) {
+      Napi::Error::New(env, "MemoryAccessor: " + error).ThrowAsJavaScriptException();
+      return;
+    }
+    const DolphinComm::SavestateImage& image = savestate->image();
+    std::cerr << "## Loaded savestate " << path << " (" << image.gameId() << ", " << image.size() << " bytes in "
+              << image.chunkCount() << " chunks" << (savestate->isARAMAccessible() ? ", ARAM" : "") << ")\n";
+    m_process = std::move(savestate);
+    return;
+  }
+
+  m_process = DolphinComm::IDolphinProcess::create();
+  if (!m_process) {
+    Napi::Error::New(env, "MemoryAccessor: No Dolphin process backend for this platform").ThrowAsJavaScriptException();
+  }
 }
 
 Napi::Value MemoryAccessor::ReadAtOffset(const Napi::CallbackInfo& info) {
@@ -57,16 +203,15 @@ Napi::Value MemoryAccessor::ReadAtOffset(const Napi::CallbackInfo& info) {
 
   uint32_t offset = info[1].As<Napi::Number>().Uint32Value();
   size_t size = info[2].As<Napi::Number>().Uint32Value();
-  std::vector<uint8_t> bytes(size);
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, size);
 
-  bool success = m_process.readAtOffset(baseAddr, offset, reinterpret_cast<char*>(bytes.data()), size);
+  bool success = m_process->readAtOffset(baseAddr, offset, reinterpret_cast<char*>(buffer.Data()), size);
 
   if (!success) {
     Napi::Error::New(env, "ReadAtOffset: Failed to read memory").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(env, bytes.data(), size);
   return buffer;
 }
 
@@ -101,7 +246,7 @@ Napi::Value MemoryAccessor::WriteAtOffset(const Napi::CallbackInfo& info) {
   Napi::Buffer<uint8_t> buffer = info[2].As<Napi::Buffer<uint8_t>>();
   size_t size = info[3].As<Napi::Number>().Uint32Value();
 
-  bool success = m_process.writeAtOffset(baseAddr, offset, reinterpret_cast<char*>(buffer.Data()), size);
+  bool success = m_process->writeAtOffset(baseAddr, offset, reinterpret_cast<char*>(buffer.Data()), size);
 
   return Napi::Boolean::New(env, success);
 }
@@ -110,14 +255,19 @@ Napi::Value MemoryAccessor::Hook(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   Napi::HandleScope scope(env);
 
-  bool success = m_process.findPID();
-  
-  if (success) {
-    std::cerr << "## Found Dolphin PID!\n";
-    success = m_process.obtainEmuRAMInformation();
+  bool success;
+  if (info.Length() >= 1 && info[0].IsNumber()) {
+    success = m_process->hookPID(info[0].As<Napi::Number>().Int32Value());
+  } else {
+    success = m_process->findPID();
+
+    if (success) {
+      std::cerr << "## Found Dolphin PID!\n";
+      success = m_process->hookPID(m_process->getPID());
+    }
   }
 
-  u64 emuRAMAddressStart = m_process.getEmuRAMAddressStart();
+  u64 emuRAMAddressStart = m_process->getEmuRAMAddressStart();
 
   return Napi::Number::New(env, emuRAMAddressStart);
 }
@@ -126,7 +276,7 @@ Napi::Value MemoryAccessor::IsHooked(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   Napi::HandleScope scope(env);
 
-  bool hooked = m_process.hasEmuRAMInformation();
+  bool hooked = m_process->hasEmuRAMInformation();
   
   return Napi::Boolean::New(env, hooked);
 }
@@ -135,7 +285,812 @@ Napi::Value MemoryAccessor::GetPID(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   Napi::HandleScope scope(env);
 
-  int pid = m_process.getPID();
+  int pid = m_process->getPID();
   
   return Napi::Number::New(env, pid);
 }
+
+// readBatch([{ offset, size }]) => Array<Uint8Array | null>. Every result is a view into one
+// shared ArrayBuffer; failed reads come back as null.
+Napi::Value MemoryAccessor::ReadBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "Array of { offset, size } requests expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array requests = info[0].As<Napi::Array>();
+  std::vector<DolphinComm::ReadRequest> reads(requests.Length());
+  std::vector<size_t> positions(requests.Length());
+  size_t total = 0;
+  for (uint32_t i = 0; i < requests.Length(); i++) {
+    Napi::Value request = requests.Get(i);
+    if (!request.IsObject() || !NapiUtils::getU32(request.As<Napi::Object>(), "offset", reads[i].offset) ||
+        !NapiUtils::getU32(request.As<Napi::Object>(), "size", reads[i].size)) {
+      Napi::TypeError::New(env, "Each request needs a numeric offset and size").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    positions[i] = total;
+    total += reads[i].size;
+  }
+
+  Napi::ArrayBuffer arena = Napi::ArrayBuffer::New(env, total);
+  char* base = static_cast<char*>(arena.Data());
+  for (size_t i = 0; i < reads.size(); i++)
+    reads[i].buffer = base + positions[i];
+
+  m_process->readBatch(reads.data(), reads.size());
+
+  Napi::Array result = Napi::Array::New(env, reads.size());
+  for (uint32_t i = 0; i < reads.size(); i++) {
+    if (reads[i].ok)
+      result.Set(i, Napi::Uint8Array::New(env, reads[i].size, arena, positions[i]));
+    else
+      result.Set(i, env.Null());
+  }
+  return result;
+}
+
+// readInto(target, targetOffset, offset, size) => boolean. Reads straight into a Buffer, TypedArray,
+// DataView or ArrayBuffer the caller owns, so polling with a preallocated target creates no garbage.
+// offset is as for readBatch; false if the read failed.
+Napi::Value MemoryAccessor::ReadInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u8* target;
+  size_t targetSize;
+  if (info.Length() < 4 || !NapiUtils::getBytes(info[0], target, targetSize) || !info[1].IsNumber() ||
+      !info[2].IsNumber() || !info[3].IsNumber()) {
+    Napi::TypeError::New(env, "Target buffer, target offset, offset, and size arguments expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t targetOffset = info[1].As<Napi::Number>().Uint32Value();
+  u32 offset = info[2].As<Napi::Number>().Uint32Value();
+  size_t size = info[3].As<Napi::Number>().Uint32Value();
+  if (targetOffset > targetSize || size > targetSize - targetOffset) {
+    Napi::RangeError::New(env, "ReadInto: Target is too small").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Boolean::New(env, m_process->readFromRAM(offset, reinterpret_cast<char*>(target + targetOffset), size));
+}
+
+// readBatchInto(target, requests: Uint32Array, status?: Uint8Array) => number of reads that succeeded.
+// requests holds [offset, size, targetOffset] triples; every read lands in the one target arena
+// and goes to the backend as a single batch. status, if given, gets 1 or 0 per request. Reusing
+// the same arrays keeps steady-state polling free of allocations.
+Napi::Value MemoryAccessor::ReadBatchInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u8* target;
+  size_t targetSize;
+  if (info.Length() < 2 || !NapiUtils::getBytes(info[0], target, targetSize) || !info[1].IsTypedArray() ||
+      info[1].As<Napi::TypedArray>().TypedArrayType() != napi_uint32_array) {
+    Napi::TypeError::New(env, "Target buffer and Uint32Array of [offset, size, targetOffset] triples expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Uint32Array requests = info[1].As<Napi::Uint32Array>();
+  if (requests.ElementLength() % 3 != 0) {
+    Napi::RangeError::New(env, "ReadBatchInto: Request array length must be a multiple of 3").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  const size_t count = requests.ElementLength() / 3;
+
+  u8* status = nullptr;
+  if (info.Length() >= 3 && !info[2].IsUndefined()) {
+    size_t statusSize;
+    if (!info[2].IsTypedArray() || info[2].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array ||
+        !NapiUtils::getBytes(info[2], status, statusSize) || statusSize < count) {
+      Napi::TypeError::New(env, "Status must be a Uint8Array with one entry per request").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  m_batchScratch.resize(count);
+  const u32* triples = requests.Data();
+  for (size_t i = 0; i < count; i++) {
+    u32 offset = triples[i * 3], size = triples[i * 3 + 1], targetOffset = triples[i * 3 + 2];
+    if (targetOffset > targetSize || size > targetSize - targetOffset) {
+      Napi::RangeError::New(env, "ReadBatchInto: A request runs past the end of the target").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    m_batchScratch[i] = {offset, size, reinterpret_cast<char*>(target + targetOffset), false};
+  }
+
+  size_t succeeded = m_process->readBatch(m_batchScratch.data(), count);
+  if (status) {
+    for (size_t i = 0; i < count; i++)
+      status[i] = m_batchScratch[i].ok;
+  }
+  return Napi::Number::New(env, static_cast<double>(succeeded));
+}
+
+// MemoryAccessor.listInstances() => [{ pid, gameId, hooked }]
+Napi::Value MemoryAccessor::ListInstances(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::vector<DolphinComm::DolphinInstanceInfo> instances = DolphinComm::listDolphinInstances();
+  Napi::Array result = Napi::Array::New(env, instances.size());
+  for (uint32_t i = 0; i < instances.size(); i++) {
+    Napi::Object instance = Napi::Object::New(env);
+    instance.Set("pid", Napi::Number::New(env, instances[i].pid));
+    instance.Set("gameId", Napi::String::New(env, instances[i].gameId));
+    instance.Set("hooked", Napi::Boolean::New(env, instances[i].hooked));
+    result.Set(i, instance);
+  }
+  return result;
+}
+
+// MemoryAccessor.setMemoryLayout("gamecube" | "wii" | "extended" | { mem1Size, mem2Size }). Applies
+// to hooks made afterwards, so call it before hook().
+Napi::Value MemoryAccessor::SetMemoryLayout(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  Common::MemoryLayout layout;
+  if (info.Length() >= 1 && info[0].IsString()) {
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    if (name == "gamecube") {
+      layout = Common::GAMECUBE_LAYOUT;
+    } else if (name == "wii") {
+      layout = Common::WII_LAYOUT;
+    } else if (name == "extended") {
+      layout = Common::EXTENDED_LAYOUT;
+    } else {
+      Napi::RangeError::New(env, "Unknown memory layout: " + name).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  } else if (info.Length() >= 1 && info[0].IsObject() &&
+             NapiUtils::getU32(info[0].As<Napi::Object>(), "mem1Size", layout.mem1SizeReal)) {
+    layout.mem2SizeReal = NapiUtils::getU32Or(info[0].As<Napi::Object>(), "mem2Size", 0);
+    // MEM1 must stay below the MEM2 window and MEM2 below the uncached mirror
+    if (layout.mem1SizeReal == 0 || layout.mem1SizeReal > Common::MEM2_START - Common::MEM1_START ||
+        layout.mem2SizeReal > 0x20000000) {
+      Napi::RangeError::New(env, "Memory sizes out of range").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  } else {
+    Napi::TypeError::New(env, "Layout name or { mem1Size, mem2Size } expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Common::SetMemoryLayout(layout);
+  return env.Undefined();
+}
+
+Napi::Value MemoryAccessor::GetMemoryLayout(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  const Common::MemoryLayout& layout = Common::GetMemoryLayout();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("mem1Size", Napi::Number::New(env, layout.mem1SizeReal));
+  result.Set("mem2Size", Napi::Number::New(env, layout.mem2SizeReal));
+  return result;
+}
+
+// MemoryAccessor.translateAddresses(Uint32Array of 0x8.../0x9... addresses) => Uint32Array of
+// offsets, 0xFFFFFFFF where the address isn't in MEM1 or MEM2
+Napi::Value MemoryAccessor::TranslateAddresses(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsTypedArray() ||
+      info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint32_array) {
+    Napi::TypeError::New(env, "Uint32Array of addresses expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Uint32Array addrs = info[0].As<Napi::Uint32Array>();
+  Napi::Uint32Array offsets = Napi::Uint32Array::New(env, addrs.ElementLength());
+  Common::dolphinAddrsToOffsets(addrs.Data(), offsets.Data(), addrs.ElementLength());
+  return offsets;
+}
+
+// readGuest(address, size) => Buffer. Takes a Dolphin virtual address (0x80..., 0x90..., 0x7E...);
+// throws a RangeError naming the first unmapped byte.
+Napi::Value MemoryAccessor::ReadGuest(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "Address and size must be numbers").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  u32 address = info[0].As<Napi::Number>().Uint32Value();
+  u32 size = info[1].As<Napi::Number>().Uint32Value();
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, size);
+
+  u32 failedAddress;
+  DolphinComm::GuestAccess result = m_process->readGuest(address, reinterpret_cast<char*>(buffer.Data()), size, &failedAddress);
+  if (result != DolphinComm::GuestAccess::ok) {
+    throwGuestAccessError(env, "ReadGuest", result, failedAddress);
+    return env.Null();
+  }
+  return buffer;
+}
+
+// writeGuest(address, buffer) => true. Nothing is written if any part of the range is unmapped.
+Napi::Value MemoryAccessor::WriteGuest(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBuffer()) {
+    Napi::TypeError::New(env, "Address must be a number and buffer must be a buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  u32 address = info[0].As<Napi::Number>().Uint32Value();
+  Napi::Buffer<uint8_t> buffer = info[1].As<Napi::Buffer<uint8_t>>();
+
+  u32 failedAddress;
+  DolphinComm::GuestAccess result = m_process->writeGuest(address, reinterpret_cast<const char*>(buffer.Data()),
+                                                          static_cast<u32>(buffer.Length()), &failedAddress);
+  if (result != DolphinComm::GuestAccess::ok) {
+    throwGuestAccessError(env, "WriteGuest", result, failedAddress);
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+DolphinComm::ProcessPauser& MemoryAccessor::pauser() {
+  if (!m_pauser)
+    m_pauser = std::make_unique<DolphinComm::ProcessPauser>(*m_process);
+  return *m_pauser;
+}
+
+Napi::Value MemoryAccessor::readGuestRequests(Napi::Env env, Napi::Value requestList, const char* operation,
+                                              u32 maxPauseMicros) {
+  if (!requestList.IsArray()) {
+    Napi::TypeError::New(env, "Array of { address, size } requests expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array requests = requestList.As<Napi::Array>();
+  std::vector<DolphinComm::GuestRead> reads(requests.Length());
+  std::vector<size_t> positions(requests.Length());
+  size_t total = 0;
+  for (uint32_t i = 0; i < requests.Length(); i++) {
+    Napi::Value request = requests.Get(i);
+    if (!request.IsObject() || !NapiUtils::getU32(request.As<Napi::Object>(), "address", reads[i].address) ||
+        !NapiUtils::getU32(request.As<Napi::Object>(), "size", reads[i].size)) {
+      Napi::TypeError::New(env, "Each request needs a numeric address and size").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    positions[i] = total;
+    total += reads[i].size;
+  }
+
+  Napi::ArrayBuffer arena = Napi::ArrayBuffer::New(env, total);
+  char* base = static_cast<char*>(arena.Data());
+  for (size_t i = 0; i < reads.size(); i++)
+    reads[i].buffer = base + positions[i];
+
+  if (maxPauseMicros != 0) {
+    if (!pauser().pause(maxPauseMicros)) {
+      Napi::Error::New(env, std::string(operation) + ": Couldn't suspend Dolphin").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    m_process->readGuestBatch(reads.data(), reads.size());
+    if (!pauser().resume()) {
+      Napi::Error::New(env, std::string(operation) + ": The reads took longer than maxPauseMs").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  } else {
+    m_process->readGuestBatch(reads.data(), reads.size());
+  }
+
+  Napi::Array result = Napi::Array::New(env, reads.size());
+  for (uint32_t i = 0; i < reads.size(); i++) {
+    if (reads[i].result == DolphinComm::GuestAccess::ok)
+      result.Set(i, Napi::Uint8Array::New(env, reads[i].size, arena, positions[i]));
+    else
+      result.Set(i, env.Null());
+  }
+  return result;
+}
+
+// readGuestBatch([{ address, size }]) => Array<Uint8Array | null>. Reads touching any mix of MEM1,
+// MEM2 and ARAM go to the backend as one batch; results are views into one ArrayBuffer.
+Napi::Value MemoryAccessor::ReadGuestBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  return readGuestRequests(env, info.Length() >= 1 ? info[0] : env.Undefined(), "ReadGuestBatch", 0);
+}
+
+// withPaused(fn, { maxPauseMs? = 50 }) => fn's result. Dolphin is suspended while fn runs, so its
+// reads and writes see and leave one consistent state. Past maxPauseMs Dolphin is resumed anyway
+// and, once fn returns, this throws.
+Napi::Value MemoryAccessor::WithPaused(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "Callback argument expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  u32 maxPauseMicros;
+  if (!getMaxPauseMicros(info, 1, maxPauseMicros))
+    return env.Null();
+
+  if (!pauser().pause(maxPauseMicros)) {
+    Napi::Error::New(env, "WithPaused: Couldn't suspend Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Value result = info[0].As<Napi::Function>().Call({});
+  bool inTime = pauser().resume();
+  // An exception from fn is passed on as is
+  if (env.IsExceptionPending())
+    return env.Null();
+  if (!inTime) {
+    Napi::Error::New(env, "WithPaused: Callback took longer than maxPauseMs; Dolphin was resumed before it returned").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return result;
+}
+
+// readConsistent([{ address, size }], { maxPauseMs? = 50 }) => as readGuestBatch, with Dolphin
+// suspended for the batch so the results can't tear
+Napi::Value MemoryAccessor::ReadConsistent(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u32 maxPauseMicros;
+  if (!getMaxPauseMicros(info, 1, maxPauseMicros))
+    return env.Null();
+  return readGuestRequests(env, info.Length() >= 1 ? info[0] : env.Undefined(), "ReadConsistent", maxPauseMicros);
+}
+
+// getPauseStats() => { pauses, failedPauses, overruns, lastPauseMicros, maxPauseMicros, totalPauseMicros }
+Napi::Value MemoryAccessor::GetPauseStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  DolphinComm::ProcessPauser::Stats pauseStats = pauser().stats();
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("pauses", Napi::Number::New(env, static_cast<double>(pauseStats.pauses)));
+  stats.Set("failedPauses", Napi::Number::New(env, static_cast<double>(pauseStats.failedPauses)));
+  stats.Set("overruns", Napi::Number::New(env, static_cast<double>(pauseStats.overruns)));
+  stats.Set("lastPauseMicros", Napi::Number::New(env, pauseStats.lastPauseNanos / 1000.0));
+  stats.Set("maxPauseMicros", Napi::Number::New(env, pauseStats.maxPauseNanos / 1000.0));
+  stats.Set("totalPauseMicros", Napi::Number::New(env, pauseStats.totalPauseNanos / 1000.0));
+  return stats;
+}
+
+// classifyRegions({ regions?: ("mem1" | "mem2")[], blockSize? = 256 })
+//   => { addresses: Uint32Array, sizes: Uint32Array, kinds: Uint8Array, kindNames: string[],
+//        totals: { [kind]: bytes }, millis, failedChunks }
+// A map of what MEM1/MEM2 seem to hold (code, text, pointers, floats, ...), see region_classifier.h.
+// kinds[i] indexes kindNames; unreadable chunks are reported as "data".
+Napi::Value MemoryAccessor::ClassifyRegions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "ClassifyRegions: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  bool classifyMEM1 = true, classifyMEM2 = true;
+  u32 blockSize = 256;
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    blockSize = NapiUtils::getU32Or(options, "blockSize", blockSize);
+    if (options.Get("regions").IsArray()) {
+      Napi::Array regions = options.Get("regions").As<Napi::Array>();
+      classifyMEM1 = classifyMEM2 = false;
+      for (uint32_t i = 0; i < regions.Length(); i++) {
+        std::string region = regions.Get(i).ToString().Utf8Value();
+        classifyMEM1 |= region == "mem1";
+        classifyMEM2 |= region == "mem2";
+      }
+    }
+  }
+  if (blockSize < 16 || blockSize > 65536 || (blockSize & (blockSize - 1)) != 0) {
+    Napi::RangeError::New(env, "blockSize must be a power of two between 16 and 65536").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const DolphinComm::RegionClassifierBounds bounds{Common::GetMEM1SizeReal(),
+                                                   m_process->isMEM2Present() ? Common::GetMEM2SizeReal() : 0};
+  struct Chunk {
+    u32 address;
+    u32 size;
+    std::vector<DolphinComm::RegionKind> kinds;
+    bool ok;
+  };
+  std::vector<Chunk> chunks;
+  std::vector<std::pair<size_t, size_t>> chunkRanges;
+  auto addRegion = [&](u32 start, u32 size) {
+    size_t first = chunks.size();
+    for (u32 offset = 0; offset < size; offset += CLASSIFY_CHUNK_SIZE)
+      chunks.push_back({start + offset, std::min(CLASSIFY_CHUNK_SIZE, size - offset), {}, false});
+    chunkRanges.push_back({first, chunks.size()});
+  };
+  if (classifyMEM1)
+    addRegion(Common::MEM1_START, Common::GetMEM1SizeReal());
+  if (classifyMEM2 && m_process->isMEM2Present())
+    addRegion(Common::MEM2_START, Common::GetMEM2SizeReal());
+
+  auto start = std::chrono::steady_clock::now();
+  Common::Executor::shared().parallelFor(chunks.size(), [&](size_t i) {
+    thread_local std::vector<u8> buffer;
+    Chunk& chunk = chunks[i];
+    buffer.resize(chunk.size);
+    chunk.ok = m_process->readGuest(chunk.address, reinterpret_cast<char*>(buffer.data()), chunk.size) ==
+               DolphinComm::GuestAccess::ok;
+    if (chunk.ok)
+      DolphinComm::classifyBlocks(buffer.data(), buffer.size(), blockSize, bounds, chunk.kinds);
+    else
+      chunk.kinds.assign((chunk.size + blockSize - 1) / blockSize, DolphinComm::RegionKind::data);
+  });
+
+  // Merge per region so runs continue across chunk boundaries
+  std::vector<DolphinComm::ClassifiedRegion> regions;
+  std::vector<DolphinComm::RegionKind> kinds;
+  u32 failedChunks = 0;
+  for (const auto& range : chunkRanges) {
+    kinds.clear();
+    for (size_t i = range.first; i < range.second; i++) {
+      failedChunks += !chunks[i].ok;
+      kinds.insert(kinds.end(), chunks[i].kinds.begin(), chunks[i].kinds.end());
+    }
+    if (range.first < range.second)
+      DolphinComm::mergeRegions(kinds.data(), kinds.size(), chunks[range.first].address, blockSize, regions);
+  }
+  double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  const size_t kindCount = static_cast<size_t>(DolphinComm::RegionKind::count);
+  std::vector<double> totals(kindCount, 0);
+  Napi::Uint32Array addresses = Napi::Uint32Array::New(env, regions.size());
+  Napi::Uint32Array sizes = Napi::Uint32Array::New(env, regions.size());
+  Napi::Uint8Array kindArray = Napi::Uint8Array::New(env, regions.size());
+  for (size_t i = 0; i < regions.size(); i++) {
+    addresses[i] = regions[i].address;
+    sizes[i] = regions[i].size;
+    kindArray[i] = static_cast<u8>(regions[i].kind);
+    totals[static_cast<size_t>(regions[i].kind)] += regions[i].size;
+  }
+
+  Napi::Array kindNames = Napi::Array::New(env, kindCount);
+  Napi::Object totalsObject = Napi::Object::New(env);
+  for (uint32_t i = 0; i < kindCount; i++) {
+    const char* name = DolphinComm::regionKindName(static_cast<DolphinComm::RegionKind>(i));
+    kindNames.Set(i, Napi::String::New(env, name));
+    totalsObject.Set(name, Napi::Number::New(env, totals[i]));
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", addresses);
+  result.Set("sizes", sizes);
+  result.Set("kinds", kindArray);
+  result.Set("kindNames", kindNames);
+  result.Set("totals", totalsObject);
+  result.Set("millis", Napi::Number::New(env, millis));
+  result.Set("failedChunks", Napi::Number::New(env, failedChunks));
+  return result;
+}
+
+// walkStructure({ head? | headPointer? | array?: { base, count, stride? = 4, pointers? = false },
+//                 links?: number | number[], pointerBias? = 0,
+//                 fields?: [{ offset, type: "u8" | "u16" | "u32" | "s8" | "s16" | "s32" | "f32" | "f64" }],
+//                 maxNodes? = 1024 })
+//   => { addresses: Uint32Array, parents: Int32Array, values: Float64Array, fieldCount, levels, batches,
+//        revisits, invalidPointers, unreadableNodes, truncated, direct }
+// Follows a linked list (one link), tree (several) or pointer table natively, see structure_walker.h.
+// values holds fieldCount values per node in node order; parents[i] is the index of the node that
+// linked to node i, -1 for start nodes.
+Napi::Value MemoryAccessor::WalkStructure(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "WalkStructure: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "WalkStructure: Expected an options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Object options = info[0].As<Napi::Object>();
+
+  DolphinComm::WalkSpec spec;
+  if (NapiUtils::getU32(options, "head", spec.start.address)) {
+    spec.start.indirect = false;
+  } else if (NapiUtils::getU32(options, "headPointer", spec.start.address)) {
+    spec.start.indirect = true;
+  } else if (options.Get("array").IsObject()) {
+    Napi::Object array = options.Get("array").As<Napi::Object>();
+    if (!NapiUtils::getU32(array, "base", spec.start.address) || !NapiUtils::getU32(array, "count", spec.start.count)) {
+      Napi::TypeError::New(env, "WalkStructure: array needs base and count").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    spec.start.stride = NapiUtils::getU32Or(array, "stride", 4);
+    spec.start.indirect = array.Get("pointers").ToBoolean();
+  } else {
+    Napi::TypeError::New(env, "WalkStructure: Expected head, headPointer or array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Value links = options.Get("links");
+  if (links.IsNumber()) {
+    spec.links.push_back(links.As<Napi::Number>().Uint32Value());
+  } else if (links.IsArray()) {
+    Napi::Array linkArray = links.As<Napi::Array>();
+    for (uint32_t i = 0; i < linkArray.Length(); i++)
+      spec.links.push_back(linkArray.Get(i).ToNumber().Uint32Value());
+  }
+  spec.pointerBias = NapiUtils::getU32Or(options, "pointerBias", 0);
+  spec.maxNodes = NapiUtils::getU32Or(options, "maxNodes", spec.maxNodes);
+
+  if (options.Get("fields").IsArray()) {
+    Napi::Array fields = options.Get("fields").As<Napi::Array>();
+    for (uint32_t i = 0; i < fields.Length(); i++) {
+      DolphinComm::WalkField field;
+      Napi::Value fieldValue = fields.Get(i);
+      if (!fieldValue.IsObject() || !NapiUtils::getU32(fieldValue.As<Napi::Object>(), "offset", field.offset) ||
+          !NapiUtils::parseWalkFieldType(fieldValue.As<Napi::Object>().Get("type"), field.type)) {
+        Napi::TypeError::New(env, "WalkStructure: Fields are { offset, type: \"u8\" | \"u16\" | \"u32\" | \"s8\" | "
+                                  "\"s16\" | \"s32\" | \"f32\" | \"f64\" }")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      spec.fields.push_back(field);
+    }
+  }
+
+  const char* error;
+  if (!DolphinComm::validateWalkSpec(spec, error)) {
+    Napi::RangeError::New(env, std::string("WalkStructure: ") + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  DolphinComm::WalkResult walk;
+  if (!DolphinComm::walkStructure(*m_process, spec, walk)) {
+    throwGuestAccessError(env, "WalkStructure", DolphinComm::GuestAccess::failed, spec.start.address);
+    return env.Null();
+  }
+
+  const size_t nodeCount = walk.addresses.size();
+  Napi::Uint32Array addresses = Napi::Uint32Array::New(env, nodeCount);
+  Napi::Int32Array parents = Napi::Int32Array::New(env, nodeCount);
+  Napi::Float64Array values = Napi::Float64Array::New(env, walk.values.size());
+  std::copy(walk.addresses.begin(), walk.addresses.end(), addresses.Data());
+  std::copy(walk.parents.begin(), walk.parents.end(), parents.Data());
+  std::copy(walk.values.begin(), walk.values.end(), values.Data());
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", addresses);
+  result.Set("parents", parents);
+  result.Set("values", values);
+  result.Set("fieldCount", Napi::Number::New(env, static_cast<double>(spec.fields.size())));
+  result.Set("levels", Napi::Number::New(env, walk.levels));
+  result.Set("batches", Napi::Number::New(env, walk.batches));
+  result.Set("revisits", Napi::Number::New(env, walk.revisits));
+  result.Set("invalidPointers", Napi::Number::New(env, walk.invalidPointers));
+  result.Set("unreadableNodes", Napi::Number::New(env, walk.unreadableNodes));
+  result.Set("truncated", Napi::Boolean::New(env, walk.truncated));
+  result.Set("direct", Napi::Boolean::New(env, walk.direct));
+  return result;
+}
+
+// renderRegion(address, size, { view?: "hex" | "columns" | "ascii" = "hex", type? = "u32", bytesPerLine?,
+//                               pointers? = true, symbols?: SymbolMap, maxTokens?, into?: Uint8Array })
+//   => { text?, bytesWritten?, renderedBytes, truncated, estimatedTokens, micros }
+// Formats guest memory as annotated text, see region_renderer.h. bytesPerLine defaults to 16 (64 for
+// ascii); type is a walkStructure field type. Rendering stops at the last whole line within
+// maxTokens, or within into when given, whose bytes then replace text; renderedBytes says where
+// to continue from.
+Napi::Value MemoryAccessor::RenderRegion(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "RenderRegion: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "RenderRegion: Address and size arguments expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  const u32 address = info[0].As<Napi::Number>().Uint32Value();
+  const u32 size = info[1].As<Napi::Number>().Uint32Value();
+  if (size == 0 || size > MAX_RENDER_SIZE) {
+    Napi::RangeError::New(env, "RenderRegion: size must be between 1 and 16 MiB").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  DolphinComm::RenderOptions options;
+  options.bounds = {Common::GetMEM1SizeReal(), m_process->isMEM2Present() ? Common::GetMEM2SizeReal() : 0};
+  u32 maxTokens = 0;
+  u8* into = nullptr;
+  size_t intoSize = 0;
+  bool hasBytesPerLine = false;
+  if (info.Length() >= 3 && info[2].IsObject()) {
+    Napi::Object object = info[2].As<Napi::Object>();
+    Napi::Value view = object.Get("view");
+    if (!view.IsUndefined()) {
+      const std::string name = view.IsString() ? view.As<Napi::String>().Utf8Value() : "";
+      if (name == "columns") {
+        options.view = DolphinComm::RenderView::columns;
+      } else if (name == "ascii") {
+        options.view = DolphinComm::RenderView::ascii;
+      } else if (name != "hex") {
+        Napi::TypeError::New(env, "RenderRegion: view must be \"hex\", \"columns\" or \"ascii\"").ThrowAsJavaScriptException();
+        return env.Null();
+      }
+    }
+    if (!object.Get("type").IsUndefined() && !NapiUtils::parseWalkFieldType(object.Get("type"), options.columnType)) {
+      Napi::TypeError::New(env, "RenderRegion: type must be \"u8\" | \"u16\" | \"u32\" | \"s8\" | \"s16\" | "
+                                "\"s32\" | \"f32\" | \"f64\"")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    hasBytesPerLine = NapiUtils::getU32(object, "bytesPerLine", options.bytesPerLine);
+    Napi::Value pointers = object.Get("pointers");
+    options.pointers = !pointers.IsBoolean() || pointers.As<Napi::Boolean>().Value();
+    Napi::Value symbols = object.Get("symbols");
+    if (!symbols.IsUndefined() && !(options.symbols = SymbolMap::indexOf(symbols))) {
+      Napi::TypeError::New(env, "RenderRegion: symbols must be a SymbolMap").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    maxTokens = NapiUtils::getU32Or(object, "maxTokens", 0);
+    Napi::Value target = object.Get("into");
+    if (!target.IsUndefined() && !NapiUtils::getBytes(target, into, intoSize)) {
+      Napi::TypeError::New(env, "RenderRegion: into must be a Uint8Array").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+  if (!hasBytesPerLine && options.view == DolphinComm::RenderView::ascii)
+    options.bytesPerLine = 64;
+  if (!DolphinComm::validRenderOptions(options)) {
+    Napi::RangeError::New(env, "RenderRegion: bytesPerLine must be between 1 and 64 and a multiple of the column size")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (options.view == DolphinComm::RenderView::columns && size % DolphinComm::walkFieldSize(options.columnType) != 0) {
+    Napi::RangeError::New(env, "RenderRegion: size must be a multiple of the column size").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<u8> data(size);
+  u32 failedAddress = address;
+  DolphinComm::GuestAccess access =
+      m_process->readGuest(address, reinterpret_cast<char*>(data.data()), size, &failedAddress);
+  if (access != DolphinComm::GuestAccess::ok) {
+    throwGuestAccessError(env, "RenderRegion", access, failedAddress);
+    return env.Null();
+  }
+
+  const size_t limit = maxTokens == 0 ? SIZE_MAX : static_cast<size_t>(maxTokens) * RENDER_CHARS_PER_TOKEN;
+  DolphinComm::RegionRenderer renderer(options);
+  DolphinComm::RenderResult rendered{0, 0, false};
+  std::string text;
+  if (into) {
+    rendered = renderer.render(data.data(), address, size, reinterpret_cast<char*>(into), std::min(intoSize, limit));
+  } else {
+    // A hex line takes a little over 4 chars per byte; grow when annotations need more
+    text.resize(std::min(limit, std::max<size_t>(renderer.maxLineLength(), static_cast<size_t>(size) * 5)));
+    while (rendered.renderedBytes < size) {
+      DolphinComm::RenderResult part =
+          renderer.render(data.data() + rendered.renderedBytes, address + rendered.renderedBytes,
+                          size - rendered.renderedBytes, &text[rendered.length], text.size() - rendered.length);
+      rendered.length += part.length;
+      rendered.renderedBytes += part.renderedBytes;
+      if (!part.truncated)
+        break;
+      if (text.size() == limit) {
+        rendered.truncated = true;
+        break;
+      }
+      text.resize(std::min(limit, text.size() * 2));
+    }
+    text.resize(rendered.length);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  if (into)
+    result.Set("bytesWritten", Napi::Number::New(env, static_cast<double>(rendered.length)));
+  else
+    result.Set("text", Napi::String::New(env, text));
+  result.Set("renderedBytes", Napi::Number::New(env, rendered.renderedBytes));
+  result.Set("truncated", Napi::Boolean::New(env, rendered.truncated));
+  result.Set("estimatedTokens",
+             Napi::Number::New(env, static_cast<double>((rendered.length + RENDER_CHARS_PER_TOKEN - 1) /
+                                                        RENDER_CHARS_PER_TOKEN)));
+  result.Set("micros", Napi::Number::New(env, std::chrono::duration<double, std::micro>(
+                                                  std::chrono::steady_clock::now() - start).count()));
+  return result;
+}
+
+// dumpToFile(path, { includeMEM2? = true, direct? = false }) => { bytes, chunks, millis, ioUring, direct }
+Napi::Value MemoryAccessor::DumpToFile(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Path argument expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  bool includeMEM2, direct;
+  parseDumpOptions(info, includeMEM2, direct);
+  auto start = std::chrono::steady_clock::now();
+  DolphinComm::RamDumpStats stats;
+  std::string error;
+  if (!dumpRam(info[0].As<Napi::String>().Utf8Value(), includeMEM2, direct, stats, error)) {
+    Napi::Error::New(env, "DumpToFile: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return dumpResultToJS(env, stats, millis);
+}
+
+// dumpToFileAsync(path, { includeMEM2?, direct?, token? }) => Promise of what dumpToFile returns.
+// Runs on the shared executor at scan priority; the token only drops a dump that hasn't started.
+Napi::Value MemoryAccessor::DumpToFileAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Path argument expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Common::CancellationToken token;
+  if (!CancellationToken::fromOptions(info.Length() >= 2 ? info[1] : env.Undefined(), token)) {
+    Napi::TypeError::New(env, "token must be a CancellationToken").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  bool includeMEM2, direct;
+  parseDumpOptions(info, includeMEM2, direct);
+  auto job = std::make_unique<DumpJob>(info.This().As<Napi::Object>(), info[0].As<Napi::String>().Utf8Value(),
+                                       includeMEM2, direct);
+  return ExecutorJob::queue(env, std::move(job), Common::JobPriority::scan, token);
+}
+
+bool MemoryAccessor::dumpRam(const std::string& path, bool includeMEM2, bool direct, DolphinComm::RamDumpStats& stats,
+                             std::string& error) {
+  std::lock_guard<std::mutex> lock(m_dumpMutex);
+  if (!m_dumper)
+    m_dumper = std::make_unique<DolphinComm::RamDumper>(*m_process);
+  return m_dumper->dump(path, includeMEM2, direct, stats, error);
+}
+
+// restoreFromFile(path) => { bytes, chunks, millis }; the dump must match the current memory layout
+Napi::Value MemoryAccessor::RestoreFromFile(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Path argument expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  DolphinComm::RamDumpStats stats;
+  std::string error;
+  std::lock_guard<std::mutex> lock(m_dumpMutex);
+  if (!m_dumper)
+    m_dumper = std::make_unique<DolphinComm::RamDumper>(*m_process);
+  if (!m_dumper->restore(info[0].As<Napi::String>().Utf8Value(), stats, error)) {
+    Napi::Error::New(env, "RestoreFromFile: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+  result.Set("chunks", Napi::Number::New(env, stats.chunks));
+  result.Set("millis", Napi::Number::New(env, millis));
+  return result;
+}
@@ -1,16 +1,39 @@
 #pragma once
 #include <napi.h>
-#include "mac_dolphin_process.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "process_pauser.h"
+#include "ram_dump.h"
 
 class MemoryAccessor : public Napi::ObjectWrap<MemoryAccessor> {
 public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports);
   MemoryAccessor(const Napi::CallbackInfo& info);
 
+  DolphinComm::IDolphinProcess& process() { return *m_process; }
+  // Any thread; dumps and restores take turns on the one dumper
+  bool dumpRam(const std::string& path, bool includeMEM2, bool direct, DolphinComm::RamDumpStats& stats,
+               std::string& error);
+
 private:
   static Napi::FunctionReference constructor;
   
-  DolphinComm::MacDolphinProcess m_process;
+  std::unique_ptr<DolphinComm::IDolphinProcess> m_process;
+  // Created on first use; keeps its buffer and io_uring for later dumps
+  std::unique_ptr<DolphinComm::RamDumper> m_dumper;
+  std::mutex m_dumpMutex;
+  std::unique_ptr<DolphinComm::ProcessPauser> m_pauser;
+  // Reused by readBatchInto so polling doesn't allocate
+  std::vector<DolphinComm::ReadRequest> m_batchScratch;
+
+  DolphinComm::ProcessPauser& pauser();
+  // With maxPauseMicros != 0 the batch runs with Dolphin suspended
+  Napi::Value readGuestRequests(Napi::Env env, Napi::Value requestList, const char* operation, u32 maxPauseMicros);
   
   Napi::Value ReadAtOffset(const Napi::CallbackInfo& info);
   Napi::Value WriteAtOffset(const Napi::CallbackInfo& info);
@@ -18,4 +41,23 @@ private:
   Napi::Value Hook(const Napi::CallbackInfo& info);
   Napi::Value IsHooked(const Napi::CallbackInfo& info);
   Napi::Value GetPID(const Napi::CallbackInfo& info);
+  Napi::Value ReadBatch(const Napi::CallbackInfo& info);
+  Napi::Value ReadInto(const Napi::CallbackInfo& info);
+  Napi::Value ReadBatchInto(const Napi::CallbackInfo& info);
+  Napi::Value ReadGuest(const Napi::CallbackInfo& info);
+  Napi::Value WriteGuest(const Napi::CallbackInfo& info);
+  Napi::Value ReadGuestBatch(const Napi::CallbackInfo& info);
+  Napi::Value WithPaused(const Napi::CallbackInfo& info);
+  Napi::Value ReadConsistent(const Napi::CallbackInfo& info);
+  Napi::Value GetPauseStats(const Napi::CallbackInfo& info);
+  Napi::Value ClassifyRegions(const Napi::CallbackInfo& info);
+  Napi::Value WalkStructure(const Napi::CallbackInfo& info);
+  Napi::Value RenderRegion(const Napi::CallbackInfo& info);
+  Napi::Value DumpToFile(const Napi::CallbackInfo& info);
+  Napi::Value DumpToFileAsync(const Napi::CallbackInfo& info);
+  Napi::Value RestoreFromFile(const Napi::CallbackInfo& info);
+  static Napi::Value ListInstances(const Napi::CallbackInfo& info);
+  static Napi::Value SetMemoryLayout(const Napi::CallbackInfo& info);
+  static Napi::Value GetMemoryLayout(const Napi::CallbackInfo& info);
+  static Napi::Value TranslateAddresses(const Napi::CallbackInfo& info);
 };
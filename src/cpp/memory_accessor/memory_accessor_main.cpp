@@ -1,8 +1,36 @@
 #include <napi.h>
+#include "cheat_engine.h"
+#include "executor_job.h"
+#include "instance_group.h"
+#include "ipc_server.h"
+#include "live_mirror.h"
 #include "memory_accessor.h"
+#include "memory_search.h"
+#include "page_activity_profiler.h"
+#include "ram_history.h"
+#include "scan_session.h"
+#include "symbol_map.h"
+#include "telemetry_stream.h"
+#include "time_series_recorder.h"
+#include "trigger_engine.h"
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
-  return MemoryAccessor::Init(env, exports);
+  MemoryAccessor::Init(env, exports);
+  TimeSeriesRecorder::Init(env, exports);
+  TimeSeriesRecording::Init(env, exports);
+  RamHistory::Init(env, exports);
+  InstanceGroup::Init(env, exports);
+  SymbolMap::Init(env, exports);
+  MemorySearch::Init(env, exports);
+  IpcServer::Init(env, exports);
+  TelemetryStream::Init(env, exports);
+  TriggerEngine::Init(env, exports);
+  PageActivityProfiler::Init(env, exports);
+  LiveMirror::Init(env, exports);
+  ExecutorJob::Init(env, exports);
+  CheatEngine::Init(env, exports);
+  ScanSession::Init(env, exports);
+  return exports;
 }
 
 NODE_API_MODULE(dolphin_memory, InitAll)
@@ -8,9 +8,12 @@
 
 #include "common_types.h"
 #include "common_utils.h"
+#include "hex_encode.h"
+#include "memory_layout.h"
 
 namespace Common
 {
+static MemoryLayout s_layout = WII_LAYOUT;
 static u32 s_mem1_size_real;
 static u32 s_mem2_size_real;
 static u32 s_mem1_size;
@@ -43,14 +46,25 @@ u32 GetMEM2End()
   return s_mem2_end;
 }
 
+void SetMemoryLayout(const MemoryLayout& layout)
+{
+  s_layout = layout;
+  UpdateMemoryValues();
+}
+
+const MemoryLayout& GetMemoryLayout()
+{
+  return s_layout;
+}
+
 void UpdateMemoryValues()
 {
-  s_mem1_size_real = 24u * 1024 * 1024;
-  s_mem2_size_real = 64u * 1024 * 1024;
-  s_mem1_size = NextPowerOf2(GetMEM1SizeReal());
-  s_mem2_size = NextPowerOf2(GetMEM2SizeReal());
-  s_mem1_end = MEM1_START + GetMEM1SizeReal();
-  s_mem2_end = MEM2_START + GetMEM2SizeReal();
+  s_mem1_size_real = s_layout.mem1SizeReal;
+  s_mem2_size_real = s_layout.mem2SizeReal;
+  s_mem1_size = s_layout.mem1Size();
+  s_mem2_size = s_layout.mem2Size();
+  s_mem1_end = s_layout.mem1End();
+  s_mem2_end = s_layout.mem2End();
 }
 
 size_t getSizeForType(const MemType type, const size_t length)
@@ -529,17 +543,11 @@ std::string formatMemoryToString(const char* memory, const MemType type, const s
   }
   case Common::MemType::type_byteArray:
   {
-    // Force Hexadecimal, no matter the base
-    ss << std::hex << std::uppercase;
-    for (int i = 0; i < length; ++i)
-    {
-      u8 aByte = 0;
-      std::memcpy(&aByte, memory + i, sizeof(u8));
-      ss << std::setfill('0') << std::setw(2) << static_cast<int>(aByte) << " ";
-    }
-    std::string str = ss.str();
-    // Remove the space at the end
-    str.pop_back();
+    // Always hexadecimal, no matter the base, and sized up front rather than streamed
+    if (length == 0)
+      return "";
+    std::string str(length * 3 - 1, ' ');
+    Common::hexEncodeSeparated(reinterpret_cast<const u8*>(memory), length, ' ', &str[0]);
     return str;
   }
   default:
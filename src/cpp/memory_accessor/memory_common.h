@@ -24,6 +24,19 @@ constexpr u32 ARAM_END = 0x7F000000;
 
 void UpdateMemoryValues();
 
+constexpr u32 NextPowerOf2(u32 value)
+{
+  --value;
+  value |= value >> 1;
+  value |= value >> 2;
+  value |= value >> 4;
+  value |= value >> 8;
+  value |= value >> 16;
+  ++value;
+
+  return value;
+};
+
 enum class MemType
 {
   type_byte = 0,
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+
+#include "common_types.h"
+#include "memory_common.h"
+
+namespace Common
+{
+// Sizes of the emulated RAM regions. MEM2 is absent (size 0) on GameCube.
+struct MemoryLayout
+{
+  u32 mem1SizeReal;
+  u32 mem2SizeReal;
+
+  constexpr u32 mem1Size() const { return NextPowerOf2(mem1SizeReal); }
+  constexpr u32 mem2Size() const { return mem2SizeReal ? NextPowerOf2(mem2SizeReal) : 0; }
+  constexpr u32 mem1End() const { return MEM1_START + mem1SizeReal; }
+  constexpr u32 mem2End() const { return MEM2_START + mem2SizeReal; }
+  constexpr bool operator==(const MemoryLayout& other) const
+  {
+    return mem1SizeReal == other.mem1SizeReal && mem2SizeReal == other.mem2SizeReal;
+  }
+};
+
+constexpr MemoryLayout GAMECUBE_LAYOUT{24u * 1024 * 1024, 0};
+constexpr MemoryLayout WII_LAYOUT{24u * 1024 * 1024, 64u * 1024 * 1024};
+// Dolphin's "Emulated Memory Size Override" at its maximum; other override values can be set as
+// a custom layout
+constexpr MemoryLayout EXTENDED_LAYOUT{64u * 1024 * 1024, 128u * 1024 * 1024};
+
+// Marks unmapped addresses in the bulk translations
+constexpr u32 INVALID_OFFSET = 0xFFFFFFFF;
+
+// Takes effect for every hook made afterwards; defaults to WII_LAYOUT
+void SetMemoryLayout(const MemoryLayout& layout);
+const MemoryLayout& GetMemoryLayout();
+
+namespace detail
+{
+// The translations for a layout given by its region sizes. With constant sizes (see
+// AddressTranslator) every bound folds into an immediate. Addresses and offsets outside every
+// region come back unchanged.
+constexpr u32 dolphinAddrToOffset(u32 mem1SizeReal, u32 mem2SizeReal, u32 addr, bool considerAram)
+{
+  if (addr >= ARAM_START && addr < ARAM_END)
+    return addr - ARAM_START;
+  if (addr >= MEM1_START && addr - MEM1_START < mem1SizeReal)
+    return addr - MEM1_START + (considerAram ? ARAM_FAKESIZE : 0);
+  if (addr >= MEM2_START && addr - MEM2_START < mem2SizeReal)
+    return addr - MEM2_START + (MEM2_START - MEM1_START);
+  return addr;
+}
+
+constexpr u32 offsetToDolphinAddr(u32 mem1SizeReal, u32 mem2SizeReal, u32 offset, bool considerAram)
+{
+  if (considerAram)
+  {
+    if (offset < ARAM_SIZE)
+      return offset + ARAM_START;
+    if (offset >= ARAM_FAKESIZE && offset - ARAM_FAKESIZE < mem1SizeReal)
+      return offset - ARAM_FAKESIZE + MEM1_START;
+    return offset;
+  }
+  if (offset < mem1SizeReal)
+    return offset + MEM1_START;
+  if (offset >= MEM2_START - MEM1_START && offset - (MEM2_START - MEM1_START) < mem2SizeReal)
+    return offset - (MEM2_START - MEM1_START) + MEM2_START;
+  return offset;
+}
+
+constexpr u32 offsetToCacheIndex(u32 mem1SizeReal, u32 mem2SizeReal, u32 offset, bool considerAram)
+{
+  if (considerAram)
+  {
+    if (offset >= ARAM_FAKESIZE && offset - ARAM_FAKESIZE < mem1SizeReal)
+      return offset - (ARAM_FAKESIZE - ARAM_SIZE);
+    return offset;
+  }
+  if (offset >= MEM2_START - MEM1_START && offset - (MEM2_START - MEM1_START) < mem2SizeReal)
+    return offset - (MEM2_START - MEM1_START) + mem1SizeReal;
+  return offset;
+}
+
+constexpr u32 cacheIndexToOffset(u32 mem1SizeReal, u32 mem2SizeReal, u32 cacheIndex, bool considerAram)
+{
+  if (considerAram)
+  {
+    if (cacheIndex >= ARAM_SIZE && cacheIndex - ARAM_SIZE < mem1SizeReal)
+      return cacheIndex + (ARAM_FAKESIZE - ARAM_SIZE);
+    return cacheIndex;
+  }
+  if (cacheIndex >= mem1SizeReal && cacheIndex - mem1SizeReal < mem2SizeReal)
+    return cacheIndex - mem1SizeReal + (MEM2_START - MEM1_START);
+  return cacheIndex;
+}
+
+// Branchless so the loop vectorizes
+inline void dolphinAddrsToOffsets(u32 mem1End, u32 mem2End, const u32* addrs, u32* offsets,
+                                  size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    const u32 mem1Offset = addrs[i] - MEM1_START;
+    const u32 mem2Offset = addrs[i] - MEM2_START;
+    const bool inMEM1 = mem1Offset < mem1End - MEM1_START;
+    const bool inMEM2 = mem2Offset < mem2End - MEM2_START;
+    offsets[i] = inMEM1 ? mem1Offset :
+                 inMEM2 ? mem2Offset + (MEM2_START - MEM1_START) :
+                          INVALID_OFFSET;
+  }
+}
+}  // namespace detail
+
+// The address translations specialized for a layout known at compile time: every bound is a
+// constant, so there are no getter calls and the region checks reduce to one compare each.
+template <u32 MEM1SizeReal, u32 MEM2SizeReal>
+struct AddressTranslator
+{
+  static constexpr u32 MEM1_END = MEM1_START + MEM1SizeReal;
+  static constexpr u32 MEM2_END = MEM2_START + MEM2SizeReal;
+
+  // As Common::dolphinAddrToOffset and friends in common_utils.h
+  static constexpr u32 toOffset(u32 addr, bool considerAram)
+  {
+    return detail::dolphinAddrToOffset(MEM1SizeReal, MEM2SizeReal, addr, considerAram);
+  }
+  static constexpr u32 toAddress(u32 offset, bool considerAram)
+  {
+    return detail::offsetToDolphinAddr(MEM1SizeReal, MEM2SizeReal, offset, considerAram);
+  }
+  static constexpr u32 toCacheIndex(u32 offset, bool considerAram)
+  {
+    return detail::offsetToCacheIndex(MEM1SizeReal, MEM2SizeReal, offset, considerAram);
+  }
+  static constexpr u32 cacheIndexToOffset(u32 cacheIndex, bool considerAram)
+  {
+    return detail::cacheIndexToOffset(MEM1SizeReal, MEM2SizeReal, cacheIndex, considerAram);
+  }
+  // MEM1/MEM2 addresses only (no ARAM); anything else becomes INVALID_OFFSET
+  static void toOffsets(const u32* addrs, u32* offsets, size_t count)
+  {
+    detail::dolphinAddrsToOffsets(MEM1_END, MEM2_END, addrs, offsets, count);
+  }
+};
+
+using GameCubeTranslator = AddressTranslator<GAMECUBE_LAYOUT.mem1SizeReal, GAMECUBE_LAYOUT.mem2SizeReal>;
+using WiiTranslator = AddressTranslator<WII_LAYOUT.mem1SizeReal, WII_LAYOUT.mem2SizeReal>;
+using ExtendedTranslator = AddressTranslator<EXTENDED_LAYOUT.mem1SizeReal, EXTENDED_LAYOUT.mem2SizeReal>;
+
+// The same translations for a custom layout, with the bounds read from the layout
+struct LayoutTranslator
+{
+  MemoryLayout layout;
+
+  u32 toOffset(u32 addr, bool considerAram) const
+  {
+    return detail::dolphinAddrToOffset(layout.mem1SizeReal, layout.mem2SizeReal, addr, considerAram);
+  }
+  u32 toAddress(u32 offset, bool considerAram) const
+  {
+    return detail::offsetToDolphinAddr(layout.mem1SizeReal, layout.mem2SizeReal, offset, considerAram);
+  }
+  u32 toCacheIndex(u32 offset, bool considerAram) const
+  {
+    return detail::offsetToCacheIndex(layout.mem1SizeReal, layout.mem2SizeReal, offset, considerAram);
+  }
+  u32 cacheIndexToOffset(u32 cacheIndex, bool considerAram) const
+  {
+    return detail::cacheIndexToOffset(layout.mem1SizeReal, layout.mem2SizeReal, cacheIndex, considerAram);
+  }
+  void toOffsets(const u32* addrs, u32* offsets, size_t count) const
+  {
+    detail::dolphinAddrsToOffsets(layout.mem1End(), layout.mem2End(), addrs, offsets, count);
+  }
+};
+
+// Calls f with the translator for the current layout: one of the specializations above, or a
+// LayoutTranslator for a custom layout. The layout is read once, however many addresses f
+// translates.
+template <typename F>
+auto withAddressTranslator(F&& f)
+{
+  const MemoryLayout& layout = GetMemoryLayout();
+  if (layout == WII_LAYOUT)
+    return f(WiiTranslator{});
+  if (layout == GAMECUBE_LAYOUT)
+    return f(GameCubeTranslator{});
+  if (layout == EXTENDED_LAYOUT)
+    return f(ExtendedTranslator{});
+  return f(LayoutTranslator{layout});
+}
+
+// Bulk dolphinAddrToOffset (without ARAM) for the current layout
+inline void dolphinAddrsToOffsets(const u32* addrs, u32* offsets, size_t count)
+{
+  withAddressTranslator([&](auto translator) { translator.toOffsets(addrs, offsets, count); });
+}
+}  // namespace Common
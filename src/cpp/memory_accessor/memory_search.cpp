@@ -0,0 +1,278 @@
+#include "memory_search.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "executor.h"
+#include "executor_job.h"
+#include "memory_accessor.h"
+#include "memory_common.h"
+#include "napi_utils.h"
+
+namespace {
+constexpr u32 SEARCH_CHUNK_SIZE = 1024 * 1024;
+
+struct SearchOptions {
+  u32 align = 1;
+  u32 maxMatches = 10000;
+};
+
+// Keeps matches in address order, dropping unaligned ones and anything past maxMatches per pattern
+Napi::Object matchesToJS(Napi::Env env, const std::vector<DolphinComm::PatternMatch>& matches,
+                         size_t patternCount, const SearchOptions& options) {
+  std::vector<u32> perPattern(patternCount, 0);
+  std::vector<u32> addresses;
+  std::vector<u32> patterns;
+  bool truncated = false;
+  for (const DolphinComm::PatternMatch& match : matches) {
+    if (match.address % options.align != 0)
+      continue;
+    if (perPattern[match.pattern] >= options.maxMatches) {
+      truncated = true;
+      continue;
+    }
+    perPattern[match.pattern]++;
+    addresses.push_back(match.address);
+    patterns.push_back(match.pattern);
+  }
+
+  Napi::Uint32Array addressArray = Napi::Uint32Array::New(env, addresses.size());
+  Napi::Uint32Array patternArray = Napi::Uint32Array::New(env, patterns.size());
+  std::copy(addresses.begin(), addresses.end(), addressArray.Data());
+  std::copy(patterns.begin(), patterns.end(), patternArray.Data());
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", addressArray);
+  result.Set("patterns", patternArray);
+  result.Set("truncated", Napi::Boolean::New(env, truncated));
+  return result;
+}
+
+SearchOptions parseOptions(const Napi::CallbackInfo& info, size_t index) {
+  SearchOptions options;
+  if (info.Length() > index && info[index].IsObject()) {
+    Napi::Object object = info[index].As<Napi::Object>();
+    options.align = std::max(1u, NapiUtils::getU32Or(object, "align", 1));
+    options.maxMatches = NapiUtils::getU32Or(object, "maxMatches", options.maxMatches);
+  }
+  return options;
+}
+
+struct SearchChunk {
+  u32 address;
+  u32 size;
+  // Bytes readable past the chunk, for matches that straddle its end
+  u32 overlap;
+  std::vector<DolphinComm::PatternMatch> matches;
+  bool ok;
+};
+
+// Cuts the regions of run()'s options into chunks
+std::vector<SearchChunk> planChunks(const Napi::CallbackInfo& info, DolphinComm::IDolphinProcess& process,
+                                    const DolphinComm::PatternSearcher& searcher) {
+  bool searchMEM1 = true, searchMEM2 = true, searchARAM = true;
+  if (info.Length() >= 1 && info[0].IsObject() && info[0].As<Napi::Object>().Get("regions").IsArray()) {
+    Napi::Array regions = info[0].As<Napi::Object>().Get("regions").As<Napi::Array>();
+    searchMEM1 = searchMEM2 = searchARAM = false;
+    for (uint32_t i = 0; i < regions.Length(); i++) {
+      std::string region = regions.Get(i).ToString().Utf8Value();
+      searchMEM1 |= region == "mem1";
+      searchMEM2 |= region == "mem2";
+      searchARAM |= region == "aram";
+    }
+  }
+
+  std::vector<SearchChunk> chunks;
+  auto addRegion = [&](u32 start, u32 size) {
+    const u32 overlap = static_cast<u32>(searcher.maxPatternLength() - 1);
+    for (u32 offset = 0; offset < size; offset += SEARCH_CHUNK_SIZE) {
+      u32 chunkSize = std::min(SEARCH_CHUNK_SIZE, size - offset);
+      chunks.push_back({start + offset, chunkSize, std::min(overlap, size - offset - chunkSize), {}, false});
+    }
+  };
+  if (searchARAM && process.isARAMAccessible())
+    addRegion(Common::ARAM_START, Common::ARAM_SIZE);
+  if (searchMEM1)
+    addRegion(Common::MEM1_START, Common::GetMEM1SizeReal());
+  if (searchMEM2 && process.isMEM2Present())
+    addRegion(Common::MEM2_START, Common::GetMEM2SizeReal());
+  return chunks;
+}
+
+// Reads and scans the chunks on the shared executor; returns the milliseconds it took
+double scanChunks(std::vector<SearchChunk>& chunks, DolphinComm::IDolphinProcess& process,
+                  const DolphinComm::PatternSearcher& searcher, const Common::CancellationToken& token) {
+  auto start = std::chrono::steady_clock::now();
+  Common::Executor::shared().parallelFor(chunks.size(), [&](size_t i) {
+    thread_local std::vector<u8> buffer;
+    SearchChunk& chunk = chunks[i];
+    if (token.cancelled())
+      return;
+    buffer.resize(chunk.size + chunk.overlap);
+    chunk.ok = process.readGuest(chunk.address, reinterpret_cast<char*>(buffer.data()),
+                                 static_cast<u32>(buffer.size())) == DolphinComm::GuestAccess::ok;
+    if (chunk.ok)
+      searcher.scan(buffer.data(), buffer.size(), chunk.size, chunk.address, chunk.matches);
+  });
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Napi::Object chunksToJS(Napi::Env env, const std::vector<SearchChunk>& chunks,
+                        const DolphinComm::PatternSearcher& searcher, const SearchOptions& options, double millis) {
+  std::vector<DolphinComm::PatternMatch> matches;
+  u32 failedChunks = 0;
+  for (const SearchChunk& chunk : chunks) {
+    failedChunks += !chunk.ok;
+    matches.insert(matches.end(), chunk.matches.begin(), chunk.matches.end());
+  }
+
+  Napi::Object result = matchesToJS(env, matches, searcher.patternCount(), options);
+  result.Set("millis", Napi::Number::New(env, millis));
+  result.Set("failedChunks", Napi::Number::New(env, failedChunks));
+  return result;
+}
+
+class SearchJob : public ExecutorJob {
+public:
+  SearchJob(const Napi::Object& search, DolphinComm::IDolphinProcess& process,
+            const DolphinComm::PatternSearcher& searcher, SearchOptions options, std::vector<SearchChunk> chunks)
+    : m_searchRef(Napi::Persistent(search)), m_process(process), m_searcher(searcher), m_options(options),
+      m_chunks(std::move(chunks)) {}
+
+protected:
+  void execute() override {
+    m_millis = scanChunks(m_chunks, m_process, m_searcher, token());
+    if (cancelled())
+      setError("Cancelled");
+  }
+
+  Napi::Value result(Napi::Env env) override { return chunksToJS(env, m_chunks, m_searcher, m_options, m_millis); }
+
+private:
+  // Keeps the searcher and, through it, the accessor alive
+  Napi::ObjectReference m_searchRef;
+  DolphinComm::IDolphinProcess& m_process;
+  const DolphinComm::PatternSearcher& m_searcher;
+  SearchOptions m_options;
+  std::vector<SearchChunk> m_chunks;
+  double m_millis = 0;
+};
+}  // namespace
+
+Napi::FunctionReference MemorySearch::constructor;
+
+Napi::Object MemorySearch::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "MemorySearch", {
+    InstanceMethod("run", &MemorySearch::Run),
+    InstanceMethod("runAsync", &MemorySearch::RunAsync),
+    InstanceMethod("scanBuffer", &MemorySearch::ScanBuffer),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("MemorySearch", func);
+  return exports;
+}
+
+// new MemorySearch(accessor, patterns). Each pattern is either a signature string
+// ("3C 60 ?? ?? 38 6?") or a Uint8Array of exact bytes (encoded text, for instance).
+MemorySearch::MemorySearch(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<MemorySearch>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray()) {
+    Napi::TypeError::New(env, "MemoryAccessor and array of patterns expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  Napi::Array patternArray = info[1].As<Napi::Array>();
+  std::vector<DolphinComm::BytePattern> patterns(patternArray.Length());
+  for (uint32_t i = 0; i < patternArray.Length(); i++) {
+    Napi::Value value = patternArray.Get(i);
+    if (value.IsString()) {
+      if (!DolphinComm::parseBytePattern(value.As<Napi::String>().Utf8Value(), patterns[i])) {
+        Napi::Error::New(env, "MemorySearch: Invalid pattern " + value.As<Napi::String>().Utf8Value()).ThrowAsJavaScriptException();
+        return;
+      }
+    } else if (value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_uint8_array) {
+      Napi::Uint8Array bytes = value.As<Napi::Uint8Array>();
+      patterns[i].bytes.assign(bytes.Data(), bytes.Data() + bytes.ElementLength());
+      patterns[i].mask.assign(bytes.ElementLength(), 0xFF);
+    } else {
+      Napi::TypeError::New(env, "Patterns must be signature strings or Uint8Arrays").ThrowAsJavaScriptException();
+      return;
+    }
+  }
+
+  if (!m_searcher.compile(std::move(patterns))) {
+    Napi::Error::New(env, "MemorySearch: Every pattern needs at least one exact byte").ThrowAsJavaScriptException();
+  }
+}
+
+// run({ regions?: ("mem1" | "mem2" | "aram")[], align?, maxMatches? })
+//   => { addresses: Uint32Array, patterns: Uint32Array, truncated, millis, failedChunks }
+// addresses are guest addresses in ascending order; patterns[i] indexes the constructor's array.
+Napi::Value MemorySearch::Run(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "MemorySearch: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  SearchOptions options = parseOptions(info, 0);
+  std::vector<SearchChunk> chunks = planChunks(info, *m_process, m_searcher);
+  double millis = scanChunks(chunks, *m_process, m_searcher, Common::CancellationToken());
+  return chunksToJS(env, chunks, m_searcher, options, millis);
+}
+
+// runAsync({ regions?, align?, maxMatches?, token? }) => Promise of what run() returns. Scans on the
+// shared executor at scan priority; cancelling the token stops it between chunks.
+Napi::Value MemorySearch::RunAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "MemorySearch: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Common::CancellationToken token;
+  if (!CancellationToken::fromOptions(info.Length() >= 1 ? info[0] : env.Undefined(), token)) {
+    Napi::TypeError::New(env, "token must be a CancellationToken").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto job = std::make_unique<SearchJob>(info.This().As<Napi::Object>(), *m_process, m_searcher, parseOptions(info, 0),
+                                         planChunks(info, *m_process, m_searcher));
+  return ExecutorJob::queue(env, std::move(job), Common::JobPriority::scan, token);
+}
+
+// scanBuffer(buffer, baseAddress, { align?, maxMatches? }) searches memory the caller already has,
+// e.g. a RamHistory sample, reporting addresses relative to baseAddress
+Napi::Value MemorySearch::ScanBuffer(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsTypedArray() || !info[1].IsNumber() ||
+      info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+    Napi::TypeError::New(env, "Uint8Array and base address expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Uint8Array buffer = info[0].As<Napi::Uint8Array>();
+  u32 baseAddress = info[1].As<Napi::Number>().Uint32Value();
+  SearchOptions options = parseOptions(info, 2);
+
+  std::vector<DolphinComm::PatternMatch> matches;
+  m_searcher.scan(buffer.Data(), buffer.ElementLength(), buffer.ElementLength(), baseAddress, matches);
+  return matchesToJS(env, matches, m_searcher.patternCount(), options);
+}
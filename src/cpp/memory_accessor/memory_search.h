@@ -0,0 +1,24 @@
+#pragma once
+#include <napi.h>
+
+#include "dolphin_process.h"
+#include "pattern_search.h"
+
+// Compiled set of byte patterns searched across MEM1, MEM2 and ARAM. The regions are cut into
+// chunks that are read and scanned on the shared executor.
+class MemorySearch : public Napi::ObjectWrap<MemorySearch> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  MemorySearch(const Napi::CallbackInfo& info);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Run(const Napi::CallbackInfo& info);
+  Napi::Value RunAsync(const Napi::CallbackInfo& info);
+  Napi::Value ScanBuffer(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  DolphinComm::PatternSearcher m_searcher;
+};
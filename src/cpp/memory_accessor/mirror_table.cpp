@@ -0,0 +1,148 @@
+#include "mirror_table.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "common_utils.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr u32 VALUES_OFFSET = 16;
+constexpr u32 BUFFER_ALIGNMENT = 64;
+
+u32 alignUp(u32 value, u32 alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+double decodeValue(const MirrorField& field, const u8* value)
+{
+  switch (field.type)
+  {
+  case Common::MemType::type_byte:
+    return value[0];
+  case Common::MemType::type_halfword:
+    return (value[0] << 8) | value[1];
+  case Common::MemType::type_word:
+  {
+    u32 word;
+    std::memcpy(&word, value, sizeof(word));
+    return Common::bSwap32(word);
+  }
+  case Common::MemType::type_float:
+  {
+    u32 bits;
+    std::memcpy(&bits, value, sizeof(bits));
+    bits = Common::bSwap32(bits);
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+  case Common::MemType::type_double:
+  {
+    u64 bits;
+    std::memcpy(&bits, value, sizeof(bits));
+    bits = Common::bSwap64(bits);
+    double result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+  case Common::MemType::type_string:
+  {
+    const void* end = std::memchr(value, 0, field.size);
+    return end != nullptr ? static_cast<const u8*>(end) - value : field.size;
+  }
+  default:
+    return field.size;
+  }
+}
+}  // namespace
+
+bool MirrorTable::setFields(std::vector<MirrorField> fields)
+{
+  m_fields.clear();
+  m_sampleOffsets.clear();
+  m_sampleSize = 0;
+  m_memory = nullptr;
+  m_frame = 0;
+  if (fields.empty() || fields.size() > MIRROR_MAX_FIELDS)
+    return false;
+
+  const u32 fieldCount = static_cast<u32>(fields.size());
+  m_statusOffset = VALUES_OFFSET + fieldCount * sizeof(double);
+  m_bytesOffset = m_statusOffset + fieldCount;
+  u32 bytesSize = 0;
+  for (MirrorField& field : fields)
+  {
+    field.size = static_cast<u32>(Common::getSizeForType(field.type, field.size));
+    if (field.size == 0 || field.size > MIRROR_MAX_BYTES_SIZE - bytesSize)
+      return false;
+    field.bytesOffset = 0;
+    if (field.type == Common::MemType::type_string || field.type == Common::MemType::type_byteArray)
+    {
+      field.bytesOffset = m_bytesOffset + bytesSize;
+      bytesSize += field.size;
+    }
+    m_sampleOffsets.push_back(m_sampleSize);
+    m_sampleSize += field.size;
+  }
+  m_bufferSize = alignUp(m_bytesOffset + bytesSize, BUFFER_ALIGNMENT);
+  m_fields = std::move(fields);
+  return true;
+}
+
+void MirrorTable::attach(u8* memory)
+{
+  m_memory = memory;
+  m_frame = 0;
+  std::memset(memory, 0, size());
+  u32* header = reinterpret_cast<u32*>(memory);
+  header[1] = static_cast<u32>(m_fields.size());
+  header[2] = m_bufferSize;
+  header[3] = m_statusOffset;
+  header[4] = m_bytesOffset;
+  header[5] = MIRROR_VERSION;
+}
+
+u32 MirrorTable::publish(const u8* sample, const u8* ok, double timestampMs)
+{
+  // Frame 0 means "nothing yet"; skipping to 2 on wrap-around keeps the buffers alternating
+  u32 frame = m_frame + 1;
+  if (frame == 0)
+    frame = 2;
+
+  u8* buffer = m_memory + MIRROR_HEADER_SIZE + (frame & 1) * static_cast<size_t>(m_bufferSize);
+  u32* bufferFrame = reinterpret_cast<u32*>(buffer);
+  __atomic_store_n(bufferFrame, 0, __ATOMIC_RELAXED);
+  // Readers must see the buffer marked as being rewritten before any of its values change
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  u32 failed = 0;
+  double* values = reinterpret_cast<double*>(buffer + VALUES_OFFSET);
+  u8* status = buffer + m_statusOffset;
+  for (size_t i = 0; i < m_fields.size(); ++i)
+  {
+    const MirrorField& field = m_fields[i];
+    status[i] = ok[i] ? 1 : 0;
+    if (!ok[i])
+    {
+      values[i] = NAN;
+      ++failed;
+      continue;
+    }
+    const u8* value = sample + m_sampleOffsets[i];
+    values[i] = decodeValue(field, value);
+    if (field.bytesOffset != 0)
+      std::memcpy(buffer + field.bytesOffset, value, field.size);
+  }
+  reinterpret_cast<u32*>(buffer)[1] = failed;
+  std::memcpy(buffer + 8, &timestampMs, sizeof(timestampMs));
+
+  __atomic_store_n(bufferFrame, frame, __ATOMIC_RELEASE);
+  __atomic_store_n(reinterpret_cast<u32*>(m_memory), frame, __ATOMIC_RELEASE);
+  m_frame = frame;
+  return frame;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common_types.h"
+#include "memory_common.h"
+
+// Watched values laid out for JS to read straight out of typed arrays, with no call into the
+// addon. The matching reader is src/ts/dolphin/live-mirror-reader.ts. All fields are native
+// endian.
+//
+//   header (MIRROR_HEADER_SIZE bytes of u32 words)
+//     0  frame         newest complete frame, 0 before the first; it lives in buffer frame & 1
+//     1  fieldCount
+//     2  bufferSize    each of the two buffers; buffer b starts at MIRROR_HEADER_SIZE + b * bufferSize
+//     3  statusOffset  within a buffer
+//     4  bytesOffset   within a buffer
+//     5  version       MIRROR_VERSION
+//
+//   buffer (twice)
+//     0             u32 frame       the frame this buffer holds; 0 while it is being rewritten
+//     4             u32 failed      fields whose read failed
+//     8             f64 timestamp   milliseconds since the epoch
+//     16            f64[fieldCount] byte, halfword and word as unsigned integers, float and double
+//                                   as is; the length for string (up to the first NUL) and byteArray
+//     statusOffset  u8[fieldCount]  1 if the field was read, else 0 and its value is NaN
+//     bytesOffset   raw bytes of the string and byteArray fields, back to back in field order
+//
+// Frames alternate buffers, so a reader copies the published buffer while the next frame goes into
+// the other one. Each buffer's frame word works as a seqlock: read the header frame, check the
+// buffer holds it, copy, and check again; only a reader still copying two frames later sees the
+// word change and retries. The frame words are meant for Atomics.load.
+namespace DolphinComm
+{
+constexpr u32 MIRROR_HEADER_SIZE = 64;
+constexpr u32 MIRROR_VERSION = 1;
+constexpr u32 MIRROR_MAX_FIELDS = 4096;
+constexpr u32 MIRROR_MAX_BYTES_SIZE = 1024 * 1024;
+
+struct MirrorField
+{
+  // Offset as produced by Common::dolphinAddrToOffset (MEM1 at 0, MEM2 at 0x10000000)
+  u32 offset;
+  Common::MemType type;
+  // Resolved by setFields; only read for string and byteArray
+  u32 size;
+  // Where the raw bytes of string and byteArray fields go in a buffer; set by setFields
+  u32 bytesOffset;
+};
+
+class MirrorTable
+{
+public:
+  // Resolves field sizes and the layout. Fails on an empty or too long list, or a field of size 0
+  // or one that doesn't fit.
+  bool setFields(std::vector<MirrorField> fields);
+
+  const std::vector<MirrorField>& fields() const { return m_fields; }
+  // Offset of each field in a sample
+  const std::vector<size_t>& sampleOffsets() const { return m_sampleOffsets; }
+  size_t sampleSize() const { return m_sampleSize; }
+  u32 bufferSize() const { return m_bufferSize; }
+  u32 statusOffset() const { return m_statusOffset; }
+  u32 bytesOffset() const { return m_bytesOffset; }
+  // Header and both buffers
+  size_t size() const { return MIRROR_HEADER_SIZE + 2 * static_cast<size_t>(m_bufferSize); }
+
+  // Writes the header into memory of size(), 64-byte aligned, which must stay valid while frames
+  // are published
+  void attach(u8* memory);
+  // Publishes one frame. sample holds every field's bytes as read from guest memory (big endian),
+  // back to back in field order; ok has one flag per field. Returns the frame number.
+  u32 publish(const u8* sample, const u8* ok, double timestampMs);
+  u32 frame() const { return m_frame; }
+
+private:
+  std::vector<MirrorField> m_fields;
+  std::vector<size_t> m_sampleOffsets;
+  size_t m_sampleSize = 0;
+  u32 m_bufferSize = 0;
+  u32 m_statusOffset = 0;
+  u32 m_bytesOffset = 0;
+
+  u8* m_memory = nullptr;
+  u32 m_frame = 0;
+};
+}  // namespace DolphinComm
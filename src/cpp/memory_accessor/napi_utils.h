@@ -0,0 +1,90 @@
+#pragma once
+#include <napi.h>
+
+#include <string>
+
+#include "common_types.h"
+#include "memory_common.h"
+#include "structure_walker.h"
+
+namespace NapiUtils
+{
+// Accepts either a Common::MemType ordinal or its name without the "type_" prefix ("word", ...)
+inline bool parseMemType(const Napi::Value& value, Common::MemType& type)
+{
+  if (value.IsNumber()) {
+    u32 ordinal = value.As<Napi::Number>().Uint32Value();
+    if (ordinal >= static_cast<u32>(Common::MemType::type_num))
+      return false;
+    type = static_cast<Common::MemType>(ordinal);
+    return true;
+  }
+
+  if (!value.IsString())
+    return false;
+
+  static const char* const names[] = {"byte",   "halfword", "word",     "float",
+                                      "double", "string",   "byteArray"};
+  std::string name = value.As<Napi::String>().Utf8Value();
+  for (u32 i = 0; i < static_cast<u32>(Common::MemType::type_num); ++i) {
+    if (name == names[i]) {
+      type = static_cast<Common::MemType>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Raw bytes behind a Buffer, any TypedArray, a DataView or an ArrayBuffer, without copying
+inline bool getBytes(const Napi::Value& value, u8*& data, size_t& size)
+{
+  if (value.IsTypedArray()) {
+    Napi::TypedArray array = value.As<Napi::TypedArray>();
+    data = static_cast<u8*>(array.ArrayBuffer().Data()) + array.ByteOffset();
+    size = array.ByteLength();
+    return true;
+  }
+  if (value.IsDataView()) {
+    Napi::DataView view = value.As<Napi::DataView>();
+    data = static_cast<u8*>(view.ArrayBuffer().Data()) + view.ByteOffset();
+    size = view.ByteLength();
+    return true;
+  }
+  if (value.IsArrayBuffer()) {
+    Napi::ArrayBuffer buffer = value.As<Napi::ArrayBuffer>();
+    data = static_cast<u8*>(buffer.Data());
+    size = buffer.ByteLength();
+    return true;
+  }
+  return false;
+}
+
+// "u8", "u16", "u32", "s8", "s16", "s32", "f32" or "f64"
+inline bool parseWalkFieldType(const Napi::Value& value, DolphinComm::WalkFieldType& type)
+{
+  static const char* const names[] = {"u8", "u16", "u32", "s8", "s16", "s32", "f32", "f64"};
+  std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+  for (u32 i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (name == names[i]) {
+      type = static_cast<DolphinComm::WalkFieldType>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool getU32(const Napi::Object& object, const char* key, u32& out)
+{
+  Napi::Value value = object.Get(key);
+  if (!value.IsNumber())
+    return false;
+  out = value.As<Napi::Number>().Uint32Value();
+  return true;
+}
+
+inline u32 getU32Or(const Napi::Object& object, const char* key, u32 fallback)
+{
+  u32 value = fallback;
+  return getU32(object, key, value) ? value : fallback;
+}
+}  // namespace NapiUtils
@@ -0,0 +1,171 @@
+#include "page_activity_profile.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "executor.h"
+#include "page_hash.h"
+
+namespace DolphinComm
+{
+namespace
+{
+// Correlation pages handed to one pool task
+constexpr size_t PAGES_PER_TASK = 16;
+}  // namespace
+
+bool PageActivityProfile::init(size_t imageSize, u32 blockSize, u64 inputWindowMicros)
+{
+  if (imageSize == 0 || blockSize < MIN_BLOCK_SIZE || blockSize > CORRELATION_PAGE_SIZE ||
+      (blockSize & (blockSize - 1)) != 0)
+    return false;
+
+  m_imageSize = imageSize;
+  m_blockSize = blockSize;
+  m_inputWindow = inputWindowMicros;
+  reset();
+  return true;
+}
+
+void PageActivityProfile::reset()
+{
+  const size_t blockCount = (m_imageSize + m_blockSize - 1) / m_blockSize;
+  const size_t pageCount = (m_imageSize + CORRELATION_PAGE_SIZE - 1) / CORRELATION_PAGE_SIZE;
+  m_hashes.assign(blockCount, 0);
+  m_counts.assign(blockCount, 0);
+  m_pageCounts.assign(pageCount, 0);
+  m_pageChanged.assign(pageCount, 0);
+  m_changedPages.clear();
+  m_labels.clear();
+  m_labelStats.clear();
+  m_timelineSamples.clear();
+  m_timelineInputs.clear();
+  m_samples = 0;
+  m_hasBaseline = false;
+}
+
+u32 PageActivityProfile::addSample(u64 timestamp, const u8* image)
+{
+  const size_t blocksPerPage = CORRELATION_PAGE_SIZE / m_blockSize;
+  const size_t pageCount = m_pageCounts.size();
+  const bool compare = m_hasBaseline;
+
+  // Tasks own whole pages, so every block and page flag is written by one thread only
+  std::atomic<u32> changedBlocks{0};
+  Common::Executor::shared().parallelFor((pageCount + PAGES_PER_TASK - 1) / PAGES_PER_TASK, [&](size_t task) {
+    u32 changed = 0;
+    const size_t endPage = std::min(pageCount, (task + 1) * PAGES_PER_TASK);
+    for (size_t page = task * PAGES_PER_TASK; page < endPage; ++page)
+    {
+      bool pageChanged = false;
+      for (size_t block = page * blocksPerPage; block < (page + 1) * blocksPerPage; ++block)
+      {
+        const size_t offset = block * m_blockSize;
+        if (offset >= m_imageSize)
+          break;
+        const u64 hash = Common::hashPage(image + offset, std::min<size_t>(m_blockSize, m_imageSize - offset));
+        if (compare && hash != m_hashes[block])
+        {
+          m_counts[block]++;
+          changed++;
+          pageChanged = true;
+        }
+        m_hashes[block] = hash;
+      }
+      m_pageChanged[page] = pageChanged;
+    }
+    changedBlocks += changed;
+  });
+
+  if (!compare)
+  {
+    m_hasBaseline = true;
+    return 0;
+  }
+
+  m_samples++;
+  m_changedPages.clear();
+  for (size_t page = 0; page < pageCount; ++page)
+  {
+    if (m_pageChanged[page])
+    {
+      m_pageCounts[page]++;
+      m_changedPages.push_back(static_cast<u32>(page));
+    }
+  }
+
+  for (Label& label : m_labelStats)
+  {
+    if (label.inputs == 0 || timestamp < label.lastInput || timestamp - label.lastInput >= m_inputWindow)
+      continue;
+    label.windowSamples++;
+    for (u32 page : m_changedPages)
+      label.hits[page]++;
+  }
+
+  m_timelineSamples.push_back({timestamp, changedBlocks});
+  if (m_timelineSamples.size() > MAX_TIMELINE)
+    m_timelineSamples.pop_front();
+  return changedBlocks;
+}
+
+bool PageActivityProfile::markInput(const std::string& label, u64 timestamp)
+{
+  size_t index = std::find(m_labels.begin(), m_labels.end(), label) - m_labels.begin();
+  if (index == m_labels.size())
+  {
+    if (m_labels.size() == MAX_LABELS)
+      return false;
+    m_labels.push_back(label);
+    m_labelStats.push_back({std::vector<u32>(m_pageCounts.size(), 0), 0, 0, 0});
+  }
+
+  Label& stats = m_labelStats[index];
+  stats.inputs++;
+  stats.lastInput = std::max(stats.lastInput, timestamp);
+  m_timelineInputs.push_back({timestamp, static_cast<u16>(index)});
+  if (m_timelineInputs.size() > MAX_TIMELINE)
+    m_timelineInputs.pop_front();
+  return true;
+}
+
+bool PageActivityProfile::correlate(const std::string& label, size_t maxPages, std::vector<Correlation>& out,
+                                    u64& windowSamples, u64& inputs) const
+{
+  out.clear();
+  size_t index = std::find(m_labels.begin(), m_labels.end(), label) - m_labels.begin();
+  if (index == m_labels.size())
+    return false;
+
+  const Label& stats = m_labelStats[index];
+  windowSamples = stats.windowSamples;
+  inputs = stats.inputs;
+  if (stats.windowSamples == 0)
+    return true;
+
+  for (size_t page = 0; page < stats.hits.size(); ++page)
+  {
+    if (stats.hits[page] == 0)
+      continue;
+    // A page with window hits has changed at least that often overall
+    const double windowRate = static_cast<double>(stats.hits[page]) / stats.windowSamples;
+    const double baseRate = static_cast<double>(m_pageCounts[page]) / m_samples;
+    out.push_back({static_cast<u32>(page * CORRELATION_PAGE_SIZE), stats.hits[page],
+                   static_cast<float>(windowRate / baseRate)});
+  }
+
+  auto byLift = [](const Correlation& a, const Correlation& b) {
+    return a.lift != b.lift ? a.lift > b.lift : a.hits > b.hits;
+  };
+  if (out.size() > maxPages)
+  {
+    std::partial_sort(out.begin(), out.begin() + maxPages, out.end(), byLift);
+    out.resize(maxPages);
+  }
+  else
+  {
+    std::sort(out.begin(), out.end(), byLift);
+  }
+  return true;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "common_types.h"
+
+namespace DolphinComm
+{
+// Change statistics for an image sampled over a session. The image is cut into blocks (a cache
+// line up to a page) and each sample is compared to the previous one by block hash, so between
+// samples only one hash per block is kept.
+//
+// Inputs marked with a label feed a correlation: for every 4 KB page the profile counts how often
+// it changed in samples that fall within `inputWindow` after an input of that label, which against
+// the page's usual change rate tells which memory reacts to the input.
+//
+// Offsets here are cache indices (Common::offsetToCacheIndex without ARAM), i.e. MEM1 followed
+// directly by MEM2.
+class PageActivityProfile
+{
+public:
+  static constexpr u32 MIN_BLOCK_SIZE = 32;
+  static constexpr u32 CORRELATION_PAGE_SIZE = 4096;
+  static constexpr size_t MAX_LABELS = 64;
+  // Samples and inputs kept for the timeline; the counts themselves cover the whole session
+  static constexpr size_t MAX_TIMELINE = 1 << 16;
+
+  struct TimelineSample
+  {
+    u64 timestamp;
+    u32 changedBlocks;
+  };
+
+  struct TimelineInput
+  {
+    u64 timestamp;
+    u16 label;
+  };
+
+  struct Correlation
+  {
+    u32 cacheIndex;
+    // Samples in an input window in which the page changed
+    u32 hits;
+    // How much likelier the page is to change in an input window than in any sample
+    float lift;
+  };
+
+  // blockSize must be a power of two between MIN_BLOCK_SIZE and CORRELATION_PAGE_SIZE
+  bool init(size_t imageSize, u32 blockSize, u64 inputWindowMicros);
+  void reset();
+
+  // Compares `image` (imageSize bytes) to the previous sample and returns how many blocks changed.
+  // The first sample only sets the baseline.
+  u32 addSample(u64 timestamp, const u8* image);
+  // False if the label would exceed MAX_LABELS
+  bool markInput(const std::string& label, u64 timestamp);
+
+  u32 blockSize() const { return m_blockSize; }
+  size_t blockCount() const { return m_counts.size(); }
+  // Samples compared so far, i.e. not counting the baseline
+  u64 samples() const { return m_samples; }
+  // Per block, how many samples it changed in
+  const std::vector<u32>& counts() const { return m_counts; }
+  const std::vector<std::string>& labels() const { return m_labels; }
+  const std::deque<TimelineSample>& timelineSamples() const { return m_timelineSamples; }
+  const std::deque<TimelineInput>& timelineInputs() const { return m_timelineInputs; }
+
+  // Pages that react to `label` most, by lift; false if no input had that label
+  bool correlate(const std::string& label, size_t maxPages, std::vector<Correlation>& out, u64& windowSamples,
+                 u64& inputs) const;
+
+private:
+  struct Label
+  {
+    // Per correlation page
+    std::vector<u32> hits;
+    u64 windowSamples;
+    u64 inputs;
+    u64 lastInput;
+  };
+
+  size_t m_imageSize = 0;
+  u32 m_blockSize = 0;
+  u64 m_inputWindow = 0;
+  std::vector<u64> m_hashes;
+  std::vector<u32> m_counts;
+  // Per correlation page: samples it changed in, and whether it changed in the current one
+  std::vector<u32> m_pageCounts;
+  std::vector<u8> m_pageChanged;
+  std::vector<u32> m_changedPages;
+  std::vector<std::string> m_labels;
+  std::vector<Label> m_labelStats;
+  std::deque<TimelineSample> m_timelineSamples;
+  std::deque<TimelineInput> m_timelineInputs;
+  u64 m_samples = 0;
+  bool m_hasBaseline = false;
+};
+}  // namespace DolphinComm
@@ -0,0 +1,371 @@
+#include "page_activity_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "common_utils.h"
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+constexpr u32 kMaxHottestBlocks = 1 << 20;
+
+u64 nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+Napi::FunctionReference PageActivityProfiler::constructor;
+
+Napi::Object PageActivityProfiler::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "PageActivityProfiler", {
+    InstanceMethod("start", &PageActivityProfiler::Start),
+    InstanceMethod("stop", &PageActivityProfiler::Stop),
+    InstanceMethod("sampleNow", &PageActivityProfiler::SampleNow),
+    InstanceMethod("markInput", &PageActivityProfiler::MarkInput),
+    InstanceMethod("reset", &PageActivityProfiler::Reset),
+    InstanceMethod("getHeatmap", &PageActivityProfiler::GetHeatmap),
+    InstanceMethod("getHottest", &PageActivityProfiler::GetHottest),
+    InstanceMethod("getTimeline", &PageActivityProfiler::GetTimeline),
+    InstanceMethod("getInputCorrelation", &PageActivityProfiler::GetInputCorrelation),
+    InstanceMethod("getStats", &PageActivityProfiler::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("PageActivityProfiler", func);
+  return exports;
+}
+
+// new PageActivityProfiler(accessor, { rateHz?, blockSize?, includeMEM2?, inputWindowMs? })
+PageActivityProfiler::PageActivityProfiler(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<PageActivityProfiler>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "MemoryAccessor argument expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  Napi::Object options = info.Length() >= 2 && info[1].IsObject() ? info[1].As<Napi::Object>() : Napi::Object::New(env);
+  m_rateHz = NapiUtils::getU32Or(options, "rateHz", 20);
+  u32 blockSize = NapiUtils::getU32Or(options, "blockSize", 4096);
+  u32 inputWindowMs = NapiUtils::getU32Or(options, "inputWindowMs", 250);
+  m_includeMEM2 = options.Get("includeMEM2").IsBoolean() && options.Get("includeMEM2").As<Napi::Boolean>().Value();
+
+  if (m_rateHz == 0) {
+    Napi::RangeError::New(env, "rateHz must be positive").ThrowAsJavaScriptException();
+    return;
+  }
+
+  size_t imageSize = Common::GetMEM1SizeReal();
+  if (m_includeMEM2)
+    imageSize += Common::GetMEM2SizeReal();
+
+  if (!m_profile.init(imageSize, blockSize, static_cast<u64>(inputWindowMs) * 1000)) {
+    Napi::RangeError::New(env, "PageActivityProfiler: blockSize must be a power of two between 32 and 4096").ThrowAsJavaScriptException();
+    return;
+  }
+  m_image.resize(imageSize);
+}
+
+PageActivityProfiler::~PageActivityProfiler() {
+  stopThread();
+}
+
+bool PageActivityProfiler::sample() {
+  std::lock_guard<std::mutex> sampleLock(m_sampleMutex);
+  auto start = std::chrono::steady_clock::now();
+  u64 timestamp = nowMicros();
+
+  // Write tracking isn't used here: the profile compares every block with the previous sample
+  bool success = m_process->readFromRAM(0, reinterpret_cast<char*>(m_image.data()), Common::GetMEM1SizeReal());
+  if (success && m_includeMEM2) {
+    success = m_process->readFromRAM(Common::MEM2_START - Common::MEM1_START,
+                                     reinterpret_cast<char*>(m_image.data() + Common::GetMEM1SizeReal()),
+                                     Common::GetMEM2SizeReal());
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!success) {
+    m_failedReads++;
+    return false;
+  }
+  m_lastChangedBlocks = m_profile.addSample(timestamp, m_image.data());
+  m_lastSampleNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return true;
+}
+
+void PageActivityProfiler::run() {
+  auto interval = std::chrono::microseconds(1000000 / m_rateHz);
+  auto next = std::chrono::steady_clock::now();
+  while (m_running) {
+    sample();
+    next += interval;
+    // Don't try to catch up if sampling fell behind, just skip the missed ticks
+    auto now = std::chrono::steady_clock::now();
+    if (next < now)
+      next = now;
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void PageActivityProfiler::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+Napi::Value PageActivityProfiler::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  m_running = true;
+  m_thread = std::thread(&PageActivityProfiler::run, this);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value PageActivityProfiler::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+Napi::Value PageActivityProfiler::SampleNow(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  return Napi::Boolean::New(env, sample());
+}
+
+// markInput(label, timestampMicros?) => false if there are already too many distinct labels
+// Call it when injecting an input; samples within inputWindowMs after it count towards the label.
+Napi::Value PageActivityProfiler::MarkInput(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Input label expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  u64 timestamp = info.Length() >= 2 && info[1].IsNumber() ? static_cast<u64>(info[1].As<Napi::Number>().DoubleValue()) :
+                                                             nowMicros();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return Napi::Boolean::New(env, m_profile.markInput(info[0].As<Napi::String>().Utf8Value(), timestamp));
+}
+
+// reset() drops all counts, labels and the timeline; the next sample becomes the new baseline
+Napi::Value PageActivityProfiler::Reset(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_profile.reset();
+  return env.Undefined();
+}
+
+// getHeatmap({ resolution? }) => { blockSize, mem1Blocks, samples, counts: Uint32Array }
+// counts[i] sums the changes of the blocks in [i * blockSize, (i + 1) * blockSize) of MEM1 followed
+// by MEM2; resolution (a power of two, default the profile's block size) coarsens the map.
+Napi::Value PageActivityProfiler::GetHeatmap(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  Napi::Object options = info.Length() >= 1 && info[0].IsObject() ? info[0].As<Napi::Object>() : Napi::Object::New(env);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const u32 resolution = NapiUtils::getU32Or(options, "resolution", m_profile.blockSize());
+  if (resolution < m_profile.blockSize() || (resolution & (resolution - 1)) != 0) {
+    Napi::RangeError::New(env, "resolution must be a power of two no smaller than the block size").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const std::vector<u32>& counts = m_profile.counts();
+  const size_t ratio = resolution / m_profile.blockSize();
+  Napi::Uint32Array heatmap = Napi::Uint32Array::New(env, (counts.size() + ratio - 1) / ratio);
+  std::fill(heatmap.Data(), heatmap.Data() + heatmap.ElementLength(), 0);
+  for (size_t block = 0; block < counts.size(); block++)
+    heatmap[block / ratio] += counts[block];
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("blockSize", Napi::Number::New(env, resolution));
+  result.Set("mem1Blocks", Napi::Number::New(env, (Common::GetMEM1SizeReal() + resolution - 1) / resolution));
+  result.Set("samples", Napi::Number::New(env, static_cast<double>(m_profile.samples())));
+  result.Set("counts", heatmap);
+  return result;
+}
+
+// getHottest({ fraction?, maxBlocks? }) => { blockSize, samples, offsets: Uint32Array, counts: Uint32Array, changeShare }
+// The most often changed blocks (default the top 1%), hottest first, as offsets usable with read().
+// changeShare is the fraction of all block changes they account for.
+Napi::Value PageActivityProfiler::GetHottest(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  double fraction = 0.01;
+  u32 maxBlocks = kMaxHottestBlocks;
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (options.Get("fraction").IsNumber())
+      fraction = options.Get("fraction").As<Napi::Number>().DoubleValue();
+    maxBlocks = std::min(NapiUtils::getU32Or(options, "maxBlocks", kMaxHottestBlocks), kMaxHottestBlocks);
+  }
+  if (!(fraction > 0 && fraction <= 1)) {
+    Napi::RangeError::New(env, "fraction must be in (0, 1]").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const std::vector<u32>& counts = m_profile.counts();
+  std::vector<u32> blocks;
+  u64 totalChanges = 0;
+  for (size_t block = 0; block < counts.size(); block++) {
+    totalChanges += counts[block];
+    if (counts[block] != 0)
+      blocks.push_back(static_cast<u32>(block));
+  }
+
+  size_t wanted = std::min<size_t>({static_cast<size_t>(std::ceil(counts.size() * fraction)), maxBlocks, blocks.size()});
+  auto hotter = [&counts](u32 a, u32 b) { return counts[a] != counts[b] ? counts[a] > counts[b] : a < b; };
+  std::partial_sort(blocks.begin(), blocks.begin() + wanted, blocks.end(), hotter);
+
+  Napi::Uint32Array offsets = Napi::Uint32Array::New(env, wanted);
+  Napi::Uint32Array hotCounts = Napi::Uint32Array::New(env, wanted);
+  u64 hotChanges = 0;
+  Common::withAddressTranslator([&](auto translator) {
+    for (size_t i = 0; i < wanted; i++) {
+      offsets[i] = translator.cacheIndexToOffset(blocks[i] * m_profile.blockSize(), false);
+      hotCounts[i] = counts[blocks[i]];
+      hotChanges += counts[blocks[i]];
+    }
+  });
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("blockSize", Napi::Number::New(env, m_profile.blockSize()));
+  result.Set("samples", Napi::Number::New(env, static_cast<double>(m_profile.samples())));
+  result.Set("offsets", offsets);
+  result.Set("counts", hotCounts);
+  result.Set("changeShare", Napi::Number::New(env, totalChanges ? static_cast<double>(hotChanges) / totalChanges : 0.0));
+  return result;
+}
+
+// getTimeline() => { timestamps: Float64Array, changedBlocks: Uint32Array, inputTimestamps: Float64Array,
+//                    inputLabels: Uint16Array, labels: string[] }
+// Recent samples and inputs in microseconds, for lining bursts of activity up with inputs;
+// inputLabels index labels.
+Napi::Value PageActivityProfiler::GetTimeline(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto& samples = m_profile.timelineSamples();
+  Napi::Float64Array timestamps = Napi::Float64Array::New(env, samples.size());
+  Napi::Uint32Array changedBlocks = Napi::Uint32Array::New(env, samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    timestamps[i] = static_cast<double>(samples[i].timestamp);
+    changedBlocks[i] = samples[i].changedBlocks;
+  }
+
+  const auto& inputs = m_profile.timelineInputs();
+  Napi::Float64Array inputTimestamps = Napi::Float64Array::New(env, inputs.size());
+  Napi::Uint16Array inputLabels = Napi::Uint16Array::New(env, inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    inputTimestamps[i] = static_cast<double>(inputs[i].timestamp);
+    inputLabels[i] = inputs[i].label;
+  }
+
+  const auto& labelNames = m_profile.labels();
+  Napi::Array labels = Napi::Array::New(env, labelNames.size());
+  for (uint32_t i = 0; i < labelNames.size(); i++)
+    labels.Set(i, Napi::String::New(env, labelNames[i]));
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("timestamps", timestamps);
+  result.Set("changedBlocks", changedBlocks);
+  result.Set("inputTimestamps", inputTimestamps);
+  result.Set("inputLabels", inputLabels);
+  result.Set("labels", labels);
+  return result;
+}
+
+// getInputCorrelation(label, { maxPages? }) => { pageSize, inputs, windowSamples, offsets: Uint32Array,
+//                                              hits: Uint32Array, lift: Float32Array }, or null
+// The 4 KB pages that change most reliably after inputs with this label, by lift over their
+// usual change rate (lift 1 means the input makes no difference).
+Napi::Value PageActivityProfiler::GetInputCorrelation(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Input label expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  u32 maxPages = 32;
+  if (info.Length() >= 2 && info[1].IsObject())
+    maxPages = NapiUtils::getU32Or(info[1].As<Napi::Object>(), "maxPages", 32);
+
+  std::vector<DolphinComm::PageActivityProfile::Correlation> pages;
+  u64 windowSamples = 0;
+  u64 inputs = 0;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_profile.correlate(info[0].As<Napi::String>().Utf8Value(), maxPages, pages, windowSamples, inputs))
+    return env.Null();
+
+  Napi::Uint32Array offsets = Napi::Uint32Array::New(env, pages.size());
+  Napi::Uint32Array hits = Napi::Uint32Array::New(env, pages.size());
+  Napi::Float32Array lift = Napi::Float32Array::New(env, pages.size());
+  Common::withAddressTranslator([&](auto translator) {
+    for (size_t i = 0; i < pages.size(); i++) {
+      offsets[i] = translator.cacheIndexToOffset(pages[i].cacheIndex, false);
+      hits[i] = pages[i].hits;
+      lift[i] = pages[i].lift;
+    }
+  });
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("pageSize", Napi::Number::New(env, DolphinComm::PageActivityProfile::CORRELATION_PAGE_SIZE));
+  result.Set("inputs", Napi::Number::New(env, static_cast<double>(inputs)));
+  result.Set("windowSamples", Napi::Number::New(env, static_cast<double>(windowSamples)));
+  result.Set("offsets", offsets);
+  result.Set("hits", hits);
+  result.Set("lift", lift);
+  return result;
+}
+
+Napi::Value PageActivityProfiler::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("samples", Napi::Number::New(env, static_cast<double>(m_profile.samples())));
+  stats.Set("blockSize", Napi::Number::New(env, m_profile.blockSize()));
+  stats.Set("blocks", Napi::Number::New(env, static_cast<double>(m_profile.blockCount())));
+  stats.Set("labels", Napi::Number::New(env, static_cast<double>(m_profile.labels().size())));
+  stats.Set("lastChangedBlocks", Napi::Number::New(env, m_lastChangedBlocks));
+  stats.Set("failedReads", Napi::Number::New(env, static_cast<double>(m_failedReads)));
+  stats.Set("lastSampleMicros", Napi::Number::New(env, m_lastSampleNanos / 1000.0));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  return stats;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "page_activity_profile.h"
+
+// Profiles which parts of MEM1 (and optionally MEM2) change, how often and after which inputs.
+// A background thread samples the emulated RAM at a fixed rate into a PageActivityProfile; JS marks
+// the inputs it injects with markInput(label) and queries heatmaps, the hottest blocks and the
+// pages that react to each input as typed arrays.
+class PageActivityProfiler : public Napi::ObjectWrap<PageActivityProfiler> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  PageActivityProfiler(const Napi::CallbackInfo& info);
+  ~PageActivityProfiler();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  bool sample();
+  void run();
+  void stopThread();
+
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value SampleNow(const Napi::CallbackInfo& info);
+  Napi::Value MarkInput(const Napi::CallbackInfo& info);
+  Napi::Value Reset(const Napi::CallbackInfo& info);
+  Napi::Value GetHeatmap(const Napi::CallbackInfo& info);
+  Napi::Value GetHottest(const Napi::CallbackInfo& info);
+  Napi::Value GetTimeline(const Napi::CallbackInfo& info);
+  Napi::Value GetInputCorrelation(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  bool m_includeMEM2 = false;
+  u32 m_rateHz = 20;
+
+  // Guards m_profile; m_sampleMutex serializes samplers so m_image can be reused
+  mutable std::mutex m_mutex;
+  std::mutex m_sampleMutex;
+  DolphinComm::PageActivityProfile m_profile;
+  std::vector<u8> m_image;
+  u64 m_failedReads = 0;
+  u64 m_lastSampleNanos = 0;
+  u32 m_lastChangedBlocks = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+};
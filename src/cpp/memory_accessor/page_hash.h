@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "common_types.h"
+
+namespace Common
+{
+// Non-cryptographic 64-bit hash used to detect changed pages between two samples. Four independent
+// multiply/rotate lanes keep the loop throughput-bound rather than latency-bound.
+inline u64 hashPage(const u8* data, size_t size)
+{
+  constexpr u64 prime1 = 0x9E3779B185EBCA87ull;
+  constexpr u64 prime2 = 0xC2B2AE3D27D4EB4Full;
+  auto rotl = [](u64 value, int shift) { return (value << shift) | (value >> (64 - shift)); };
+
+  u64 lanes[4] = {prime1, prime2, ~prime1, ~prime2};
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32)
+  {
+    for (int lane = 0; lane < 4; ++lane)
+    {
+      u64 word;
+      std::memcpy(&word, data + i + lane * 8, sizeof(u64));
+      lanes[lane] = rotl(lanes[lane] ^ (word * prime2), 31) * prime1;
+    }
+  }
+
+  u64 hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+  for (; i < size; ++i)
+    hash = rotl(hash ^ (data[i] * prime1), 11) * prime2;
+  hash ^= size;
+  hash ^= hash >> 33;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  return hash;
+}
+}  // namespace Common
@@ -0,0 +1,277 @@
+#include "pattern_search.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DolphinComm
+{
+namespace
+{
+// Rough commonness of a byte in GameCube/Wii RAM: zero fill, 0xFF fill, pointer high bytes and
+// the opcode bytes of the most frequent PowerPC instructions (addi/lwz/stw/mr/blr...)
+int byteCommonness(u8 value)
+{
+  switch (value)
+  {
+  case 0x00:
+    return 100;
+  case 0xFF:
+    return 60;
+  case 0x80:
+  case 0x81:
+  case 0x90:
+    return 40;
+  case 0x38:
+  case 0x3C:
+  case 0x7C:
+  case 0x4E:
+  case 0x4B:
+  case 0x48:
+  case 0x60:
+  case 0x93:
+  case 0x94:
+  case 0x01:
+  case 0x20:
+  case 0x3F:
+    return 20;
+  default:
+    return 1;
+  }
+}
+
+int hexDigit(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+}  // namespace
+
+bool parseBytePattern(std::string_view text, BytePattern& pattern)
+{
+  pattern.bytes.clear();
+  pattern.mask.clear();
+
+  size_t pos = 0;
+  while (pos < text.size())
+  {
+    if (text[pos] == ' ' || text[pos] == '\t')
+    {
+      ++pos;
+      continue;
+    }
+
+    // A lone "?" is a full wildcard byte, like "??"
+    if (text[pos] == '?' && (pos + 1 == text.size() || text[pos + 1] == ' ' || text[pos + 1] == '\t'))
+    {
+      pattern.bytes.push_back(0);
+      pattern.mask.push_back(0);
+      ++pos;
+      continue;
+    }
+    if (pos + 1 >= text.size())
+      return false;
+
+    u8 value = 0;
+    u8 mask = 0;
+    for (size_t nibble = 0; nibble < 2; ++nibble)
+    {
+      char c = text[pos + nibble];
+      int shift = nibble == 0 ? 4 : 0;
+      if (c == '?')
+        continue;
+      int digit = hexDigit(c);
+      if (digit < 0)
+        return false;
+      value |= digit << shift;
+      mask |= 0xF << shift;
+    }
+    pattern.bytes.push_back(value);
+    pattern.mask.push_back(mask);
+    pos += 2;
+  }
+  return !pattern.bytes.empty();
+}
+
+bool PatternSearcher::compile(std::vector<BytePattern> patterns)
+{
+  m_patterns.clear();
+  m_maxLength = 0;
+  m_pairFilter.clear();
+  m_pairBuckets.clear();
+
+  for (BytePattern& pattern : patterns)
+  {
+    if (pattern.bytes.empty() || pattern.mask.size() != pattern.bytes.size())
+      return false;
+
+    CompiledPattern compiled{};
+    bool hasAnchor = false;
+    int pairCost = 0;
+    for (size_t i = 0; i < pattern.bytes.size(); ++i)
+    {
+      pattern.bytes[i] &= pattern.mask[i];
+      if (pattern.mask[i] != 0xFF)
+        continue;
+      if (!hasAnchor ||
+          byteCommonness(pattern.bytes[i]) < byteCommonness(pattern.bytes[compiled.anchorOffset]))
+        compiled.anchorOffset = i;
+      hasAnchor = true;
+
+      // Prefer an exact pair of uncommon bytes; a lone exact byte only if there is no pair
+      if (i + 1 < pattern.bytes.size() && pattern.mask[i + 1] == 0xFF)
+      {
+        int cost = byteCommonness(pattern.bytes[i]) + byteCommonness(pattern.bytes[i + 1] & pattern.mask[i + 1]);
+        if (compiled.pairLength < 2 || cost < pairCost)
+        {
+          compiled.pairOffset = i;
+          compiled.pairLength = 2;
+          pairCost = cost;
+        }
+      }
+    }
+    if (!hasAnchor)
+      return false;
+    if (compiled.pairLength < 2)
+    {
+      compiled.pairOffset = compiled.anchorOffset;
+      compiled.pairLength = 1;
+    }
+
+    m_maxLength = std::max(m_maxLength, pattern.bytes.size());
+    compiled.pattern = std::move(pattern);
+    m_patterns.push_back(std::move(compiled));
+  }
+
+  if (m_patterns.size() > PAIR_FILTER_THRESHOLD)
+    buildPairFilter();
+  return !m_patterns.empty();
+}
+
+void PatternSearcher::buildPairFilter()
+{
+  m_pairFilter.assign(65536 / 64, 0);
+  m_pairBuckets.clear();
+  for (u32 index = 0; index < m_patterns.size(); ++index)
+  {
+    const CompiledPattern& compiled = m_patterns[index];
+    const u8 first = compiled.pattern.bytes[compiled.pairOffset];
+    // A lone exact byte matches whatever follows it
+    const u32 secondCount = compiled.pairLength == 2 ? 1 : 256;
+    for (u32 i = 0; i < secondCount; ++i)
+    {
+      const u16 second = compiled.pairLength == 2 ? compiled.pattern.bytes[compiled.pairOffset + 1] : i;
+      const u16 key = static_cast<u16>(first << 8 | second);
+      m_pairFilter[key / 64] |= u64(1) << (key % 64);
+      m_pairBuckets.push_back({key, index});
+    }
+  }
+  std::sort(m_pairBuckets.begin(), m_pairBuckets.end(),
+            [](const PairBucket& a, const PairBucket& b) { return a.key != b.key ? a.key < b.key : a.pattern < b.pattern; });
+}
+
+bool PatternSearcher::matchesAt(const CompiledPattern& compiled, const u8* data) const
+{
+  const BytePattern& pattern = compiled.pattern;
+  for (size_t i = 0; i < pattern.bytes.size(); ++i)
+  {
+    if ((data[i] & pattern.mask[i]) != pattern.bytes[i])
+      return false;
+  }
+  return true;
+}
+
+void PatternSearcher::scanAnchored(const CompiledPattern& compiled, u32 index, const u8* data,
+                                   size_t size, size_t scanEnd, u32 baseAddress,
+                                   std::vector<PatternMatch>& matches) const
+{
+  const size_t length = compiled.pattern.bytes.size();
+  const size_t anchor = compiled.anchorOffset;
+  if (size < length || scanEnd == 0)
+    return;
+  // Last start that both lies before scanEnd and leaves room for the whole pattern
+  const size_t lastStart = std::min(scanEnd - 1, size - length);
+
+  const u8 anchorValue = compiled.pattern.bytes[anchor];
+  const u8* cursor = data + anchor;
+  const u8* end = data + lastStart + anchor + 1;
+  while (cursor < end)
+  {
+    const u8* hit = static_cast<const u8*>(std::memchr(cursor, anchorValue, end - cursor));
+    if (!hit)
+      break;
+    const u8* start = hit - anchor;
+    if (matchesAt(compiled, start))
+      matches.push_back({index, baseAddress + static_cast<u32>(start - data)});
+    cursor = hit + 1;
+  }
+}
+
+void PatternSearcher::verifyPair(u16 key, size_t pos, const u8* data, size_t size, size_t scanEnd,
+                                 u32 baseAddress, std::vector<PatternMatch>& matches) const
+{
+  auto bucket = std::lower_bound(m_pairBuckets.begin(), m_pairBuckets.end(), key,
+                                 [](const PairBucket& entry, u16 value) { return entry.key < value; });
+  for (; bucket != m_pairBuckets.end() && bucket->key == key; ++bucket)
+  {
+    const CompiledPattern& compiled = m_patterns[bucket->pattern];
+    if (pos < compiled.pairOffset)
+      continue;
+    const size_t start = pos - compiled.pairOffset;
+    if (start >= scanEnd || start + compiled.pattern.bytes.size() > size)
+      continue;
+    if (matchesAt(compiled, data + start))
+      matches.push_back({bucket->pattern, baseAddress + static_cast<u32>(start)});
+  }
+}
+
+void PatternSearcher::scanPairs(const u8* data, size_t size, size_t scanEnd, u32 baseAddress,
+                                std::vector<PatternMatch>& matches) const
+{
+  // A pair starting past this point belongs to a match starting at or after scanEnd
+  const size_t end = std::min(size, scanEnd + m_maxLength);
+  if (end == 0)
+    return;
+
+  // Each position is an independent load from an 8 KB table that stays in L1, unlike an automaton
+  // whose every step waits on the previous one
+  const u64* filter = m_pairFilter.data();
+  for (size_t pos = 0; pos + 1 < end; ++pos)
+  {
+    const u16 key = static_cast<u16>(data[pos] << 8 | data[pos + 1]);
+    if (filter[key / 64] & (u64(1) << (key % 64)))
+      verifyPair(key, pos, data, size, scanEnd, baseAddress, matches);
+  }
+  // At the last byte only lone-byte keys can match; they are filed under every second byte
+  const u16 lastKey = static_cast<u16>(data[end - 1] << 8);
+  if (filter[lastKey / 64] & (u64(1) << (lastKey % 64)))
+    verifyPair(lastKey, end - 1, data, size, scanEnd, baseAddress, matches);
+}
+
+void PatternSearcher::scan(const u8* data, size_t size, size_t scanEnd, u32 baseAddress,
+                           std::vector<PatternMatch>& matches) const
+{
+  scanEnd = std::min(scanEnd, size);
+  size_t firstMatch = matches.size();
+  if (!m_pairFilter.empty())
+  {
+    scanPairs(data, size, scanEnd, baseAddress, matches);
+  }
+  else
+  {
+    for (u32 index = 0; index < m_patterns.size(); ++index)
+      scanAnchored(m_patterns[index], index, data, size, scanEnd, baseAddress, matches);
+  }
+  // Both paths find matches at their anchors, which sit at different offsets into each pattern;
+  // callers rely on address order
+  if (m_patterns.size() > 1)
+  {
+    std::stable_sort(matches.begin() + firstMatch, matches.end(),
+                     [](const PatternMatch& a, const PatternMatch& b) { return a.address < b.address; });
+  }
+}
+}  // namespace DolphinComm
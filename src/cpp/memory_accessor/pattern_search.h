@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "common_types.h"
+
+// Multi-pattern byte search with wildcards.
+//
+// A pattern is a byte string plus a per-byte mask: 0xFF for an exact byte, 0x00 for "??" and
+// 0xF0/0x0F for nibble wildcards ("3?"). Small pattern sets are searched one by one with memchr
+// (vectorized in every libc we ship on) on the pattern's rarest exact byte, then verified. Larger
+// sets take a single pass with a 64K-bit filter holding the least common pair of adjacent exact
+// bytes of each pattern; positions that pass are verified against the patterns filed under that
+// pair.
+namespace DolphinComm
+{
+struct BytePattern
+{
+  std::vector<u8> bytes;
+  std::vector<u8> mask;
+};
+
+struct PatternMatch
+{
+  u32 pattern;
+  u32 address;
+};
+
+// Parses "3C 60 ?? ?? 38 6?"-style signatures (whitespace between bytes is optional)
+bool parseBytePattern(std::string_view text, BytePattern& pattern);
+
+class PatternSearcher
+{
+public:
+  // Above this many patterns one pair filter pass beats a memchr pass per pattern
+  static constexpr size_t PAIR_FILTER_THRESHOLD = 4;
+
+  // Fails if a pattern is empty or has no exact byte to anchor on
+  bool compile(std::vector<BytePattern> patterns);
+
+  size_t patternCount() const { return m_patterns.size(); }
+  size_t maxPatternLength() const { return m_maxLength; }
+
+  // Appends matches that start in data[0, scanEnd). data may run up to maxPatternLength() - 1
+  // bytes past scanEnd so matches straddling the end of a chunk are still verified.
+  void scan(const u8* data, size_t size, size_t scanEnd, u32 baseAddress,
+            std::vector<PatternMatch>& matches) const;
+
+private:
+  struct CompiledPattern
+  {
+    BytePattern pattern;
+    // Rarest exact byte, used by the memchr path
+    size_t anchorOffset;
+    // Least common pair of adjacent exact bytes (or a lone exact byte), used by the pair filter
+    size_t pairOffset;
+    size_t pairLength;
+  };
+
+  bool matchesAt(const CompiledPattern& pattern, const u8* data) const;
+  void scanAnchored(const CompiledPattern& pattern, u32 index, const u8* data, size_t size,
+                    size_t scanEnd, u32 baseAddress, std::vector<PatternMatch>& matches) const;
+  void buildPairFilter();
+  void verifyPair(u16 key, size_t pos, const u8* data, size_t size, size_t scanEnd, u32 baseAddress,
+                  std::vector<PatternMatch>& matches) const;
+  void scanPairs(const u8* data, size_t size, size_t scanEnd, u32 baseAddress,
+                 std::vector<PatternMatch>& matches) const;
+
+  struct PairBucket
+  {
+    u16 key;
+    u32 pattern;
+  };
+
+  std::vector<CompiledPattern> m_patterns;
+  size_t m_maxLength = 0;
+  // Bit per (first, second) byte pair that keys some pattern
+  std::vector<u64> m_pairFilter;
+  // Patterns by pair, sorted by key
+  std::vector<PairBucket> m_pairBuckets;
+};
+}  // namespace DolphinComm
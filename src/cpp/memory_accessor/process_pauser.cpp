@@ -0,0 +1,83 @@
+#include "process_pauser.h"
+
+#include <algorithm>
+
+namespace DolphinComm
+{
+ProcessPauser::~ProcessPauser()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    if (m_paused)
+      endPause();
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+bool ProcessPauser::pause(u32 maxPauseMicros)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_paused)
+    return false;
+  if (!m_thread.joinable())
+    m_thread = std::thread(&ProcessPauser::watchdog, this);
+
+  if (!m_process.suspend())
+  {
+    m_stats.failedPauses++;
+    return false;
+  }
+  m_paused = true;
+  m_pauseStart = std::chrono::steady_clock::now();
+  m_deadline = m_pauseStart + std::chrono::microseconds(maxPauseMicros);
+  m_wake.notify_all();
+  return true;
+}
+
+bool ProcessPauser::resume()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_paused)
+    return false;
+  endPause();
+  m_wake.notify_all();
+  return true;
+}
+
+void ProcessPauser::endPause()
+{
+  m_process.resume();
+  m_paused = false;
+  const u64 nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - m_pauseStart)
+                        .count();
+  m_stats.pauses++;
+  m_stats.lastPauseNanos = nanos;
+  m_stats.maxPauseNanos = std::max(m_stats.maxPauseNanos, nanos);
+  m_stats.totalPauseNanos += nanos;
+}
+
+ProcessPauser::Stats ProcessPauser::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+void ProcessPauser::watchdog()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopping)
+  {
+    m_wake.wait(lock, [this] { return m_stopping || m_paused; });
+    if (m_stopping)
+      break;
+    if (m_wake.wait_until(lock, m_deadline, [this] { return m_stopping || !m_paused; }))
+      continue;
+    endPause();
+    m_stats.overruns++;
+  }
+}
+}  // namespace DolphinComm
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+
+namespace DolphinComm
+{
+// Suspends the hooked emulator around accesses that must not tear. Every pause has a deadline: a
+// watchdog thread resumes the emulator once it passes, so a slow or stuck caller can stall the game
+// for a bounded time only.
+class ProcessPauser
+{
+public:
+  struct Stats
+  {
+    u64 pauses;
+    u64 failedPauses;
+    // Pauses the watchdog had to end
+    u64 overruns;
+    u64 lastPauseNanos;
+    u64 maxPauseNanos;
+    u64 totalPauseNanos;
+  };
+
+  explicit ProcessPauser(IDolphinProcess& process) : m_process(process) {}
+  ~ProcessPauser();
+  ProcessPauser(const ProcessPauser&) = delete;
+  ProcessPauser& operator=(const ProcessPauser&) = delete;
+
+  // False if the emulator couldn't be suspended (or is already paused); nothing is suspended then
+  bool pause(u32 maxPauseMicros);
+  // False if the watchdog already ended the pause, i.e. part of the work ran unpaused
+  bool resume();
+  Stats stats() const;
+
+private:
+  void watchdog();
+  // With m_mutex held
+  void endPause();
+
+  IDolphinProcess& m_process;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::thread m_thread;
+  bool m_stopping = false;
+  bool m_paused = false;
+  std::chrono::steady_clock::time_point m_pauseStart;
+  std::chrono::steady_clock::time_point m_deadline;
+  Stats m_stats{};
+};
+}  // namespace DolphinComm
@@ -0,0 +1,171 @@
+#include "ram_dump.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "executor.h"
+#include "memory_common.h"
+
+namespace DolphinComm
+{
+void RamDumper::planChunks(bool includeMEM2)
+{
+  m_chunks.clear();
+  u64 fileOffset = 0;
+  auto addRegion = [&](u32 start, u32 size) {
+    for (u32 offset = 0; offset < size; offset += CHUNK_SIZE)
+    {
+      const u32 chunkSize = std::min(CHUNK_SIZE, size - offset);
+      m_chunks.push_back({start + offset, chunkSize, fileOffset});
+      fileOffset += chunkSize;
+    }
+  };
+  addRegion(0, Common::GetMEM1SizeReal());
+  if (includeMEM2)
+    addRegion(Common::MEM2_START - Common::MEM1_START, Common::GetMEM2SizeReal());
+}
+
+u8* RamDumper::image(size_t size)
+{
+  if (size > m_imageSize)
+  {
+    const size_t alignment = Common::AsyncFileWriter::ALIGNMENT;
+    m_image.reset(static_cast<u8*>(std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)));
+    m_imageSize = m_image ? size : 0;
+  }
+  return m_image.get();
+}
+
+bool RamDumper::dump(const std::string& path, bool includeMEM2, bool direct, RamDumpStats& stats,
+                     std::string& error)
+{
+  if (!m_process.hasEmuRAMInformation())
+  {
+    error = "Not hooked to Dolphin";
+    return false;
+  }
+  includeMEM2 = includeMEM2 && m_process.isMEM2Present();
+  planChunks(includeMEM2);
+  const size_t totalSize = m_chunks.back().fileOffset + m_chunks.back().size;
+  u8* buffer = image(totalSize);
+  if (buffer == nullptr)
+  {
+    error = "Out of memory for the dump buffer";
+    return false;
+  }
+  if (!m_writer.open(path, totalSize, direct))
+  {
+    error = "Can't create " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  std::atomic<bool> readFailed{false};
+  std::atomic<bool> writeFailed{false};
+  Common::Executor::shared().parallelFor(m_chunks.size(), [&](size_t i) {
+    const Chunk& chunk = m_chunks[i];
+    u8* data = buffer + chunk.fileOffset;
+    ReadRequest request{chunk.offset, chunk.size, reinterpret_cast<char*>(data), false};
+    if (readFailed || m_process.readBatch(&request, 1) != 1)
+      readFailed = true;
+    else if (!m_writer.write(data, chunk.size, chunk.fileOffset))
+      writeFailed = true;
+  });
+  const bool written = m_writer.finish() && !writeFailed;
+
+  if (readFailed || !written)
+  {
+    error = readFailed ? "Failed to read emulated RAM" : "Failed to write " + path;
+    unlink(path.c_str());
+    return false;
+  }
+  stats = {totalSize, static_cast<u32>(m_chunks.size()), m_writer.usesIoUring(), m_writer.isDirect()};
+  return true;
+}
+
+bool RamDumper::restore(const std::string& path, RamDumpStats& stats, std::string& error)
+{
+  if (!m_process.hasEmuRAMInformation())
+  {
+    error = "Not hooked to Dolphin";
+    return false;
+  }
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    error = "Can't open " + path + ": " + strerror(errno);
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+
+  const u64 MEM1Size = Common::GetMEM1SizeReal();
+  const u64 fullSize = MEM1Size + Common::GetMEM2SizeReal();
+  const u64 fileSize = static_cast<u64>(st.st_size);
+  const bool includeMEM2 = fileSize == fullSize && fullSize != MEM1Size;
+  if (fileSize != MEM1Size && !includeMEM2)
+  {
+    close(fd);
+    error = "Dump size doesn't match the current memory layout";
+    return false;
+  }
+  if (includeMEM2 && !m_process.isMEM2Present())
+  {
+    close(fd);
+    error = "Dump holds MEM2 but the hooked game has none";
+    return false;
+  }
+
+  planChunks(includeMEM2);
+  u8* buffer = image(fileSize);
+  if (buffer == nullptr)
+  {
+    close(fd);
+    error = "Out of memory for the dump buffer";
+    return false;
+  }
+
+  // Chunks are loaded in parallel, then go back into the process as one batch, which the backend
+  // turns into as few vectored writes as it can
+  std::atomic<bool> readFailed{false};
+  Common::Executor::shared().parallelFor(m_chunks.size(), [&](size_t i) {
+    const Chunk& chunk = m_chunks[i];
+    size_t done = 0;
+    while (done < chunk.size && !readFailed)
+    {
+      ssize_t result = pread(fd, buffer + chunk.fileOffset + done, chunk.size - done,
+                             static_cast<off_t>(chunk.fileOffset + done));
+      if (result < 0 && errno == EINTR)
+        continue;
+      if (result <= 0)
+        readFailed = true;
+      else
+        done += static_cast<size_t>(result);
+    }
+  });
+  close(fd);
+  if (readFailed)
+  {
+    error = "Failed to read " + path;
+    return false;
+  }
+
+  std::vector<WriteRequest> writes;
+  writes.reserve(m_chunks.size());
+  for (const Chunk& chunk : m_chunks)
+    writes.push_back({chunk.offset, chunk.size, reinterpret_cast<char*>(buffer + chunk.fileOffset), false});
+  if (m_process.writeBatch(writes.data(), writes.size()) != writes.size())
+  {
+    error = "Failed to write emulated RAM";
+    return false;
+  }
+  stats = {fileSize, static_cast<u32>(m_chunks.size()), false, false};
+  return true;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_file_writer.h"
+#include "common_types.h"
+#include "dolphin_process.h"
+
+namespace DolphinComm
+{
+struct RamDumpStats
+{
+  u64 bytes;
+  u32 chunks;
+  bool ioUring;
+  bool direct;
+};
+
+// Full MEM1/MEM2 dumps to raw files and back: MEM1, then MEM2 if included, back to back in guest
+// (big endian) byte order, i.e. Dolphin's own MEM1/MEM2 dumps concatenated. The regions are split
+// into chunks read in parallel on the shared executor; each chunk is queued on the file writer as soon
+// as it is in, so process reads and disk writes overlap. The aligned image buffer is kept between
+// calls so frequent checkpoints don't fault in fresh memory every time.
+class RamDumper
+{
+public:
+  static constexpr u32 CHUNK_SIZE = 2 * 1024 * 1024;
+
+  explicit RamDumper(IDolphinProcess& process) : m_process(process) {}
+
+  bool dump(const std::string& path, bool includeMEM2, bool direct, RamDumpStats& stats, std::string& error);
+  // The file's size tells whether it holds MEM2; it must match the current memory layout
+  bool restore(const std::string& path, RamDumpStats& stats, std::string& error);
+
+private:
+  struct Chunk
+  {
+    u32 offset;
+    u32 size;
+    u64 fileOffset;
+  };
+
+  struct FreeDeleter
+  {
+    void operator()(u8* data) const { std::free(data); }
+  };
+
+  void planChunks(bool includeMEM2);
+  u8* image(size_t size);
+
+  IDolphinProcess& m_process;
+  Common::AsyncFileWriter m_writer;
+  std::unique_ptr<u8, FreeDeleter> m_image;
+  size_t m_imageSize = 0;
+  std::vector<Chunk> m_chunks;
+};
+}  // namespace DolphinComm
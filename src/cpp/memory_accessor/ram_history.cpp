@@ -0,0 +1,300 @@
+#include "ram_history.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "common_utils.h"
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+// With write tracking, still read everything this often in case a write slipped through
+constexpr u32 kFullReadSeconds = 10;
+
+u64 nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+Napi::FunctionReference RamHistory::constructor;
+
+Napi::Object RamHistory::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "RamHistory", {
+    InstanceMethod("start", &RamHistory::Start),
+    InstanceMethod("stop", &RamHistory::Stop),
+    InstanceMethod("sampleNow", &RamHistory::SampleNow),
+    InstanceMethod("readAt", &RamHistory::ReadAt),
+    InstanceMethod("readAgo", &RamHistory::ReadAgo),
+    InstanceMethod("getTimestamps", &RamHistory::GetTimestamps),
+    InstanceMethod("getStats", &RamHistory::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("RamHistory", func);
+  return exports;
+}
+
+// new RamHistory(accessor, { rateHz?, budgetMB?, includeMEM2?, pageSize?, maxSamples? })
+RamHistory::RamHistory(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<RamHistory>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "MemoryAccessor argument expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  Napi::Object options = info.Length() >= 2 && info[1].IsObject() ? info[1].As<Napi::Object>() : Napi::Object::New(env);
+  m_rateHz = NapiUtils::getU32Or(options, "rateHz", 10);
+  u32 budgetMB = NapiUtils::getU32Or(options, "budgetMB", 256);
+  u32 pageSize = NapiUtils::getU32Or(options, "pageSize", 4096);
+  u32 maxSamples = NapiUtils::getU32Or(options, "maxSamples", m_rateHz * 60);
+  m_includeMEM2 = options.Get("includeMEM2").IsBoolean() && options.Get("includeMEM2").As<Napi::Boolean>().Value();
+
+  if (m_rateHz == 0 || pageSize == 0 || (pageSize & (pageSize - 1)) != 0) {
+    Napi::RangeError::New(env, "rateHz must be positive and pageSize a power of two").ThrowAsJavaScriptException();
+    return;
+  }
+
+  size_t imageSize = Common::GetMEM1SizeReal();
+  if (m_includeMEM2)
+    imageSize += Common::GetMEM2SizeReal();
+
+  if (!m_ring.init(imageSize, pageSize, static_cast<size_t>(budgetMB) * 1024 * 1024, maxSamples)) {
+    Napi::RangeError::New(env, "RamHistory: budget must hold at least two full images and maxSamples must be >= 2").ThrowAsJavaScriptException();
+    return;
+  }
+  m_image.resize(imageSize);
+  m_dirtyConsumer = m_process->addDirtyConsumer();
+}
+
+RamHistory::~RamHistory() {
+  stopThread();
+  if (m_dirtyConsumer >= 0)
+    m_process->removeDirtyConsumer(m_dirtyConsumer);
+}
+
+bool RamHistory::readImage(u64& bytesRead) {
+  bytesRead = m_image.size();
+  if (!m_process->readFromRAM(0, reinterpret_cast<char*>(m_image.data()), Common::GetMEM1SizeReal()))
+    return false;
+  if (m_includeMEM2) {
+    return m_process->readFromRAM(Common::MEM2_START - Common::MEM1_START,
+                                  reinterpret_cast<char*>(m_image.data() + Common::GetMEM1SizeReal()),
+                                  Common::GetMEM2SizeReal());
+  }
+  return true;
+}
+
+// Re-reads the pages in m_dirtyPages into m_image, merging neighbours into one read
+bool RamHistory::readDirtyPages(u64& bytesRead) {
+  const u32 pageSize = m_process->dirtyPageSize();
+  m_requests.clear();
+  bytesRead = 0;
+  Common::withAddressTranslator([&](auto translator) {
+    for (u32 cacheIndex : m_dirtyPages) {
+      if (cacheIndex >= m_image.size())
+        break;
+      u32 size = static_cast<u32>(std::min<size_t>(pageSize, m_image.size() - cacheIndex));
+      u32 offset = translator.cacheIndexToOffset(cacheIndex, false);
+      // The end of MEM1 and the start of MEM2 are neighbours in the image but not as offsets
+      if (!m_requests.empty() && m_requests.back().offset + m_requests.back().size == offset) {
+        m_requests.back().size += size;
+      } else {
+        m_requests.push_back({offset, size, reinterpret_cast<char*>(m_image.data() + cacheIndex), false});
+      }
+      bytesRead += size;
+    }
+  });
+  return m_process->readBatch(m_requests.data(), m_requests.size()) == m_requests.size();
+}
+
+bool RamHistory::sample() {
+  std::lock_guard<std::mutex> sampleLock(m_sampleMutex);
+  auto start = std::chrono::steady_clock::now();
+  u64 timestamp = nowMicros();
+
+  // Also starts the next tracking interval before a full read. The occasional full read is only a
+  // safety net.
+  m_dirtyPages.clear();
+  bool tracked = m_dirtyConsumer >= 0 && m_process->dirtyPagesSince(m_dirtyConsumer, m_dirtyPages);
+  bool incremental = tracked && m_imageValid && m_samplesSinceFullRead < m_rateHz * kFullReadSeconds;
+
+  u64 bytesRead = 0;
+  bool success = incremental ? readDirtyPages(bytesRead) : readImage(bytesRead);
+  if (!success) {
+    m_imageValid = false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failedReads++;
+    return false;
+  }
+
+  // Hashing is the expensive part and only touches the scratch buffers, so keep it outside the lock
+  if (incremental) {
+    m_ring.hashRanges(m_image.data(), m_dirtyPages.data(), m_dirtyPages.size(), m_process->dirtyPageSize(), m_hashes);
+    m_samplesSinceFullRead++;
+  } else {
+    m_ring.hashImage(m_image.data(), m_hashes);
+    m_samplesSinceFullRead = 0;
+  }
+  m_imageValid = true;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  success = m_ring.commitSample(timestamp, m_image.data(), m_hashes);
+  m_lastSampleIncremental = incremental;
+  m_lastReadBytes = bytesRead;
+  m_lastSampleNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return success;
+}
+
+void RamHistory::run() {
+  auto interval = std::chrono::microseconds(1000000 / m_rateHz);
+  auto next = std::chrono::steady_clock::now();
+  while (m_running) {
+    sample();
+    next += interval;
+    // Don't try to catch up if sampling fell behind, just skip the missed ticks
+    auto now = std::chrono::steady_clock::now();
+    if (next < now)
+      next = now;
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void RamHistory::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+Napi::Value RamHistory::readSample(Napi::Env env, long sampleIndex, u32 offset, size_t size) {
+  // Only MEM1 and (if sampled) MEM2 offsets map into the history, and a read can't straddle them
+  const u32 MEM2Offset = Common::MEM2_START - Common::MEM1_START;
+  bool inMEM1 = offset < Common::GetMEM1SizeReal() && size <= Common::GetMEM1SizeReal() - offset;
+  bool inMEM2 = m_includeMEM2 && offset >= MEM2Offset && offset - MEM2Offset < Common::GetMEM2SizeReal() &&
+                size <= Common::GetMEM2SizeReal() - (offset - MEM2Offset);
+  if (!inMEM1 && !inMEM2) {
+    Napi::RangeError::New(env, "Offset range is not covered by the history").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (sampleIndex < 0)
+    return env.Null();
+
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, size);
+  u32 cacheIndex = Common::offsetToCacheIndex(offset, false);
+  if (!m_ring.read(static_cast<size_t>(sampleIndex), cacheIndex, buffer.Data(), size))
+    return env.Null();
+  return buffer;
+}
+
+Napi::Value RamHistory::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  m_running = true;
+  m_thread = std::thread(&RamHistory::run, this);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value RamHistory::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+Napi::Value RamHistory::SampleNow(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  return Napi::Boolean::New(env, sample());
+}
+
+// readAt(timestampMicros, offset, size) => Buffer, or null if the history doesn't reach back that far
+Napi::Value RamHistory::ReadAt(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber()) {
+    Napi::TypeError::New(env, "Timestamp, offset, and size arguments expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  u64 timestamp = static_cast<u64>(info[0].As<Napi::Number>().DoubleValue());
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return readSample(env, m_ring.findSample(timestamp), info[1].As<Napi::Number>().Uint32Value(),
+                    info[2].As<Napi::Number>().Uint32Value());
+}
+
+// readAgo(seconds, offset, size) => Buffer as of `seconds` ago, or null
+Napi::Value RamHistory::ReadAgo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber()) {
+    Napi::TypeError::New(env, "Seconds, offset, and size arguments expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  double secondsAgo = info[0].As<Napi::Number>().DoubleValue();
+  u64 timestamp = nowMicros() - static_cast<u64>(secondsAgo * 1000000.0);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return readSample(env, m_ring.findSample(timestamp), info[1].As<Napi::Number>().Uint32Value(),
+                    info[2].As<Napi::Number>().Uint32Value());
+}
+
+Napi::Value RamHistory::GetTimestamps(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Float64Array timestamps = Napi::Float64Array::New(env, m_ring.sampleCount());
+  for (size_t i = 0; i < m_ring.sampleCount(); i++)
+    timestamps[i] = static_cast<double>(m_ring.sampleTimestamp(i));
+  return timestamps;
+}
+
+Napi::Value RamHistory::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  DolphinComm::RamHistoryRing::Stats ringStats = m_ring.stats();
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("samples", Napi::Number::New(env, ringStats.samples));
+  stats.Set("maxSamples", Napi::Number::New(env, ringStats.maxSamples));
+  stats.Set("pagesUsed", Napi::Number::New(env, ringStats.pagesUsed));
+  stats.Set("pagesTotal", Napi::Number::New(env, ringStats.pagesTotal));
+  stats.Set("bytesUsed", Napi::Number::New(env, static_cast<double>(ringStats.pagesUsed * m_ring.pageSize())));
+  stats.Set("oldestTimestamp", Napi::Number::New(env, static_cast<double>(ringStats.oldestTimestamp)));
+  stats.Set("newestTimestamp", Napi::Number::New(env, static_cast<double>(ringStats.newestTimestamp)));
+  stats.Set("lastChangedPages", Napi::Number::New(env, static_cast<double>(ringStats.lastChangedPages)));
+  stats.Set("droppedSamples", Napi::Number::New(env, static_cast<double>(ringStats.droppedSamples)));
+  stats.Set("evictedSamples", Napi::Number::New(env, static_cast<double>(ringStats.evictedSamples)));
+  stats.Set("failedReads", Napi::Number::New(env, static_cast<double>(m_failedReads)));
+  stats.Set("lastSampleMicros", Napi::Number::New(env, m_lastSampleNanos / 1000.0));
+  stats.Set("lastReadBytes", Napi::Number::New(env, static_cast<double>(m_lastReadBytes)));
+  stats.Set("incremental", Napi::Boolean::New(env, m_lastSampleIncremental));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  return stats;
+}
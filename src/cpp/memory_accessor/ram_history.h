@@ -0,0 +1,68 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "ram_history_ring.h"
+
+// Rolling "time travel" history of MEM1 (and optionally MEM2). A background thread samples the
+// emulated RAM at a fixed rate into a RamHistoryRing, so any offset can be read as it was at any
+// retained sample without taking explicit snapshots. Where the backend tracks writes (soft-dirty
+// pages on Linux), a sample only reads and rehashes the pages written since the previous one.
+class RamHistory : public Napi::ObjectWrap<RamHistory> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  RamHistory(const Napi::CallbackInfo& info);
+  ~RamHistory();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  bool sample();
+  bool readImage(u64& bytesRead);
+  bool readDirtyPages(u64& bytesRead);
+  void run();
+  void stopThread();
+  Napi::Value readSample(Napi::Env env, long sampleIndex, u32 offset, size_t size);
+
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value SampleNow(const Napi::CallbackInfo& info);
+  Napi::Value ReadAt(const Napi::CallbackInfo& info);
+  Napi::Value ReadAgo(const Napi::CallbackInfo& info);
+  Napi::Value GetTimestamps(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  bool m_includeMEM2 = false;
+  u32 m_rateHz = 10;
+
+  // Guards m_ring; m_sampleMutex serializes samplers so the scratch buffers can be reused
+  mutable std::mutex m_mutex;
+  std::mutex m_sampleMutex;
+  DolphinComm::RamHistoryRing m_ring;
+  std::vector<u8> m_image;
+  std::vector<u64> m_hashes;
+  // m_image and m_hashes hold the previous sample, so dirty pages can be patched in
+  bool m_imageValid = false;
+  u32 m_samplesSinceFullRead = 0;
+  // Our handle on the backend's write tracking, -1 without it
+  int m_dirtyConsumer = -1;
+  std::vector<u32> m_dirtyPages;
+  std::vector<DolphinComm::ReadRequest> m_requests;
+  u64 m_failedReads = 0;
+  u64 m_lastSampleNanos = 0;
+  u64 m_lastReadBytes = 0;
+  bool m_lastSampleIncremental = false;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+};
@@ -0,0 +1,289 @@
+#include "ram_history_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "page_hash.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr u32 NO_CHUNK = 0xFFFFFFFF;
+}
+
+bool PageArena::init(size_t pageSize, size_t pageCount)
+{
+  if (pageSize == 0 || pageCount == 0 || pageCount >= NO_PAGE)
+    return false;
+
+  m_storage.reset(new (std::nothrow) u8[pageSize * pageCount]);
+  if (!m_storage)
+    return false;
+
+  m_pageSize = pageSize;
+  m_refCounts.assign(pageCount, 0);
+  m_free.resize(pageCount);
+  // Hand out low pages first
+  for (size_t i = 0; i < pageCount; ++i)
+    m_free[i] = static_cast<u32>(pageCount - 1 - i);
+  return true;
+}
+
+u32 PageArena::allocate()
+{
+  if (m_free.empty())
+    return NO_PAGE;
+  u32 page = m_free.back();
+  m_free.pop_back();
+  m_refCounts[page] = 1;
+  return page;
+}
+
+void PageArena::release(u32 page)
+{
+  if (--m_refCounts[page] == 0)
+    m_free.push_back(page);
+}
+
+bool RamHistoryRing::init(size_t imageSize, size_t pageSize, size_t budgetBytes, size_t maxSamples)
+{
+  if (imageSize == 0 || pageSize == 0 || maxSamples < 2)
+    return false;
+
+  m_imageSize = imageSize;
+  m_pageCount = (imageSize + pageSize - 1) / pageSize;
+  m_chunksPerSample = (m_pageCount + CHUNK_PAGES - 1) / CHUNK_PAGES;
+  m_maxSamples = maxSamples;
+
+  // The newest sample may hold a full image and the next one may change every page, so anything
+  // below two images can't make progress
+  size_t arenaPages = budgetBytes / pageSize;
+  if (arenaPages < 2 * m_pageCount || !m_arena.init(pageSize, arenaPages))
+    return false;
+
+  // Every live chunk owns at least one page it allocated, except for the rows of the first sample
+  size_t chunkCapacity = arenaPages + m_chunksPerSample;
+  m_chunks.pages.assign(chunkCapacity * CHUNK_PAGES, PageArena::NO_PAGE);
+  m_chunks.refCounts.assign(chunkCapacity, 0);
+  m_chunks.free.resize(chunkCapacity);
+  for (size_t i = 0; i < chunkCapacity; ++i)
+    m_chunks.free[i] = static_cast<u32>(chunkCapacity - 1 - i);
+
+  m_rows.assign(m_maxSamples * m_chunksPerSample, NO_CHUNK);
+  m_timestamps.assign(m_maxSamples, 0);
+  m_first = 0;
+  m_count = 0;
+  m_lastHashes.clear();
+  return true;
+}
+
+void RamHistoryRing::hashImage(const u8* image, std::vector<u64>& hashes) const
+{
+  const size_t pageSize = m_arena.pageSize();
+  hashes.resize(m_pageCount);
+  for (size_t page = 0; page < m_pageCount; ++page)
+  {
+    size_t offset = page * pageSize;
+    hashes[page] = Common::hashPage(image + offset, std::min(pageSize, m_imageSize - offset));
+  }
+}
+
+void RamHistoryRing::hashRanges(const u8* image, const u32* cacheIndices, size_t count, u32 rangeSize,
+                                std::vector<u64>& hashes) const
+{
+  const size_t pageSize = m_arena.pageSize();
+  // Ranges come in ascending order, so a page shared by neighbouring ranges is hashed once
+  size_t nextPage = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    size_t end = std::min(m_imageSize, static_cast<size_t>(cacheIndices[i]) + rangeSize);
+    for (size_t page = std::max(nextPage, cacheIndices[i] / pageSize); page * pageSize < end; ++page)
+    {
+      size_t offset = page * pageSize;
+      hashes[page] = Common::hashPage(image + offset, std::min(pageSize, m_imageSize - offset));
+      nextPage = page + 1;
+    }
+  }
+}
+
+u32 RamHistoryRing::allocateChunk()
+{
+  u32 chunk = m_chunks.free.back();
+  m_chunks.free.pop_back();
+  m_chunks.refCounts[chunk] = 1;
+  return chunk;
+}
+
+void RamHistoryRing::releaseChunk(u32 chunk)
+{
+  if (chunk == NO_CHUNK || --m_chunks.refCounts[chunk] != 0)
+    return;
+
+  u32* pages = m_chunks.pages.data() + static_cast<size_t>(chunk) * CHUNK_PAGES;
+  for (u32 i = 0; i < CHUNK_PAGES; ++i)
+  {
+    if (pages[i] != PageArena::NO_PAGE)
+      m_arena.release(pages[i]);
+    pages[i] = PageArena::NO_PAGE;
+  }
+  m_chunks.free.push_back(chunk);
+}
+
+void RamHistoryRing::evictOldest()
+{
+  if (m_count == 0)
+    return;
+
+  u32* oldest = row(m_first);
+  for (size_t c = 0; c < m_chunksPerSample; ++c)
+  {
+    releaseChunk(oldest[c]);
+    oldest[c] = NO_CHUNK;
+  }
+  m_first = (m_first + 1) % m_maxSamples;
+  m_count--;
+  m_evictedSamples++;
+}
+
+bool RamHistoryRing::commitSample(u64 timestamp, const u8* image, const std::vector<u64>& hashes)
+{
+  if (hashes.size() != m_pageCount)
+    return false;
+  if (m_count > 0 && timestamp < sampleTimestamp(m_count - 1))
+    return false;
+
+  const bool fullImage = m_count == 0 || m_lastHashes.size() != m_pageCount;
+  std::vector<u8> changedChunks(m_chunksPerSample, 0);
+  size_t changedPages = 0;
+  size_t newChunks = 0;
+  for (size_t page = 0; page < m_pageCount; ++page)
+  {
+    if (fullImage || hashes[page] != m_lastHashes[page])
+    {
+      changedPages++;
+      u8& chunkFlag = changedChunks[page / CHUNK_PAGES];
+      newChunks += chunkFlag == 0;
+      chunkFlag = 1;
+    }
+  }
+
+  if (m_count == m_maxSamples)
+    evictOldest();
+  while ((m_arena.freePages() < changedPages || m_chunks.free.size() < newChunks) && m_count > 1)
+    evictOldest();
+  if (m_arena.freePages() < changedPages || m_chunks.free.size() < newChunks)
+  {
+    m_droppedSamples++;
+    return false;
+  }
+
+  const size_t pageSize = m_arena.pageSize();
+  const u32* previous = m_count > 0 ? row(slotFor(m_count - 1)) : nullptr;
+  const size_t slot = slotFor(m_count);
+  u32* current = row(slot);
+
+  for (size_t c = 0; c < m_chunksPerSample; ++c)
+  {
+    if (!changedChunks[c])
+    {
+      current[c] = previous[c];
+      m_chunks.refCounts[previous[c]]++;
+      continue;
+    }
+
+    u32 chunk = allocateChunk();
+    u32* pages = m_chunks.pages.data() + static_cast<size_t>(chunk) * CHUNK_PAGES;
+    const u32* previousPages =
+        previous ? m_chunks.pages.data() + static_cast<size_t>(previous[c]) * CHUNK_PAGES : nullptr;
+
+    size_t firstPage = c * CHUNK_PAGES;
+    size_t lastPage = std::min(m_pageCount, firstPage + CHUNK_PAGES);
+    for (size_t page = firstPage; page < lastPage; ++page)
+    {
+      size_t slotInChunk = page - firstPage;
+      if (fullImage || hashes[page] != m_lastHashes[page])
+      {
+        u32 stored = m_arena.allocate();
+        size_t offset = page * pageSize;
+        size_t length = std::min(pageSize, m_imageSize - offset);
+        std::memcpy(m_arena.page(stored), image + offset, length);
+        if (length < pageSize)
+          std::memset(m_arena.page(stored) + length, 0, pageSize - length);
+        pages[slotInChunk] = stored;
+      }
+      else
+      {
+        pages[slotInChunk] = previousPages[slotInChunk];
+        m_arena.retain(pages[slotInChunk]);
+      }
+    }
+    current[c] = chunk;
+  }
+
+  m_timestamps[slot] = timestamp;
+  m_count++;
+  m_lastHashes = hashes;
+  m_lastChangedPages = changedPages;
+  return true;
+}
+
+u64 RamHistoryRing::sampleTimestamp(size_t index) const
+{
+  return m_timestamps[slotFor(index)];
+}
+
+long RamHistoryRing::findSample(u64 timestamp) const
+{
+  size_t low = 0;
+  size_t high = m_count;
+  while (low < high)
+  {
+    size_t mid = (low + high) / 2;
+    if (sampleTimestamp(mid) <= timestamp)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return static_cast<long>(low) - 1;
+}
+
+bool RamHistoryRing::read(size_t sampleIndex, u32 cacheIndex, u8* out, size_t size) const
+{
+  if (sampleIndex >= m_count || cacheIndex > m_imageSize || size > m_imageSize - cacheIndex)
+    return false;
+
+  const size_t pageSize = m_arena.pageSize();
+  const u32* sampleRow = row(slotFor(sampleIndex));
+  size_t position = cacheIndex;
+  size_t remaining = size;
+  while (remaining > 0)
+  {
+    size_t page = position / pageSize;
+    size_t inPage = position % pageSize;
+    size_t length = std::min(remaining, pageSize - inPage);
+    u32 chunk = sampleRow[page / CHUNK_PAGES];
+    u32 stored = m_chunks.pages[static_cast<size_t>(chunk) * CHUNK_PAGES + page % CHUNK_PAGES];
+    std::memcpy(out, m_arena.page(stored) + inPage, length);
+    out += length;
+    position += length;
+    remaining -= length;
+  }
+  return true;
+}
+
+RamHistoryRing::Stats RamHistoryRing::stats() const
+{
+  Stats result;
+  result.samples = m_count;
+  result.maxSamples = m_maxSamples;
+  result.pagesTotal = m_arena.capacity();
+  result.pagesUsed = m_arena.capacity() - m_arena.freePages();
+  result.oldestTimestamp = m_count ? sampleTimestamp(0) : 0;
+  result.newestTimestamp = m_count ? sampleTimestamp(m_count - 1) : 0;
+  result.droppedSamples = m_droppedSamples;
+  result.evictedSamples = m_evictedSamples;
+  result.lastChangedPages = m_lastChangedPages;
+  return result;
+}
+}  // namespace DolphinComm
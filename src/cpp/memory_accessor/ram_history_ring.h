@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "common_types.h"
+
+namespace DolphinComm
+{
+// Fixed pool of equally sized pages with reference counts. Everything is allocated up front so the
+// history never grows past its budget.
+class PageArena
+{
+public:
+  static constexpr u32 NO_PAGE = 0xFFFFFFFF;
+
+  bool init(size_t pageSize, size_t pageCount);
+  u32 allocate();
+  void retain(u32 page) { m_refCounts[page]++; }
+  void release(u32 page);
+
+  u8* page(u32 page) { return m_storage.get() + static_cast<size_t>(page) * m_pageSize; }
+  const u8* page(u32 page) const { return m_storage.get() + static_cast<size_t>(page) * m_pageSize; }
+  size_t pageSize() const { return m_pageSize; }
+  size_t capacity() const { return m_refCounts.size(); }
+  size_t freePages() const { return m_free.size(); }
+
+private:
+  std::unique_ptr<u8[]> m_storage;
+  std::vector<u32> m_refCounts;
+  std::vector<u32> m_free;
+  size_t m_pageSize = 0;
+};
+
+// Ring of RAM samples. Each sample is a two-level table: a row of chunk references, each chunk
+// holding CHUNK_PAGES page references. A new sample only allocates pages (and chunks) whose hash
+// changed; everything else is shared with the previous sample by reference count. When the arena
+// runs low the oldest samples are evicted first.
+//
+// Offsets here are cache indices (Common::offsetToCacheIndex without ARAM), i.e. MEM1 followed
+// directly by MEM2.
+class RamHistoryRing
+{
+public:
+  static constexpr u32 CHUNK_PAGES = 64;
+
+  struct Stats
+  {
+    size_t samples;
+    size_t maxSamples;
+    size_t pagesUsed;
+    size_t pagesTotal;
+    u64 oldestTimestamp;
+    u64 newestTimestamp;
+    u64 droppedSamples;
+    u64 evictedSamples;
+    u64 lastChangedPages;
+  };
+
+  // imageSize bytes are covered by each sample; budgetBytes bounds the page arena
+  bool init(size_t imageSize, size_t pageSize, size_t budgetBytes, size_t maxSamples);
+
+  size_t imageSize() const { return m_imageSize; }
+  size_t pageSize() const { return m_arena.pageSize(); }
+  size_t pageCount() const { return m_pageCount; }
+
+  // Fills `hashes` (one per page) for a full image; done outside any lock by the caller
+  void hashImage(const u8* image, std::vector<u64>& hashes) const;
+  // Rehashes the pages overlapping [cacheIndices[i], cacheIndices[i] + rangeSize) only; the rest of
+  // `hashes` must already match the image
+  void hashRanges(const u8* image, const u32* cacheIndices, size_t count, u32 rangeSize,
+                  std::vector<u64>& hashes) const;
+  // Stores a sample. `image` must hold imageSize bytes and `hashes` must come from hashImage.
+  bool commitSample(u64 timestamp, const u8* image, const std::vector<u64>& hashes);
+
+  size_t sampleCount() const { return m_count; }
+  u64 sampleTimestamp(size_t index) const;
+  // Newest sample taken at or before `timestamp`, or -1 if the history does not reach that far
+  long findSample(u64 timestamp) const;
+  bool read(size_t sampleIndex, u32 cacheIndex, u8* out, size_t size) const;
+  Stats stats() const;
+
+private:
+  struct ChunkPool
+  {
+    std::vector<u32> pages;
+    std::vector<u32> refCounts;
+    std::vector<u32> free;
+  };
+
+  size_t slotFor(size_t index) const { return (m_first + index) % m_maxSamples; }
+  u32* row(size_t slot) { return m_rows.data() + slot * m_chunksPerSample; }
+  const u32* row(size_t slot) const { return m_rows.data() + slot * m_chunksPerSample; }
+  u32 allocateChunk();
+  void releaseChunk(u32 chunk);
+  void evictOldest();
+
+  PageArena m_arena;
+  ChunkPool m_chunks;
+  size_t m_imageSize = 0;
+  size_t m_pageCount = 0;
+  size_t m_chunksPerSample = 0;
+  size_t m_maxSamples = 0;
+
+  std::vector<u32> m_rows;
+  std::vector<u64> m_timestamps;
+  size_t m_first = 0;
+  size_t m_count = 0;
+
+  std::vector<u64> m_lastHashes;
+  u64 m_droppedSamples = 0;
+  u64 m_evictedSamples = 0;
+  u64 m_lastChangedPages = 0;
+};
+}  // namespace DolphinComm
@@ -0,0 +1,217 @@
+#include "region_classifier.h"
+
+#include <cstring>
+
+#include "common_utils.h"
+#include "memory_common.h"
+
+namespace DolphinComm
+{
+namespace
+{
+enum OpcodeFlags : u8
+{
+  VALID_OPCODE = 1,
+  COMMON_OPCODE = 2
+};
+
+// Flags by the first byte of a word (the primary opcode is its top six bits). A lookup keeps the
+// word loop cheap without AVX2, which a 64-bit opcode bitmask would need to vectorize.
+struct OpcodeTable
+{
+  u8 flags[256];
+
+  constexpr OpcodeTable() : flags()
+  {
+    for (u32 b0 = 0; b0 < 256; ++b0)
+    {
+      const u32 op = b0 >> 2;
+      // Gekko decodes all but 0-2, 5, 6, 9, 22, 30, 58 and 62 (unused or 64-bit only)
+      const bool valid = !(op <= 2 || op == 5 || op == 6 || op == 9 || op == 22 || op == 30 ||
+                           op == 58 || op == 62);
+      // What most compiled code is made of: cmpli/cmpi, addi(s), bc, b, the bclr group, rlwinm,
+      // ori, X-form (31), integer and float loads/stores. Random data hits these about a quarter
+      // of the time.
+      const bool common = op == 10 || op == 11 || (op >= 14 && op <= 16) || op == 18 || op == 19 ||
+                          op == 21 || op == 24 || (op >= 31 && op <= 34) || (op >= 36 && op <= 38) ||
+                          op == 40 || op == 44 || op == 48 || op == 52 || op == 63;
+      flags[b0] = (valid ? VALID_OPCODE : 0) | (common ? COMMON_OPCODE : 0);
+    }
+  }
+};
+constexpr OpcodeTable OPCODE_TABLE;
+
+// A block of real code uses many primary opcodes; float arrays decode to only a handful
+constexpr int MIN_CODE_OPCODES = 7;
+
+// Biased float exponents for magnitudes of roughly 1e-7 to 1e8
+constexpr u32 MIN_FLOAT_EXPONENT = 0x66;
+constexpr u32 MAX_FLOAT_EXPONENT = 0x98;
+
+struct WordCounts
+{
+  u32 zero;
+  u32 pointer;
+  u32 floating;
+  u32 smallInt;
+  u32 validOpcode;
+  u32 commonOpcode;
+  // blr, mflr r0, mtlr r0, stwu r1: function prologues and epilogues
+  u32 codeMarker;
+};
+
+struct ByteCounts
+{
+  u32 nul;
+  u32 printable;
+  u32 sjisPairs;
+};
+
+// One pass over the words, branch-free: every predicate is 32-bit arithmetic on the word except
+// the opcode flags, which come from an OPCODE_TABLE lookup by the word's first byte
+WordCounts countWords(const u8* data, size_t words, const RegionClassifierBounds& bounds)
+{
+  const u32 mem1Size = bounds.mem1Size, mem2Size = bounds.mem2Size;
+  // Plain locals rather than WordCounts members so they stay in registers
+  u32 zero = 0, pointer = 0, floating = 0, smallInt = 0, validOpcode = 0, commonOpcode = 0, codeMarker = 0;
+  for (size_t i = 0; i < words; ++i)
+  {
+    u32 word;
+    std::memcpy(&word, data + i * 4, 4);
+    word = Common::bSwap32(word);
+    const u32 exponent = (word >> 23) & 0xFF;
+    const u32 nonZero = word != 0;
+    const u32 opcodeFlags = OPCODE_TABLE.flags[word >> 24];
+
+    zero += !nonZero;
+    pointer += ((word - Common::MEM1_START) < mem1Size) | ((word - Common::MEM2_START) < mem2Size);
+    floating += nonZero & (exponent >= MIN_FLOAT_EXPONENT) & (exponent <= MAX_FLOAT_EXPONENT);
+    // -32768 to 65535
+    smallInt += nonZero & ((word + 0x8000u) < 0x18000u);
+    validOpcode += nonZero & opcodeFlags;
+    commonOpcode += nonZero & (opcodeFlags >> 1);
+    // blr, mflr r0, mtlr r0, stwu r1
+    codeMarker += (word == 0x4E800020) | (word == 0x7C0802A6) | (word == 0x7C0803A6) | ((word >> 16) == 0x9421);
+  }
+  return {zero, pointer, floating, smallInt, validOpcode, commonOpcode, codeMarker};
+}
+
+// Zero fill is most of a typical RAM image, so it is ruled out first with a cheap OR
+bool isAllZero(const u8* data, size_t size)
+{
+  u8 any = 0;
+  for (size_t i = 0; i < size; ++i)
+    any |= data[i];
+  return any == 0;
+}
+
+// Only asked of blocks that already look like code, so it needn't vectorize
+int countDistinctOpcodes(const u8* data, size_t words)
+{
+  u64 opcodes = 0;
+  for (size_t i = 0; i < words; ++i)
+    opcodes |= u64(1) << (data[i * 4] >> 2);
+  return __builtin_popcountll(opcodes);
+}
+
+ByteCounts countBytes(const u8* data, size_t size)
+{
+  u32 nul = 0, printable = 0, sjisPairs = 0;
+  for (size_t i = 0; i < size; ++i)
+  {
+    const u8 byte = data[i];
+    nul += byte == 0;
+    printable += ((byte >= 0x20) & (byte < 0x7F)) | (byte == '\n') | (byte == '\t');
+  }
+  // Shift-JIS double-byte characters: a lead byte in 81-9F or E0-EF and a trail byte in 40-FC
+  for (size_t i = 0; i + 1 < size; ++i)
+  {
+    const u8 lead = data[i];
+    const u8 trail = data[i + 1];
+    sjisPairs += (((lead >= 0x81) & (lead <= 0x9F)) | ((lead >= 0xE0) & (lead <= 0xEF))) &
+                 (trail >= 0x40) & (trail <= 0xFC) & (trail != 0x7F);
+  }
+  return {nul, printable, sjisPairs};
+}
+}  // namespace
+
+const char* regionKindName(RegionKind kind)
+{
+  switch (kind)
+  {
+  case RegionKind::zero:
+    return "zero";
+  case RegionKind::pointers:
+    return "pointers";
+  case RegionKind::floats:
+    return "floats";
+  case RegionKind::integers:
+    return "integers";
+  case RegionKind::text:
+    return "text";
+  case RegionKind::code:
+    return "code";
+  default:
+    return "data";
+  }
+}
+
+RegionKind classifyBlock(const u8* data, size_t size, const RegionClassifierBounds& bounds)
+{
+  if (isAllZero(data, size))
+    return RegionKind::zero;
+  const u32 words = static_cast<u32>(size / 4);
+  const WordCounts wordCounts = countWords(data, words, bounds);
+  const u32 nonZero = words - wordCounts.zero;
+
+  // Text: mostly printable or Shift-JIS once the NUL padding is set aside
+  const ByteCounts byteCounts = countBytes(data, size);
+  const u32 textBytes = byteCounts.printable + 2 * byteCounts.sjisPairs;
+  const u32 contentBytes = static_cast<u32>(size) - byteCounts.nul;
+  if (contentBytes >= size / 4 && textBytes * 5 >= contentBytes * 4)
+    return RegionKind::text;
+
+  if (wordCounts.validOpcode * 10 >= words * 9 && wordCounts.commonOpcode * 5 >= words * 3 &&
+      (wordCounts.codeMarker > 0 || countDistinctOpcodes(data, words) >= MIN_CODE_OPCODES))
+    return RegionKind::code;
+
+  if (nonZero * 4 >= words)
+  {
+    if (wordCounts.pointer * 2 >= nonZero)
+      return RegionKind::pointers;
+    if (wordCounts.floating * 5 >= nonZero * 3)
+      return RegionKind::floats;
+  }
+  if ((wordCounts.smallInt + wordCounts.zero) * 4 >= words * 3)
+    return RegionKind::integers;
+  return RegionKind::data;
+}
+
+void classifyBlocks(const u8* data, size_t size, u32 blockSize, const RegionClassifierBounds& bounds,
+                    std::vector<RegionKind>& kinds)
+{
+  for (size_t offset = 0; offset < size; offset += blockSize)
+  {
+    const size_t length = (size - offset < blockSize ? size - offset : blockSize) & ~size_t(3);
+    kinds.push_back(length == 0 ? RegionKind::data : classifyBlock(data + offset, length, bounds));
+  }
+}
+
+void mergeRegions(const RegionKind* kinds, size_t count, u32 baseAddress, u32 blockSize,
+                  std::vector<ClassifiedRegion>& regions)
+{
+  const size_t firstRegion = regions.size();
+  for (size_t i = 0; i < count; ++i)
+  {
+    const u32 address = baseAddress + static_cast<u32>(i) * blockSize;
+    RegionKind kind = kinds[i];
+    if (i > 0 && i + 1 < count && kinds[i - 1] == kinds[i + 1] && kinds[i] != kinds[i - 1])
+      kind = kinds[i - 1];
+
+    if (regions.size() > firstRegion && regions.back().kind == kind)
+      regions.back().size += blockSize;
+    else
+      regions.push_back({address, blockSize, kind});
+  }
+}
+}  // namespace DolphinComm
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common_types.h"
+
+// Guesses what guest RAM holds, block by block. Each block's words are run through cheap
+// predicates (zero, guest pointer, plausible float, small integer, valid Gekko opcode, printable
+// ASCII / Shift-JIS bytes) in branch-free loops the compiler vectorizes, and the counts decide the
+// block's kind. Runs of blocks of the same kind are merged into regions.
+namespace DolphinComm
+{
+enum class RegionKind : u8
+{
+  data = 0,  // Nothing dominates: structs, compressed data, ...
+  zero,
+  pointers,
+  floats,
+  integers,
+  text,
+  code,
+  count
+};
+
+const char* regionKindName(RegionKind kind);
+
+struct ClassifiedRegion
+{
+  u32 address;
+  u32 size;
+  RegionKind kind;
+};
+
+struct RegionClassifierBounds
+{
+  // Guest pointers must land in [MEM1_START, MEM1_START + mem1Size) or the MEM2 equivalent
+  u32 mem1Size;
+  u32 mem2Size;
+};
+
+// Classifies one block; size must be a multiple of 4 and data is guest (big endian) memory
+RegionKind classifyBlock(const u8* data, size_t size, const RegionClassifierBounds& bounds);
+
+// Classifies [data, data + size) in blocks of blockSize bytes, appending one kind per block
+void classifyBlocks(const u8* data, size_t size, u32 blockSize, const RegionClassifierBounds& bounds,
+                    std::vector<RegionKind>& kinds);
+
+// Merges per-block kinds starting at baseAddress into regions. A lone block between two runs of
+// the same kind is folded into them, which keeps the map short without hiding anything large.
+void mergeRegions(const RegionKind* kinds, size_t count, u32 baseAddress, u32 blockSize,
+                  std::vector<ClassifiedRegion>& regions);
+}  // namespace DolphinComm
@@ -0,0 +1,286 @@
+#include "region_renderer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "hex_encode.h"
+#include "memory_common.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr size_t ADDRESS_PREFIX_LENGTH = 10;  // "80001000: "
+// Longer symbol names are cut short
+constexpr size_t MAX_SYMBOL_NAME = 48;
+constexpr size_t MAX_SYMBOL_LABEL = MAX_SYMBOL_NAME + 11;  // name+0xFFFFFFFF
+constexpr size_t MAX_LABEL_LINE = 2 + MAX_SYMBOL_LABEL + 1;
+// ", +0x3C -> 80002000 <label>"; the first one of a line starts with "  ; " instead of ", "
+constexpr size_t MAX_POINTER_NOTE = 2 + 5 + 4 + 8 + 2 + MAX_SYMBOL_LABEL + 1;
+
+u32 columnWidth(WalkFieldType type)
+{
+  switch (type)
+  {
+  case WalkFieldType::uint8:
+    return 2;
+  case WalkFieldType::uint16:
+    return 4;
+  case WalkFieldType::uint32:
+    return 8;
+  case WalkFieldType::int8:
+    return 4;
+  case WalkFieldType::int16:
+    return 6;
+  case WalkFieldType::int32:
+    return 11;
+  case WalkFieldType::float32:
+    return 15;  // -1.17549435e-38
+  default:
+    return 24;  // -2.2250738585072014e-308
+  }
+}
+
+bool showsPointers(const RenderOptions& options)
+{
+  return options.pointers && (options.view == RenderView::hex ||
+                              (options.view == RenderView::columns && options.columnType == WalkFieldType::uint32));
+}
+
+u32 readBigEndian32(const u8* data)
+{
+  return (static_cast<u32>(data[0]) << 24) | (static_cast<u32>(data[1]) << 16) | (static_cast<u32>(data[2]) << 8) |
+         data[3];
+}
+
+u64 readBigEndian64(const u8* data)
+{
+  return (static_cast<u64>(readBigEndian32(data)) << 32) | readBigEndian32(data + 4);
+}
+
+// "name" or "name+0x1c" for the symbol containing address; 0 chars if there is none
+size_t writeSymbolLabel(const SymbolIndex& symbols, u32 address, char* out)
+{
+  const u32 index = symbols.lookup(address);
+  if (index == NO_SYMBOL)
+    return 0;
+  const SymbolInfo symbol = symbols.symbol(index);
+  const size_t nameLength = std::min(symbol.name.size(), MAX_SYMBOL_NAME);
+  std::memcpy(out, symbol.name.data(), nameLength);
+  if (address == symbol.address)
+    return nameLength;
+  return nameLength + std::snprintf(out + nameLength, 12, "+0x%x", address - symbol.address);
+}
+
+size_t writeAddress(u32 address, char* out)
+{
+  const u8 bytes[4] = {static_cast<u8>(address >> 24), static_cast<u8>(address >> 16),
+                       static_cast<u8>(address >> 8), static_cast<u8>(address)};
+  Common::hexEncode(bytes, 4, out);
+  return 8;
+}
+
+size_t writeColumns(const u8* data, u32 count, const RenderOptions& options, char* out)
+{
+  const WalkFieldType type = options.columnType;
+  const u32 size = walkFieldSize(type);
+  const int width = static_cast<int>(columnWidth(type));
+  char* position = out;
+  for (u32 i = 0; i < count; i += size)
+  {
+    if (i != 0)
+      *position++ = ' ';
+    const u8* value = data + i;
+    switch (type)
+    {
+    case WalkFieldType::uint8:
+    case WalkFieldType::uint16:
+    case WalkFieldType::uint32:
+      // Guest memory is big endian, so the bytes in order are the value's digits
+      Common::hexEncode(value, size, position);
+      position += size * 2;
+      break;
+    case WalkFieldType::int8:
+      position += std::snprintf(position, width + 1, "%*d", width, static_cast<s8>(value[0]));
+      break;
+    case WalkFieldType::int16:
+      position += std::snprintf(position, width + 1, "%*d", width,
+                                static_cast<s16>((static_cast<u16>(value[0]) << 8) | value[1]));
+      break;
+    case WalkFieldType::int32:
+      position += std::snprintf(position, width + 1, "%*d", width, static_cast<s32>(readBigEndian32(value)));
+      break;
+    case WalkFieldType::float32:
+    {
+      const u32 bits = readBigEndian32(value);
+      float number;
+      std::memcpy(&number, &bits, sizeof(number));
+      // With 9 digits a float converts back to the same bits
+      position += std::snprintf(position, width + 1, "%*.9g", width, number);
+      break;
+    }
+    default:
+    {
+      const u64 bits = readBigEndian64(value);
+      double number;
+      std::memcpy(&number, &bits, sizeof(number));
+      position += std::snprintf(position, width + 1, "%*.17g", width, number);
+      break;
+    }
+    }
+  }
+  return position - out;
+}
+
+// The pointer notes of one line
+size_t writePointers(const u8* data, u32 address, u32 count, const RenderOptions& options, char* out)
+{
+  const u32 mem1End = Common::MEM1_START + options.bounds.mem1Size;
+  const u32 mem2End = Common::MEM2_START + options.bounds.mem2Size;
+  char* position = out;
+  for (u32 i = (4 - (address & 3)) & 3; i + 4 <= count; i += 4)
+  {
+    const u32 target = readBigEndian32(data + i);
+    if (!((target >= Common::MEM1_START && target < mem1End) || (target >= Common::MEM2_START && target < mem2End)))
+      continue;
+    if (position == out)
+    {
+      std::memcpy(position, "  ; ", 4);
+      position += 4;
+    }
+    else
+    {
+      std::memcpy(position, ", ", 2);
+      position += 2;
+    }
+    position += std::snprintf(position, 6, "+0x%X", i);
+    std::memcpy(position, " -> ", 4);
+    position += 4;
+    position += writeAddress(target, position);
+    if (options.symbols)
+    {
+      char label[MAX_SYMBOL_LABEL + 1];
+      const size_t labelLength = writeSymbolLabel(*options.symbols, target, label);
+      if (labelLength != 0)
+      {
+        *position++ = ' ';
+        *position++ = '<';
+        std::memcpy(position, label, labelLength);
+        position += labelLength;
+        *position++ = '>';
+      }
+    }
+  }
+  return position - out;
+}
+
+size_t lineLengthBound(const RenderOptions& options)
+{
+  const size_t count = options.bytesPerLine;
+  size_t length = ADDRESS_PREFIX_LENGTH + 1;
+  switch (options.view)
+  {
+  case RenderView::hex:
+    length += count * 3 - 1 + 2 + count;
+    break;
+  case RenderView::columns:
+    length += count / walkFieldSize(options.columnType) * (columnWidth(options.columnType) + 1);
+    break;
+  default:
+    length += count;
+    break;
+  }
+  if (showsPointers(options))
+    length += 2 + count / 4 * MAX_POINTER_NOTE;
+  if (options.symbols)
+    length += MAX_LABEL_LINE;
+  return length;
+}
+}  // namespace
+
+bool validRenderOptions(const RenderOptions& options)
+{
+  if (options.bytesPerLine == 0 || options.bytesPerLine > MAX_RENDER_LINE_BYTES)
+    return false;
+  return options.view != RenderView::columns || options.bytesPerLine % walkFieldSize(options.columnType) == 0;
+}
+
+RegionRenderer::RegionRenderer(const RenderOptions& options)
+    : m_options(options), m_maxLine(lineLengthBound(options)), m_pointers(showsPointers(options))
+{
+}
+
+RenderResult RegionRenderer::render(const u8* data, u32 address, u32 size, char* out, size_t capacity)
+{
+  const RenderOptions& options = m_options;
+  RenderResult result{0, 0, false};
+  for (u32 offset = 0; offset < size; offset += options.bytesPerLine)
+  {
+    const u32 lineAddress = address + offset;
+    const u32 count = std::min(options.bytesPerLine, size - offset);
+    const u8* line = data + offset;
+
+    char* target = out + result.length;
+    if (capacity - result.length < m_maxLine)
+    {
+      m_scratch.resize(m_maxLine);
+      target = m_scratch.data();
+    }
+    char* position = target;
+
+    if (options.symbols)
+    {
+      const u32 symbol = options.symbols->lookup(lineAddress);
+      if (symbol != m_previousSymbol && symbol != NO_SYMBOL)
+      {
+        *position++ = ';';
+        *position++ = ' ';
+        position += writeSymbolLabel(*options.symbols, lineAddress, position);
+        *position++ = '\n';
+      }
+      m_previousSymbol = symbol;
+    }
+
+    position += writeAddress(lineAddress, position);
+    *position++ = ':';
+    *position++ = ' ';
+    switch (options.view)
+    {
+    case RenderView::hex:
+    {
+      Common::hexEncodeSeparated(line, count, ' ', position);
+      // Short last line: pad so the text column lines up
+      const size_t hexWidth = options.bytesPerLine * 3 - 1;
+      std::memset(position + count * 3 - 1, ' ', hexWidth - (count * 3 - 1) + 2);
+      position += hexWidth + 2;
+      for (u32 i = 0; i < count; ++i)
+        *position++ = line[i] >= 0x20 && line[i] < 0x7F ? static_cast<char>(line[i]) : '.';
+      break;
+    }
+    case RenderView::columns:
+      position += writeColumns(line, count, options, position);
+      break;
+    default:
+      for (u32 i = 0; i < count; ++i)
+        *position++ = line[i] >= 0x20 && line[i] < 0x7F ? static_cast<char>(line[i]) : '.';
+      break;
+    }
+    if (m_pointers)
+      position += writePointers(line, lineAddress, count, options, position);
+    *position++ = '\n';
+
+    const size_t lineLength = position - target;
+    if (lineLength > capacity - result.length)
+    {
+      result.truncated = true;
+      break;
+    }
+    if (target != out + result.length)
+      std::memcpy(out + result.length, target, lineLength);
+    result.length += lineLength;
+    result.renderedBytes = offset + count;
+  }
+  return result;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common_types.h"
+#include "region_classifier.h"
+#include "structure_walker.h"
+#include "symbol_index.h"
+
+// Renders a region of guest memory as text for people and language models, one line per
+// bytesPerLine bytes:
+//
+//   hex      80001000: 00 11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF  ..."3DUfw........
+//   columns  80001000: 80002000 00000005 3F800000 00000000
+//   ascii    80001000: ...Mario....Luigi......
+//
+// Unsigned columns are hex, signed ones decimal and floats as many digits as round trip. Lines
+// whose first byte falls in a different symbol than the line before get a "; name+0x10" label
+// line, and in the hex and u32 column views every aligned word that points into MEM1 or MEM2 is
+// listed at the end of its line ("; +4 -> 80002000 <name+0x10>").
+//
+// Output goes straight into the caller's buffer a whole line at a time; rendering stops at the
+// first line that doesn't fit, which is how a token budget is enforced.
+namespace DolphinComm
+{
+enum class RenderView : u8
+{
+  hex,
+  columns,
+  ascii
+};
+
+struct RenderOptions
+{
+  RenderView view = RenderView::hex;
+  // Type of the columns view
+  WalkFieldType columnType = WalkFieldType::uint32;
+  u32 bytesPerLine = 16;
+  bool pointers = true;
+  // Targets must land in MEM1 or MEM2 to count as pointers
+  RegionClassifierBounds bounds{0, 0};
+  // Labels lines and pointer targets when set
+  const SymbolIndex* symbols = nullptr;
+};
+
+struct RenderResult
+{
+  size_t length;
+  // Region bytes covered by the lines written
+  u32 renderedBytes;
+  bool truncated;
+};
+
+constexpr u32 MAX_RENDER_LINE_BYTES = 64;
+
+// False if bytesPerLine is 0, above MAX_RENDER_LINE_BYTES or not a multiple of the column size
+bool validRenderOptions(const RenderOptions& options);
+
+class RegionRenderer
+{
+public:
+  // options must be valid
+  explicit RegionRenderer(const RenderOptions& options);
+
+  // The most chars one line of the region (label line included) can take
+  size_t maxLineLength() const { return m_maxLine; }
+
+  // Renders data, the size bytes at address, into out until capacity runs out. Calling again with
+  // the bytes after renderedBytes continues the same rendering.
+  RenderResult render(const u8* data, u32 address, u32 size, char* out, size_t capacity);
+
+private:
+  RenderOptions m_options;
+  size_t m_maxLine;
+  bool m_pointers;
+  // Lines go straight to out while a worst case line still fits, through here near the end
+  std::vector<char> m_scratch;
+  u32 m_previousSymbol = NO_SYMBOL;
+};
+}  // namespace DolphinComm
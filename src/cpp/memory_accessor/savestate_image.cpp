@@ -0,0 +1,330 @@
+#include "savestate_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include "executor.h"
+#include "lz_decompress.h"
+#include "mapped_file.h"
+#include "memory_common.h"
+
+namespace DolphinComm
+{
+namespace
+{
+// StateHeaderLegacy: char game_id[6], u32 lzo_size, double time, naturally aligned
+constexpr size_t LEGACY_HEADER_SIZE = 24;
+constexpr size_t LEGACY_LZO_SIZE_OFFSET = 8;
+constexpr u32 COOKIE_BASE = 0xBAADBABE;
+// StateExtendedBaseHeader: u16 header_version, u16 compression_type, u32 payload_offset,
+// u64 uncompressed_size
+constexpr size_t EXTENDED_HEADER_SIZE = 16;
+constexpr u64 LZO_CHUNK_SIZE = 128 * 1024;
+// LZ4_MAX_INPUT_SIZE; Dolphin compresses LZ4 states in chunks of this size
+constexpr u64 LZ4_CHUNK_SIZE = 0x7E000000;
+
+constexpr u32 L1_CACHE_SIZE = 0x40000;
+// PointerWrap::DoMarker's default value, written after every section
+constexpr u32 MARKER = 0x42;
+// Markers between the memory manager's state and ARAM: HW's "Memory", then the video, serial
+// and processor interface states
+constexpr int MARKERS_BEFORE_ARAM = 4;
+constexpr u64 ARAM_SEARCH_WINDOW = 64 * 1024;
+
+struct Chunk
+{
+  u64 source;
+  u32 compressedSize;
+  u64 destination;
+  u64 size;
+};
+
+u32 readU32(const u8* data)
+{
+  u32 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+u64 readU64(const u8* data)
+{
+  u64 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+}  // namespace
+
+void SavestateImage::close()
+{
+  if (m_mapping != nullptr)
+    munmap(m_mapping, m_mappingSize);
+  m_mapping = nullptr;
+  m_mappingSize = 0;
+  m_data = nullptr;
+  m_size = 0;
+  m_sections = Sections();
+  m_chunkCount = 0;
+  m_hasEXRAM = false;
+  m_gameId.clear();
+}
+
+bool SavestateImage::open(const std::string& path, const Sections& overrides, std::string& error)
+{
+  close();
+  Common::UpdateMemoryValues();
+
+  Common::MappedFile file;
+  if (!file.openReadOnly(path))
+  {
+    error = "Can't open " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  Payload payload;
+  if (!parseHeader(file.data(), file.size(), payload, error))
+    return false;
+  m_compression = payload.compression;
+  bool loaded = payload.compression == Compression::none ? mapUncompressed(path, payload, error) :
+                                                           decompress(file.data(), file.size(), payload, error);
+  if (!loaded)
+  {
+    close();
+    return false;
+  }
+
+  u64 memoryEnd = locateMemory();
+  // Wii states keep no ARAM array; the DSP uses EXRAM instead
+  if (memoryEnd != 0 && !m_hasEXRAM)
+    locateARAM(memoryEnd);
+
+  if (overrides.mem1 != NO_SECTION)
+    m_sections.mem1 = overrides.mem1;
+  if (overrides.mem2 != NO_SECTION)
+    m_sections.mem2 = overrides.mem2;
+  if (overrides.aram != NO_SECTION)
+    m_sections.aram = overrides.aram;
+
+  auto fits = [this](u64 offset, u64 size) { return offset == NO_SECTION || (offset <= m_size && size <= m_size - offset); };
+  if (m_sections.mem1 == NO_SECTION)
+    error = "Couldn't find MEM1 in the savestate; pass its offset explicitly";
+  else if (!fits(m_sections.mem1, Common::GetMEM1SizeReal()) || !fits(m_sections.mem2, Common::GetMEM2SizeReal()) ||
+           !fits(m_sections.aram, Common::ARAM_SIZE))
+    error = "Memory section offsets run past the end of the savestate";
+  if (!error.empty())
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool SavestateImage::parseHeader(const u8* file, size_t fileSize, Payload& payload, std::string& error)
+{
+  if (fileSize < LEGACY_HEADER_SIZE)
+  {
+    error = "Not a Dolphin savestate";
+    return false;
+  }
+  m_gameId.assign(reinterpret_cast<const char*>(file), strnlen(reinterpret_cast<const char*>(file), 6));
+
+  // Extended header: version cookie and string, then compression type and payload offset. Legacy
+  // uncompressed states also start their payload with the cookie, so the rest has to check out too.
+  if (fileSize >= LEGACY_HEADER_SIZE + 8 && readU32(file + LEGACY_HEADER_SIZE) - COOKIE_BASE < 0x10000)
+  {
+    const u64 versionLength = readU32(file + LEGACY_HEADER_SIZE + 4);
+    const u64 extended = LEGACY_HEADER_SIZE + 8 + versionLength;
+    if (extended + EXTENDED_HEADER_SIZE <= fileSize)
+    {
+      u16 compression;
+      std::memcpy(&compression, file + extended + 2, sizeof(compression));
+      const u64 offset = readU32(file + extended + 4);
+      const u64 size = readU64(file + extended + 8);
+      if (compression <= 2 && offset >= extended + EXTENDED_HEADER_SIZE && offset <= fileSize && size != 0)
+      {
+        payload = {offset, size, static_cast<Compression>(compression)};
+        if (payload.compression == Compression::none && size > fileSize - offset)
+        {
+          error = "Savestate is truncated";
+          return false;
+        }
+        return true;
+      }
+    }
+  }
+
+  const u64 lzoSize = readU32(file + LEGACY_LZO_SIZE_OFFSET);
+  payload = {LEGACY_HEADER_SIZE, lzoSize != 0 ? lzoSize : fileSize - LEGACY_HEADER_SIZE,
+             lzoSize != 0 ? Compression::lzo : Compression::none};
+  if (payload.uncompressedSize == 0)
+  {
+    error = "Savestate is empty";
+    return false;
+  }
+  return true;
+}
+
+bool SavestateImage::mapUncompressed(const std::string& path, const Payload& payload, std::string& error)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    error = "Can't open " + path + ": " + strerror(errno);
+    return false;
+  }
+  // Private mapping: writes through the accessor change the image, never the file
+  const u64 pageSize = static_cast<u64>(sysconf(_SC_PAGESIZE));
+  const u64 alignedOffset = payload.offset / pageSize * pageSize;
+  m_mappingSize = payload.offset - alignedOffset + payload.uncompressedSize;
+  void* mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(alignedOffset));
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    error = std::string("Can't map the savestate: ") + strerror(errno);
+    m_mappingSize = 0;
+    return false;
+  }
+  m_mapping = static_cast<u8*>(mapping);
+  m_data = m_mapping + (payload.offset - alignedOffset);
+  m_size = payload.uncompressedSize;
+  return true;
+}
+
+bool SavestateImage::decompress(const u8* file, size_t fileSize, const Payload& payload, std::string& error)
+{
+  // Chunk sizes are only in the stream, so find every chunk first, then decompress them all at once
+  const u64 chunkSize = payload.compression == Compression::lz4 ? LZ4_CHUNK_SIZE : LZO_CHUNK_SIZE;
+  std::vector<Chunk> chunks;
+  u64 position = payload.offset;
+  u64 destination = 0;
+  while (destination < payload.uncompressedSize)
+  {
+    if (fileSize - position < 4)
+    {
+      error = "Savestate is truncated";
+      return false;
+    }
+    const u32 compressedSize = readU32(file + position);
+    position += 4;
+    if (compressedSize == 0 || compressedSize > fileSize - position)
+    {
+      error = "Savestate is truncated or corrupt";
+      return false;
+    }
+    const u64 size = std::min(chunkSize, payload.uncompressedSize - destination);
+    chunks.push_back({position, compressedSize, destination, size});
+    position += compressedSize;
+    destination += size;
+  }
+
+  void* mapping = mmap(nullptr, payload.uncompressedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED)
+  {
+    error = std::string("Out of memory for the savestate: ") + strerror(errno);
+    return false;
+  }
+  m_mapping = static_cast<u8*>(mapping);
+  m_mappingSize = payload.uncompressedSize;
+  m_data = m_mapping;
+  m_size = payload.uncompressedSize;
+  m_chunkCount = chunks.size();
+
+  std::atomic<bool> failed{false};
+  const bool lz4 = payload.compression == Compression::lz4;
+  Common::Executor::shared().parallelFor(chunks.size(), [&](size_t i) {
+    const Chunk& chunk = chunks[i];
+    if (failed)
+      return;
+    size_t written = 0;
+    const u8* source = file + chunk.source;
+    u8* target = m_data + chunk.destination;
+    bool ok = lz4 ? Common::decompressLZ4Block(source, chunk.compressedSize, target, chunk.size, written) :
+                    Common::decompressLZO1X(source, chunk.compressedSize, target, chunk.size, written);
+    if (!ok || written != chunk.size)
+      failed = true;
+  });
+  if (failed)
+  {
+    error = "Savestate data is corrupt";
+    return false;
+  }
+  return true;
+}
+
+u64 SavestateImage::locateMemory()
+{
+  // MemoryManager::DoState: u32 RAM size, u32 L1 cache size, bool + u32 fake VMEM, bool + u32
+  // EXRAM, then the arrays with a marker after RAM + L1 cache, after fake VMEM and after EXRAM
+  const u32 ramSizes[] = {Common::GetMEM1SizeReal(), Common::GetMEM1Size()};
+  for (u32 ramSize : ramSizes)
+  {
+    u8 pattern[8];
+    std::memcpy(pattern, &ramSize, 4);
+    std::memcpy(pattern + 4, &L1_CACHE_SIZE, 4);
+
+    const u8* searchFrom = m_data;
+    const u8* end = m_data + m_size;
+    while (const void* hit = memmem(searchFrom, end - searchFrom, pattern, sizeof(pattern)))
+    {
+      const u8* header = static_cast<const u8*>(hit);
+      searchFrom = header + 1;
+      const u64 start = header - m_data;
+      if (m_size - start < 18)
+        break;
+
+      const u8 haveFakeVMEM = header[8];
+      const u8 haveEXRAM = header[13];
+      if (haveFakeVMEM > 1 || haveEXRAM > 1)
+        continue;
+      const u64 fakeVMEMSize = haveFakeVMEM ? readU32(header + 9) : 0;
+      const u64 EXRAMSize = haveEXRAM ? readU32(header + 14) : 0;
+
+      // Each array is followed by a marker: RAM + L1 cache, fake VMEM, EXRAM
+      const u64 mem1 = start + 18;
+      const u64 arrays[] = {u64(ramSize) + L1_CACHE_SIZE, fakeVMEMSize, EXRAMSize};
+      u64 position = mem1;
+      u64 EXRAMStart = 0;
+      bool valid = true;
+      for (size_t i = 0; i < 3 && valid; ++i)
+      {
+        if (i == 2)
+          EXRAMStart = position;
+        valid = arrays[i] <= m_size - position && m_size - position - arrays[i] >= 4 &&
+                readU32(m_data + position + arrays[i]) == MARKER;
+        position += valid ? arrays[i] + 4 : 0;
+      }
+      if (!valid)
+        continue;
+
+      m_sections.mem1 = mem1;
+      m_hasEXRAM = haveEXRAM;
+      if (haveEXRAM && EXRAMSize >= Common::GetMEM2SizeReal())
+        m_sections.mem2 = EXRAMStart;
+      return position;
+    }
+  }
+  return 0;
+}
+
+void SavestateImage::locateARAM(u64 searchStart)
+{
+  const u64 searchEnd = std::min<u64>(m_size < 4 ? 0 : m_size - 4, searchStart + ARAM_SEARCH_WINDOW);
+  int markers = 0;
+  for (u64 position = searchStart; position < searchEnd; ++position)
+  {
+    if (readU32(m_data + position) != MARKER)
+      continue;
+    if (++markers < MARKERS_BEFORE_ARAM)
+      continue;
+    const u64 aram = position + 4;
+    if (aram <= m_size && Common::ARAM_SIZE <= m_size - aram)
+      m_sections.aram = aram;
+    return;
+  }
+}
+}  // namespace DolphinComm
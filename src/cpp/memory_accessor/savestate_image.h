@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+
+#include "common_types.h"
+
+namespace DolphinComm
+{
+// A Dolphin savestate (.sav) decompressed into an anonymous mapping, with the emulated memory
+// located inside it.
+//
+// Both header layouts are understood: the legacy one (game id, LZO size, time) with LZO chunks of
+// 128 KB or no compression, and the extended one (version string, compression type, payload
+// offset) with LZ4 or LZO chunks. Chunks decompress in parallel; uncompressed states are mapped
+// straight from the file.
+//
+// MEM1 and MEM2 are found through the header Dolphin's memory manager writes before them (RAM, L1
+// cache, fake VMEM and EXRAM sizes), checked against the section markers that follow each array.
+// GameCube ARAM is stored a few small chunks later, after the processor interface state; its offset
+// is a best guess from those markers, so pass an explicit one where it matters.
+class SavestateImage
+{
+public:
+  static constexpr u64 NO_SECTION = ~0ull;
+
+  enum class Compression
+  {
+    none,
+    lzo,
+    lz4
+  };
+
+  // Offsets into the decompressed state
+  struct Sections
+  {
+    u64 mem1 = NO_SECTION;
+    u64 mem2 = NO_SECTION;
+    u64 aram = NO_SECTION;
+  };
+
+  SavestateImage() = default;
+  ~SavestateImage() { close(); }
+  SavestateImage(const SavestateImage&) = delete;
+  SavestateImage& operator=(const SavestateImage&) = delete;
+
+  // Sections set in `overrides` are used as given instead of being searched for
+  bool open(const std::string& path, const Sections& overrides, std::string& error);
+  void close();
+
+  u8* data() { return m_data; }
+  size_t size() const { return m_size; }
+  const Sections& sections() const { return m_sections; }
+  Compression compression() const { return m_compression; }
+  size_t chunkCount() const { return m_chunkCount; }
+  const std::string& gameId() const { return m_gameId; }
+
+private:
+  struct Payload
+  {
+    u64 offset;
+    u64 uncompressedSize;
+    Compression compression;
+  };
+
+  bool parseHeader(const u8* file, size_t fileSize, Payload& payload, std::string& error);
+  bool mapUncompressed(const std::string& path, const Payload& payload, std::string& error);
+  bool decompress(const u8* file, size_t fileSize, const Payload& payload, std::string& error);
+  // Returns the end of the memory manager's state, or 0 if it wasn't found
+  u64 locateMemory();
+  void locateARAM(u64 searchStart);
+
+  u8* m_mapping = nullptr;
+  size_t m_mappingSize = 0;
+  u8* m_data = nullptr;
+  size_t m_size = 0;
+  Sections m_sections;
+  Compression m_compression = Compression::none;
+  size_t m_chunkCount = 0;
+  bool m_hasEXRAM = false;
+  std::string m_gameId;
+};
+}  // namespace DolphinComm
@@ -0,0 +1,70 @@
+#include "savestate_process.h"
+
+#include <cstring>
+
+namespace DolphinComm {
+  bool SavestateProcess::open(const std::string& path, const SavestateImage::Sections& overrides, std::string& error) {
+    if (!m_image.open(path, overrides, error))
+      return false;
+    return hookPID(-1);
+  }
+
+  std::vector<int> SavestateProcess::findPIDs() {
+    return {};
+  }
+
+  bool SavestateProcess::obtainEmuRAMInformation() {
+    if (m_image.data() == nullptr)
+      return false;
+
+    const SavestateImage::Sections& sections = m_image.sections();
+    u64 base = reinterpret_cast<u64>(m_image.data());
+    m_emuRAMAddressStart = base + sections.mem1;
+    m_MEM2Present = sections.mem2 != SavestateImage::NO_SECTION;
+    m_MEM2AddressStart = m_MEM2Present ? base + sections.mem2 : 0;
+    m_ARAMAccessible = sections.aram != SavestateImage::NO_SECTION;
+    m_emuARAMAdressStart = m_ARAMAccessible ? base + sections.aram : 0;
+    return true;
+  }
+
+  u8* SavestateProcess::hostRange(u64 address, size_t size) {
+    u64 start = reinterpret_cast<u64>(m_image.data());
+    if (m_image.data() == nullptr || address < start || address - start > m_image.size() ||
+        size > m_image.size() - (address - start))
+      return nullptr;
+    return reinterpret_cast<u8*>(address);
+  }
+
+  bool SavestateProcess::readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) {
+    u8* source = hostRange(baseAddr + offset, size);
+    if (source == nullptr)
+      return false;
+    std::memcpy(buffer, source, size);
+    return true;
+  }
+
+  bool SavestateProcess::writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) {
+    u8* target = hostRange(baseAddr + offset, size);
+    if (target == nullptr)
+      return false;
+    std::memcpy(target, buffer, size);
+    return true;
+  }
+
+  size_t SavestateProcess::readHostBatch(HostRead* reads, size_t count) {
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; i++) {
+      u8* source = hostRange(reads[i].address, reads[i].size);
+      reads[i].ok = source != nullptr;
+      if (reads[i].ok) {
+        std::memcpy(reads[i].buffer, source, reads[i].size);
+        succeeded++;
+      }
+    }
+    return succeeded;
+  }
+
+  const u8* SavestateProcess::mappedHost(u64 hostAddress, size_t size) {
+    return hostRange(hostAddress, size);
+  }
+}  // namespace DolphinComm
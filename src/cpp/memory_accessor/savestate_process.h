@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+#include "savestate_image.h"
+
+namespace DolphinComm
+{
+// Serves a savestate file as if it were a running Dolphin: host addresses point into the
+// decompressed image, so every read is a memcpy and all the batch, guest-address and scanning code
+// works unchanged. Writes change the in-memory image only. There is no process, so there are no
+// PIDs and nothing to suspend.
+class SavestateProcess : public IDolphinProcess
+{
+public:
+  SavestateProcess() {}
+
+  bool open(const std::string& path, const SavestateImage::Sections& overrides, std::string& error);
+  const SavestateImage& image() const { return m_image; }
+
+  std::vector<int> findPIDs() override;
+  bool readAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) override;
+  bool writeAtOffset(u64 baseAddr, u32 offset, char* buffer, size_t size) override;
+  size_t readHostBatch(HostRead* reads, size_t count) override;
+  const u8* mappedHost(u64 hostAddress, size_t size) override;
+
+protected:
+  bool obtainEmuRAMInformation() override;
+
+private:
+  // Null if [address, address + size) isn't inside the image
+  u8* hostRange(u64 address, size_t size);
+
+  SavestateImage m_image;
+};
+}  // namespace DolphinComm
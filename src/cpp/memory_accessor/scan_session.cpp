@@ -0,0 +1,335 @@
+#include "scan_session.h"
+
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "executor_job.h"
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+constexpr u32 kDefaultCandidateLimit = 1000;
+constexpr u32 kMaxCandidateLimit = 1 << 20;
+
+const char* const kTypeNames[] = {"u8", "u16", "u32", "s8", "s16", "s32", "f32", "f64"};
+const char* const kCompareNames[] = {"changed",  "unchanged", "increased", "decreased", "increasedBy", "decreasedBy",
+                                     "equal",    "notEqual",  "greater",   "less",      "between"};
+
+// { compare, value?, upper? }; value is needed from increasedBy on, upper by between
+bool parseFilter(Napi::Env env, const Napi::Value& value, DolphinComm::ScanFilter& filter) {
+  if (!value.IsObject()) {
+    Napi::TypeError::New(env, "ScanSession: Options with compare expected").ThrowAsJavaScriptException();
+    return false;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  std::string compare = object.Get("compare").IsString() ? object.Get("compare").As<Napi::String>().Utf8Value() : "";
+  const char* const* name = std::find(std::begin(kCompareNames), std::end(kCompareNames), compare);
+  if (name == std::end(kCompareNames)) {
+    Napi::TypeError::New(env, "ScanSession: Unknown compare \"" + compare + "\"").ThrowAsJavaScriptException();
+    return false;
+  }
+  filter.compare = static_cast<DolphinComm::ScanCompare>(name - std::begin(kCompareNames));
+
+  if (filter.compare >= DolphinComm::ScanCompare::increasedBy) {
+    if (!object.Get("value").IsNumber()) {
+      Napi::TypeError::New(env, "ScanSession: " + compare + " needs a value").ThrowAsJavaScriptException();
+      return false;
+    }
+    filter.value = object.Get("value").As<Napi::Number>().DoubleValue();
+  }
+  if (filter.compare == DolphinComm::ScanCompare::between) {
+    if (!object.Get("upper").IsNumber()) {
+      Napi::TypeError::New(env, "ScanSession: between needs an upper bound").ThrowAsJavaScriptException();
+      return false;
+    }
+    filter.upper = object.Get("upper").As<Napi::Number>().DoubleValue();
+  }
+  return true;
+}
+
+Napi::Object statsToJS(Napi::Env env, const DolphinComm::ScanStepStats& stats) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("candidates", Napi::Number::New(env, static_cast<double>(stats.candidates)));
+  result.Set("previousCandidates", Napi::Number::New(env, static_cast<double>(stats.previousCandidates)));
+  result.Set("imagePages", Napi::Number::New(env, stats.imagePages));
+  result.Set("storePages", Napi::Number::New(env, static_cast<double>(stats.storePages)));
+  result.Set("unreadableContainers", Napi::Number::New(env, stats.unreadableContainers));
+  result.Set("compacted", Napi::Boolean::New(env, stats.compacted));
+  result.Set("millis", Napi::Number::New(env, stats.millis));
+  return result;
+}
+}  // namespace
+
+class ScanSession::NarrowJob : public ExecutorJob {
+public:
+  NarrowJob(const Napi::Object& session, ScanSession& owner, DolphinComm::ScanFilter filter)
+    : m_sessionRef(Napi::Persistent(session)), m_session(owner), m_filter(filter) {
+    m_session.m_busy = true;
+  }
+  // Runs on the JS thread once the promise settles, whether or not the job ran
+  ~NarrowJob() override { m_session.m_busy = false; }
+
+protected:
+  void execute() override {
+    std::string error;
+    if (!m_session.m_store.narrow(*m_session.m_process, m_filter, token(), m_stats, error))
+      setError(error == "cancelled" ? "Cancelled" : "ScanSession: " + error);
+  }
+
+  Napi::Value result(Napi::Env env) override { return statsToJS(env, m_stats); }
+
+private:
+  // Keeps the session and, through it, the accessor alive
+  Napi::ObjectReference m_sessionRef;
+  ScanSession& m_session;
+  DolphinComm::ScanFilter m_filter;
+  DolphinComm::ScanStepStats m_stats;
+};
+
+Napi::FunctionReference ScanSession::constructor;
+
+Napi::Object ScanSession::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "ScanSession", {
+    InstanceMethod("narrow", &ScanSession::Narrow),
+    InstanceMethod("narrowAsync", &ScanSession::NarrowAsync),
+    InstanceMethod("merge", &ScanSession::Merge),
+    InstanceMethod("getCandidates", &ScanSession::GetCandidates),
+    InstanceMethod("getInfo", &ScanSession::GetInfo),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("ScanSession", func);
+  return exports;
+}
+
+// new ScanSession(accessor, path, { type?: "u32", alignment?, regions?: ("mem1" | "mem2")[], reset? })
+// reopens the session saved at path, or starts one over every aligned value of the regions when
+// there is none or reset is set. A session that is there but can't be opened (a missing page
+// store, corruption, another version) is reported rather than replaced. alignment defaults to the
+// size of type; when reopening, type and alignment must match the session's if they are given.
+ScanSession::ScanSession(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<ScanSession>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsString()) {
+    Napi::TypeError::New(env, "MemoryAccessor and session path expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+  std::string path = info[1].As<Napi::String>().Utf8Value();
+
+  Napi::Object options = info.Length() >= 3 && info[2].IsObject() ? info[2].As<Napi::Object>()
+                                                                  : Napi::Object::New(env);
+  DolphinComm::WalkFieldType type = DolphinComm::WalkFieldType::uint32;
+  const bool typeGiven = !options.Get("type").IsUndefined();
+  if (typeGiven && !NapiUtils::parseWalkFieldType(options.Get("type"), type)) {
+    Napi::TypeError::New(env, "ScanSession: type must be \"u8\", \"u16\", \"u32\", \"s8\", \"s16\", \"s32\", "
+                              "\"f32\" or \"f64\"")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+  u32 alignment = 0;
+  const bool alignmentGiven = NapiUtils::getU32(options, "alignment", alignment);
+
+  std::string error;
+  struct stat existing;
+  if (!options.Get("reset").ToBoolean().Value() && stat(path.c_str(), &existing) == 0) {
+    if (!m_store.open(path, error)) {
+      Napi::Error::New(env, "ScanSession: " + error).ThrowAsJavaScriptException();
+      return;
+    }
+    const DolphinComm::ScanSessionHeader& header = m_store.header();
+    if ((typeGiven && m_store.type() != type) || (alignmentGiven && header.alignment != alignment)) {
+      Napi::Error::New(env, "ScanSession: " + path + " holds a " + kTypeNames[header.type] + " scan at alignment " +
+                                std::to_string(header.alignment))
+          .ThrowAsJavaScriptException();
+    }
+    return;
+  }
+
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "ScanSession: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return;
+  }
+  bool mem1 = true, mem2 = true;
+  if (options.Get("regions").IsArray()) {
+    Napi::Array regions = options.Get("regions").As<Napi::Array>();
+    mem1 = mem2 = false;
+    for (uint32_t i = 0; i < regions.Length(); i++) {
+      std::string region = regions.Get(i).ToString().Utf8Value();
+      mem1 |= region == "mem1";
+      mem2 |= region == "mem2";
+    }
+  }
+  DolphinComm::ScanStepStats stats;
+  error.clear();
+  if (!m_store.create(path, *m_process, type, alignmentGiven ? alignment : DolphinComm::walkFieldSize(type), mem1,
+                      mem2, stats, error)) {
+    Napi::Error::New(env, "ScanSession: " + error).ThrowAsJavaScriptException();
+  }
+}
+
+bool ScanSession::checkIdle(Napi::Env env) {
+  if (m_busy) {
+    Napi::Error::New(env, "ScanSession: A narrowAsync() is still running").ThrowAsJavaScriptException();
+    return false;
+  }
+  return true;
+}
+
+// narrow({ compare, value?, upper? })
+//   => { candidates, previousCandidates, imagePages, storePages, unreadableContainers, compacted, millis }
+// keeps the candidates whose current value passes compare, then makes the current values the
+// previous ones. compare is one of "changed", "unchanged", "increased", "decreased" (against the
+// previous value), "increasedBy", "decreasedBy" (by value), "equal", "notEqual", "greater", "less"
+// (against value) or "between" (value <= x <= upper).
+Napi::Value ScanSession::Narrow(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!checkIdle(env))
+    return env.Null();
+  DolphinComm::ScanFilter filter;
+  if (!parseFilter(env, info.Length() >= 1 ? info[0] : env.Undefined(), filter))
+    return env.Null();
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "ScanSession: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  DolphinComm::ScanStepStats stats;
+  std::string error;
+  if (!m_store.narrow(*m_process, filter, Common::CancellationToken(), stats, error)) {
+    Napi::Error::New(env, "ScanSession: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return statsToJS(env, stats);
+}
+
+// narrowAsync({ compare, value?, upper?, token? }) => Promise of what narrow() returns. Runs on the
+// shared executor at scan priority; cancelling the token stops it with the session unchanged.
+Napi::Value ScanSession::NarrowAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!checkIdle(env))
+    return env.Null();
+  DolphinComm::ScanFilter filter;
+  if (!parseFilter(env, info.Length() >= 1 ? info[0] : env.Undefined(), filter))
+    return env.Null();
+  if (!m_process->hasEmuRAMInformation()) {
+    Napi::Error::New(env, "ScanSession: Not hooked to Dolphin").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Common::CancellationToken token;
+  if (!CancellationToken::fromOptions(info[0], token)) {
+    Napi::TypeError::New(env, "token must be a CancellationToken").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto job = std::make_unique<NarrowJob>(info.This().As<Napi::Object>(), *this, filter);
+  return ExecutorJob::queue(env, std::move(job), Common::JobPriority::scan, token);
+}
+
+// merge(otherPath, { mode?: "intersect" | "union" }) => what narrow() returns
+// combines the candidates of another session of the same type and alignment with this one's.
+// Candidates only the other session has keep their previous values from it.
+Napi::Value ScanSession::Merge(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!checkIdle(env))
+    return env.Null();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "ScanSession: Session path expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  std::string mode = "intersect";
+  if (info.Length() >= 2 && info[1].IsObject() && info[1].As<Napi::Object>().Get("mode").IsString())
+    mode = info[1].As<Napi::Object>().Get("mode").As<Napi::String>().Utf8Value();
+  if (mode != "intersect" && mode != "union") {
+    Napi::TypeError::New(env, "ScanSession: mode must be \"intersect\" or \"union\"").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  DolphinComm::ScanStepStats stats;
+  std::string error;
+  if (!m_store.merge(info[0].As<Napi::String>().Utf8Value(), mode == "intersect", stats, error)) {
+    Napi::Error::New(env, "ScanSession: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return statsToJS(env, stats);
+}
+
+// getCandidates({ start?, limit? = 1000 }) => { addresses: Uint32Array, values: Float64Array }
+// candidates in address order from the start-th on, with their values as of the last step
+Napi::Value ScanSession::GetCandidates(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!checkIdle(env))
+    return env.Null();
+  double start = 0;
+  u32 limit = kDefaultCandidateLimit;
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (options.Get("start").IsNumber())
+      start = std::max(0.0, options.Get("start").As<Napi::Number>().DoubleValue());
+    limit = NapiUtils::getU32Or(options, "limit", limit);
+  }
+  if (limit > kMaxCandidateLimit) {
+    Napi::RangeError::New(env, "ScanSession: limit must be at most 1048576").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<u32> addresses;
+  std::vector<double> values;
+  m_store.candidates(static_cast<u64>(start), limit, addresses, values);
+  Napi::Uint32Array addressArray = Napi::Uint32Array::New(env, addresses.size());
+  Napi::Float64Array valueArray = Napi::Float64Array::New(env, values.size());
+  std::copy(addresses.begin(), addresses.end(), addressArray.Data());
+  std::copy(values.begin(), values.end(), valueArray.Data());
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", addressArray);
+  result.Set("values", valueArray);
+  return result;
+}
+
+// getInfo() => { path, type, alignment, scans, candidates, containers: { array, bitmap, full },
+//   imagePages, storePages, lastScanMillis }
+Napi::Value ScanSession::GetInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!checkIdle(env))
+    return env.Null();
+  u32 kinds[3] = {0, 0, 0};
+  for (const DolphinComm::BitmapContainer& container : m_store.containers())
+    kinds[static_cast<u32>(container.kind)]++;
+  Napi::Object containers = Napi::Object::New(env);
+  containers.Set("array", Napi::Number::New(env, kinds[0]));
+  containers.Set("bitmap", Napi::Number::New(env, kinds[1]));
+  containers.Set("full", Napi::Number::New(env, kinds[2]));
+
+  const DolphinComm::ScanSessionHeader& header = m_store.header();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("path", Napi::String::New(env, m_store.path()));
+  result.Set("type", Napi::String::New(env, kTypeNames[header.type]));
+  result.Set("alignment", Napi::Number::New(env, header.alignment));
+  result.Set("scans", Napi::Number::New(env, header.scanCount));
+  result.Set("candidates", Napi::Number::New(env, static_cast<double>(header.candidateCount)));
+  result.Set("containers", containers);
+  result.Set("imagePages", Napi::Number::New(env, m_store.imagePageCount()));
+  result.Set("storePages", Napi::Number::New(env, static_cast<double>(header.storePageCount)));
+  result.Set("lastScanMillis", Napi::Number::New(env, static_cast<double>(header.lastScanMillis)));
+  return result;
+}
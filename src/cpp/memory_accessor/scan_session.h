@@ -0,0 +1,34 @@
+#pragma once
+#include <napi.h>
+
+#include "dolphin_process.h"
+#include "scan_session_store.h"
+
+// Unknown-initial-value scans kept on disk by ScanSessionStore (see scan_session_store.h): the
+// candidate set and the previous values live in the session's files rather than on the JS heap,
+// so a scan of every word of MEM1 and MEM2 can be narrowed step by step, reopened after a restart
+// and merged with other sessions.
+class ScanSession : public Napi::ObjectWrap<ScanSession> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  ScanSession(const Napi::CallbackInfo& info);
+
+private:
+  static Napi::FunctionReference constructor;
+  class NarrowJob;
+
+  // Throws if a narrowAsync() is working on the session
+  bool checkIdle(Napi::Env env);
+
+  Napi::Value Narrow(const Napi::CallbackInfo& info);
+  Napi::Value NarrowAsync(const Napi::CallbackInfo& info);
+  Napi::Value Merge(const Napi::CallbackInfo& info);
+  Napi::Value GetCandidates(const Napi::CallbackInfo& info);
+  Napi::Value GetInfo(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  DolphinComm::ScanSessionStore m_store;
+  // Set on the JS thread while a narrowAsync() job owns m_store
+  bool m_busy = false;
+};
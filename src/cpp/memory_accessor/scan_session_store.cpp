@@ -0,0 +1,884 @@
+#include "scan_session_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "memory_common.h"
+#include "page_hash.h"
+
+namespace DolphinComm
+{
+namespace
+{
+// Pages of one container's span at the largest alignment
+constexpr u32 MAX_SPAN_PAGES = CONTAINER_KEYS * 8 / SCAN_PAGE_SIZE;
+// Garbage the store may hold on top of twice the pages in use before it is compacted
+constexpr u64 COMPACT_SLACK_PAGES = 1024;
+
+u64 nowMillis()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+double millisSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Guest memory is big endian
+template <typename T>
+T readValue(const u8* data)
+{
+  using Raw = std::conditional_t<sizeof(T) == 8, u64,
+                                 std::conditional_t<sizeof(T) == 4, u32, std::conditional_t<sizeof(T) == 2, u16, u8>>>;
+  Raw raw = 0;
+  for (size_t i = 0; i < sizeof(T); ++i)
+    raw = static_cast<Raw>((static_cast<u64>(raw) << 8) | data[i]);
+  T value;
+  std::memcpy(&value, &raw, sizeof(T));
+  return value;
+}
+
+double readAsDouble(WalkFieldType type, const u8* data)
+{
+  switch (type)
+  {
+  case WalkFieldType::uint8:
+    return readValue<u8>(data);
+  case WalkFieldType::uint16:
+    return readValue<u16>(data);
+  case WalkFieldType::uint32:
+    return readValue<u32>(data);
+  case WalkFieldType::int8:
+    return readValue<s8>(data);
+  case WalkFieldType::int16:
+    return readValue<s16>(data);
+  case WalkFieldType::int32:
+    return readValue<s32>(data);
+  case WalkFieldType::float32:
+    return readValue<float>(data);
+  default:
+    return readValue<double>(data);
+  }
+}
+
+// changed and unchanged compare the bytes; the rest compare values of type T, without overflow
+// for the integer types
+template <typename T>
+bool passes(const u8* current, const u8* previous, const ScanFilter& filter)
+{
+  switch (filter.compare)
+  {
+  case ScanCompare::changed:
+    return std::memcmp(current, previous, sizeof(T)) != 0;
+  case ScanCompare::unchanged:
+    return std::memcmp(current, previous, sizeof(T)) == 0;
+  default:
+    break;
+  }
+
+  const T now = readValue<T>(current);
+  switch (filter.compare)
+  {
+  case ScanCompare::increased:
+    return now > readValue<T>(previous);
+  case ScanCompare::decreased:
+    return now < readValue<T>(previous);
+  case ScanCompare::increasedBy:
+  case ScanCompare::decreasedBy:
+  {
+    const T before = readValue<T>(previous);
+    const double by = filter.compare == ScanCompare::increasedBy ? filter.value : -filter.value;
+    if constexpr (std::is_floating_point_v<T>)
+      return now == static_cast<T>(before + static_cast<T>(by));
+    else
+      return static_cast<double>(static_cast<s64>(now) - static_cast<s64>(before)) == by;
+  }
+  case ScanCompare::equal:
+    return static_cast<double>(now) == filter.value;
+  case ScanCompare::notEqual:
+    return static_cast<double>(now) != filter.value;
+  case ScanCompare::greater:
+    return static_cast<double>(now) > filter.value;
+  case ScanCompare::less:
+    return static_cast<double>(now) < filter.value;
+  default:
+    return static_cast<double>(now) >= filter.value && static_cast<double>(now) <= filter.upper;
+  }
+}
+
+// Appends the lower bits of the container's candidates that pass to lows, flagging the span
+// pages that hold them
+template <typename T>
+void filterContainer(const BitmapContainer& container, const u8* span, u32 spanOffset, u32 alignment,
+                     const std::vector<u32>& pageTable, const ScanPageStore& store, const ScanFilter& filter,
+                     std::vector<u16>& lows, bool* pages)
+{
+  container.forEach([&](u16 low) {
+    const u32 offset = low * alignment;
+    const u32 page = pageTable[(spanOffset + offset) / SCAN_PAGE_SIZE];
+    if (passes<T>(span + offset, store.page(page) + offset % SCAN_PAGE_SIZE, filter))
+    {
+      lows.push_back(low);
+      pages[offset / SCAN_PAGE_SIZE] = true;
+    }
+  });
+}
+
+void filterContainer(WalkFieldType type, const BitmapContainer& container, const u8* span, u32 spanOffset,
+                     u32 alignment, const std::vector<u32>& pageTable, const ScanPageStore& store,
+                     const ScanFilter& filter, std::vector<u16>& lows, bool* pages)
+{
+  switch (type)
+  {
+  case WalkFieldType::uint8:
+    return filterContainer<u8>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  case WalkFieldType::uint16:
+    return filterContainer<u16>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  case WalkFieldType::uint32:
+    return filterContainer<u32>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  case WalkFieldType::int8:
+    return filterContainer<s8>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  case WalkFieldType::int16:
+    return filterContainer<s16>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  case WalkFieldType::int32:
+    return filterContainer<s32>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  case WalkFieldType::float32:
+    return filterContainer<float>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  default:
+    return filterContainer<double>(container, span, spanOffset, alignment, pageTable, store, filter, lows, pages);
+  }
+}
+
+// Whether any bit of words [first, first + count) is set
+bool anyBits(const u64* words, u32 first, u32 count)
+{
+  for (u32 w = first; w < first + count; ++w)
+  {
+    if (words[w] != 0)
+      return true;
+  }
+  return false;
+}
+}  // namespace
+
+bool ScanPageStore::open(const std::string& path, u64 pageCount, bool create)
+{
+  close();
+  if (!create)
+  {
+    std::ifstream existing(path, std::ios::binary);
+    if (!existing)
+      return false;
+  }
+  if (!m_file.openReadWrite(path, (pageCount + 1) * SCAN_PAGE_SIZE, create))
+    return false;
+  if (create)
+  {
+    std::memcpy(m_file.data(), SCAN_PAGES_MAGIC, sizeof(SCAN_PAGES_MAGIC));
+  }
+  else if (std::memcmp(m_file.data(), SCAN_PAGES_MAGIC, sizeof(SCAN_PAGES_MAGIC)) != 0)
+  {
+    close();
+    return false;
+  }
+
+  m_pageCount = pageCount;
+  m_capacity = pageCount;
+  // Pages past pageCount are left over from a step that never got saved
+  if (!m_file.truncate((pageCount + 1) * SCAN_PAGE_SIZE))
+  {
+    close();
+    return false;
+  }
+  m_index.reserve(pageCount);
+  for (u64 i = 0; i < pageCount; ++i)
+    m_index.emplace(Common::hashPage(page(static_cast<u32>(i)), SCAN_PAGE_SIZE), static_cast<u32>(i));
+  return true;
+}
+
+bool ScanPageStore::openReadOnly(const std::string& path, u64 pageCount)
+{
+  close();
+  if (!m_file.openReadOnly(path) || m_file.size() < (pageCount + 1) * SCAN_PAGE_SIZE ||
+      std::memcmp(m_file.data(), SCAN_PAGES_MAGIC, sizeof(SCAN_PAGES_MAGIC)) != 0)
+  {
+    close();
+    return false;
+  }
+  m_pageCount = pageCount;
+  m_capacity = pageCount;
+  return true;
+}
+
+void ScanPageStore::close()
+{
+  m_file.close();
+  m_index.clear();
+  m_pageCount = 0;
+  m_capacity = 0;
+}
+
+bool ScanPageStore::reserve(u64 count)
+{
+  if (m_pageCount + count >= NO_SCAN_PAGE)
+    return false;
+  if (!m_file.grow((m_pageCount + count + 1) * SCAN_PAGE_SIZE))
+    return false;
+  m_capacity = m_pageCount + count;
+  return true;
+}
+
+u32 ScanPageStore::intern(const u8* data)
+{
+  const u64 hash = Common::hashPage(data, SCAN_PAGE_SIZE);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto range = m_index.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (std::memcmp(page(it->second), data, SCAN_PAGE_SIZE) == 0)
+      return it->second;
+  }
+  if (m_pageCount == m_capacity)
+    return NO_SCAN_PAGE;
+  const u32 index = static_cast<u32>(m_pageCount++);
+  std::memcpy(m_file.data() + (static_cast<u64>(index) + 1) * SCAN_PAGE_SIZE, data, SCAN_PAGE_SIZE);
+  m_index.emplace(hash, index);
+  return index;
+}
+
+bool ScanPageStore::finish()
+{
+  m_capacity = m_pageCount;
+  return m_file.truncate((m_pageCount + 1) * SCAN_PAGE_SIZE) && m_file.sync();
+}
+
+bool ScanSessionStore::create(const std::string& path, IDolphinProcess& process, WalkFieldType type,
+                              u32 alignment, bool mem1, bool mem2, ScanStepStats& stats, std::string& error)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const u32 size = walkFieldSize(type);
+  if (alignment == 0 || alignment > 8 || (alignment & (alignment - 1)) != 0 || alignment < size)
+  {
+    error = "alignment must be 1, 2, 4 or 8 and at least the size of the type";
+    return false;
+  }
+  const u32 mem1Size = mem1 ? Common::GetMEM1SizeReal() : 0;
+  const u32 mem2Size = mem2 && process.isMEM2Present() ? Common::GetMEM2SizeReal() : 0;
+  if (mem1Size == 0 && mem2Size == 0)
+  {
+    error = "no region to scan";
+    return false;
+  }
+
+  // Replacing a session: move past its store's generation so the old store can be deleted
+  m_path = path;
+  u32 generation = 0;
+  std::string oldStorePath;
+  {
+    std::ifstream existing(path, std::ios::binary);
+    ScanSessionHeader old{};
+    if (existing.read(reinterpret_cast<char*>(&old), sizeof(old)) &&
+        std::memcmp(old.magic, SCAN_SESSION_MAGIC, sizeof(SCAN_SESSION_MAGIC)) == 0)
+    {
+      generation = old.storeGeneration + 1;
+      oldStorePath = storePath(old.storeGeneration);
+    }
+  }
+
+  m_header = ScanSessionHeader{};
+  std::memcpy(m_header.magic, SCAN_SESSION_MAGIC, sizeof(SCAN_SESSION_MAGIC));
+  m_header.version = SCAN_SESSION_VERSION;
+  m_header.type = static_cast<u16>(type);
+  m_header.alignment = static_cast<u16>(alignment);
+  m_header.mem1Size = mem1Size;
+  m_header.mem2Size = mem2Size;
+  m_header.pageTableSize =
+      (mem2Size != 0 ? Common::MEM2_START - Common::MEM1_START + mem2Size : mem1Size) / SCAN_PAGE_SIZE;
+  m_header.storeGeneration = generation;
+  m_containers.clear();
+  m_pageTable.clear();
+
+  // Both regions start on a container boundary at every alignment
+  std::vector<BitmapContainer> containers;
+  auto addRegion = [&](u32 offset, u32 regionSize) {
+    const u32 firstKey = offset / alignment;
+    const u32 endKey = firstKey + regionSize / alignment;
+    for (u32 key = firstKey; key < endKey; key += CONTAINER_KEYS)
+      containers.push_back(BitmapContainer::range(static_cast<u16>(key >> 16), std::min(endKey - key, CONTAINER_KEYS)));
+  };
+  if (mem1Size != 0)
+    addRegion(0, mem1Size);
+  if (mem2Size != 0)
+    addRegion(Common::MEM2_START - Common::MEM1_START, mem2Size);
+
+  if (!m_store->open(storePath(generation), 0, true) || !m_store->reserve(m_header.pageTableSize))
+  {
+    error = "couldn't create the page store";
+    return false;
+  }
+
+  std::vector<u32> pageTable(m_header.pageTableSize, NO_SCAN_PAGE);
+  std::vector<u8> readable(containers.size());
+  Common::Executor::shared().parallelFor(containers.size(), [&](size_t i) {
+    thread_local std::vector<u8> span;
+    const u32 spanOffset = (static_cast<u32>(containers[i].key) << 16) * alignment;
+    const u32 address = Common::MEM1_START + spanOffset;
+    const u32 length = std::min(containerSpan(), regionEnd(address) - address);
+    span.resize(containerSpan());
+    if (process.readGuest(address, reinterpret_cast<char*>(span.data()), length) != GuestAccess::ok)
+      return;
+    readable[i] = 1;
+    for (u32 offset = 0; offset < length; offset += SCAN_PAGE_SIZE)
+      pageTable[(spanOffset + offset) / SCAN_PAGE_SIZE] = m_store->intern(span.data() + offset);
+  });
+
+  std::vector<BitmapContainer> kept;
+  for (size_t i = 0; i < containers.size(); ++i)
+  {
+    if (readable[i])
+      kept.push_back(std::move(containers[i]));
+    else
+      ++stats.unreadableContainers;
+  }
+  if (kept.empty())
+  {
+    m_store->close();
+    std::remove(storePath(generation).c_str());
+    error = "couldn't read guest memory";
+    return false;
+  }
+
+  m_header.scanCount = 0;
+  if (!commitStep(std::move(kept), std::move(pageTable), m_header.mem1Size, m_header.mem2Size, stats, error))
+    return false;
+  if (!oldStorePath.empty() && oldStorePath != storePath(m_header.storeGeneration))
+    std::remove(oldStorePath.c_str());
+  stats.millis = millisSince(start);
+  return true;
+}
+
+bool ScanSessionStore::open(const std::string& path, std::string& error)
+{
+  return load(path, false, error);
+}
+
+bool ScanSessionStore::load(const std::string& path, bool readOnly, std::string& error)
+{
+  m_path = path;
+  m_containers.clear();
+  m_pageTable.clear();
+  m_store->close();
+
+  Common::MappedFile file;
+  if (!file.openReadOnly(path))
+  {
+    error = "couldn't open " + path;
+    return false;
+  }
+  const u8* data = file.data();
+  const size_t size = file.size();
+  if (size < sizeof(ScanSessionHeader))
+  {
+    error = path + " is not a scan session";
+    return false;
+  }
+  std::memcpy(&m_header, data, sizeof(m_header));
+  if (std::memcmp(m_header.magic, SCAN_SESSION_MAGIC, sizeof(SCAN_SESSION_MAGIC)) != 0 ||
+      m_header.version != SCAN_SESSION_VERSION)
+  {
+    error = path + " is not a scan session of this version";
+    return false;
+  }
+
+  const size_t tableOffset = sizeof(ScanSessionHeader);
+  const size_t directoryOffset = tableOffset + static_cast<size_t>(m_header.pageTableSize) * sizeof(u32);
+  const size_t dataOffset = directoryOffset + static_cast<size_t>(m_header.containerCount) * sizeof(ScanContainerEntry);
+  const u32 mem2Offset = Common::MEM2_START - Common::MEM1_START;
+  const u32 alignment = m_header.alignment;
+  // The same limits create() holds new sessions to, and the page table create() would make
+  if (m_header.type > static_cast<u16>(WalkFieldType::float64) || alignment == 0 || alignment > 8 ||
+      (alignment & (alignment - 1)) != 0 || alignment < walkFieldSize(type()) || dataOffset > size ||
+      m_header.mem1Size > mem2Offset || m_header.mem2Size > mem2Offset || m_header.mem1Size % SCAN_PAGE_SIZE != 0 ||
+      m_header.mem2Size % SCAN_PAGE_SIZE != 0 ||
+      m_header.pageTableSize !=
+          (m_header.mem2Size != 0 ? mem2Offset + m_header.mem2Size : m_header.mem1Size) / SCAN_PAGE_SIZE)
+  {
+    error = path + " is corrupt";
+    return false;
+  }
+
+  m_pageTable.resize(m_header.pageTableSize);
+  std::memcpy(m_pageTable.data(), data + tableOffset, m_pageTable.size() * sizeof(u32));
+  for (u32 page : m_pageTable)
+  {
+    if (page != NO_SCAN_PAGE && page >= m_header.storePageCount)
+    {
+      error = path + " is corrupt";
+      return false;
+    }
+  }
+
+  u64 candidates = 0;
+  m_containers.reserve(m_header.containerCount);
+  for (u32 i = 0; i < m_header.containerCount; ++i)
+  {
+    ScanContainerEntry entry;
+    std::memcpy(&entry, data + directoryOffset + i * sizeof(ScanContainerEntry), sizeof(entry));
+    BitmapContainer container;
+    container.key = entry.key;
+    container.kind = static_cast<ContainerKind>(entry.kind);
+    container.cardinality = entry.cardinality;
+    const u8* source = data + dataOffset + entry.dataOffset;
+    const size_t available = entry.dataOffset <= size - dataOffset ? size - dataOffset - entry.dataOffset : 0;
+    bool valid = true;
+    switch (container.kind)
+    {
+    case ContainerKind::array:
+      valid = entry.cardinality != 0 && entry.cardinality <= ARRAY_CONTAINER_MAX &&
+              entry.cardinality * sizeof(u16) <= available;
+      if (valid)
+      {
+        container.values.resize(entry.cardinality);
+        std::memcpy(container.values.data(), source, entry.cardinality * sizeof(u16));
+        for (u32 v = 1; v < entry.cardinality && valid; ++v)
+          valid = container.values[v - 1] < container.values[v];
+      }
+      break;
+    case ContainerKind::bitmap:
+      valid = entry.cardinality != 0 && CONTAINER_WORDS * sizeof(u64) <= available;
+      if (valid)
+      {
+        container.bits.resize(CONTAINER_WORDS);
+        std::memcpy(container.bits.data(), source, CONTAINER_WORDS * sizeof(u64));
+        u32 count = 0;
+        for (u64 word : container.bits)
+          count += __builtin_popcountll(word);
+        valid = count == entry.cardinality;
+      }
+      break;
+    case ContainerKind::full:
+      valid = entry.cardinality == CONTAINER_KEYS;
+      break;
+    default:
+      valid = false;
+      break;
+    }
+    // Keys ascend, and every candidate lies whole in a scanned region on a page with an image
+    valid = valid && (m_containers.empty() || m_containers.back().key < container.key);
+    const u64 spanStart = (static_cast<u64>(container.key) << 16) * alignment;
+    const u32 spanOffset = static_cast<u32>(spanStart);
+    const u32 end =
+        spanStart < static_cast<u64>(mem2Offset) + m_header.mem2Size ? regionEnd(Common::MEM1_START + spanOffset) : 0;
+    valid = valid && end != 0;
+    if (valid)
+    {
+      const u32 valueSize = walkFieldSize(type());
+      container.forEach([&](u16 low) {
+        const u32 address = Common::MEM1_START + spanOffset + low * alignment;
+        valid = valid && address <= end - valueSize &&
+                m_pageTable[(address - Common::MEM1_START) / SCAN_PAGE_SIZE] != NO_SCAN_PAGE;
+      });
+    }
+    if (!valid)
+    {
+      error = path + " is corrupt";
+      m_containers.clear();
+      return false;
+    }
+    candidates += container.cardinality;
+    m_containers.push_back(std::move(container));
+  }
+  m_header.candidateCount = candidates;
+
+  const std::string pages = storePath(m_header.storeGeneration);
+  if (!(readOnly ? m_store->openReadOnly(pages, m_header.storePageCount)
+                 : m_store->open(pages, m_header.storePageCount, false)))
+  {
+    error = "couldn't open the page store of " + path;
+    m_containers.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ScanSessionStore::narrow(IDolphinProcess& process, const ScanFilter& filter,
+                              const Common::CancellationToken& token, ScanStepStats& stats, std::string& error)
+{
+  const auto start = std::chrono::steady_clock::now();
+  stats.previousCandidates = m_header.candidateCount;
+  // Every page the new image needs already holds a candidate now
+  if (!m_store->reserve(imagePageCount()))
+  {
+    error = "couldn't grow the page store";
+    return false;
+  }
+
+  const WalkFieldType valueType = type();
+  const u32 alignment = m_header.alignment;
+  std::vector<BitmapContainer> containers(m_containers.size());
+  std::vector<u32> pageTable(m_pageTable.size(), NO_SCAN_PAGE);
+  std::atomic<u32> unreadable{0};
+  std::atomic<bool> storeFull{false};
+  Common::Executor::shared().parallelFor(m_containers.size(), [&](size_t i) {
+    if (token.cancelled())
+      return;
+    thread_local std::vector<u8> span;
+    thread_local std::vector<u16> lows;
+    const BitmapContainer& container = m_containers[i];
+    const u32 spanOffset = (static_cast<u32>(container.key) << 16) * alignment;
+    const u32 firstPage = spanOffset / SCAN_PAGE_SIZE;
+    const u32 address = Common::MEM1_START + spanOffset;
+    const u32 length = std::min(containerSpan(), regionEnd(address) - address);
+    // Sparse containers only need the pages between their first and last candidate
+    u32 readStart = 0;
+    u32 readEnd = length;
+    if (container.kind == ContainerKind::array)
+    {
+      readStart = container.values.front() * alignment / SCAN_PAGE_SIZE * SCAN_PAGE_SIZE;
+      readEnd = (container.values.back() * alignment / SCAN_PAGE_SIZE + 1) * SCAN_PAGE_SIZE;
+    }
+    span.resize(containerSpan());
+    if (process.readGuest(address + readStart, reinterpret_cast<char*>(span.data()) + readStart,
+                          readEnd - readStart) != GuestAccess::ok)
+    {
+      ++unreadable;
+      containers[i] = container;
+      std::copy(m_pageTable.begin() + firstPage, m_pageTable.begin() + firstPage + length / SCAN_PAGE_SIZE,
+                pageTable.begin() + firstPage);
+      return;
+    }
+
+    lows.clear();
+    bool pages[MAX_SPAN_PAGES] = {};
+    filterContainer(valueType, container, span.data(), spanOffset, alignment, m_pageTable, *m_store, filter, lows,
+                    pages);
+    containers[i] = BitmapContainer::fromSorted(container.key, lows.data(), static_cast<u32>(lows.size()));
+    for (u32 page = readStart / SCAN_PAGE_SIZE; page < readEnd / SCAN_PAGE_SIZE; ++page)
+    {
+      if (!pages[page])
+        continue;
+      const u32 index = m_store->intern(span.data() + page * SCAN_PAGE_SIZE);
+      if (index == NO_SCAN_PAGE)
+        storeFull = true;
+      pageTable[firstPage + page] = index;
+    }
+  });
+
+  if (token.cancelled() || storeFull)
+  {
+    m_store->finish();
+    error = token.cancelled() ? "cancelled" : "page store ran out of room";
+    return false;
+  }
+
+  containers.erase(std::remove_if(containers.begin(), containers.end(),
+                                  [](const BitmapContainer& container) { return container.cardinality == 0; }),
+                   containers.end());
+  stats.unreadableContainers = unreadable;
+  if (!commitStep(std::move(containers), std::move(pageTable), m_header.mem1Size, m_header.mem2Size, stats, error))
+    return false;
+  stats.millis = millisSince(start);
+  return true;
+}
+
+bool ScanSessionStore::merge(const std::string& otherPath, bool intersect, ScanStepStats& stats, std::string& error)
+{
+  const auto start = std::chrono::steady_clock::now();
+  stats.previousCandidates = m_header.candidateCount;
+  if (otherPath == m_path)
+  {
+    error = "can't merge a session with itself";
+    return false;
+  }
+  ScanSessionStore other;
+  if (!other.load(otherPath, true, error))
+    return false;
+  if (other.m_header.type != m_header.type || other.m_header.alignment != m_header.alignment)
+  {
+    error = "sessions differ in type or alignment";
+    return false;
+  }
+
+  const u32 alignment = m_header.alignment;
+  const u32 size = walkFieldSize(type());
+  const u32 keysPerPage = SCAN_PAGE_SIZE / alignment;
+  const u32 wordsPerPage = keysPerPage / 64;
+  const u32 spanPages = containerSpan() / SCAN_PAGE_SIZE;
+
+  // Pair up the containers by key
+  std::vector<std::pair<const BitmapContainer*, const BitmapContainer*>> pairs;
+  {
+    size_t a = 0;
+    size_t b = 0;
+    const auto& mine = m_containers;
+    const auto& theirs = other.m_containers;
+    while (a < mine.size() || b < theirs.size())
+    {
+      if (b == theirs.size() || (a < mine.size() && mine[a].key < theirs[b].key))
+      {
+        if (!intersect)
+          pairs.emplace_back(&mine[a], nullptr);
+        ++a;
+      }
+      else if (a == mine.size() || theirs[b].key < mine[a].key)
+      {
+        if (!intersect)
+          pairs.emplace_back(nullptr, &theirs[b]);
+        ++b;
+      }
+      else
+      {
+        pairs.emplace_back(&mine[a++], &theirs[b++]);
+      }
+    }
+  }
+
+  // A union covers both sessions' regions; the header takes them on only once the step commits
+  const u32 mem1Size = intersect ? m_header.mem1Size : std::max(m_header.mem1Size, other.m_header.mem1Size);
+  const u32 mem2Size = intersect ? m_header.mem2Size : std::max(m_header.mem2Size, other.m_header.mem2Size);
+  const u32 pageTableSize =
+      intersect ? m_header.pageTableSize : std::max(m_header.pageTableSize, other.m_header.pageTableSize);
+  std::vector<u32> mineTable = m_pageTable;
+  mineTable.resize(pageTableSize, NO_SCAN_PAGE);
+  std::vector<u32> pageTable(pageTableSize, NO_SCAN_PAGE);
+  if (!m_store->reserve(imagePageCount() + other.imagePageCount()))
+  {
+    error = "couldn't grow the page store";
+    return false;
+  }
+
+  std::vector<BitmapContainer> containers(pairs.size());
+  std::atomic<bool> storeFull{false};
+  Common::Executor::shared().parallelFor(pairs.size(), [&](size_t i) {
+    thread_local std::vector<u64> mine;
+    thread_local std::vector<u64> theirs;
+    thread_local std::vector<u64> merged;
+    mine.assign(CONTAINER_WORDS, 0);
+    theirs.assign(CONTAINER_WORDS, 0);
+    merged.resize(CONTAINER_WORDS);
+    if (pairs[i].first)
+      pairs[i].first->toBits(mine.data());
+    if (pairs[i].second)
+      pairs[i].second->toBits(theirs.data());
+    const u16 key = pairs[i].first ? pairs[i].first->key : pairs[i].second->key;
+    for (u32 w = 0; w < CONTAINER_WORDS; ++w)
+      merged[w] = intersect ? mine[w] & theirs[w] : mine[w] | theirs[w];
+    containers[i] = BitmapContainer::fromBits(key, merged.data());
+
+    const u32 firstPage = (static_cast<u32>(key) << 16) * alignment / SCAN_PAGE_SIZE;
+    for (u32 page = 0; page < spanPages && firstPage + page < pageTable.size(); ++page)
+    {
+      const u32 firstWord = page * wordsPerPage;
+      if (!anyBits(merged.data(), firstWord, wordsPerPage))
+        continue;
+      // Candidates only the other session has take their previous values from its image
+      bool theirsOnly = false;
+      for (u32 w = firstWord; !intersect && w < firstWord + wordsPerPage; ++w)
+        theirsOnly = theirsOnly || (theirs[w] & ~mine[w]) != 0;
+      if (!theirsOnly)
+      {
+        pageTable[firstPage + page] = mineTable[firstPage + page];
+        continue;
+      }
+
+      const u8* theirPage = other.m_store->page(other.m_pageTable[firstPage + page]);
+      u8 composed[SCAN_PAGE_SIZE];
+      const u32 minePage = mineTable[firstPage + page];
+      std::memcpy(composed, minePage != NO_SCAN_PAGE ? m_store->page(minePage) : theirPage, SCAN_PAGE_SIZE);
+      for (u32 w = firstWord; w < firstWord + wordsPerPage; ++w)
+      {
+        for (u64 word = theirs[w] & ~mine[w]; word != 0; word &= word - 1)
+        {
+          const u32 offset = (w * 64 + __builtin_ctzll(word)) * alignment % SCAN_PAGE_SIZE;
+          std::memcpy(composed + offset, theirPage + offset, size);
+        }
+      }
+      const u32 index = m_store->intern(composed);
+      if (index == NO_SCAN_PAGE)
+        storeFull = true;
+      pageTable[firstPage + page] = index;
+    }
+  });
+
+  if (storeFull)
+  {
+    m_store->finish();
+    error = "page store ran out of room";
+    return false;
+  }
+  containers.erase(std::remove_if(containers.begin(), containers.end(),
+                                  [](const BitmapContainer& container) { return container.cardinality == 0; }),
+                   containers.end());
+  if (!commitStep(std::move(containers), std::move(pageTable), mem1Size, mem2Size, stats, error))
+    return false;
+  stats.millis = millisSince(start);
+  return true;
+}
+
+void ScanSessionStore::candidates(u64 start, u32 limit, std::vector<u32>& addresses,
+                                  std::vector<double>& values) const
+{
+  const u32 alignment = m_header.alignment;
+  u64 skip = start;
+  for (const BitmapContainer& container : m_containers)
+  {
+    if (addresses.size() >= limit)
+      break;
+    if (skip >= container.cardinality)
+    {
+      skip -= container.cardinality;
+      continue;
+    }
+    const u32 base = Common::MEM1_START + (static_cast<u32>(container.key) << 16) * alignment;
+    container.forEach([&](u16 low) {
+      if (skip != 0)
+      {
+        --skip;
+        return;
+      }
+      if (addresses.size() >= limit)
+        return;
+      const u32 address = base + low * alignment;
+      addresses.push_back(address);
+      values.push_back(previousValue(address));
+    });
+  }
+}
+
+u32 ScanSessionStore::imagePageCount() const
+{
+  return static_cast<u32>(
+      std::count_if(m_pageTable.begin(), m_pageTable.end(), [](u32 page) { return page != NO_SCAN_PAGE; }));
+}
+
+std::string ScanSessionStore::storePath(u32 generation) const
+{
+  return m_path + ".pages" + std::to_string(generation);
+}
+
+u32 ScanSessionStore::regionEnd(u32 address) const
+{
+  if (address >= Common::MEM1_START && address - Common::MEM1_START < m_header.mem1Size)
+    return Common::MEM1_START + m_header.mem1Size;
+  if (address >= Common::MEM2_START && address - Common::MEM2_START < m_header.mem2Size)
+    return Common::MEM2_START + m_header.mem2Size;
+  return 0;
+}
+
+double ScanSessionStore::previousValue(u32 address) const
+{
+  const u32 page = m_pageTable[(address - Common::MEM1_START) / SCAN_PAGE_SIZE];
+  return readAsDouble(type(), m_store->page(page) + address % SCAN_PAGE_SIZE);
+}
+
+bool ScanSessionStore::compact(std::string& oldStorePath, std::string& error)
+{
+  const u32 generation = m_header.storeGeneration + 1;
+  auto store = std::make_unique<ScanPageStore>();
+  const u32 livePages = imagePageCount();
+  if (!store->open(storePath(generation), 0, true) || !store->reserve(livePages))
+  {
+    error = "couldn't create the compacted page store";
+    return false;
+  }
+  std::vector<u32> moved(m_store->pageCount(), NO_SCAN_PAGE);
+  for (u32& page : m_pageTable)
+  {
+    if (page == NO_SCAN_PAGE)
+      continue;
+    if (moved[page] == NO_SCAN_PAGE)
+      moved[page] = store->intern(m_store->page(page));
+    page = moved[page];
+  }
+  store->finish();
+  oldStorePath = storePath(m_header.storeGeneration);
+  m_store = std::move(store);
+  m_header.storeGeneration = generation;
+  return true;
+}
+
+bool ScanSessionStore::save(std::string& error)
+{
+  std::vector<ScanContainerEntry> entries;
+  entries.reserve(m_containers.size());
+  u64 dataOffset = 0;
+  for (const BitmapContainer& container : m_containers)
+  {
+    entries.push_back({container.key, static_cast<u8>(container.kind), 0, container.cardinality, dataOffset});
+    dataOffset += container.dataSize();
+  }
+
+  // Write to a temporary file first so a crash never leaves a truncated session behind
+  std::string tempPath = m_path + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    out.write(reinterpret_cast<const char*>(m_pageTable.data()), m_pageTable.size() * sizeof(u32));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ScanContainerEntry));
+    for (const BitmapContainer& container : m_containers)
+    {
+      if (container.kind == ContainerKind::array)
+        out.write(reinterpret_cast<const char*>(container.values.data()), container.values.size() * sizeof(u16));
+      else if (container.kind == ContainerKind::bitmap)
+        out.write(reinterpret_cast<const char*>(container.bits.data()), container.bits.size() * sizeof(u64));
+    }
+    if (!out)
+    {
+      error = "couldn't write " + tempPath;
+      return false;
+    }
+  }
+  if (std::rename(tempPath.c_str(), m_path.c_str()) != 0)
+  {
+    error = "couldn't replace " + m_path;
+    return false;
+  }
+  return true;
+}
+
+bool ScanSessionStore::commitStep(std::vector<BitmapContainer>&& containers, std::vector<u32>&& pageTable,
+                                  u32 mem1Size, u32 mem2Size, ScanStepStats& stats, std::string& error)
+{
+  m_store->finish();
+  m_containers = std::move(containers);
+  m_pageTable = std::move(pageTable);
+  m_header.mem1Size = mem1Size;
+  m_header.mem2Size = mem2Size;
+  m_header.pageTableSize = static_cast<u32>(m_pageTable.size());
+  u64 candidates = 0;
+  for (const BitmapContainer& container : m_containers)
+    candidates += container.cardinality;
+
+  const u32 livePages = imagePageCount();
+  std::string oldStorePath;
+  if (m_store->pageCount() > 2ull * livePages + COMPACT_SLACK_PAGES)
+  {
+    if (!compact(oldStorePath, error))
+      return false;
+    stats.compacted = true;
+  }
+
+  m_header.containerCount = static_cast<u32>(m_containers.size());
+  m_header.candidateCount = candidates;
+  m_header.storePageCount = m_store->pageCount();
+  m_header.lastScanMillis = nowMillis();
+  ++m_header.scanCount;
+  if (!save(error))
+    return false;
+  if (!oldStorePath.empty())
+    std::remove(oldStorePath.c_str());
+
+  stats.candidates = candidates;
+  stats.imagePages = livePages;
+  stats.storePages = m_store->pageCount();
+  return true;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "candidate_bitmap.h"
+#include "common_types.h"
+#include "dolphin_process.h"
+#include "executor.h"
+#include "mapped_file.h"
+#include "structure_walker.h"
+
+// Scan sessions kept on disk, so an unknown-initial-value scan of all of RAM doesn't hold tens of
+// millions of candidates and their previous values in memory, and survives restarts.
+//
+// A session is two files:
+//
+//   <path>           ScanSessionHeader, the page table (one u32 per 4 KiB page of guest address
+//                    space from MEM1_START, NO_SCAN_PAGE where no candidate lies), one
+//                    ScanContainerEntry per candidate container, then the containers' data. Written
+//                    to <path>.tmp and renamed over the old file after every step.
+//   <path>.pages<N>  Page store: a header page, then 4 KiB pages of guest memory as of the last
+//                    scan. Pages are deduplicated by content, so zero pages and pages unchanged
+//                    since an earlier scan are stored once, and only pages that still hold a
+//                    candidate are kept at all. The store is memory-mapped for the comparisons;
+//                    steps only append to it. When most of it is no longer referenced it is
+//                    compacted into generation N + 1, which the renamed header switches to.
+//
+// Candidate keys are (address - MEM1_START) / alignment, in a CandidateBitmap-style list of
+// containers (see candidate_bitmap.h). Steps run container by container across the shared
+// executor, each reading its 64K candidates' span of guest memory once, so memory use stays at a
+// few spans per worker however large the scan. Only one process should have a session open.
+namespace DolphinComm
+{
+constexpr char SCAN_SESSION_MAGIC[8] = {'D', 'A', 'B', 'S', 'C', 'N', '0', '1'};
+constexpr char SCAN_PAGES_MAGIC[8] = {'D', 'A', 'B', 'S', 'C', 'P', '0', '1'};
+constexpr u32 SCAN_SESSION_VERSION = 1;
+constexpr u32 SCAN_PAGE_SIZE = 4096;
+constexpr u32 NO_SCAN_PAGE = 0xFFFFFFFF;
+
+struct ScanSessionHeader
+{
+  char magic[8];
+  u32 version;
+  // WalkFieldType of the values
+  u16 type;
+  u16 alignment;
+  // Bytes of MEM1 and MEM2 covered, 0 for a region not scanned
+  u32 mem1Size;
+  u32 mem2Size;
+  u32 scanCount;
+  u32 containerCount;
+  u32 pageTableSize;
+  u32 storeGeneration;
+  // Pages of the store in use; anything after them is left over from an interrupted step
+  u64 storePageCount;
+  u64 candidateCount;
+  u64 lastScanMillis;
+};
+
+struct ScanContainerEntry
+{
+  u16 key;
+  u8 kind;
+  u8 reserved;
+  u32 cardinality;
+  // From the start of the data section
+  u64 dataOffset;
+};
+
+enum class ScanCompare : u8
+{
+  // Against the value of the previous scan
+  changed,
+  unchanged,
+  increased,
+  decreased,
+  increasedBy,
+  decreasedBy,
+  // Against value (and upper)
+  equal,
+  notEqual,
+  greater,
+  less,
+  between
+};
+
+struct ScanFilter
+{
+  ScanCompare compare;
+  double value = 0;
+  // between: value <= x <= upper
+  double upper = 0;
+};
+
+struct ScanStepStats
+{
+  u64 previousCandidates = 0;
+  u64 candidates = 0;
+  // Pages of the new image, and of the store holding it
+  u32 imagePages = 0;
+  u64 storePages = 0;
+  // Containers whose memory couldn't be read; they are kept as they were
+  u32 unreadableContainers = 0;
+  bool compacted = false;
+  double millis = 0;
+};
+
+// Content-addressed store of 4 KiB pages in one memory-mapped file
+class ScanPageStore
+{
+public:
+  // Opens (or creates) the store, keeping the first pageCount pages
+  bool open(const std::string& path, u64 pageCount, bool create);
+  // Maps the first pageCount pages for page() only, leaving the file as it is
+  bool openReadOnly(const std::string& path, u64 pageCount);
+  void close();
+
+  // Makes room for count more pages so intern() never remaps; pointers from page() stay valid
+  // until finish()
+  bool reserve(u64 count);
+  // Thread safe. The index of a page with these bytes, appending one if there is none.
+  u32 intern(const u8* page);
+  // Drops the unused reserve
+  bool finish();
+
+  const u8* page(u32 index) const { return m_file.data() + (static_cast<u64>(index) + 1) * SCAN_PAGE_SIZE; }
+  u64 pageCount() const { return m_pageCount; }
+
+private:
+  Common::MappedFile m_file;
+  u64 m_pageCount = 0;
+  u64 m_capacity = 0;
+  std::mutex m_mutex;
+  std::unordered_multimap<u64, u32> m_index;
+};
+
+class ScanSessionStore
+{
+public:
+  // A session of every aligned address of the regions, holding their values as they are now
+  bool create(const std::string& path, IDolphinProcess& process, WalkFieldType type, u32 alignment, bool mem1,
+              bool mem2, ScanStepStats& stats, std::string& error);
+  bool open(const std::string& path, std::string& error);
+
+  // Keeps the candidates whose current value passes filter, then makes the current values the
+  // previous ones. Stops early, leaving the session as it was, if token is cancelled.
+  bool narrow(IDolphinProcess& process, const ScanFilter& filter, const Common::CancellationToken& token,
+              ScanStepStats& stats, std::string& error);
+  // Intersects with or adds the candidates of another session of the same type and alignment.
+  // Candidates only the other session has keep their previous values from it.
+  bool merge(const std::string& otherPath, bool intersect, ScanStepStats& stats, std::string& error);
+
+  // Up to limit candidates from the start-th on, with their previous values
+  void candidates(u64 start, u32 limit, std::vector<u32>& addresses, std::vector<double>& values) const;
+
+  const std::string& path() const { return m_path; }
+  const ScanSessionHeader& header() const { return m_header; }
+  WalkFieldType type() const { return static_cast<WalkFieldType>(m_header.type); }
+  u64 candidateCount() const { return m_header.candidateCount; }
+  const std::vector<BitmapContainer>& containers() const { return m_containers; }
+  u32 imagePageCount() const;
+
+private:
+  // A read-only session is only looked at, e.g. the other side of a merge, which may be open for
+  // steps elsewhere; its page store is mapped read-only and never truncated
+  bool load(const std::string& path, bool readOnly, std::string& error);
+  std::string storePath(u32 generation) const;
+  u32 containerSpan() const { return CONTAINER_KEYS * m_header.alignment; }
+  // End of the region containing address, 0 if none
+  u32 regionEnd(u32 address) const;
+  double previousValue(u32 address) const;
+  // Moves the pages in use to a fresh generation of the store, returning the old one's path
+  bool compact(std::string& oldStorePath, std::string& error);
+  bool save(std::string& error);
+  // Makes a step's result the session, covering mem1Size and mem2Size bytes, compacting the store
+  // if most of it is garbage, and saves it. The header only changes here.
+  bool commitStep(std::vector<BitmapContainer>&& containers, std::vector<u32>&& pageTable, u32 mem1Size,
+                  u32 mem2Size, ScanStepStats& stats, std::string& error);
+
+  std::string m_path;
+  ScanSessionHeader m_header{};
+  std::vector<u32> m_pageTable;
+  std::vector<BitmapContainer> m_containers;
+  std::unique_ptr<ScanPageStore> m_store = std::make_unique<ScanPageStore>();
+};
+}  // namespace DolphinComm
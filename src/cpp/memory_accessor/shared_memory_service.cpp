@@ -0,0 +1,330 @@
+#include "shared_memory_service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#include "common_utils.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr size_t CACHE_LINE = 64;
+// How long the server sleeps in futex waits before re-checking whether it should stop
+constexpr long WAIT_TIMEOUT_NS = 100 * 1000 * 1000;
+
+size_t roundUp(size_t value, size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+u32 loadAcquire(const u32* word)
+{
+  return __atomic_load_n(word, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(u32* word, u32 value)
+{
+  __atomic_store_n(word, value, __ATOMIC_RELEASE);
+}
+
+// Cross-process futex (no FUTEX_PRIVATE_FLAG); polling elsewhere
+void futexWait(u32* word, u32 expected)
+{
+#ifdef __linux__
+  timespec timeout{0, WAIT_TIMEOUT_NS};
+  syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+  (void)word;
+  (void)expected;
+#endif
+}
+
+void futexWakeAll(u32* word)
+{
+#ifdef __linux__
+  syscall(SYS_futex, word, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+}  // namespace
+
+bool SharedMemoryService::start(IDolphinProcess* process, const std::string& name, u32 slotCount,
+                                u32 ringEntries, u32 dataSize)
+{
+  stop();
+  if (!process || name.empty() || slotCount == 0 || ringEntries == 0 || dataSize == 0)
+    return false;
+
+  ringEntries = Common::NextPowerOf2(ringEntries);
+  const size_t headerSize = roundUp(sizeof(DabIpcHeader), CACHE_LINE);
+  const size_t dataOffset = roundUp(sizeof(DabIpcSlot) + ringEntries * sizeof(DabIpcRequest) +
+                                        ringEntries * sizeof(DabIpcResponse),
+                                    CACHE_LINE);
+  const size_t slotStride = roundUp(dataOffset + dataSize, 4096);
+  const size_t size = headerSize + slotCount * slotStride;
+
+  // A previous run that crashed leaves its object behind
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0)
+    return false;
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED)
+  {
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  m_process = process;
+  m_name = name;
+  m_base = static_cast<u8*>(base);
+  m_size = size;
+  m_slotCount = slotCount;
+  m_ringEntries = ringEntries;
+  m_dataSize = dataSize;
+  m_headerSize = headerSize;
+  m_dataOffset = dataOffset;
+  m_slotStride = slotStride;
+
+  DabIpcHeader* ipcHeader = header();
+  std::memset(ipcHeader, 0, headerSize);
+  std::memcpy(ipcHeader->magic, DAB_IPC_MAGIC, sizeof(ipcHeader->magic));
+  ipcHeader->version = DAB_IPC_VERSION;
+  ipcHeader->headerSize = static_cast<u32>(headerSize);
+  ipcHeader->slotCount = slotCount;
+  ipcHeader->ringEntries = ringEntries;
+  ipcHeader->dataSize = dataSize;
+  ipcHeader->dataOffset = static_cast<u32>(dataOffset);
+  ipcHeader->slotStride = slotStride;
+  ipcHeader->serverPid = static_cast<u32>(getpid());
+  storeRelease(&ipcHeader->serverRunning, 1);
+
+  m_requestCount = 0;
+  m_batchCount = 0;
+  m_bytesRead = 0;
+  m_bytesWritten = 0;
+  m_running = true;
+  m_thread = std::thread(&SharedMemoryService::run, this);
+  return true;
+}
+
+void SharedMemoryService::stop()
+{
+  if (m_running.exchange(false))
+  {
+    storeRelease(&header()->serverRunning, 0);
+    __atomic_fetch_add(&header()->doorbell, 1, __ATOMIC_SEQ_CST);
+    futexWakeAll(&header()->doorbell);
+  }
+  if (m_thread.joinable())
+    m_thread.join();
+
+  if (m_base)
+  {
+    // Wake clients sleeping on a response that will never come so they notice serverRunning
+    for (u32 i = 0; i < m_slotCount; ++i)
+      futexWakeAll(&slot(i)->responseHead);
+    munmap(m_base, m_size);
+    shm_unlink(m_name.c_str());
+    m_base = nullptr;
+    m_size = 0;
+    m_slotCount = 0;
+  }
+}
+
+SharedMemoryServiceStats SharedMemoryService::stats() const
+{
+  SharedMemoryServiceStats result{m_requestCount.load(), m_batchCount.load(), m_bytesRead.load(),
+                                  m_bytesWritten.load(), 0};
+  if (m_base)
+  {
+    for (u32 i = 0; i < m_slotCount; ++i)
+      result.activeClients += loadAcquire(&slot(i)->owner) != 0;
+  }
+  return result;
+}
+
+DabIpcSlot* SharedMemoryService::slot(u32 index) const
+{
+  return reinterpret_cast<DabIpcSlot*>(m_base + m_headerSize + index * m_slotStride);
+}
+
+DabIpcRequest* SharedMemoryService::requests(DabIpcSlot* ipcSlot) const
+{
+  return reinterpret_cast<DabIpcRequest*>(reinterpret_cast<u8*>(ipcSlot) + sizeof(DabIpcSlot));
+}
+
+DabIpcResponse* SharedMemoryService::responses(DabIpcSlot* ipcSlot) const
+{
+  return reinterpret_cast<DabIpcResponse*>(requests(ipcSlot) + m_ringEntries);
+}
+
+u8* SharedMemoryService::data(DabIpcSlot* ipcSlot) const
+{
+  return reinterpret_cast<u8*>(ipcSlot) + m_dataOffset;
+}
+
+void SharedMemoryService::run()
+{
+  u32 idleRounds = 0;
+  while (m_running.load())
+  {
+    const u32 seenDoorbell = __atomic_load_n(&header()->doorbell, __ATOMIC_SEQ_CST);
+    bool worked = false;
+    for (u32 i = 0; i < m_slotCount; ++i)
+      worked |= serviceSlot(i);
+
+    if (worked)
+    {
+      idleRounds = 0;
+      continue;
+    }
+    waitForWork(seenDoorbell, idleRounds++);
+  }
+}
+
+void SharedMemoryService::waitForWork(u32 seenDoorbell, u32 idleRounds)
+{
+#ifdef __linux__
+  (void)idleRounds;
+  // Clients increment the doorbell before checking serverWaiting, so either they see the flag
+  // and wake us, or we see their increment here and don't sleep
+  __atomic_store_n(&header()->serverWaiting, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&header()->doorbell, __ATOMIC_SEQ_CST) == seenDoorbell)
+    futexWait(&header()->doorbell, seenDoorbell);
+  __atomic_store_n(&header()->serverWaiting, 0, __ATOMIC_SEQ_CST);
+#else
+  (void)seenDoorbell;
+  // No cross-process futex: spin briefly after activity, then back off to 1 ms
+  if (idleRounds < 64)
+    std::this_thread::yield();
+  else
+    std::this_thread::sleep_for(std::chrono::microseconds(idleRounds < 1024 ? 50 : 1000));
+#endif
+}
+
+bool SharedMemoryService::serviceSlot(u32 slotIndex)
+{
+  DabIpcSlot* ipcSlot = slot(slotIndex);
+  const u32 mask = m_ringEntries - 1;
+  const u32 dataSize = m_dataSize;
+  const u32 head = loadAcquire(&ipcSlot->requestHead);
+  const u32 tail = ipcSlot->requestTail;
+  if (head == tail)
+    return false;
+
+  // Only take requests we have response space for. The indices are client-writable too, so a
+  // batch never exceeds the ring whatever they say.
+  const u32 responsesQueued = ipcSlot->responseHead - loadAcquire(&ipcSlot->responseTail);
+  const u32 responseSpace = m_ringEntries - std::min(m_ringEntries, responsesQueued);
+  const u32 count = std::min({head - tail, responseSpace, m_ringEntries});
+  if (count == 0)
+    return false;
+
+  DabIpcRequest* requestRing = requests(ipcSlot);
+  DabIpcResponse* responseRing = responses(ipcSlot);
+  u8* slotData = data(ipcSlot);
+  const u32 responseHead = ipcSlot->responseHead;
+
+  // Copy the requests out first; the client may reuse ring entries as soon as it sees responses
+  m_reads.clear();
+  m_readRequests.clear();
+  auto flushReads = [&]() {
+    if (m_reads.empty())
+      return;
+    m_process->readGuestBatch(m_reads.data(), m_reads.size());
+    for (size_t i = 0; i < m_reads.size(); ++i)
+    {
+      DabIpcResponse& response = responseRing[(responseHead + m_readRequests[i]) & mask];
+      response.status = m_reads[i].result == GuestAccess::ok       ? DAB_IPC_OK :
+                        m_reads[i].result == GuestAccess::unmapped ? DAB_IPC_UNMAPPED :
+                                                                     DAB_IPC_FAILED;
+      response.failedAddress = m_reads[i].result == GuestAccess::ok ? 0 : m_reads[i].failedAddress;
+      if (m_reads[i].result == GuestAccess::ok)
+        m_bytesRead += m_reads[i].size;
+    }
+    m_reads.clear();
+    m_readRequests.clear();
+  };
+
+  for (u32 i = 0; i < count; ++i)
+  {
+    const DabIpcRequest request = requestRing[(tail + i) & mask];
+    DabIpcResponse& response = responseRing[(responseHead + i) & mask];
+    response.id = request.id;
+    response.size = request.size;
+    response.failedAddress = 0;
+
+    const bool inData = request.dataOffset <= dataSize && request.size <= dataSize - request.dataOffset;
+    switch (request.op)
+    {
+    case DAB_IPC_OP_READ:
+      if (!inData)
+      {
+        response.status = DAB_IPC_BAD_REQUEST;
+        break;
+      }
+      m_reads.push_back({request.address, request.size,
+                         reinterpret_cast<char*>(slotData + request.dataOffset), GuestAccess::failed, 0});
+      m_readRequests.push_back(i);
+      break;
+    case DAB_IPC_OP_WRITE:
+    {
+      if (!inData)
+      {
+        response.status = DAB_IPC_BAD_REQUEST;
+        break;
+      }
+      // Earlier reads in the batch must see memory from before this write
+      flushReads();
+      u32 failedAddress = 0;
+      GuestAccess result = m_process->writeGuest(
+          request.address, reinterpret_cast<const char*>(slotData + request.dataOffset), request.size,
+          &failedAddress);
+      response.status = result == GuestAccess::ok       ? DAB_IPC_OK :
+                        result == GuestAccess::unmapped ? DAB_IPC_UNMAPPED :
+                                                          DAB_IPC_FAILED;
+      response.failedAddress = result == GuestAccess::ok ? 0 : failedAddress;
+      if (result == GuestAccess::ok)
+        m_bytesWritten += request.size;
+      break;
+    }
+    case DAB_IPC_OP_PING:
+      response.status = DAB_IPC_OK;
+      break;
+    default:
+      response.status = DAB_IPC_BAD_REQUEST;
+      break;
+    }
+  }
+  flushReads();
+  m_requestCount += count;
+  ++m_batchCount;
+
+  storeRelease(&ipcSlot->requestTail, tail + count);
+  __atomic_store_n(&ipcSlot->responseHead, responseHead + count, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ipcSlot->responseWaiting, __ATOMIC_SEQ_CST))
+    futexWakeAll(&ipcSlot->responseHead);
+  return true;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+#include "ipc_protocol.h"
+
+namespace DolphinComm
+{
+struct SharedMemoryServiceStats
+{
+  u64 requests;
+  u64 batches;
+  u64 bytesRead;
+  u64 bytesWritten;
+  u32 activeClients;
+};
+
+// Serves the protocol in ipc_protocol.h: owns the shared memory object and a thread that drains
+// every client's request ring against one hooked process.
+class SharedMemoryService
+{
+public:
+  SharedMemoryService() = default;
+  ~SharedMemoryService() { stop(); }
+  SharedMemoryService(const SharedMemoryService&) = delete;
+  SharedMemoryService& operator=(const SharedMemoryService&) = delete;
+
+  // ringEntries is rounded up to a power of two. Replaces a stale object of the same name.
+  bool start(IDolphinProcess* process, const std::string& name, u32 slotCount, u32 ringEntries,
+             u32 dataSize);
+  // Stops the thread and unlinks the shared memory object
+  void stop();
+
+  bool isRunning() const { return m_running.load(); }
+  const std::string& name() const { return m_name; }
+  size_t mappingSize() const { return m_size; }
+  SharedMemoryServiceStats stats() const;
+
+private:
+  void run();
+  // Handles what is queued in one slot; false if it had nothing to do
+  bool serviceSlot(u32 slotIndex);
+  void waitForWork(u32 seenDoorbell, u32 idleRounds);
+
+  DabIpcHeader* header() const { return reinterpret_cast<DabIpcHeader*>(m_base); }
+  DabIpcSlot* slot(u32 index) const;
+  DabIpcRequest* requests(DabIpcSlot* slot) const;
+  DabIpcResponse* responses(DabIpcSlot* slot) const;
+  u8* data(DabIpcSlot* slot) const;
+
+  IDolphinProcess* m_process = nullptr;
+  std::string m_name;
+  u8* m_base = nullptr;
+  size_t m_size = 0;
+  // The layout as start() made it. Clients can write the copy in the header, so it is never read
+  // back.
+  u32 m_slotCount = 0;
+  u32 m_ringEntries = 0;
+  u32 m_dataSize = 0;
+  size_t m_headerSize = 0;
+  size_t m_dataOffset = 0;
+  size_t m_slotStride = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+
+  // Scratch for batching consecutive reads of a slot
+  std::vector<GuestRead> m_reads;
+  std::vector<u32> m_readRequests;
+
+  std::atomic<u64> m_requestCount{0};
+  std::atomic<u64> m_batchCount{0};
+  std::atomic<u64> m_bytesRead{0};
+  std::atomic<u64> m_bytesWritten{0};
+};
+}  // namespace DolphinComm
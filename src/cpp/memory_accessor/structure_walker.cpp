@@ -0,0 +1,358 @@
+#include "structure_walker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "common_utils.h"
+#include "memory_layout.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr size_t CACHE_LINE_SIZE = 64;
+// Lines prefetched per node; the walk only needs the start of most nodes soon
+constexpr size_t MAX_PREFETCH_LINES = 4;
+// Largest pointer table a walk may start from
+constexpr u64 MAX_START_TABLE_SIZE = 16 * 1024 * 1024;
+
+u32 readBigEndian32(const u8* data)
+{
+  u32 value;
+  std::memcpy(&value, data, sizeof(value));
+  return Common::bSwap32(value);
+}
+
+double decodeField(const u8* data, WalkFieldType type)
+{
+  switch (type)
+  {
+  case WalkFieldType::uint8:
+    return data[0];
+  case WalkFieldType::int8:
+    return static_cast<s8>(data[0]);
+  case WalkFieldType::uint16:
+  case WalkFieldType::int16:
+  {
+    u16 value;
+    std::memcpy(&value, data, sizeof(value));
+    value = Common::bSwap16(value);
+    return type == WalkFieldType::uint16 ? value : static_cast<s16>(value);
+  }
+  case WalkFieldType::uint32:
+    return readBigEndian32(data);
+  case WalkFieldType::int32:
+    return static_cast<s32>(readBigEndian32(data));
+  case WalkFieldType::float32:
+  {
+    u32 bits = readBigEndian32(data);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  case WalkFieldType::float64:
+  {
+    u64 bits;
+    std::memcpy(&bits, data, sizeof(bits));
+    bits = Common::bSwap64(bits);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  }
+  return 0;
+}
+
+// readFromRAM offset of [address, address + size), false unless all of it is in one of MEM1/MEM2
+bool rangeToOffset(u32 address, u32 size, u32& offset)
+{
+  const u32 ends[2] = {address, address + size - 1};
+  u32 offsets[2];
+  Common::dolphinAddrsToOffsets(ends, offsets, 2);
+  offset = offsets[0];
+  return offsets[0] != Common::INVALID_OFFSET && offsets[1] == offsets[0] + (size - 1);
+}
+
+class Walker
+{
+public:
+  Walker(IDolphinProcess& process, const WalkSpec& spec, WalkResult& result)
+      : m_process(process), m_spec(spec), m_result(result)
+  {
+    u32 spanEnd = 0;
+    m_spanStart = ~0u;
+    for (const WalkField& field : spec.fields)
+    {
+      m_spanStart = std::min(m_spanStart, field.offset);
+      spanEnd = std::max(spanEnd, field.offset + walkFieldSize(field.type));
+    }
+    for (u32 link : spec.links)
+    {
+      m_spanStart = std::min(m_spanStart, link);
+      spanEnd = std::max(spanEnd, link + 4);
+    }
+    m_span = spanEnd - m_spanStart;
+  }
+
+  bool run()
+  {
+    m_result = WalkResult();
+    m_result.direct = m_process.mappedRAM(0, 1) != nullptr;
+    if (!queueStart())
+      return false;
+    std::swap(m_level, m_next);
+
+    while (!m_level.empty())
+    {
+      ++m_result.levels;
+      fetchLevel();
+      m_next.clear();
+      for (size_t i = 0; i < m_level.size(); ++i)
+        visit(i);
+      std::swap(m_level, m_next);
+    }
+    return true;
+  }
+
+private:
+  struct Pending
+  {
+    u32 address;
+    s32 parent;
+  };
+
+  bool queueStart()
+  {
+    const WalkStart& start = m_spec.start;
+    if (!start.indirect)
+    {
+      for (u64 i = 0; i < start.count; ++i)
+      {
+        const u64 address = start.address + i * start.stride;
+        if (address > 0xFFFFFFFF)
+          break;
+        queue(static_cast<u32>(address), -1);
+      }
+      return true;
+    }
+
+    // The whole pointer table is one read
+    const u32 tableSize = (start.count - 1) * start.stride + 4;
+    u32 offset;
+    if (!rangeToOffset(start.address, tableSize, offset))
+      return false;
+    std::vector<u8> table(tableSize);
+    ReadRequest request{offset, tableSize, reinterpret_cast<char*>(table.data()), false};
+    m_process.readBatch(&request, 1);
+    ++m_result.batches;
+    if (!request.ok)
+      return false;
+    for (u32 i = 0; i < start.count; ++i)
+      queuePointer(readBigEndian32(table.data() + i * start.stride), -1);
+    return true;
+  }
+
+  void queuePointer(u32 pointer, s32 parent)
+  {
+    if (pointer != 0)
+      queue(pointer - m_spec.pointerBias, parent);
+  }
+
+  void queue(u32 address, s32 parent)
+  {
+    if (m_visited.count(address) != 0)
+    {
+      ++m_result.revisits;
+      return;
+    }
+    if (m_visited.size() >= m_spec.maxNodes)
+    {
+      m_result.truncated = true;
+      return;
+    }
+    m_visited.insert(address);
+    m_next.push_back({address, parent});
+
+    // Start pulling the node in while the rest of this level is decoded
+    u32 offset;
+    if (m_result.direct && rangeToOffset(address + m_spanStart, m_span, offset))
+    {
+      if (const u8* node = m_process.mappedRAM(offset, m_span))
+      {
+        const size_t lines = std::min<size_t>(MAX_PREFETCH_LINES, (m_span + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE);
+        for (size_t line = 0; line < lines; ++line)
+          __builtin_prefetch(node + line * CACHE_LINE_SIZE);
+      }
+    }
+  }
+
+  // Points m_nodeData at each node's span, null where it can't be read
+  void fetchLevel()
+  {
+    const size_t count = m_level.size();
+    m_addresses.resize(count);
+    m_offsets.resize(count);
+    m_lastOffsets.resize(count);
+    for (size_t i = 0; i < count; ++i)
+      m_addresses[i] = m_level[i].address + m_spanStart;
+    Common::dolphinAddrsToOffsets(m_addresses.data(), m_offsets.data(), count);
+    for (size_t i = 0; i < count; ++i)
+      m_addresses[i] += m_span - 1;
+    Common::dolphinAddrsToOffsets(m_addresses.data(), m_lastOffsets.data(), count);
+
+    m_nodeData.assign(count, nullptr);
+    m_requests.clear();
+    m_requestNodes.clear();
+    m_buffer.resize(count * static_cast<size_t>(m_span));
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (m_offsets[i] == Common::INVALID_OFFSET || m_lastOffsets[i] != m_offsets[i] + (m_span - 1))
+      {
+        ++m_result.invalidPointers;
+        m_offsets[i] = Common::INVALID_OFFSET;
+        continue;
+      }
+      if (m_result.direct && (m_nodeData[i] = m_process.mappedRAM(m_offsets[i], m_span)) != nullptr)
+        continue;
+      char* target = reinterpret_cast<char*>(m_buffer.data() + i * m_span);
+      m_requests.push_back({m_offsets[i], m_span, target, false});
+      m_requestNodes.push_back(i);
+    }
+
+    if (m_requests.empty())
+      return;
+    m_process.readBatch(m_requests.data(), m_requests.size());
+    ++m_result.batches;
+    for (size_t i = 0; i < m_requests.size(); ++i)
+    {
+      if (m_requests[i].ok)
+        m_nodeData[m_requestNodes[i]] = reinterpret_cast<const u8*>(m_requests[i].buffer);
+    }
+  }
+
+  void visit(size_t levelIndex)
+  {
+    const Pending& node = m_level[levelIndex];
+    const u8* data = m_nodeData[levelIndex];
+    if (data == nullptr)
+    {
+      // Invalid pointers were counted when the level was translated
+      if (m_offsets[levelIndex] != Common::INVALID_OFFSET)
+        ++m_result.unreadableNodes;
+      return;
+    }
+
+    const s32 index = static_cast<s32>(m_result.addresses.size());
+    m_result.addresses.push_back(node.address);
+    m_result.parents.push_back(node.parent);
+    for (const WalkField& field : m_spec.fields)
+      m_result.values.push_back(decodeField(data + (field.offset - m_spanStart), field.type));
+    for (u32 link : m_spec.links)
+      queuePointer(readBigEndian32(data + (link - m_spanStart)), index);
+  }
+
+  IDolphinProcess& m_process;
+  const WalkSpec& m_spec;
+  WalkResult& m_result;
+  u32 m_spanStart;
+  u32 m_span;
+
+  std::unordered_set<u32> m_visited;
+  std::vector<Pending> m_level;
+  std::vector<Pending> m_next;
+  std::vector<u32> m_addresses;
+  std::vector<u32> m_offsets;
+  std::vector<u32> m_lastOffsets;
+  std::vector<const u8*> m_nodeData;
+  std::vector<ReadRequest> m_requests;
+  std::vector<size_t> m_requestNodes;
+  std::vector<u8> m_buffer;
+};
+}  // namespace
+
+u32 walkFieldSize(WalkFieldType type)
+{
+  switch (type)
+  {
+  case WalkFieldType::uint8:
+  case WalkFieldType::int8:
+    return 1;
+  case WalkFieldType::uint16:
+  case WalkFieldType::int16:
+    return 2;
+  case WalkFieldType::uint32:
+  case WalkFieldType::int32:
+  case WalkFieldType::float32:
+    return 4;
+  case WalkFieldType::float64:
+    return 8;
+  }
+  return 0;
+}
+
+bool validateWalkSpec(const WalkSpec& spec, const char*& error)
+{
+  if (spec.fields.empty() && spec.links.empty())
+  {
+    error = "Nothing to read: give fields or links";
+    return false;
+  }
+  u32 spanStart = ~0u;
+  u32 spanEnd = 0;
+  for (const WalkField& field : spec.fields)
+  {
+    if (field.offset > WALK_MAX_NODE_SPAN)
+    {
+      error = "Field offset is too large";
+      return false;
+    }
+    spanStart = std::min(spanStart, field.offset);
+    spanEnd = std::max(spanEnd, field.offset + walkFieldSize(field.type));
+  }
+  for (u32 link : spec.links)
+  {
+    if (link > WALK_MAX_NODE_SPAN)
+    {
+      error = "Link offset is too large";
+      return false;
+    }
+    spanStart = std::min(spanStart, link);
+    spanEnd = std::max(spanEnd, link + 4);
+  }
+  if (spanEnd - spanStart > WALK_MAX_NODE_SPAN)
+  {
+    error = "Fields and links span more than 64 KB";
+    return false;
+  }
+
+  const WalkStart& start = spec.start;
+  if (start.count == 0 || start.count > WALK_MAX_NODES)
+  {
+    error = "count must be between 1 and 1048576";
+    return false;
+  }
+  if (start.indirect &&
+      (start.stride < 4 || static_cast<u64>(start.count - 1) * start.stride + 4 > MAX_START_TABLE_SIZE))
+  {
+    error = "A pointer table needs a stride of at least 4 and must fit in 16 MB";
+    return false;
+  }
+  if (!start.indirect && start.count > 1 && start.stride == 0)
+  {
+    error = "stride must not be 0";
+    return false;
+  }
+  if (spec.maxNodes == 0 || spec.maxNodes > WALK_MAX_NODES)
+  {
+    error = "maxNodes must be between 1 and 1048576";
+    return false;
+  }
+  return true;
+}
+
+bool walkStructure(IDolphinProcess& process, const WalkSpec& spec, WalkResult& result)
+{
+  return Walker(process, spec, result).run();
+}
+}  // namespace DolphinComm
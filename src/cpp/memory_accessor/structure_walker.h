@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+
+// Follows linked lists, trees and pointer tables in guest memory natively, so a whole actor list
+// costs one call instead of a round trip per node.
+//
+// The walk is breadth first: every node of one level is read as one batch, and the pointers at
+// the link offsets of those nodes make up the next level. Each node is read once, as the span
+// covering all of its fields and links. A list is one node per level; a tree or a table of lists
+// gets wider levels and fewer batches. When the backend maps emulated memory into this process
+// (savestates), nodes are read in place and every newly found node is prefetched as soon as its
+// pointer is seen, while the rest of the level is still being decoded.
+namespace DolphinComm
+{
+enum class WalkFieldType : u8
+{
+  uint8,
+  uint16,
+  uint32,
+  int8,
+  int16,
+  int32,
+  float32,
+  float64
+};
+
+u32 walkFieldSize(WalkFieldType type);
+
+struct WalkField
+{
+  // From the node's start
+  u32 offset;
+  WalkFieldType type;
+};
+
+// Where the walk starts: count entries stride bytes apart from address. Direct entries are the
+// first nodes themselves (a head node, an array of structs); indirect ones are pointers to them (a
+// head pointer, a pointer table), null entries skipped.
+struct WalkStart
+{
+  u32 address;
+  u32 count = 1;
+  u32 stride = 4;
+  bool indirect = false;
+};
+
+struct WalkSpec
+{
+  WalkStart start;
+  // Offsets of the pointers to further nodes: one for a list, two for a binary tree, ...
+  std::vector<u32> links;
+  // How far into the node pointers read from memory point, for intrusive lists whose links
+  // point at the embedded link rather than the start of the node
+  u32 pointerBias = 0;
+  std::vector<WalkField> fields;
+  u32 maxNodes = 1024;
+};
+
+struct WalkResult
+{
+  // Nodes in visiting order
+  std::vector<u32> addresses;
+  // Index of the node each was reached from, -1 for start nodes
+  std::vector<s32> parents;
+  // fields.size() values per node, in node order
+  std::vector<double> values;
+  u32 levels = 0;
+  u32 batches = 0;
+  // Links that led back to a node already visited: a cycle in a list, a shared node in a graph.
+  // The node isn't visited again.
+  u32 revisits = 0;
+  // Pointers outside MEM1/MEM2, and nodes whose memory couldn't be read; neither is followed
+  u32 invalidPointers = 0;
+  u32 unreadableNodes = 0;
+  // maxNodes cut the walk short
+  bool truncated = false;
+  // Nodes were read in place rather than through the backend
+  bool direct = false;
+};
+
+// Largest span of one node (the distance from its first to the end of its last field or link)
+constexpr u32 WALK_MAX_NODE_SPAN = 64 * 1024;
+constexpr u32 WALK_MAX_NODES = 1 << 20;
+
+bool validateWalkSpec(const WalkSpec& spec, const char*& error);
+// The spec must have passed validateWalkSpec. False if an indirect start's pointer table can't be
+// read; null and invalid pointers are not errors, they just end that branch.
+bool walkStructure(IDolphinProcess& process, const WalkSpec& spec, WalkResult& result);
+}  // namespace DolphinComm
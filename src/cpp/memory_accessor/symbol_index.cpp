@@ -0,0 +1,435 @@
+#include "symbol_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <sys/stat.h>
+
+#include "executor.h"
+#include "mapped_file.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr u32 SYMBOL_CACHE_VERSION = 1;
+// Small enough to spread a typical 2-5 MB map across every worker
+constexpr size_t PARSE_CHUNK_SIZE = 256 * 1024;
+constexpr std::string_view SECTION_LAYOUT = "section layout";
+
+struct SymbolCacheHeader
+{
+  char magic[8];
+  u32 version;
+  u32 symbolCount;
+  u64 sourceSize;
+  s64 sourceMtime;
+  u32 namesSize;
+  u32 sectionCount;
+  u32 sectionNamesSize;
+  u32 reserved;
+};
+
+bool statSource(const std::string& path, u64& size, s64& mtime)
+{
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0)
+    return false;
+  size = static_cast<u64>(info.st_size);
+  mtime = static_cast<s64>(info.st_mtime);
+  return true;
+}
+
+bool parseHex(std::string_view token, u32& value)
+{
+  if (token.empty() || token.size() > 8)
+    return false;
+  value = 0;
+  for (char c : token)
+  {
+    u32 digit;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      return false;
+    value = (value << 4) | digit;
+  }
+  return true;
+}
+
+bool isDecimal(std::string_view token)
+{
+  return !token.empty() &&
+         std::all_of(token.begin(), token.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+size_t splitTokens(std::string_view line, std::string_view* tokens, size_t maxTokens)
+{
+  size_t count = 0;
+  size_t pos = 0;
+  while (count < maxTokens)
+  {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r'))
+      ++pos;
+    if (pos >= line.size())
+      break;
+    size_t end = pos;
+    while (end < line.size() && line[end] != ' ' && line[end] != '\t' && line[end] != '\r')
+      ++end;
+    tokens[count++] = line.substr(pos, end - pos);
+    pos = end;
+  }
+  return count;
+}
+
+// Accepts the column layouts found in the wild:
+//   CodeWarrior:  00000000 000020 80003100  4 __check_pad3 	Pad.c
+//   Dolphin:      80003100 00000034 80003100 0 __start
+//   Short forms:  80003100 00000034 __start   /   80003100 __start
+bool parseSymbolLine(std::string_view line, u32& address, u32& size, std::string_view& name)
+{
+  std::string_view tokens[5];
+  size_t count = splitTokens(line, tokens, 5);
+  if (count < 2 || tokens[0] == "UNUSED")
+    return false;
+
+  u32 first, second, third;
+  if (!parseHex(tokens[0], first))
+    return false;
+  bool secondHex = parseHex(tokens[1], second);
+
+  if (count >= 4 && secondHex && parseHex(tokens[2], third))
+  {
+    address = third;
+    size = second;
+    name = count >= 5 && isDecimal(tokens[3]) ? tokens[4] : tokens[3];
+  }
+  else if (count >= 3 && secondHex)
+  {
+    address = first;
+    size = second;
+    name = tokens[2];
+  }
+  else if (tokens[0].size() == 8)
+  {
+    address = first;
+    size = 0;
+    name = tokens[1];
+  }
+  else
+  {
+    return false;
+  }
+  // Only keep symbols that live at guest virtual addresses
+  return address >= 0x80000000;
+}
+}  // namespace
+
+void SymbolIndex::clear()
+{
+  m_starts.clear();
+  m_sizes.clear();
+  m_maxEnds.clear();
+  m_nameOffsets.clear();
+  m_sections.clear();
+  m_byName.clear();
+  m_names.clear();
+  m_sectionNames.clear();
+}
+
+bool SymbolIndex::loadMap(const std::string& path)
+{
+  clear();
+  Common::MappedFile file;
+  if (!file.openReadOnly(path))
+    return false;
+  std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+
+  // Section headers ("  .text section layout") are found up front so every chunk knows which
+  // section it starts in. Section 0 is "no section yet".
+  std::vector<size_t> sectionStarts{0};
+  m_sectionNames.push_back("");
+  for (size_t pos = text.find(SECTION_LAYOUT); pos != std::string_view::npos;
+       pos = text.find(SECTION_LAYOUT, pos + SECTION_LAYOUT.size()))
+  {
+    size_t lineStart = text.rfind('\n', pos);
+    lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+    std::string_view tokens[1];
+    if (m_sectionNames.size() < 256 &&
+        splitTokens(text.substr(lineStart, pos - lineStart), tokens, 1) == 1)
+    {
+      sectionStarts.push_back(lineStart);
+      m_sectionNames.emplace_back(tokens[0]);
+    }
+  }
+
+  std::vector<size_t> chunkStarts{0};
+  while (chunkStarts.back() + PARSE_CHUNK_SIZE < text.size())
+  {
+    size_t next = text.find('\n', chunkStarts.back() + PARSE_CHUNK_SIZE);
+    if (next == std::string_view::npos)
+      break;
+    chunkStarts.push_back(next + 1);
+  }
+  chunkStarts.push_back(text.size());
+
+  struct Chunk
+  {
+    std::vector<ParsedSymbol> symbols;
+    std::vector<char> names;
+  };
+  std::vector<Chunk> chunks(chunkStarts.size() - 1);
+
+  Common::Executor::shared().parallelFor(chunks.size(), [&](size_t i) {
+    Chunk& chunk = chunks[i];
+    size_t pos = chunkStarts[i];
+    const size_t end = chunkStarts[i + 1];
+    size_t section = std::upper_bound(sectionStarts.begin(), sectionStarts.end(), pos) -
+                     sectionStarts.begin() - 1;
+
+    while (pos < end)
+    {
+      size_t lineEnd = text.find('\n', pos);
+      if (lineEnd == std::string_view::npos || lineEnd > end)
+        lineEnd = end;
+      std::string_view line = text.substr(pos, lineEnd - pos);
+
+      if (section + 1 < sectionStarts.size() && sectionStarts[section + 1] == pos)
+      {
+        ++section;
+      }
+      else
+      {
+        u32 address, size;
+        std::string_view name;
+        if (parseSymbolLine(line, address, size, name))
+        {
+          chunk.symbols.push_back({address, size, static_cast<u32>(chunk.names.size()),
+                                   static_cast<u8>(section)});
+          chunk.names.insert(chunk.names.end(), name.begin(), name.end());
+          chunk.names.push_back('\0');
+        }
+      }
+      pos = lineEnd + 1;
+    }
+  });
+
+  std::vector<ParsedSymbol> symbols;
+  std::vector<char> names;
+  for (Chunk& chunk : chunks)
+  {
+    u32 nameBase = static_cast<u32>(names.size());
+    for (ParsedSymbol& symbol : chunk.symbols)
+    {
+      symbol.nameOffset += nameBase;
+      symbols.push_back(symbol);
+    }
+    names.insert(names.end(), chunk.names.begin(), chunk.names.end());
+  }
+
+  build(symbols, names);
+  return true;
+}
+
+void SymbolIndex::build(std::vector<ParsedSymbol>& symbols, std::vector<char>& names)
+{
+  // Containers sort before what they contain, so walking back from the end of an address run
+  // finds the innermost symbol first
+  std::sort(symbols.begin(), symbols.end(), [](const ParsedSymbol& a, const ParsedSymbol& b) {
+    return a.address != b.address ? a.address < b.address : a.size > b.size;
+  });
+
+  m_names = std::move(names);
+  m_starts.resize(symbols.size());
+  m_sizes.resize(symbols.size());
+  m_maxEnds.resize(symbols.size());
+  m_nameOffsets.resize(symbols.size());
+  m_sections.resize(symbols.size());
+
+  u32 maxEnd = 0;
+  for (size_t i = 0; i < symbols.size(); ++i)
+  {
+    m_starts[i] = symbols[i].address;
+    m_sizes[i] = symbols[i].size;
+    m_nameOffsets[i] = symbols[i].nameOffset;
+    m_sections[i] = symbols[i].section;
+    // Zero-sized symbols still cover their own address
+    u64 end = static_cast<u64>(symbols[i].address) + std::max<u32>(symbols[i].size, 1);
+    maxEnd = std::max(maxEnd, static_cast<u32>(std::min<u64>(end, 0xFFFFFFFF)));
+    m_maxEnds[i] = maxEnd;
+  }
+
+  m_byName.resize(symbols.size());
+  for (u32 i = 0; i < m_byName.size(); ++i)
+    m_byName[i] = i;
+  std::sort(m_byName.begin(), m_byName.end(), [this](u32 a, u32 b) {
+    int order = std::strcmp(m_names.data() + m_nameOffsets[a], m_names.data() + m_nameOffsets[b]);
+    return order != 0 ? order < 0 : a < b;
+  });
+}
+
+SymbolInfo SymbolIndex::symbol(u32 index) const
+{
+  return {m_starts[index], m_sizes[index], nameAt(m_nameOffsets[index]),
+          m_sections[index] < m_sectionNames.size() ? std::string_view(m_sectionNames[m_sections[index]]) :
+                                                      std::string_view()};
+}
+
+u32 SymbolIndex::lookup(u32 address) const
+{
+  auto it = std::upper_bound(m_starts.begin(), m_starts.end(), address);
+  if (it == m_starts.begin())
+    return NO_SYMBOL;
+
+  size_t i = it - m_starts.begin() - 1;
+  while (true)
+  {
+    if (address - m_starts[i] < std::max<u32>(m_sizes[i], 1))
+      return static_cast<u32>(i);
+    if (i == 0 || m_maxEnds[i - 1] <= address)
+      return NO_SYMBOL;
+    --i;
+  }
+}
+
+void SymbolIndex::lookupAll(const u32* addresses, u32* symbols, size_t count) const
+{
+  for (size_t i = 0; i < count; ++i)
+    symbols[i] = lookup(addresses[i]);
+}
+
+std::vector<u32> SymbolIndex::findByName(std::string_view name) const
+{
+  auto range = std::equal_range(
+      m_byName.begin(), m_byName.end(), name, [this](const auto& a, const auto& b) {
+        using T = std::decay_t<decltype(a)>;
+        if constexpr (std::is_same_v<T, u32>)
+          return nameAt(m_nameOffsets[a]) < b;
+        else
+          return a < nameAt(m_nameOffsets[b]);
+      });
+  return std::vector<u32>(range.first, range.second);
+}
+
+bool SymbolIndex::saveCache(const std::string& cachePath, const std::string& sourcePath) const
+{
+  SymbolCacheHeader header{};
+  std::memcpy(header.magic, SYMBOL_CACHE_MAGIC, sizeof(SYMBOL_CACHE_MAGIC));
+  header.version = SYMBOL_CACHE_VERSION;
+  if (!statSource(sourcePath, header.sourceSize, header.sourceMtime))
+    return false;
+  header.symbolCount = static_cast<u32>(m_starts.size());
+  header.namesSize = static_cast<u32>(m_names.size());
+  header.sectionCount = static_cast<u32>(m_sectionNames.size());
+
+  std::vector<char> sectionNames;
+  for (const std::string& section : m_sectionNames)
+    sectionNames.insert(sectionNames.end(), section.c_str(), section.c_str() + section.size() + 1);
+  header.sectionNamesSize = static_cast<u32>(sectionNames.size());
+
+  // Write to a temporary file first so a crash never leaves a truncated cache behind
+  std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    auto writeArray = [&out](const auto& array) {
+      out.write(reinterpret_cast<const char*>(array.data()),
+                array.size() * sizeof(typename std::decay_t<decltype(array)>::value_type));
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(m_starts);
+    writeArray(m_sizes);
+    writeArray(m_maxEnds);
+    writeArray(m_nameOffsets);
+    writeArray(m_byName);
+    writeArray(m_sections);
+    writeArray(m_names);
+    writeArray(sectionNames);
+    if (!out)
+      return false;
+  }
+  return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+
+bool SymbolIndex::loadCache(const std::string& cachePath, const std::string& sourcePath)
+{
+  clear();
+  u64 sourceSize;
+  s64 sourceMtime;
+  Common::MappedFile file;
+  if (!statSource(sourcePath, sourceSize, sourceMtime) || !file.openReadOnly(cachePath) ||
+      file.size() < sizeof(SymbolCacheHeader))
+    return false;
+
+  SymbolCacheHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  const size_t count = header.symbolCount;
+  const size_t expectedSize = sizeof(header) + count * (5 * sizeof(u32) + sizeof(u8)) +
+                              header.namesSize + header.sectionNamesSize;
+  if (std::memcmp(header.magic, SYMBOL_CACHE_MAGIC, sizeof(SYMBOL_CACHE_MAGIC)) != 0 ||
+      header.version != SYMBOL_CACHE_VERSION || header.sourceSize != sourceSize ||
+      header.sourceMtime != sourceMtime || file.size() != expectedSize)
+    return false;
+
+  const u8* pos = file.data() + sizeof(header);
+  auto readArray = [&pos](auto& array, size_t elements) {
+    array.resize(elements);
+    size_t bytes = elements * sizeof(typename std::decay_t<decltype(array)>::value_type);
+    std::memcpy(array.data(), pos, bytes);
+    pos += bytes;
+  };
+  readArray(m_starts, count);
+  readArray(m_sizes, count);
+  readArray(m_maxEnds, count);
+  readArray(m_nameOffsets, count);
+  readArray(m_byName, count);
+  readArray(m_sections, count);
+  readArray(m_names, header.namesSize);
+
+  const char* sectionName = reinterpret_cast<const char*>(pos);
+  const char* sectionEnd = sectionName + header.sectionNamesSize;
+  for (u32 i = 0; i < header.sectionCount && sectionName < sectionEnd; ++i)
+  {
+    m_sectionNames.emplace_back(sectionName, strnlen(sectionName, sectionEnd - sectionName));
+    sectionName += m_sectionNames.back().size() + 1;
+  }
+
+  // A cache with names running off the end of the pool, or indices past the symbols or sections,
+  // is corrupt
+  if (!m_names.empty() && m_names.back() != '\0')
+  {
+    clear();
+    return false;
+  }
+  for (u32 offset : m_nameOffsets)
+  {
+    if (offset >= m_names.size())
+    {
+      clear();
+      return false;
+    }
+  }
+  for (u32 index : m_byName)
+  {
+    if (index >= count)
+    {
+      clear();
+      return false;
+    }
+  }
+  for (u8 section : m_sections)
+  {
+    if (section >= m_sectionNames.size())
+    {
+      clear();
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common_types.h"
+
+// Address <-> symbol index built from linker/Dolphin .map files.
+//
+// Symbols are kept sorted by address as parallel arrays, so the binary search in lookup() only
+// touches the start addresses. Map files nest entries (an object file's section entry covers the
+// functions inside it), so each entry also stores the furthest end address of any symbol up to
+// and including it; lookup() walks back from the search position while that bound still covers
+// the address and returns the innermost containing symbol.
+//
+// The index can be saved to a binary cache (magic "DABSYM01") that is a straight dump of the
+// arrays, tagged with the size and mtime of the source map so stale caches are ignored.
+namespace DolphinComm
+{
+constexpr char SYMBOL_CACHE_MAGIC[8] = {'D', 'A', 'B', 'S', 'Y', 'M', '0', '1'};
+constexpr u32 NO_SYMBOL = 0xFFFFFFFF;
+
+struct SymbolInfo
+{
+  u32 address;
+  u32 size;
+  std::string_view name;
+  std::string_view section;
+};
+
+class SymbolIndex
+{
+public:
+  // Parses a .map file (CodeWarrior linker maps and Dolphin's own symbol map export), splitting
+  // the file across the shared executor
+  bool loadMap(const std::string& path);
+  bool loadCache(const std::string& cachePath, const std::string& sourcePath);
+  bool saveCache(const std::string& cachePath, const std::string& sourcePath) const;
+  void clear();
+
+  size_t size() const { return m_starts.size(); }
+  SymbolInfo symbol(u32 index) const;
+
+  // Innermost symbol containing address, or NO_SYMBOL. Zero-sized symbols only match their own
+  // address.
+  u32 lookup(u32 address) const;
+  // Bulk lookup; symbols[i] is NO_SYMBOL where nothing contains addresses[i]
+  void lookupAll(const u32* addresses, u32* symbols, size_t count) const;
+  // Every symbol with exactly this name (static functions may repeat), sorted by address
+  std::vector<u32> findByName(std::string_view name) const;
+
+private:
+  struct ParsedSymbol
+  {
+    u32 address;
+    u32 size;
+    u32 nameOffset;
+    u8 section;
+  };
+
+  void build(std::vector<ParsedSymbol>& symbols, std::vector<char>& names);
+  std::string_view nameAt(u32 offset) const { return std::string_view(m_names.data() + offset); }
+
+  std::vector<u32> m_starts;
+  std::vector<u32> m_sizes;
+  std::vector<u32> m_maxEnds;
+  std::vector<u32> m_nameOffsets;
+  std::vector<u8> m_sections;
+  // Symbol indices sorted by name, for findByName
+  std::vector<u32> m_byName;
+  // NUL-terminated names
+  std::vector<char> m_names;
+  std::vector<std::string> m_sectionNames;
+};
+}  // namespace DolphinComm
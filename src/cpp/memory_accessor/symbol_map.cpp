@@ -0,0 +1,173 @@
+#include "symbol_map.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+Napi::FunctionReference SymbolMap::constructor;
+
+Napi::Object SymbolMap::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "SymbolMap", {
+    InstanceMethod("getInfo", &SymbolMap::GetInfo),
+    InstanceMethod("lookup", &SymbolMap::Lookup),
+    InstanceMethod("find", &SymbolMap::Find),
+    InstanceMethod("annotate", &SymbolMap::Annotate),
+    InstanceMethod("saveCache", &SymbolMap::SaveCache),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("SymbolMap", func);
+  return exports;
+}
+
+// new SymbolMap(mapPath, cachePath?). With a cache path, a cache matching the map's size and
+// mtime is loaded instead of parsing, and a fresh one is written after parsing.
+SymbolMap::SymbolMap(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<SymbolMap>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Map path expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  m_path = info[0].As<Napi::String>().Utf8Value();
+  std::string cachePath = info.Length() >= 2 && info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : "";
+
+  auto start = std::chrono::steady_clock::now();
+  m_fromCache = !cachePath.empty() && m_index.loadCache(cachePath, m_path);
+  if (!m_fromCache) {
+    if (!m_index.loadMap(m_path)) {
+      Napi::Error::New(env, "SymbolMap: Failed to read map " + m_path).ThrowAsJavaScriptException();
+      return;
+    }
+    if (!cachePath.empty() && !m_index.saveCache(cachePath, m_path))
+      std::cerr << "## Failed to write symbol cache " << cachePath << "\n";
+  }
+  m_loadMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const DolphinComm::SymbolIndex* SymbolMap::indexOf(Napi::Value value) {
+  if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor.Value()))
+    return nullptr;
+  return &Unwrap(value.As<Napi::Object>())->m_index;
+}
+
+Napi::Object SymbolMap::symbolObject(Napi::Env env, u32 index) {
+  DolphinComm::SymbolInfo symbol = m_index.symbol(index);
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("name", Napi::String::New(env, symbol.name.data(), symbol.name.size()));
+  result.Set("address", Napi::Number::New(env, symbol.address));
+  result.Set("size", Napi::Number::New(env, symbol.size));
+  result.Set("section", Napi::String::New(env, symbol.section.data(), symbol.section.size()));
+  return result;
+}
+
+Napi::Value SymbolMap::GetInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("path", Napi::String::New(env, m_path));
+  result.Set("symbols", Napi::Number::New(env, static_cast<double>(m_index.size())));
+  result.Set("fromCache", Napi::Boolean::New(env, m_fromCache));
+  result.Set("loadMillis", Napi::Number::New(env, m_loadMillis));
+  return result;
+}
+
+// lookup(address) => { name, address, size, section, offset } | null
+Napi::Value SymbolMap::Lookup(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "Address expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  u32 address = info[0].As<Napi::Number>().Uint32Value();
+  u32 index = m_index.lookup(address);
+  if (index == DolphinComm::NO_SYMBOL)
+    return env.Null();
+
+  Napi::Object result = symbolObject(env, index);
+  result.Set("offset", Napi::Number::New(env, address - m_index.symbol(index).address));
+  return result;
+}
+
+// find(name) => [{ name, address, size, section }]
+Napi::Value SymbolMap::Find(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Symbol name expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<u32> matches = m_index.findByName(info[0].As<Napi::String>().Utf8Value());
+  Napi::Array result = Napi::Array::New(env, matches.size());
+  for (uint32_t i = 0; i < matches.size(); i++)
+    result.Set(i, symbolObject(env, matches[i]));
+  return result;
+}
+
+// annotate(addresses: Uint32Array | number[]) => Array<string | null>, "name" or "name+0x1c"
+Napi::Value SymbolMap::Annotate(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::vector<u32> addresses;
+  if (info.Length() >= 1 && info[0].IsTypedArray() &&
+      info[0].As<Napi::TypedArray>().TypedArrayType() == napi_uint32_array) {
+    Napi::Uint32Array array = info[0].As<Napi::Uint32Array>();
+    addresses.assign(array.Data(), array.Data() + array.ElementLength());
+  } else if (info.Length() >= 1 && info[0].IsArray()) {
+    Napi::Array array = info[0].As<Napi::Array>();
+    addresses.resize(array.Length());
+    for (uint32_t i = 0; i < array.Length(); i++)
+      addresses[i] = array.Get(i).ToNumber().Uint32Value();
+  } else {
+    Napi::TypeError::New(env, "Uint32Array or array of addresses expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<u32> symbols(addresses.size());
+  m_index.lookupAll(addresses.data(), symbols.data(), addresses.size());
+
+  Napi::Array result = Napi::Array::New(env, addresses.size());
+  std::string label;
+  for (uint32_t i = 0; i < addresses.size(); i++) {
+    if (symbols[i] == DolphinComm::NO_SYMBOL) {
+      result.Set(i, env.Null());
+      continue;
+    }
+    DolphinComm::SymbolInfo symbol = m_index.symbol(symbols[i]);
+    label.assign(symbol.name);
+    if (addresses[i] != symbol.address) {
+      char offset[16];
+      std::snprintf(offset, sizeof(offset), "+0x%x", addresses[i] - symbol.address);
+      label += offset;
+    }
+    result.Set(i, Napi::String::New(env, label));
+  }
+  return result;
+}
+
+Napi::Value SymbolMap::SaveCache(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Cache path expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Boolean::New(env, m_index.saveCache(info[0].As<Napi::String>().Utf8Value(), m_path));
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <napi.h>
+
+#include "symbol_index.h"
+
+// JS handle on a loaded symbol map: name <-> address lookups and bulk annotation of addresses
+// (scan results, pointer chains).
+class SymbolMap : public Napi::ObjectWrap<SymbolMap> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  SymbolMap(const Napi::CallbackInfo& info);
+
+  // The index behind value if it is a SymbolMap, else null
+  static const DolphinComm::SymbolIndex* indexOf(Napi::Value value);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Object symbolObject(Napi::Env env, u32 index);
+
+  Napi::Value GetInfo(const Napi::CallbackInfo& info);
+  Napi::Value Lookup(const Napi::CallbackInfo& info);
+  Napi::Value Find(const Napi::CallbackInfo& info);
+  Napi::Value Annotate(const Napi::CallbackInfo& info);
+  Napi::Value SaveCache(const Napi::CallbackInfo& info);
+
+  DolphinComm::SymbolIndex m_index;
+  std::string m_path;
+  bool m_fromCache = false;
+  double m_loadMillis = 0;
+};
@@ -0,0 +1,139 @@
+#include "telemetry_encoder.h"
+
+#include <cstring>
+
+#include "varint.h"
+
+namespace DolphinComm
+{
+namespace
+{
+bool isIntegerType(Common::MemType type)
+{
+  return type == Common::MemType::type_byte || type == Common::MemType::type_halfword ||
+         type == Common::MemType::type_word;
+}
+
+// Guest integers are big endian
+u32 readInteger(const u8* value, u32 size)
+{
+  u32 result = 0;
+  for (u32 i = 0; i < size; ++i)
+    result = result << 8 | value[i];
+  return result;
+}
+}  // namespace
+
+bool TelemetryEncoder::setFields(std::vector<TelemetryField> fields, u32 schemaId)
+{
+  m_fields.clear();
+  m_sampleOffsets.clear();
+  m_sampleSize = 0;
+  m_previous.clear();
+  m_hasPrevious = false;
+  m_sequence = 0;
+  if (fields.empty())
+    return false;
+
+  // FNV-1a over the resolved field list, so the same watches always get the same id
+  u32 hash = 2166136261u;
+  auto mix = [&hash](u32 value) {
+    for (int i = 0; i < 4; ++i)
+    {
+      hash ^= (value >> (i * 8)) & 0xFF;
+      hash *= 16777619u;
+    }
+  };
+
+  for (TelemetryField& field : fields)
+  {
+    field.size = static_cast<u32>(Common::getSizeForType(field.type, field.size));
+    if (field.size == 0 || field.size > TELEMETRY_MAX_VALUE_SIZE)
+      return false;
+    m_sampleOffsets.push_back(m_sampleSize);
+    m_sampleSize += field.size;
+    mix(field.offset);
+    mix(static_cast<u32>(field.type));
+    mix(field.size);
+  }
+
+  m_fields = std::move(fields);
+  m_schemaId = schemaId != 0 ? schemaId : hash;
+  m_previous.resize(m_sampleSize);
+  return true;
+}
+
+void TelemetryEncoder::encodeValue(const TelemetryField& field, const u8* value,
+                                   const u8* previous, std::vector<u8>& out) const
+{
+  switch (field.type)
+  {
+  case Common::MemType::type_byte:
+  case Common::MemType::type_halfword:
+  case Common::MemType::type_word:
+  {
+    const u32 current = readInteger(value, field.size);
+    if (!previous)
+      Common::putVarint(out, current);
+    else
+      Common::putVarint(out, Common::zigzagEncode(static_cast<s64>(current) -
+                                                  static_cast<s64>(readInteger(previous, field.size))));
+    break;
+  }
+  case Common::MemType::type_float:
+  case Common::MemType::type_double:
+    // Big endian in guest memory, little endian on the wire
+    for (u32 i = field.size; i > 0; --i)
+      out.push_back(value[i - 1]);
+    break;
+  case Common::MemType::type_string:
+  {
+    const void* terminator = std::memchr(value, 0, field.size);
+    const size_t length = terminator ? static_cast<const u8*>(terminator) - value : field.size;
+    Common::putVarint(out, length);
+    out.insert(out.end(), value, value + length);
+    break;
+  }
+  default:
+    out.insert(out.end(), value, value + field.size);
+    break;
+  }
+}
+
+bool TelemetryEncoder::encode(const u8* sample, u64 timestampMs, bool keyframe, std::vector<u8>& out)
+{
+  keyframe = keyframe || !m_hasPrevious;
+  out.push_back(keyframe ? TELEMETRY_KEYFRAME : 0);
+  Common::putVarint(out, m_schemaId);
+  Common::putVarint(out, m_sequence++);
+  Common::putVarint(out, keyframe ? timestampMs
+                                  : (timestampMs >= m_lastTimestamp ? timestampMs - m_lastTimestamp : 0));
+  m_lastTimestamp = timestampMs;
+
+  if (keyframe)
+  {
+    for (size_t i = 0; i < m_fields.size(); ++i)
+      encodeValue(m_fields[i], sample + m_sampleOffsets[i], nullptr, out);
+  }
+  else
+  {
+    // Reserve the changed bitmap, fill it in as fields are compared
+    const size_t bitmapStart = out.size();
+    out.resize(out.size() + (m_fields.size() + 7) / 8, 0);
+    for (size_t i = 0; i < m_fields.size(); ++i)
+    {
+      const TelemetryField& field = m_fields[i];
+      const u8* value = sample + m_sampleOffsets[i];
+      const u8* previous = m_previous.data() + m_sampleOffsets[i];
+      if (std::memcmp(value, previous, field.size) == 0)
+        continue;
+      out[bitmapStart + i / 8] |= 1 << (i % 8);
+      encodeValue(field, value, isIntegerType(field.type) ? previous : nullptr, out);
+    }
+  }
+
+  std::memcpy(m_previous.data(), sample, m_sampleSize);
+  m_hasPrevious = true;
+  return keyframe;
+}
+}  // namespace DolphinComm
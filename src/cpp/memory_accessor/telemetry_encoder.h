@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common_types.h"
+#include "memory_common.h"
+
+// Compact frames of watched values for streaming to dashboards. The matching decoder is
+// src/ts/dolphin/telemetry-decoder.ts. A frame is:
+//
+//   u8      flags            bit 0: keyframe
+//   varint  schemaId         identifies the field list; clients drop frames of unknown schemas
+//   varint  sequence         +1 per frame; a gap means a delta frame was lost, wait for a keyframe
+//   varint  timestamp        keyframe: milliseconds since the epoch, otherwise the delta in ms
+//   u8[]    changed          delta frames only: ceil(fields / 8) bytes, bit i % 8 of byte i / 8
+//                            set if field i is present
+//   values                   one per present field, in field order
+//
+// Values by type:
+//   byte, halfword, word     keyframe: varint of the unsigned value; delta frame: zigzag varint
+//                            of value - previous value
+//   float, double            raw IEEE 754, little endian
+//   string                   varint length (up to the first NUL) then the bytes
+//   byteArray                the field's size in raw bytes
+//
+// Varints are unsigned LEB128, zigzag is (n << 1) ^ (n >> 63).
+namespace DolphinComm
+{
+constexpr u32 TELEMETRY_MAX_VALUE_SIZE = 4096;
+
+enum TelemetryFrameFlags : u8
+{
+  TELEMETRY_KEYFRAME = 1
+};
+
+struct TelemetryField
+{
+  // Offset as produced by Common::dolphinAddrToOffset (MEM1 at 0, MEM2 at 0x10000000)
+  u32 offset;
+  Common::MemType type;
+  // Resolved by setFields; only read for string and byteArray
+  u32 size;
+};
+
+class TelemetryEncoder
+{
+public:
+  // Resolves field sizes and derives a schema id from the fields unless one is given (non-zero).
+  // Fails on an empty list or a field of size 0 or above TELEMETRY_MAX_VALUE_SIZE.
+  bool setFields(std::vector<TelemetryField> fields, u32 schemaId = 0);
+
+  const std::vector<TelemetryField>& fields() const { return m_fields; }
+  // Offset of each field in a sample
+  const std::vector<size_t>& sampleOffsets() const { return m_sampleOffsets; }
+  size_t sampleSize() const { return m_sampleSize; }
+  u32 schemaId() const { return m_schemaId; }
+  u64 sequence() const { return m_sequence; }
+
+  // Appends one frame to out. sample holds every field's bytes as read from guest memory (big
+  // endian), back to back in field order. The first frame, and any after reset(), is a keyframe.
+  // Returns whether the frame was a keyframe.
+  bool encode(const u8* sample, u64 timestampMs, bool keyframe, std::vector<u8>& out);
+  // Makes the next frame a keyframe, e.g. when a client joins or a frame was dropped
+  void reset() { m_hasPrevious = false; }
+
+private:
+  void encodeValue(const TelemetryField& field, const u8* value, const u8* previous,
+                   std::vector<u8>& out) const;
+
+  std::vector<TelemetryField> m_fields;
+  std::vector<size_t> m_sampleOffsets;
+  size_t m_sampleSize = 0;
+  u32 m_schemaId = 0;
+
+  std::vector<u8> m_previous;
+  bool m_hasPrevious = false;
+  u64 m_sequence = 0;
+  u64 m_lastTimestamp = 0;
+};
+}  // namespace DolphinComm
@@ -0,0 +1,274 @@
+#include "telemetry_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+// Watches closer than this are merged into one read
+constexpr u32 kCoalesceGap = 64;
+// Frames waiting for the JS thread; past this the stream drops frames instead of queueing them
+constexpr size_t kMaxQueuedFrames = 8;
+
+const char* const kTypeNames[] = {"byte", "halfword", "word", "float", "double", "string", "byteArray"};
+
+u64 nowMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+Napi::FunctionReference TelemetryStream::constructor;
+
+Napi::Object TelemetryStream::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "TelemetryStream", {
+    InstanceMethod("getSchema", &TelemetryStream::GetSchema),
+    InstanceMethod("encode", &TelemetryStream::Encode),
+    InstanceMethod("start", &TelemetryStream::Start),
+    InstanceMethod("stop", &TelemetryStream::Stop),
+    InstanceMethod("requestKeyframe", &TelemetryStream::RequestKeyframe),
+    InstanceMethod("getStats", &TelemetryStream::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("TelemetryStream", func);
+  return exports;
+}
+
+// new TelemetryStream(accessor, [{ offset, type, length? }], { schemaId?, keyframeInterval? })
+TelemetryStream::TelemetryStream(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<TelemetryStream>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray()) {
+    Napi::TypeError::New(env, "MemoryAccessor and watch list arguments expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  Napi::Array watches = info[1].As<Napi::Array>();
+  std::vector<DolphinComm::TelemetryField> fields;
+  for (uint32_t i = 0; i < watches.Length(); i++) {
+    Napi::Value entry = watches.Get(i);
+    DolphinComm::TelemetryField field{0, Common::MemType::type_word, 0};
+    if (!entry.IsObject() || !NapiUtils::getU32(entry.As<Napi::Object>(), "offset", field.offset) ||
+        !NapiUtils::parseMemType(entry.As<Napi::Object>().Get("type"), field.type)) {
+      Napi::TypeError::New(env, "Each watch needs a numeric offset and a MemType").ThrowAsJavaScriptException();
+      return;
+    }
+    field.size = NapiUtils::getU32Or(entry.As<Napi::Object>(), "length", 0);
+    fields.push_back(field);
+  }
+
+  u32 schemaId = 0;
+  if (info.Length() >= 3 && info[2].IsObject()) {
+    Napi::Object options = info[2].As<Napi::Object>();
+    schemaId = NapiUtils::getU32Or(options, "schemaId", 0);
+    m_keyframeInterval = NapiUtils::getU32Or(options, "keyframeInterval", 0);
+  }
+
+  if (!m_encoder.setFields(std::move(fields), schemaId)) {
+    Napi::RangeError::New(env, "TelemetryStream: Watch list is empty or a watch is too large").ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Sort watches by offset and merge neighbours into spans
+  const std::vector<DolphinComm::TelemetryField>& resolved = m_encoder.fields();
+  std::vector<size_t> order(resolved.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return resolved[a].offset < resolved[b].offset; });
+
+  size_t bufferSize = 0;
+  for (size_t index : order) {
+    const DolphinComm::TelemetryField& field = resolved[index];
+    if (m_spans.empty() || field.offset > m_spans.back().offset + m_spans.back().size + kCoalesceGap) {
+      m_spans.push_back({field.offset, field.size, bufferSize});
+      bufferSize += field.size;
+    } else {
+      ReadSpan& span = m_spans.back();
+      u32 end = std::max(span.offset + span.size, field.offset + field.size);
+      bufferSize += end - (span.offset + span.size);
+      span.size = end - span.offset;
+    }
+    const ReadSpan& span = m_spans.back();
+    m_copies.push_back({span.bufferOffset + (field.offset - span.offset), m_encoder.sampleOffsets()[index], field.size});
+  }
+
+  m_spanBuffer.resize(bufferSize);
+  m_sample.resize(m_encoder.sampleSize());
+  for (const ReadSpan& span : m_spans)
+    m_requests.push_back({span.offset, span.size, reinterpret_cast<char*>(m_spanBuffer.data() + span.bufferOffset), false});
+}
+
+TelemetryStream::~TelemetryStream() {
+  stopThread();
+}
+
+bool TelemetryStream::produceFrame(bool keyframe, std::vector<u8>& out) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto start = std::chrono::steady_clock::now();
+  if (m_process->readBatch(m_requests.data(), m_requests.size()) != m_requests.size()) {
+    m_failedReads++;
+    return false;
+  }
+  for (const FieldCopy& copy : m_copies)
+    std::memcpy(m_sample.data() + copy.sampleOffset, m_spanBuffer.data() + copy.spanBufferOffset, copy.size);
+
+  keyframe = keyframe || m_keyframeRequested ||
+             (m_keyframeInterval != 0 && m_encoder.sequence() % m_keyframeInterval == 0);
+  m_keyframeRequested = false;
+  if (m_encoder.encode(m_sample.data(), nowMillis(), keyframe, out))
+    m_keyframes++;
+  m_frames++;
+  m_bytes += out.size();
+  m_lastEncodeNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return true;
+}
+
+void TelemetryStream::run(u32 intervalMs) {
+  auto next = std::chrono::steady_clock::now();
+  while (m_running) {
+    auto* frame = new std::vector<u8>();
+    if (produceFrame(false, *frame)) {
+      napi_status status = m_callback.NonBlockingCall(frame, [](Napi::Env env, Napi::Function callback, std::vector<u8>* data) {
+        if (env != nullptr && callback != nullptr)
+          callback.Call({Napi::Buffer<u8>::Copy(env, data->data(), data->size())});
+        delete data;
+      });
+      if (status != napi_ok) {
+        delete frame;
+        // Clients would apply the next delta on top of a frame they never saw
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_droppedFrames++;
+        m_encoder.reset();
+      }
+    } else {
+      delete frame;
+    }
+
+    next += std::chrono::milliseconds(intervalMs);
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void TelemetryStream::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable()) {
+    m_thread.join();
+    m_callback.Release();
+  }
+}
+
+// getSchema() => { schemaId, fields: [{ offset, type, length }] }; send to clients before frames
+Napi::Value TelemetryStream::GetSchema(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  const auto& fields = m_encoder.fields();
+  Napi::Array fieldArray = Napi::Array::New(env, fields.size());
+  for (uint32_t i = 0; i < fields.size(); i++) {
+    Napi::Object field = Napi::Object::New(env);
+    field.Set("offset", Napi::Number::New(env, fields[i].offset));
+    field.Set("type", Napi::String::New(env, kTypeNames[static_cast<int>(fields[i].type)]));
+    field.Set("length", Napi::Number::New(env, fields[i].size));
+    fieldArray.Set(i, field);
+  }
+
+  Napi::Object schema = Napi::Object::New(env);
+  schema.Set("schemaId", Napi::Number::New(env, m_encoder.schemaId()));
+  schema.Set("fields", fieldArray);
+  return schema;
+}
+
+// encode(keyframe?) => Buffer, or null if the read failed. Not while started: the frames share one
+// delta chain, so a frame taken here would be missing from the stream the clients decode.
+Napi::Value TelemetryStream::Encode(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (m_running) {
+    Napi::Error::New(env, "TelemetryStream: encode() can't be used while the stream is started").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  bool keyframe = info.Length() >= 1 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+  std::vector<u8> frame;
+  if (!produceFrame(keyframe, frame))
+    return env.Null();
+  return Napi::Buffer<u8>::Copy(env, frame.data(), frame.size());
+}
+
+// start(intervalMs, (frame: Buffer) => void)
+Napi::Value TelemetryStream::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 2 || !info[0].IsNumber() || info[0].As<Napi::Number>().Uint32Value() == 0 || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "Interval in milliseconds and frame callback expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  stopThread();
+  m_callback = Napi::ThreadSafeFunction::New(env, info[1].As<Napi::Function>(), "TelemetryStream", kMaxQueuedFrames, 1);
+  m_running = true;
+  m_thread = std::thread(&TelemetryStream::run, this, info[0].As<Napi::Number>().Uint32Value());
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value TelemetryStream::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+// requestKeyframe() makes the next frame a keyframe, e.g. when a client connects
+Napi::Value TelemetryStream::RequestKeyframe(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_keyframeRequested = true;
+  return env.Undefined();
+}
+
+Napi::Value TelemetryStream::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("frames", Napi::Number::New(env, static_cast<double>(m_frames)));
+  stats.Set("keyframes", Napi::Number::New(env, static_cast<double>(m_keyframes)));
+  stats.Set("bytes", Napi::Number::New(env, static_cast<double>(m_bytes)));
+  stats.Set("sampleBytes", Napi::Number::New(env, static_cast<double>(m_encoder.sampleSize())));
+  stats.Set("reads", Napi::Number::New(env, static_cast<double>(m_spans.size())));
+  stats.Set("failedReads", Napi::Number::New(env, static_cast<double>(m_failedReads)));
+  stats.Set("droppedFrames", Napi::Number::New(env, static_cast<double>(m_droppedFrames)));
+  stats.Set("lastEncodeMicros", Napi::Number::New(env, m_lastEncodeNanos / 1000.0));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  return stats;
+}
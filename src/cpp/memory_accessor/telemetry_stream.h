@@ -0,0 +1,75 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "telemetry_encoder.h"
+
+// Reads a fixed set of watched values and encodes them as compact telemetry frames (see
+// telemetry_encoder.h). Frames come either from encode() or, exclusively while it runs, from a
+// background thread started with start(intervalMs, callback), which reads and encodes off the main
+// thread and only hands the finished Buffer to JS.
+class TelemetryStream : public Napi::ObjectWrap<TelemetryStream> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  TelemetryStream(const Napi::CallbackInfo& info);
+  ~TelemetryStream();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  // Adjacent watches are read with a single request
+  struct ReadSpan {
+    u32 offset;
+    u32 size;
+    size_t bufferOffset;
+  };
+  struct FieldCopy {
+    size_t spanBufferOffset;
+    size_t sampleOffset;
+    u32 size;
+  };
+
+  // Reads the watches and appends a frame to out; false if the read failed
+  bool produceFrame(bool keyframe, std::vector<u8>& out);
+  void run(u32 intervalMs);
+  void stopThread();
+
+  Napi::Value GetSchema(const Napi::CallbackInfo& info);
+  Napi::Value Encode(const Napi::CallbackInfo& info);
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value RequestKeyframe(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+
+  std::mutex m_mutex;
+  DolphinComm::TelemetryEncoder m_encoder;
+  std::vector<ReadSpan> m_spans;
+  std::vector<DolphinComm::ReadRequest> m_requests;
+  std::vector<FieldCopy> m_copies;
+  std::vector<u8> m_spanBuffer;
+  std::vector<u8> m_sample;
+  u32 m_keyframeInterval = 0;
+  bool m_keyframeRequested = false;
+
+  u64 m_frames = 0;
+  u64 m_keyframes = 0;
+  u64 m_bytes = 0;
+  u64 m_failedReads = 0;
+  u64 m_droppedFrames = 0;
+  u64 m_lastEncodeNanos = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  Napi::ThreadSafeFunction m_callback;
+};
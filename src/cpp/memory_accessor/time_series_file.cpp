@@ -0,0 +1,658 @@
+#include "time_series_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "common_utils.h"
+#include "varint.h"
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr size_t DATA_GROW_STEP = 4 * 1024 * 1024;
+constexpr size_t INITIAL_INDEX_ENTRIES = 1024;
+
+size_t roundUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Integer channels are signed, as in the rest of the engine; values are sign-extended from the
+// channel's width (only the low bits matter, so this also reads columns stored zero-extended)
+s64 signExtend(u64 value, Common::MemType type)
+{
+  switch (type)
+  {
+  case Common::MemType::type_byte:
+    return static_cast<s8>(value);
+  case Common::MemType::type_halfword:
+    return static_cast<s16>(value);
+  case Common::MemType::type_word:
+    return static_cast<s32>(value);
+  default:
+    return static_cast<s64>(value);
+  }
+}
+
+// Raw big endian bytes from the emulated RAM to a host integer (sign-extended) / float bit pattern
+u64 loadValue(const u8* raw, Common::MemType type)
+{
+  switch (type)
+  {
+  case Common::MemType::type_byte:
+    return static_cast<u64>(signExtend(raw[0], type));
+  case Common::MemType::type_halfword:
+  {
+    u16 value;
+    std::memcpy(&value, raw, sizeof(u16));
+    return static_cast<u64>(signExtend(Common::bSwap16(value), type));
+  }
+  case Common::MemType::type_word:
+  {
+    u32 value;
+    std::memcpy(&value, raw, sizeof(u32));
+    return static_cast<u64>(signExtend(Common::bSwap32(value), type));
+  }
+  case Common::MemType::type_float:
+  {
+    u32 value;
+    std::memcpy(&value, raw, sizeof(u32));
+    return Common::bSwap32(value);
+  }
+  case Common::MemType::type_double:
+  {
+    u64 value;
+    std::memcpy(&value, raw, sizeof(u64));
+    return Common::bSwap64(value);
+  }
+  default:
+    return 0;
+  }
+}
+
+void storeValue(u64 value, Common::MemType type, u8* raw)
+{
+  switch (type)
+  {
+  case Common::MemType::type_byte:
+    raw[0] = static_cast<u8>(value);
+    break;
+  case Common::MemType::type_halfword:
+  {
+    u16 swapped = Common::bSwap16(static_cast<u16>(value));
+    std::memcpy(raw, &swapped, sizeof(u16));
+    break;
+  }
+  case Common::MemType::type_word:
+  case Common::MemType::type_float:
+  {
+    u32 swapped = Common::bSwap32(static_cast<u32>(value));
+    std::memcpy(raw, &swapped, sizeof(u32));
+    break;
+  }
+  case Common::MemType::type_double:
+  {
+    u64 swapped = Common::bSwap64(value);
+    std::memcpy(raw, &swapped, sizeof(u64));
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+bool decodeNumericColumn(const u8* begin, const u8* end, Common::MemType type, u32 count,
+                         std::vector<u64>& out)
+{
+  out.resize(count);
+  switch (type)
+  {
+  case Common::MemType::type_byte:
+  case Common::MemType::type_halfword:
+  case Common::MemType::type_word:
+  {
+    s64 previous = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+      u64 encoded = 0;
+      if (!Common::getVarint(begin, end, encoded))
+        return false;
+      previous += Common::zigzagDecode(encoded);
+      out[i] = static_cast<u64>(previous);
+    }
+    return true;
+  }
+  case Common::MemType::type_float:
+  {
+    Common::BitReader reader(begin, end - begin);
+    Common::XorDecoder<32> decoder;
+    for (u32 i = 0; i < count; ++i)
+    {
+      if (!decoder.decode(reader, out[i]))
+        return false;
+    }
+    return true;
+  }
+  case Common::MemType::type_double:
+  {
+    Common::BitReader reader(begin, end - begin);
+    Common::XorDecoder<64> decoder;
+    for (u32 i = 0; i < count; ++i)
+    {
+      if (!decoder.decode(reader, out[i]))
+        return false;
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+}  // namespace
+
+bool isNumericMemType(Common::MemType type)
+{
+  return type == Common::MemType::type_byte || type == Common::MemType::type_halfword ||
+         type == Common::MemType::type_word || type == Common::MemType::type_float ||
+         type == Common::MemType::type_double;
+}
+
+bool TimeSeriesWriter::open(const std::string& path, const std::vector<RecordedChannel>& channels,
+                            u32 samplesPerBlock)
+{
+  close();
+  if (channels.empty() || samplesPerBlock == 0)
+    return false;
+
+  m_channels = channels;
+  m_columnOffsets.clear();
+  m_sampleSize = 0;
+  for (RecordedChannel& channel : m_channels)
+  {
+    channel.size = static_cast<u32>(Common::getSizeForType(channel.type, channel.size));
+    if (channel.size == 0 || channel.size > TIME_SERIES_MAX_VALUE_SIZE)
+      return false;
+    m_columnOffsets.push_back(m_sampleSize);
+    m_sampleSize += channel.size;
+  }
+  m_samplesPerBlock = samplesPerBlock;
+
+  size_t headerSize =
+      roundUp(sizeof(TimeSeriesHeader) + m_channels.size() * sizeof(ChannelDescriptor), 4096);
+  if (!m_data.openReadWrite(path, headerSize + DATA_GROW_STEP, true))
+    return false;
+  if (!m_index.openReadWrite(path + ".idx",
+                             sizeof(TimeSeriesIndexHeader) +
+                                 INITIAL_INDEX_ENTRIES * sizeof(TimeSeriesIndexEntry),
+                             true))
+  {
+    m_data.close();
+    return false;
+  }
+
+  TimeSeriesHeader* fileHeader = header();
+  std::memcpy(fileHeader->magic, TIME_SERIES_MAGIC, sizeof(TIME_SERIES_MAGIC));
+  fileHeader->version = TIME_SERIES_VERSION;
+  fileHeader->channelCount = static_cast<u32>(m_channels.size());
+  fileHeader->samplesPerBlock = m_samplesPerBlock;
+  fileHeader->headerSize = static_cast<u32>(headerSize);
+  fileHeader->blockCount = 0;
+  fileHeader->dataEnd = headerSize;
+  fileHeader->sampleCount = 0;
+  fileHeader->firstTimestamp = 0;
+  fileHeader->lastTimestamp = 0;
+
+  ChannelDescriptor* descriptors =
+      reinterpret_cast<ChannelDescriptor*>(m_data.data() + sizeof(TimeSeriesHeader));
+  for (size_t i = 0; i < m_channels.size(); ++i)
+  {
+    descriptors[i].offset = m_channels[i].offset;
+    descriptors[i].type = static_cast<u16>(m_channels[i].type);
+    descriptors[i].size = static_cast<u16>(m_channels[i].size);
+  }
+
+  TimeSeriesIndexHeader* indexHeader = reinterpret_cast<TimeSeriesIndexHeader*>(m_index.data());
+  std::memcpy(indexHeader->magic, TIME_SERIES_INDEX_MAGIC, sizeof(TIME_SERIES_INDEX_MAGIC));
+  indexHeader->entryCount = 0;
+
+  m_pendingTimestamps.reserve(m_samplesPerBlock);
+  m_pendingSamples.reserve(m_samplesPerBlock * m_sampleSize);
+  return true;
+}
+
+bool TimeSeriesWriter::append(u64 timestamp, const u8* sample)
+{
+  if (!isOpen())
+    return false;
+
+  u64 latest = m_pendingTimestamps.empty() ? header()->lastTimestamp : m_pendingTimestamps.back();
+  if (timestamp < latest)
+    return false;
+
+  m_pendingTimestamps.push_back(timestamp);
+  m_pendingSamples.insert(m_pendingSamples.end(), sample, sample + m_sampleSize);
+  if (m_pendingTimestamps.size() >= m_samplesPerBlock)
+    return flush();
+  return true;
+}
+
+bool TimeSeriesWriter::encodeBlock(std::vector<u8>& out) const
+{
+  const u32 count = static_cast<u32>(m_pendingTimestamps.size());
+  const size_t columnCount = m_channels.size() + 2;
+  std::vector<u32> columns(columnCount);
+
+  out.assign(sizeof(TimeSeriesBlockHeader) + columnCount * sizeof(u32), 0);
+
+  columns[0] = static_cast<u32>(out.size());
+  s64 previousDelta = 0;
+  for (u32 i = 1; i < count; ++i)
+  {
+    s64 delta = static_cast<s64>(m_pendingTimestamps[i] - m_pendingTimestamps[i - 1]);
+    Common::putVarint(out, Common::zigzagEncode(delta - previousDelta));
+    previousDelta = delta;
+  }
+
+  for (size_t c = 0; c < m_channels.size(); ++c)
+  {
+    columns[c + 1] = static_cast<u32>(out.size());
+    const RecordedChannel& channel = m_channels[c];
+    const u8* column = m_pendingSamples.data() + m_columnOffsets[c];
+
+    switch (channel.type)
+    {
+    case Common::MemType::type_byte:
+    case Common::MemType::type_halfword:
+    case Common::MemType::type_word:
+    {
+      s64 previous = 0;
+      for (u32 i = 0; i < count; ++i)
+      {
+        s64 value = static_cast<s64>(loadValue(column + i * m_sampleSize, channel.type));
+        Common::putVarint(out, Common::zigzagEncode(value - previous));
+        previous = value;
+      }
+      break;
+    }
+    case Common::MemType::type_float:
+    {
+      Common::BitWriter writer(out);
+      Common::XorEncoder<32> encoder;
+      for (u32 i = 0; i < count; ++i)
+        encoder.encode(writer, loadValue(column + i * m_sampleSize, channel.type));
+      break;
+    }
+    case Common::MemType::type_double:
+    {
+      Common::BitWriter writer(out);
+      Common::XorEncoder<64> encoder;
+      for (u32 i = 0; i < count; ++i)
+        encoder.encode(writer, loadValue(column + i * m_sampleSize, channel.type));
+      break;
+    }
+    default:
+    {
+      // Strings and byte arrays rarely change between ticks: (run length, value) pairs
+      u32 i = 0;
+      while (i < count)
+      {
+        const u8* value = column + i * m_sampleSize;
+        u32 j = i + 1;
+        while (j < count && std::memcmp(column + j * m_sampleSize, value, channel.size) == 0)
+          ++j;
+        Common::putVarint(out, j - i);
+        out.insert(out.end(), value, value + channel.size);
+        i = j;
+      }
+      break;
+    }
+    }
+  }
+  columns[columnCount - 1] = static_cast<u32>(out.size());
+
+  TimeSeriesBlockHeader blockHeader;
+  blockHeader.magic = TIME_SERIES_BLOCK_MAGIC;
+  blockHeader.sampleCount = count;
+  blockHeader.firstTimestamp = m_pendingTimestamps.front();
+  blockHeader.byteLength = static_cast<u32>(out.size());
+  blockHeader.channelCount = static_cast<u32>(m_channels.size());
+  std::memcpy(out.data(), &blockHeader, sizeof(blockHeader));
+  std::memcpy(out.data() + sizeof(blockHeader), columns.data(), columnCount * sizeof(u32));
+  return true;
+}
+
+bool TimeSeriesWriter::flush()
+{
+  if (!isOpen())
+    return false;
+  if (m_pendingTimestamps.empty())
+    return true;
+
+  if (!encodeBlock(m_blockScratch))
+    return false;
+
+  u64 dataEnd = header()->dataEnd;
+  size_t needed = dataEnd + m_blockScratch.size();
+  if (needed > m_data.size() && !m_data.grow(roundUp(needed + DATA_GROW_STEP, DATA_GROW_STEP)))
+    return false;
+  std::memcpy(m_data.data() + dataEnd, m_blockScratch.data(), m_blockScratch.size());
+
+  u64 entryCount = reinterpret_cast<TimeSeriesIndexHeader*>(m_index.data())->entryCount;
+  size_t indexNeeded = sizeof(TimeSeriesIndexHeader) + (entryCount + 1) * sizeof(TimeSeriesIndexEntry);
+  if (indexNeeded > m_index.size() && !m_index.grow(m_index.size() * 2))
+    return false;
+
+  TimeSeriesIndexHeader* indexHeader = reinterpret_cast<TimeSeriesIndexHeader*>(m_index.data());
+  TimeSeriesIndexEntry* entries =
+      reinterpret_cast<TimeSeriesIndexEntry*>(m_index.data() + sizeof(TimeSeriesIndexHeader));
+  TimeSeriesIndexEntry& entry = entries[entryCount];
+  entry.firstTimestamp = m_pendingTimestamps.front();
+  entry.lastTimestamp = m_pendingTimestamps.back();
+  entry.fileOffset = dataEnd;
+  entry.byteLength = static_cast<u32>(m_blockScratch.size());
+  entry.sampleCount = static_cast<u32>(m_pendingTimestamps.size());
+
+  // Publish the block only once its bytes and index entry are in place
+  std::atomic_thread_fence(std::memory_order_release);
+  indexHeader->entryCount = entryCount + 1;
+
+  TimeSeriesHeader* fileHeader = header();
+  if (fileHeader->sampleCount == 0)
+    fileHeader->firstTimestamp = m_pendingTimestamps.front();
+  fileHeader->lastTimestamp = m_pendingTimestamps.back();
+  fileHeader->sampleCount += m_pendingTimestamps.size();
+  fileHeader->dataEnd = dataEnd + m_blockScratch.size();
+  std::atomic_thread_fence(std::memory_order_release);
+  fileHeader->blockCount = entryCount + 1;
+
+  m_pendingTimestamps.clear();
+  m_pendingSamples.clear();
+  return true;
+}
+
+void TimeSeriesWriter::close()
+{
+  if (!isOpen())
+    return;
+
+  flush();
+  u64 dataEnd = header()->dataEnd;
+  u64 entryCount = reinterpret_cast<TimeSeriesIndexHeader*>(m_index.data())->entryCount;
+  m_data.truncate(dataEnd);
+  m_index.truncate(sizeof(TimeSeriesIndexHeader) + entryCount * sizeof(TimeSeriesIndexEntry));
+  m_data.sync();
+  m_index.sync();
+  m_data.close();
+  m_index.close();
+  m_pendingTimestamps.clear();
+  m_pendingSamples.clear();
+}
+
+u64 TimeSeriesWriter::sampleCount() const
+{
+  if (!isOpen())
+    return 0;
+  return header()->sampleCount + m_pendingTimestamps.size();
+}
+
+u64 TimeSeriesWriter::blockCount() const
+{
+  return isOpen() ? header()->blockCount : 0;
+}
+
+u64 TimeSeriesWriter::bytesWritten() const
+{
+  return isOpen() ? header()->dataEnd : 0;
+}
+
+bool TimeSeriesReader::open(const std::string& path)
+{
+  close();
+  if (!m_data.openReadOnly(path) || m_data.size() < sizeof(TimeSeriesHeader))
+  {
+    close();
+    return false;
+  }
+
+  TimeSeriesHeader fileHeader;
+  std::memcpy(&fileHeader, m_data.data(), sizeof(fileHeader));
+  if (std::memcmp(fileHeader.magic, TIME_SERIES_MAGIC, sizeof(TIME_SERIES_MAGIC)) != 0 ||
+      fileHeader.version != TIME_SERIES_VERSION ||
+      sizeof(TimeSeriesHeader) + fileHeader.channelCount * sizeof(ChannelDescriptor) >
+          fileHeader.headerSize ||
+      fileHeader.headerSize > m_data.size())
+  {
+    close();
+    return false;
+  }
+
+  const ChannelDescriptor* descriptors =
+      reinterpret_cast<const ChannelDescriptor*>(m_data.data() + sizeof(TimeSeriesHeader));
+  for (u32 i = 0; i < fileHeader.channelCount; ++i)
+  {
+    m_channels.push_back({descriptors[i].offset, static_cast<Common::MemType>(descriptors[i].type),
+                          descriptors[i].size});
+  }
+
+  if (!m_index.openReadOnly(path + ".idx") || m_index.size() < sizeof(TimeSeriesIndexHeader) ||
+      std::memcmp(m_index.data(), TIME_SERIES_INDEX_MAGIC, sizeof(TIME_SERIES_INDEX_MAGIC)) != 0)
+  {
+    close();
+    return false;
+  }
+
+  const TimeSeriesIndexHeader* indexHeader =
+      reinterpret_cast<const TimeSeriesIndexHeader*>(m_index.data());
+  size_t mappedEntries =
+      (m_index.size() - sizeof(TimeSeriesIndexHeader)) / sizeof(TimeSeriesIndexEntry);
+  m_blockCount = std::min<size_t>({fileHeader.blockCount, indexHeader->entryCount, mappedEntries});
+  m_entries = reinterpret_cast<const TimeSeriesIndexEntry*>(m_index.data() +
+                                                            sizeof(TimeSeriesIndexHeader));
+  return true;
+}
+
+void TimeSeriesReader::close()
+{
+  m_data.close();
+  m_index.close();
+  m_channels.clear();
+  m_entries = nullptr;
+  m_blockCount = 0;
+}
+
+u64 TimeSeriesReader::sampleCount() const
+{
+  u64 total = 0;
+  for (size_t i = 0; i < m_blockCount; ++i)
+    total += m_entries[i].sampleCount;
+  return total;
+}
+
+u64 TimeSeriesReader::firstTimestamp() const
+{
+  return m_blockCount ? m_entries[0].firstTimestamp : 0;
+}
+
+u64 TimeSeriesReader::lastTimestamp() const
+{
+  return m_blockCount ? m_entries[m_blockCount - 1].lastTimestamp : 0;
+}
+
+std::pair<size_t, size_t> TimeSeriesReader::blocksInRange(u64 from, u64 to) const
+{
+  const TimeSeriesIndexEntry* begin = m_entries;
+  const TimeSeriesIndexEntry* end = m_entries + m_blockCount;
+  const TimeSeriesIndexEntry* first = std::lower_bound(
+      begin, end, from,
+      [](const TimeSeriesIndexEntry& entry, u64 value) { return entry.lastTimestamp < value; });
+  const TimeSeriesIndexEntry* last = std::upper_bound(
+      first, end, to,
+      [](u64 value, const TimeSeriesIndexEntry& entry) { return value < entry.firstTimestamp; });
+  return {static_cast<size_t>(first - begin), static_cast<size_t>(last - begin)};
+}
+
+TimeSeriesReader::BlockView TimeSeriesReader::block(size_t index) const
+{
+  if (index >= m_blockCount)
+    return {nullptr, 0, 0, 0, 0};
+  const TimeSeriesIndexEntry& entry = m_entries[index];
+  if (entry.fileOffset + entry.byteLength > m_data.size())
+    return {nullptr, 0, 0, 0, 0};
+  return {m_data.data() + entry.fileOffset, entry.byteLength, entry.firstTimestamp,
+          entry.lastTimestamp, entry.sampleCount};
+}
+
+bool TimeSeriesReader::columnBounds(size_t blockIndex, u32 column, const u8*& begin,
+                                    const u8*& end, u32& sampleCount) const
+{
+  BlockView view = block(blockIndex);
+  const size_t columnCount = m_channels.size() + 2;
+  if (view.data == nullptr ||
+      view.size < sizeof(TimeSeriesBlockHeader) + columnCount * sizeof(u32) ||
+      column + 1 >= columnCount)
+    return false;
+
+  TimeSeriesBlockHeader blockHeader;
+  std::memcpy(&blockHeader, view.data, sizeof(blockHeader));
+  if (blockHeader.magic != TIME_SERIES_BLOCK_MAGIC || blockHeader.channelCount != m_channels.size())
+    return false;
+
+  u32 first = 0;
+  u32 last = 0;
+  std::memcpy(&first, view.data + sizeof(blockHeader) + column * sizeof(u32), sizeof(u32));
+  std::memcpy(&last, view.data + sizeof(blockHeader) + (column + 1) * sizeof(u32), sizeof(u32));
+  if (first > last || last > view.size)
+    return false;
+
+  begin = view.data + first;
+  end = view.data + last;
+  sampleCount = blockHeader.sampleCount;
+  return true;
+}
+
+bool TimeSeriesReader::decodeTimestamps(size_t blockIndex, std::vector<u64>& out) const
+{
+  const u8* begin = nullptr;
+  const u8* end = nullptr;
+  u32 count = 0;
+  if (!columnBounds(blockIndex, 0, begin, end, count) || count == 0)
+    return false;
+
+  out.resize(count);
+  out[0] = block(blockIndex).firstTimestamp;
+  s64 previousDelta = 0;
+  for (u32 i = 1; i < count; ++i)
+  {
+    u64 encoded = 0;
+    if (!Common::getVarint(begin, end, encoded))
+      return false;
+    previousDelta += Common::zigzagDecode(encoded);
+    out[i] = out[i - 1] + previousDelta;
+  }
+  return true;
+}
+
+bool TimeSeriesReader::decodeValues(size_t blockIndex, u32 channel, std::vector<double>& out) const
+{
+  if (channel >= m_channels.size() || !isNumericMemType(m_channels[channel].type))
+    return false;
+
+  const u8* begin = nullptr;
+  const u8* end = nullptr;
+  u32 count = 0;
+  if (!columnBounds(blockIndex, channel + 1, begin, end, count))
+    return false;
+
+  std::vector<u64> bits;
+  const Common::MemType type = m_channels[channel].type;
+  if (!decodeNumericColumn(begin, end, type, count, bits))
+    return false;
+
+  out.resize(count);
+  for (u32 i = 0; i < count; ++i)
+  {
+    if (type == Common::MemType::type_float)
+    {
+      u32 pattern = static_cast<u32>(bits[i]);
+      float value;
+      std::memcpy(&value, &pattern, sizeof(float));
+      out[i] = value;
+    }
+    else if (type == Common::MemType::type_double)
+    {
+      std::memcpy(&out[i], &bits[i], sizeof(double));
+    }
+    else
+    {
+      out[i] = static_cast<double>(signExtend(bits[i], type));
+    }
+  }
+  return true;
+}
+
+bool TimeSeriesReader::decodeRaw(size_t blockIndex, u32 channel, std::vector<u8>& out) const
+{
+  if (channel >= m_channels.size())
+    return false;
+
+  const u8* begin = nullptr;
+  const u8* end = nullptr;
+  u32 count = 0;
+  if (!columnBounds(blockIndex, channel + 1, begin, end, count))
+    return false;
+
+  const RecordedChannel& info = m_channels[channel];
+  out.resize(static_cast<size_t>(count) * info.size);
+  if (isNumericMemType(info.type))
+  {
+    std::vector<u64> bits;
+    if (!decodeNumericColumn(begin, end, info.type, count, bits))
+      return false;
+    for (u32 i = 0; i < count; ++i)
+      storeValue(bits[i], info.type, out.data() + i * info.size);
+    return true;
+  }
+
+  u32 produced = 0;
+  while (produced < count)
+  {
+    u64 run = 0;
+    if (!Common::getVarint(begin, end, run) || run == 0 || run > count - produced ||
+        static_cast<size_t>(end - begin) < info.size)
+      return false;
+    for (u64 i = 0; i < run; ++i)
+      std::memcpy(out.data() + (produced + i) * info.size, begin, info.size);
+    begin += info.size;
+    produced += static_cast<u32>(run);
+  }
+  return true;
+}
+
+bool TimeSeriesReader::query(u32 channel, u64 from, u64 to, std::vector<u64>& timestamps,
+                             std::vector<double>& values) const
+{
+  timestamps.clear();
+  values.clear();
+  if (channel >= m_channels.size() || !isNumericMemType(m_channels[channel].type))
+    return false;
+
+  std::vector<u64> blockTimestamps;
+  std::vector<double> blockValues;
+  auto range = blocksInRange(from, to);
+  for (size_t b = range.first; b < range.second; ++b)
+  {
+    if (!decodeTimestamps(b, blockTimestamps) || !decodeValues(b, channel, blockValues))
+      return false;
+    for (size_t i = 0; i < blockTimestamps.size(); ++i)
+    {
+      if (blockTimestamps[i] < from || blockTimestamps[i] > to)
+        continue;
+      timestamps.push_back(blockTimestamps[i]);
+      values.push_back(blockValues[i]);
+    }
+  }
+  return true;
+}
+}  // namespace DolphinComm
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common_types.h"
+#include "mapped_file.h"
+#include "memory_common.h"
+
+// On-disk format for recorded watch values. A recording is two append-only files:
+//
+//   <path>      header page (TimeSeriesHeader + one ChannelDescriptor per channel), followed by
+//               encoded blocks of up to samplesPerBlock samples each
+//   <path>.idx  TimeSeriesIndexHeader followed by one TimeSeriesIndexEntry per block, sorted by time
+//
+// Blocks are columnar: a timestamp column (delta-of-delta zigzag varints) then one column per
+// channel. Integer channels store zigzag varint deltas, float/double channels use Gorilla XOR
+// encoding, and string/byte array channels are run-length encoded raw bytes. The header's
+// blockCount is only bumped after a block and its index entry are fully written, so a reader never
+// sees a partial block.
+namespace DolphinComm
+{
+constexpr char TIME_SERIES_MAGIC[8] = {'D', 'A', 'B', 'T', 'S', 'R', '0', '1'};
+constexpr char TIME_SERIES_INDEX_MAGIC[8] = {'D', 'A', 'B', 'T', 'S', 'I', '0', '1'};
+constexpr u32 TIME_SERIES_VERSION = 1;
+constexpr u32 TIME_SERIES_BLOCK_MAGIC = 0x4B4C4231;  // "BLK1"
+constexpr u32 TIME_SERIES_DEFAULT_SAMPLES_PER_BLOCK = 512;
+constexpr u32 TIME_SERIES_MAX_VALUE_SIZE = 256;
+
+struct RecordedChannel
+{
+  // Offset as produced by Common::dolphinAddrToOffset (MEM1 at 0, MEM2 at 0x10000000)
+  u32 offset;
+  Common::MemType type;
+  u32 size;
+};
+
+struct TimeSeriesHeader
+{
+  char magic[8];
+  u32 version;
+  u32 channelCount;
+  u32 samplesPerBlock;
+  u32 headerSize;
+  u64 blockCount;
+  u64 dataEnd;
+  u64 sampleCount;
+  u64 firstTimestamp;
+  u64 lastTimestamp;
+};
+
+struct ChannelDescriptor
+{
+  u32 offset;
+  u16 type;
+  u16 size;
+};
+
+struct TimeSeriesIndexHeader
+{
+  char magic[8];
+  u64 entryCount;
+  u64 reserved[2];
+};
+
+struct TimeSeriesIndexEntry
+{
+  u64 firstTimestamp;
+  u64 lastTimestamp;
+  u64 fileOffset;
+  u32 byteLength;
+  u32 sampleCount;
+};
+
+struct TimeSeriesBlockHeader
+{
+  u32 magic;
+  u32 sampleCount;
+  u64 firstTimestamp;
+  u32 byteLength;
+  u32 channelCount;
+  // Followed by channelCount + 2 u32 column offsets relative to the block start: the timestamp
+  // column, each channel column, and the end of the block
+};
+
+class TimeSeriesWriter
+{
+public:
+  TimeSeriesWriter() = default;
+  ~TimeSeriesWriter() { close(); }
+  TimeSeriesWriter(const TimeSeriesWriter&) = delete;
+  TimeSeriesWriter& operator=(const TimeSeriesWriter&) = delete;
+
+  bool open(const std::string& path, const std::vector<RecordedChannel>& channels,
+            u32 samplesPerBlock = TIME_SERIES_DEFAULT_SAMPLES_PER_BLOCK);
+  // `sample` holds every channel's raw (big endian) bytes back to back, in channel order.
+  // Timestamps must not go backwards.
+  bool append(u64 timestamp, const u8* sample);
+  // Encodes any pending samples into a block so they become visible to readers
+  bool flush();
+  void close();
+
+  bool isOpen() const { return m_data.isOpen(); }
+  size_t sampleSize() const { return m_sampleSize; }
+  const std::vector<RecordedChannel>& channels() const { return m_channels; }
+  u64 sampleCount() const;
+  u64 blockCount() const;
+  u64 bytesWritten() const;
+
+private:
+  TimeSeriesHeader* header() { return reinterpret_cast<TimeSeriesHeader*>(m_data.data()); }
+  const TimeSeriesHeader* header() const
+  {
+    return reinterpret_cast<const TimeSeriesHeader*>(m_data.data());
+  }
+  bool encodeBlock(std::vector<u8>& out) const;
+
+  Common::MappedFile m_data;
+  Common::MappedFile m_index;
+  std::vector<RecordedChannel> m_channels;
+  std::vector<size_t> m_columnOffsets;
+  size_t m_sampleSize = 0;
+  u32 m_samplesPerBlock = TIME_SERIES_DEFAULT_SAMPLES_PER_BLOCK;
+  std::vector<u64> m_pendingTimestamps;
+  std::vector<u8> m_pendingSamples;
+  std::vector<u8> m_blockScratch;
+};
+
+// Read side. Blocks are exposed as views straight into the mapping; decoding is opt-in per block
+// and per channel.
+class TimeSeriesReader
+{
+public:
+  struct BlockView
+  {
+    const u8* data;
+    size_t size;
+    u64 firstTimestamp;
+    u64 lastTimestamp;
+    u32 sampleCount;
+  };
+
+  bool open(const std::string& path);
+  void close();
+
+  const std::vector<RecordedChannel>& channels() const { return m_channels; }
+  size_t blockCount() const { return m_blockCount; }
+  u64 sampleCount() const;
+  u64 firstTimestamp() const;
+  u64 lastTimestamp() const;
+
+  // Half-open range [first, last) of blocks overlapping [from, to], found by binary search
+  std::pair<size_t, size_t> blocksInRange(u64 from, u64 to) const;
+  BlockView block(size_t index) const;
+
+  bool decodeTimestamps(size_t blockIndex, std::vector<u64>& out) const;
+  // Numeric channels only, values are converted to double (integers as signed)
+  bool decodeValues(size_t blockIndex, u32 channel, std::vector<double>& out) const;
+  // Any channel, values come back as raw big endian bytes (channel size bytes per sample)
+  bool decodeRaw(size_t blockIndex, u32 channel, std::vector<u8>& out) const;
+
+  bool query(u32 channel, u64 from, u64 to, std::vector<u64>& timestamps,
+             std::vector<double>& values) const;
+
+private:
+  bool columnBounds(size_t blockIndex, u32 column, const u8*& begin, const u8*& end,
+                    u32& sampleCount) const;
+
+  Common::MappedFile m_data;
+  Common::MappedFile m_index;
+  std::vector<RecordedChannel> m_channels;
+  const TimeSeriesIndexEntry* m_entries = nullptr;
+  size_t m_blockCount = 0;
+};
+
+bool isNumericMemType(Common::MemType type);
+}  // namespace DolphinComm
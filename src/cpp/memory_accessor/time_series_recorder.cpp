@@ -0,0 +1,439 @@
+#include "time_series_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+// Watches closer than this are merged into one read
+constexpr u32 kCoalesceGap = 64;
+
+u64 nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+bool readRange(const Napi::CallbackInfo& info, size_t index, u64& from, u64& to) {
+  from = 0;
+  to = std::numeric_limits<u64>::max();
+  if (info.Length() > index && info[index].IsNumber())
+    from = static_cast<u64>(info[index].As<Napi::Number>().DoubleValue());
+  if (info.Length() > index + 1 && info[index + 1].IsNumber())
+    to = static_cast<u64>(info[index + 1].As<Napi::Number>().DoubleValue());
+  return from <= to;
+}
+}  // namespace
+
+Napi::FunctionReference TimeSeriesRecorder::constructor;
+
+Napi::Object TimeSeriesRecorder::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "TimeSeriesRecorder", {
+    InstanceMethod("tick", &TimeSeriesRecorder::Tick),
+    InstanceMethod("start", &TimeSeriesRecorder::Start),
+    InstanceMethod("stop", &TimeSeriesRecorder::Stop),
+    InstanceMethod("flush", &TimeSeriesRecorder::Flush),
+    InstanceMethod("close", &TimeSeriesRecorder::Close),
+    InstanceMethod("getStats", &TimeSeriesRecorder::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("TimeSeriesRecorder", func);
+  return exports;
+}
+
+// new TimeSeriesRecorder(accessor, path, [{ offset, type, length? }], samplesPerBlock?)
+TimeSeriesRecorder::TimeSeriesRecorder(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<TimeSeriesRecorder>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 3 || !info[0].IsObject() || !info[1].IsString() || !info[2].IsArray()) {
+    Napi::TypeError::New(env, "MemoryAccessor, path, and watch list arguments expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  Napi::Array watches = info[2].As<Napi::Array>();
+  std::vector<DolphinComm::RecordedChannel> channels;
+  for (uint32_t i = 0; i < watches.Length(); i++) {
+    Napi::Value entry = watches.Get(i);
+    DolphinComm::RecordedChannel channel{0, Common::MemType::type_word, 0};
+    if (!entry.IsObject() || !NapiUtils::getU32(entry.As<Napi::Object>(), "offset", channel.offset) ||
+        !NapiUtils::parseMemType(entry.As<Napi::Object>().Get("type"), channel.type)) {
+      Napi::TypeError::New(env, "Each watch needs a numeric offset and a MemType").ThrowAsJavaScriptException();
+      return;
+    }
+    channel.size = NapiUtils::getU32Or(entry.As<Napi::Object>(), "length", 0);
+    channels.push_back(channel);
+  }
+
+  u32 samplesPerBlock = DolphinComm::TIME_SERIES_DEFAULT_SAMPLES_PER_BLOCK;
+  if (info.Length() >= 4 && info[3].IsNumber())
+    samplesPerBlock = info[3].As<Napi::Number>().Uint32Value();
+
+  std::string path = info[1].As<Napi::String>().Utf8Value();
+  if (!m_writer.open(path, channels, samplesPerBlock)) {
+    Napi::Error::New(env, "TimeSeriesRecorder: Failed to create recording " + path).ThrowAsJavaScriptException();
+    return;
+  }
+
+  // Sort watches by offset and merge neighbours into spans
+  const std::vector<DolphinComm::RecordedChannel>& resolved = m_writer.channels();
+  std::vector<size_t> sampleOffsets(resolved.size());
+  size_t sampleSize = 0;
+  for (size_t i = 0; i < resolved.size(); i++) {
+    sampleOffsets[i] = sampleSize;
+    sampleSize += resolved[i].size;
+  }
+
+  std::vector<size_t> order(resolved.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return resolved[a].offset < resolved[b].offset; });
+
+  size_t bufferSize = 0;
+  for (size_t index : order) {
+    const DolphinComm::RecordedChannel& channel = resolved[index];
+    if (m_spans.empty() || channel.offset > m_spans.back().offset + m_spans.back().size + kCoalesceGap) {
+      m_spans.push_back({channel.offset, channel.size, bufferSize});
+      bufferSize += channel.size;
+    } else {
+      ReadSpan& span = m_spans.back();
+      u32 end = std::max(span.offset + span.size, channel.offset + channel.size);
+      bufferSize += end - (span.offset + span.size);
+      span.size = end - span.offset;
+    }
+    const ReadSpan& span = m_spans.back();
+    m_copies.push_back({span.bufferOffset + (channel.offset - span.offset), sampleOffsets[index], channel.size});
+  }
+
+  m_spanBuffer.resize(bufferSize);
+  m_sample.resize(sampleSize);
+  for (const ReadSpan& span : m_spans)
+    m_requests.push_back({span.offset, span.size, reinterpret_cast<char*>(m_spanBuffer.data() + span.bufferOffset), false});
+}
+
+TimeSeriesRecorder::~TimeSeriesRecorder() {
+  stopThread();
+}
+
+bool TimeSeriesRecorder::sample(u64 timestamp) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_writer.isOpen())
+    return false;
+
+  auto start = std::chrono::steady_clock::now();
+  if (m_process->readBatch(m_requests.data(), m_requests.size()) != m_requests.size()) {
+    m_failedTicks++;
+    return false;
+  }
+  for (const ChannelCopy& copy : m_copies)
+    std::memcpy(m_sample.data() + copy.sampleOffset, m_spanBuffer.data() + copy.spanBufferOffset, copy.size);
+
+  bool success = m_writer.append(timestamp, m_sample.data());
+  m_lastTickNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  return success;
+}
+
+void TimeSeriesRecorder::run(u32 intervalMs) {
+  auto next = std::chrono::steady_clock::now();
+  while (m_running) {
+    sample(nowMicros());
+    next += std::chrono::milliseconds(intervalMs);
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void TimeSeriesRecorder::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+Napi::Value TimeSeriesRecorder::Tick(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u64 timestamp = nowMicros();
+  if (info.Length() >= 1 && info[0].IsNumber())
+    timestamp = static_cast<u64>(info[0].As<Napi::Number>().DoubleValue());
+
+  return Napi::Boolean::New(env, sample(timestamp));
+}
+
+Napi::Value TimeSeriesRecorder::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().Uint32Value() == 0) {
+    Napi::TypeError::New(env, "Interval in milliseconds expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  stopThread();
+  m_running = true;
+  m_thread = std::thread(&TimeSeriesRecorder::run, this, info[0].As<Napi::Number>().Uint32Value());
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value TimeSeriesRecorder::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+Napi::Value TimeSeriesRecorder::Flush(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return Napi::Boolean::New(env, m_writer.flush());
+}
+
+Napi::Value TimeSeriesRecorder::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_writer.close();
+  return env.Undefined();
+}
+
+Napi::Value TimeSeriesRecorder::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("samples", Napi::Number::New(env, static_cast<double>(m_writer.sampleCount())));
+  stats.Set("blocks", Napi::Number::New(env, static_cast<double>(m_writer.blockCount())));
+  stats.Set("bytes", Napi::Number::New(env, static_cast<double>(m_writer.bytesWritten())));
+  stats.Set("reads", Napi::Number::New(env, static_cast<double>(m_spans.size())));
+  stats.Set("failedTicks", Napi::Number::New(env, static_cast<double>(m_failedTicks)));
+  stats.Set("lastTickMicros", Napi::Number::New(env, m_lastTickNanos / 1000.0));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  return stats;
+}
+
+Napi::FunctionReference TimeSeriesRecording::constructor;
+
+Napi::Object TimeSeriesRecording::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "TimeSeriesRecording", {
+    InstanceMethod("getChannels", &TimeSeriesRecording::GetChannels),
+    InstanceMethod("getInfo", &TimeSeriesRecording::GetInfo),
+    InstanceMethod("query", &TimeSeriesRecording::Query),
+    InstanceMethod("queryRaw", &TimeSeriesRecording::QueryRaw),
+    InstanceMethod("blocks", &TimeSeriesRecording::Blocks),
+    InstanceMethod("close", &TimeSeriesRecording::Close),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("TimeSeriesRecording", func);
+  return exports;
+}
+
+// new TimeSeriesRecording(path)
+TimeSeriesRecording::TimeSeriesRecording(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<TimeSeriesRecording>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Recording path expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+  m_reader = std::make_shared<DolphinComm::TimeSeriesReader>();
+  if (!m_reader->open(path)) {
+    m_reader.reset();
+    Napi::Error::New(env, "TimeSeriesRecording: Failed to open recording " + path).ThrowAsJavaScriptException();
+  }
+}
+
+Napi::Value TimeSeriesRecording::GetChannels(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_reader) {
+    Napi::Error::New(env, "Recording is closed").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const auto& channels = m_reader->channels();
+  Napi::Array result = Napi::Array::New(env, channels.size());
+  for (uint32_t i = 0; i < channels.size(); i++) {
+    Napi::Object channel = Napi::Object::New(env);
+    channel.Set("offset", Napi::Number::New(env, channels[i].offset));
+    channel.Set("type", Napi::Number::New(env, static_cast<int>(channels[i].type)));
+    channel.Set("length", Napi::Number::New(env, channels[i].size));
+    result.Set(i, channel);
+  }
+  return result;
+}
+
+Napi::Value TimeSeriesRecording::GetInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (!m_reader) {
+    Napi::Error::New(env, "Recording is closed").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("blocks", Napi::Number::New(env, static_cast<double>(m_reader->blockCount())));
+  result.Set("samples", Napi::Number::New(env, static_cast<double>(m_reader->sampleCount())));
+  result.Set("firstTimestamp", Napi::Number::New(env, static_cast<double>(m_reader->firstTimestamp())));
+  result.Set("lastTimestamp", Napi::Number::New(env, static_cast<double>(m_reader->lastTimestamp())));
+  return result;
+}
+
+// query(channel, from?, to?) => { timestamps: Float64Array, values: Float64Array }
+Napi::Value TimeSeriesRecording::Query(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u64 from, to;
+  if (!m_reader || info.Length() < 1 || !info[0].IsNumber() || !readRange(info, 1, from, to)) {
+    Napi::TypeError::New(env, "Channel index and optional time range expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<u64> timestamps;
+  std::vector<double> values;
+  if (!m_reader->query(info[0].As<Napi::Number>().Uint32Value(), from, to, timestamps, values)) {
+    Napi::Error::New(env, "Query: Failed to decode numeric channel").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Float64Array timestampArray = Napi::Float64Array::New(env, timestamps.size());
+  Napi::Float64Array valueArray = Napi::Float64Array::New(env, values.size());
+  for (size_t i = 0; i < timestamps.size(); i++) {
+    timestampArray[i] = static_cast<double>(timestamps[i]);
+    valueArray[i] = values[i];
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("timestamps", timestampArray);
+  result.Set("values", valueArray);
+  return result;
+}
+
+// queryRaw(channel, from?, to?) => { timestamps: Float64Array, data: Buffer } with `length` bytes
+// per sample, big endian as in the emulated RAM
+Napi::Value TimeSeriesRecording::QueryRaw(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u64 from, to;
+  if (!m_reader || info.Length() < 1 || !info[0].IsNumber() || !readRange(info, 1, from, to)) {
+    Napi::TypeError::New(env, "Channel index and optional time range expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  u32 channel = info[0].As<Napi::Number>().Uint32Value();
+  if (channel >= m_reader->channels().size()) {
+    Napi::RangeError::New(env, "Channel index out of range").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  const size_t valueSize = m_reader->channels()[channel].size;
+
+  std::vector<double> timestamps;
+  std::vector<u8> data;
+  std::vector<u64> blockTimestamps;
+  std::vector<u8> blockData;
+  auto range = m_reader->blocksInRange(from, to);
+  for (size_t b = range.first; b < range.second; b++) {
+    if (!m_reader->decodeTimestamps(b, blockTimestamps) || !m_reader->decodeRaw(b, channel, blockData)) {
+      Napi::Error::New(env, "QueryRaw: Failed to decode block").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    for (size_t i = 0; i < blockTimestamps.size(); i++) {
+      if (blockTimestamps[i] < from || blockTimestamps[i] > to)
+        continue;
+      timestamps.push_back(static_cast<double>(blockTimestamps[i]));
+      data.insert(data.end(), blockData.begin() + i * valueSize, blockData.begin() + (i + 1) * valueSize);
+    }
+  }
+
+  Napi::Float64Array timestampArray = Napi::Float64Array::New(env, timestamps.size());
+  std::copy(timestamps.begin(), timestamps.end(), timestampArray.Data());
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("timestamps", timestampArray);
+  result.Set("data", Napi::Buffer<uint8_t>::Copy(env, data.data(), data.size()));
+  return result;
+}
+
+// blocks(from?, to?) => [{ firstTimestamp, lastTimestamp, samples, data }], where data is an
+// external Buffer over the still-encoded block in the mapping
+Napi::Value TimeSeriesRecording::Blocks(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  u64 from, to;
+  if (!m_reader || !readRange(info, 0, from, to)) {
+    Napi::TypeError::New(env, "Optional time range expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto range = m_reader->blocksInRange(from, to);
+  Napi::Array result = Napi::Array::New(env);
+  uint32_t count = 0;
+  for (size_t b = range.first; b < range.second; b++) {
+    DolphinComm::TimeSeriesReader::BlockView view = m_reader->block(b);
+    if (view.data == nullptr)
+      continue;
+
+    // The buffer keeps the mapping alive even if the recording is closed from JS
+    auto* keepAlive = new std::shared_ptr<DolphinComm::TimeSeriesReader>(m_reader);
+    Napi::Buffer<uint8_t> data = Napi::Buffer<uint8_t>::New(
+        env, const_cast<uint8_t*>(view.data), view.size,
+        [](Napi::Env, uint8_t*, std::shared_ptr<DolphinComm::TimeSeriesReader>* hint) { delete hint; },
+        keepAlive);
+
+    Napi::Object block = Napi::Object::New(env);
+    block.Set("firstTimestamp", Napi::Number::New(env, static_cast<double>(view.firstTimestamp)));
+    block.Set("lastTimestamp", Napi::Number::New(env, static_cast<double>(view.lastTimestamp)));
+    block.Set("samples", Napi::Number::New(env, view.sampleCount));
+    block.Set("data", data);
+    result.Set(count++, block);
+  }
+  return result;
+}
+
+Napi::Value TimeSeriesRecording::Close(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  m_reader.reset();
+  return env.Undefined();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "time_series_file.h"
+
+// Samples a fixed set of watched values every tick and appends them to a columnar recording
+// (see time_series_file.h). Ticks either come from JS via tick() or from a background thread
+// started with start(intervalMs).
+class TimeSeriesRecorder : public Napi::ObjectWrap<TimeSeriesRecorder> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  TimeSeriesRecorder(const Napi::CallbackInfo& info);
+  ~TimeSeriesRecorder();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  // Adjacent watches are read with a single request
+  struct ReadSpan {
+    u32 offset;
+    u32 size;
+    size_t bufferOffset;
+  };
+  struct ChannelCopy {
+    size_t spanBufferOffset;
+    size_t sampleOffset;
+    u32 size;
+  };
+
+  bool sample(u64 timestamp);
+  void run(u32 intervalMs);
+  void stopThread();
+
+  Napi::Value Tick(const Napi::CallbackInfo& info);
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value Flush(const Napi::CallbackInfo& info);
+  Napi::Value Close(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+
+  std::mutex m_mutex;
+  DolphinComm::TimeSeriesWriter m_writer;
+  std::vector<ReadSpan> m_spans;
+  std::vector<DolphinComm::ReadRequest> m_requests;
+  std::vector<ChannelCopy> m_copies;
+  std::vector<u8> m_spanBuffer;
+  std::vector<u8> m_sample;
+  u64 m_failedTicks = 0;
+  u64 m_lastTickNanos = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+};
+
+// Read-back side of a recording. Blocks handed to JS are external Buffers over the mapping, so
+// reading raw blocks never copies.
+class TimeSeriesRecording : public Napi::ObjectWrap<TimeSeriesRecording> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  TimeSeriesRecording(const Napi::CallbackInfo& info);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value GetChannels(const Napi::CallbackInfo& info);
+  Napi::Value GetInfo(const Napi::CallbackInfo& info);
+  Napi::Value Query(const Napi::CallbackInfo& info);
+  Napi::Value QueryRaw(const Napi::CallbackInfo& info);
+  Napi::Value Blocks(const Napi::CallbackInfo& info);
+  Napi::Value Close(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<DolphinComm::TimeSeriesReader> m_reader;
+};
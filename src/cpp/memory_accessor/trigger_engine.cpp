@@ -0,0 +1,295 @@
+#include "trigger_engine.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "memory_accessor.h"
+#include "napi_utils.h"
+
+namespace {
+constexpr u32 kDefaultRateHz = 60;
+constexpr u32 kMaxRateHz = 1000;
+// Batches per tick; also bounds how many pointer hops a trigger can follow
+constexpr int kMaxRounds = 8;
+// Ticks with matches waiting for the JS thread; past this matches are dropped instead of queued
+constexpr size_t kMaxQueuedTicks = 16;
+
+u64 nowMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+Napi::FunctionReference TriggerEngine::constructor;
+
+Napi::Object TriggerEngine::Init(Napi::Env env, Napi::Object exports) {
+  Napi::HandleScope scope(env);
+
+  Napi::Function func = DefineClass(env, "TriggerEngine", {
+    InstanceMethod("add", &TriggerEngine::Add),
+    InstanceMethod("remove", &TriggerEngine::Remove),
+    InstanceMethod("evaluate", &TriggerEngine::Evaluate),
+    InstanceMethod("start", &TriggerEngine::Start),
+    InstanceMethod("stop", &TriggerEngine::Stop),
+    InstanceMethod("getStats", &TriggerEngine::GetStats),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("TriggerEngine", func);
+  return exports;
+}
+
+// new TriggerEngine(accessor, { rateHz? })
+TriggerEngine::TriggerEngine(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<TriggerEngine>(info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "MemoryAccessor argument expected").ThrowAsJavaScriptException();
+    return;
+  }
+
+  MemoryAccessor* accessor = MemoryAccessor::Unwrap(info[0].As<Napi::Object>());
+  m_accessorRef = Napi::Persistent(info[0].As<Napi::Object>());
+  m_process = &accessor->process();
+
+  u32 rateHz = kDefaultRateHz;
+  if (info.Length() >= 2 && info[1].IsObject())
+    rateHz = NapiUtils::getU32Or(info[1].As<Napi::Object>(), "rateHz", kDefaultRateHz);
+  if (rateHz == 0 || rateHz > kMaxRateHz) {
+    Napi::RangeError::New(env, "TriggerEngine: rateHz must be between 1 and 1000").ThrowAsJavaScriptException();
+    return;
+  }
+  m_periodMicros = 1000000 / rateHz;
+}
+
+TriggerEngine::~TriggerEngine() {
+  stopThread();
+}
+
+void TriggerEngine::tick(std::vector<Match>& matches) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto start = std::chrono::steady_clock::now();
+  m_cache.clear();
+  m_pending.clear();
+  for (size_t i = 0; i < m_triggers.size(); i++) {
+    for (const DolphinComm::TriggerLoad& load : m_triggers[i].program.staticLoads)
+      m_cache.request(load.address, load.size);
+    m_pending.push_back(i);
+  }
+
+  const u64 timestamp = nowMillis();
+  for (int round = 0; round < kMaxRounds && !m_pending.empty(); round++) {
+    if (m_cache.hasMisses()) {
+      m_reads += m_cache.fetch(*m_process);
+      m_batches++;
+    }
+
+    m_next.clear();
+    for (size_t index : m_pending) {
+      Trigger& trigger = m_triggers[index];
+      DolphinComm::TriggerResult result = DolphinComm::evaluateTrigger(trigger.program, trigger.state, m_cache);
+      if (result == DolphinComm::TriggerResult::incomplete) {
+        m_next.push_back(index);
+        continue;
+      }
+      if (result == DolphinComm::TriggerResult::failed)
+        m_failedEvaluations++;
+
+      const bool isTrue = result == DolphinComm::TriggerResult::isTrue;
+      if (isTrue && (trigger.level || !trigger.wasTrue)) {
+        matches.push_back({trigger.id, timestamp, trigger.state.current});
+        m_fires++;
+        trigger.done = trigger.once;
+      }
+      trigger.wasTrue = isTrue;
+    }
+    m_pending.swap(m_next);
+  }
+  // Still waiting on reads after the last round: more pointer hops than the engine follows
+  m_failedEvaluations += m_pending.size();
+
+  m_triggers.erase(std::remove_if(m_triggers.begin(), m_triggers.end(), [](const Trigger& trigger) { return trigger.done; }),
+                   m_triggers.end());
+  m_ticks++;
+  m_lastTickNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  m_maxTickNanos = std::max(m_maxTickNanos, m_lastTickNanos);
+}
+
+void TriggerEngine::run() {
+  auto next = std::chrono::steady_clock::now();
+  std::vector<Match> matches;
+  while (m_running) {
+    tick(matches);
+    if (!matches.empty()) {
+      auto* data = new std::vector<Match>(std::move(matches));
+      napi_status status = m_callback.NonBlockingCall(data, [](Napi::Env env, Napi::Function callback, std::vector<Match>* data) {
+        if (env != nullptr && callback != nullptr)
+          callback.Call({matchesToArray(env, *data)});
+        delete data;
+      });
+      if (status != napi_ok) {
+        delete data;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_droppedCallbacks++;
+      }
+      matches.clear();
+    }
+
+    next += std::chrono::microseconds(m_periodMicros);
+    // Don't try to catch up on ticks missed while the machine was busy
+    next = std::max(next, std::chrono::steady_clock::now());
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait_until(lock, next, [this] { return !m_running; });
+  }
+}
+
+void TriggerEngine::stopThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable()) {
+    m_thread.join();
+    m_callback.Release();
+  }
+}
+
+Napi::Array TriggerEngine::matchesToArray(Napi::Env env, const std::vector<Match>& matches) {
+  Napi::Array result = Napi::Array::New(env, matches.size());
+  for (uint32_t i = 0; i < matches.size(); i++) {
+    const Match& match = matches[i];
+    Napi::Array values = Napi::Array::New(env, match.values.size());
+    for (uint32_t v = 0; v < match.values.size(); v++)
+      values.Set(v, Napi::Number::New(env, match.values[v]));
+
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("id", Napi::Number::New(env, match.id));
+    entry.Set("timestamp", Napi::Number::New(env, static_cast<double>(match.timestamp)));
+    entry.Set("values", values);
+    result.Set(i, entry);
+  }
+  return result;
+}
+
+// add(expression, { mode?: 'edge' | 'level', once? }) => id
+// Throws with the position of the problem if the expression doesn't compile
+Napi::Value TriggerEngine::Add(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expression string expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Trigger trigger{0, {}, {}, false, false, false, false};
+  std::string error;
+  if (!DolphinComm::compileTrigger(info[0].As<Napi::String>().Utf8Value(), trigger.program, error)) {
+    Napi::Error::New(env, "TriggerEngine: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    Napi::Value mode = options.Get("mode");
+    if (mode.IsString()) {
+      const std::string name = mode.As<Napi::String>().Utf8Value();
+      if (name != "edge" && name != "level") {
+        Napi::TypeError::New(env, "TriggerEngine: mode must be 'edge' or 'level'").ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      trigger.level = name == "level";
+    }
+    Napi::Value once = options.Get("once");
+    trigger.once = once.IsBoolean() && once.As<Napi::Boolean>().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  trigger.id = m_nextId++;
+  m_triggers.push_back(std::move(trigger));
+  return Napi::Number::New(env, m_triggers.back().id);
+}
+
+// remove(id) => false if there was no such trigger (e.g. a once trigger that already fired)
+Napi::Value TriggerEngine::Remove(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "Trigger id expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const u32 id = info[0].As<Napi::Number>().Uint32Value();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_triggers.begin(), m_triggers.end(), [id](const Trigger& trigger) { return trigger.id == id; });
+  if (it == m_triggers.end())
+    return Napi::Boolean::New(env, false);
+  m_triggers.erase(it);
+  return Napi::Boolean::New(env, true);
+}
+
+// evaluate() => [{ id, timestamp, values }] for the triggers that fire on this evaluation
+// Runs one tick on the calling thread; it shares edge state with the background thread
+Napi::Value TriggerEngine::Evaluate(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::vector<Match> matches;
+  tick(matches);
+  return matchesToArray(env, matches);
+}
+
+// start((matches: [{ id, timestamp, values }]) => void)
+// values holds every load of the expression in source order, as last read
+Napi::Value TriggerEngine::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "Match callback expected").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  stopThread();
+  m_callback = Napi::ThreadSafeFunction::New(env, info[0].As<Napi::Function>(), "TriggerEngine", kMaxQueuedTicks, 1);
+  m_running = true;
+  m_thread = std::thread(&TriggerEngine::run, this);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value TriggerEngine::Stop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  stopThread();
+  return env.Undefined();
+}
+
+Napi::Value TriggerEngine::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::HandleScope scope(env);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Napi::Object stats = Napi::Object::New(env);
+  stats.Set("triggers", Napi::Number::New(env, static_cast<double>(m_triggers.size())));
+  stats.Set("ticks", Napi::Number::New(env, static_cast<double>(m_ticks)));
+  stats.Set("batches", Napi::Number::New(env, static_cast<double>(m_batches)));
+  stats.Set("reads", Napi::Number::New(env, static_cast<double>(m_reads)));
+  stats.Set("fires", Napi::Number::New(env, static_cast<double>(m_fires)));
+  stats.Set("failedEvaluations", Napi::Number::New(env, static_cast<double>(m_failedEvaluations)));
+  stats.Set("droppedCallbacks", Napi::Number::New(env, static_cast<double>(m_droppedCallbacks)));
+  stats.Set("lastTickMicros", Napi::Number::New(env, m_lastTickNanos / 1000.0));
+  stats.Set("maxTickMicros", Napi::Number::New(env, m_maxTickNanos / 1000.0));
+  stats.Set("running", Napi::Boolean::New(env, m_running));
+  return stats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <napi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dolphin_process.h"
+#include "trigger_program.h"
+
+// Evaluates memory conditions (see trigger_program.h for the expression syntax) natively. After
+// start(callback) a background thread evaluates every trigger at a fixed rate and only calls into
+// JS when one fires. All triggers share the reads of a tick: constant-address loads go out as one
+// batch, then one more batch per level of pointer dereference still unresolved.
+class TriggerEngine : public Napi::ObjectWrap<TriggerEngine> {
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  TriggerEngine(const Napi::CallbackInfo& info);
+  ~TriggerEngine();
+
+private:
+  static Napi::FunctionReference constructor;
+
+  struct Trigger {
+    u32 id;
+    DolphinComm::TriggerProgram program;
+    DolphinComm::TriggerState state;
+    // Level triggers fire on every tick they hold, edge triggers only when they become true
+    bool level;
+    bool once;
+    bool wasTrue;
+    bool done;
+  };
+  struct Match {
+    u32 id;
+    u64 timestamp;
+    std::vector<double> values;
+  };
+
+  // Evaluates every trigger once and appends those that fire
+  void tick(std::vector<Match>& matches);
+  void run();
+  void stopThread();
+  static Napi::Array matchesToArray(Napi::Env env, const std::vector<Match>& matches);
+
+  Napi::Value Add(const Napi::CallbackInfo& info);
+  Napi::Value Remove(const Napi::CallbackInfo& info);
+  Napi::Value Evaluate(const Napi::CallbackInfo& info);
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  Napi::ObjectReference m_accessorRef;
+  DolphinComm::IDolphinProcess* m_process = nullptr;
+  u32 m_periodMicros = 0;
+
+  std::mutex m_mutex;
+  std::vector<Trigger> m_triggers;
+  u32 m_nextId = 1;
+  DolphinComm::TriggerReadCache m_cache;
+  std::vector<size_t> m_pending;
+  std::vector<size_t> m_next;
+
+  u64 m_ticks = 0;
+  u64 m_batches = 0;
+  u64 m_reads = 0;
+  u64 m_fires = 0;
+  u64 m_failedEvaluations = 0;
+  u64 m_droppedCallbacks = 0;
+  u64 m_lastTickNanos = 0;
+  u64 m_maxTickNanos = 0;
+
+  std::thread m_thread;
+  std::atomic<bool> m_running{false};
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  Napi::ThreadSafeFunction m_callback;
+};
@@ -0,0 +1,587 @@
+#include "trigger_program.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace DolphinComm
+{
+namespace
+{
+constexpr size_t MAX_SOURCE_LENGTH = 8192;
+constexpr int MAX_STACK = 64;
+// Nesting of the parser itself, so a pathological "((((..." can't overflow the native stack
+constexpr int MAX_NESTING = 128;
+
+struct Node
+{
+  enum class Kind
+  {
+    number,
+    load,
+    previous,
+    unary,
+    binary,
+    logical
+  };
+
+  Kind kind;
+  TriggerOp op = TriggerOp::constant;
+  TriggerLoadType loadType = TriggerLoadType::uint32;
+  double value = 0;
+  std::unique_ptr<Node> left;
+  std::unique_ptr<Node> right;
+};
+
+struct LoadTypeName
+{
+  const char* name;
+  TriggerLoadType type;
+};
+
+const LoadTypeName LOAD_TYPES[] = {
+    {"u8", TriggerLoadType::uint8},   {"u16", TriggerLoadType::uint16}, {"u32", TriggerLoadType::uint32},
+    {"s8", TriggerLoadType::int8},    {"s16", TriggerLoadType::int16},  {"s32", TriggerLoadType::int32},
+    {"f32", TriggerLoadType::float32}, {"f64", TriggerLoadType::float64},
+};
+
+struct BinaryOperator
+{
+  const char* token;
+  TriggerOp op;
+};
+
+// By precedence, lowest first; within a level longer tokens come first so "<<" isn't read as "<"
+const std::vector<std::vector<BinaryOperator>> BINARY_LEVELS = {
+    {{"||", TriggerOp::jumpIfTrue}},
+    {{"&&", TriggerOp::jumpIfFalse}},
+    {{"|", TriggerOp::bitOr}},
+    {{"^", TriggerOp::bitXor}},
+    {{"&", TriggerOp::bitAnd}},
+    {{"==", TriggerOp::equal}, {"!=", TriggerOp::notEqual}},
+    {{"<=", TriggerOp::lessEqual}, {">=", TriggerOp::greaterEqual}, {"<", TriggerOp::less}, {">", TriggerOp::greater}},
+    {{"<<", TriggerOp::shiftLeft}, {">>", TriggerOp::shiftRight}},
+    {{"+", TriggerOp::add}, {"-", TriggerOp::subtract}},
+    {{"*", TriggerOp::multiply}, {"/", TriggerOp::divide}, {"%", TriggerOp::modulo}},
+};
+
+u8 loadSize(TriggerLoadType type)
+{
+  switch (type)
+  {
+  case TriggerLoadType::uint8:
+  case TriggerLoadType::int8:
+    return 1;
+  case TriggerLoadType::uint16:
+  case TriggerLoadType::int16:
+    return 2;
+  case TriggerLoadType::float64:
+    return 8;
+  default:
+    return 4;
+  }
+}
+
+double decodeLoad(u64 raw, TriggerLoadType type)
+{
+  switch (type)
+  {
+  case TriggerLoadType::uint8:
+  case TriggerLoadType::uint16:
+  case TriggerLoadType::uint32:
+    return static_cast<double>(raw);
+  case TriggerLoadType::int8:
+    return static_cast<s8>(raw);
+  case TriggerLoadType::int16:
+    return static_cast<s16>(raw);
+  case TriggerLoadType::int32:
+    return static_cast<s32>(raw);
+  case TriggerLoadType::float32:
+  {
+    u32 bits = static_cast<u32>(raw);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  default:
+  {
+    double value;
+    std::memcpy(&value, &raw, sizeof(value));
+    return value;
+  }
+  }
+}
+
+// Bit operators see values as 32-bit integers, wrapping negative ones like a C cast would
+u32 toU32(double value)
+{
+  if (!(std::fabs(value) < 9.2e18))
+    return 0;
+  return static_cast<u32>(static_cast<s64>(value));
+}
+
+bool isTrue(double value)
+{
+  return value != 0 && !std::isnan(value);
+}
+
+class Parser
+{
+public:
+  explicit Parser(const std::string& source) : m_source(source) {}
+
+  std::unique_ptr<Node> parse(std::string& error)
+  {
+    std::unique_ptr<Node> root = parseBinary(0);
+    skipSpace();
+    if (root && m_position < m_source.size())
+      fail("Unexpected character");
+    if (!m_error.empty())
+    {
+      error = m_error;
+      return nullptr;
+    }
+    return root;
+  }
+
+private:
+  void skipSpace()
+  {
+    while (m_position < m_source.size() && std::isspace(static_cast<unsigned char>(m_source[m_position])))
+      ++m_position;
+  }
+
+  bool match(const char* token)
+  {
+    skipSpace();
+    size_t length = std::strlen(token);
+    if (m_source.compare(m_position, length, token) != 0)
+      return false;
+    // "|" and "&" mustn't eat the first half of "||" and "&&"
+    if (length == 1 && (token[0] == '|' || token[0] == '&') && m_position + 1 < m_source.size() &&
+        m_source[m_position + 1] == token[0])
+      return false;
+    m_position += length;
+    return true;
+  }
+
+  std::nullptr_t fail(const char* message)
+  {
+    if (m_error.empty())
+      m_error = std::string(message) + " at position " + std::to_string(m_position);
+    return nullptr;
+  }
+
+  std::unique_ptr<Node> parseBinary(size_t level)
+  {
+    if (level == BINARY_LEVELS.size())
+      return parseUnary();
+
+    std::unique_ptr<Node> left = parseBinary(level + 1);
+    while (left)
+    {
+      const BinaryOperator* found = nullptr;
+      for (const BinaryOperator& candidate : BINARY_LEVELS[level])
+      {
+        if (match(candidate.token))
+        {
+          found = &candidate;
+          break;
+        }
+      }
+      if (!found)
+        break;
+
+      std::unique_ptr<Node> right = parseBinary(level + 1);
+      if (!right)
+        return nullptr;
+      auto node = std::make_unique<Node>();
+      node->kind = found->op == TriggerOp::jumpIfFalse || found->op == TriggerOp::jumpIfTrue ? Node::Kind::logical :
+                                                                                               Node::Kind::binary;
+      node->op = found->op;
+      node->left = std::move(left);
+      node->right = std::move(right);
+      left = std::move(node);
+    }
+    return left;
+  }
+
+  std::unique_ptr<Node> parseUnary()
+  {
+    if (++m_nesting > MAX_NESTING)
+      return fail("Expression nests too deeply");
+
+    std::unique_ptr<Node> result;
+    TriggerOp op = TriggerOp::constant;
+    if (match("!"))
+      op = TriggerOp::logicalNot;
+    else if (match("-"))
+      op = TriggerOp::negate;
+    else if (match("~"))
+      op = TriggerOp::bitNot;
+
+    if (op != TriggerOp::constant)
+    {
+      std::unique_ptr<Node> operand = parseUnary();
+      if (operand)
+      {
+        result = std::make_unique<Node>();
+        result->kind = Node::Kind::unary;
+        result->op = op;
+        result->left = std::move(operand);
+      }
+    }
+    else
+    {
+      result = parsePrimary();
+    }
+    --m_nesting;
+    return result;
+  }
+
+  std::unique_ptr<Node> parsePrimary()
+  {
+    skipSpace();
+    if (m_position >= m_source.size())
+      return fail("Unexpected end of expression");
+
+    if (match("("))
+    {
+      std::unique_ptr<Node> inner = parseBinary(0);
+      if (inner && !match(")"))
+        return fail("Expected ')'");
+      return inner;
+    }
+
+    const char c = m_source[m_position];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+    {
+      const char* start = m_source.c_str() + m_position;
+      char* end;
+      // strtoul first so hex literals don't go through strtod's hex-float syntax
+      double value = (c == '0' && m_position + 1 < m_source.size() &&
+                      (m_source[m_position + 1] == 'x' || m_source[m_position + 1] == 'X')) ?
+                         static_cast<double>(std::strtoull(start, &end, 16)) :
+                         std::strtod(start, &end);
+      if (end == start)
+        return fail("Bad number");
+      m_position += end - start;
+      auto node = std::make_unique<Node>();
+      node->kind = Node::Kind::number;
+      node->value = value;
+      return node;
+    }
+
+    size_t nameStart = m_position;
+    while (m_position < m_source.size() && std::isalnum(static_cast<unsigned char>(m_source[m_position])))
+      ++m_position;
+    const std::string name = m_source.substr(nameStart, m_position - nameStart);
+    if (name == "prev")
+    {
+      if (!match("("))
+        return fail("Expected '(' after prev");
+      std::unique_ptr<Node> load = parsePrimary();
+      if (!load)
+        return nullptr;
+      if (load->kind != Node::Kind::load)
+        return fail("prev() takes a load such as u32[0x80000000]");
+      if (!match(")"))
+        return fail("Expected ')'");
+      load->kind = Node::Kind::previous;
+      return load;
+    }
+    for (const LoadTypeName& type : LOAD_TYPES)
+    {
+      if (name != type.name)
+        continue;
+      if (!match("["))
+        return fail("Expected '[' after load type");
+      std::unique_ptr<Node> address = parseBinary(0);
+      if (!address)
+        return nullptr;
+      if (!match("]"))
+        return fail("Expected ']'");
+      auto node = std::make_unique<Node>();
+      node->kind = Node::Kind::load;
+      node->loadType = type.type;
+      node->left = std::move(address);
+      return node;
+    }
+    m_position = nameStart;
+    return fail(name.empty() ? "Unexpected character" : "Unknown name");
+  }
+
+  const std::string& m_source;
+  size_t m_position = 0;
+  int m_nesting = 0;
+  std::string m_error;
+};
+
+class CodeGenerator
+{
+public:
+  explicit CodeGenerator(TriggerProgram& program) : m_program(program) {}
+
+  // Returns the stack depth the node needs, or -1 if the program got too large
+  int emit(const Node& node)
+  {
+    switch (node.kind)
+    {
+    case Node::Kind::number:
+      m_program.constants.push_back(node.value);
+      return push(TriggerOp::constant, static_cast<u32>(m_program.constants.size() - 1)) ? 1 : -1;
+    case Node::Kind::load:
+    case Node::Kind::previous:
+    {
+      int depth = emit(*node.left);
+      if (depth < 0 || m_program.slotCount == 0xFFFF)
+        return -1;
+      if (node.left->kind == Node::Kind::number)
+        m_program.staticLoads.push_back({toU32(node.left->value), loadSize(node.loadType)});
+      const TriggerOp op = node.kind == Node::Kind::load ? TriggerOp::load : TriggerOp::loadPrevious;
+      if (!push(op, m_program.slotCount++))
+        return -1;
+      m_program.code.back().loadType = node.loadType;
+      return depth;
+    }
+    case Node::Kind::unary:
+    {
+      int depth = emit(*node.left);
+      return depth >= 0 && push(node.op, 0) ? depth : -1;
+    }
+    case Node::Kind::binary:
+    {
+      int left = emit(*node.left);
+      int right = emit(*node.right);
+      if (left < 0 || right < 0 || !push(node.op, 0))
+        return -1;
+      return std::max(left, right + 1);
+    }
+    default:
+    {
+      // left, toBool, jump over right if that decides it, right, toBool
+      int left = emit(*node.left);
+      if (left < 0 || !push(TriggerOp::toBool, 0) || !push(node.op, 0))
+        return -1;
+      const size_t jump = m_program.code.size() - 1;
+      int right = emit(*node.right);
+      if (right < 0 || !push(TriggerOp::toBool, 0))
+        return -1;
+      m_program.code[jump].operand = static_cast<u16>(m_program.code.size());
+      return std::max(left, right);
+    }
+    }
+  }
+
+private:
+  bool push(TriggerOp op, u32 operand)
+  {
+    if (operand > 0xFFFF || m_program.code.size() >= 0xFFFF)
+      return false;
+    m_program.code.push_back({op, TriggerLoadType::uint32, static_cast<u16>(operand)});
+    return true;
+  }
+
+  TriggerProgram& m_program;
+};
+}  // namespace
+
+bool compileTrigger(const std::string& source, TriggerProgram& program, std::string& error)
+{
+  program = TriggerProgram();
+  if (source.size() > MAX_SOURCE_LENGTH)
+  {
+    error = "Expression is too long";
+    return false;
+  }
+
+  std::unique_ptr<Node> root = Parser(source).parse(error);
+  if (!root)
+    return false;
+
+  int depth = CodeGenerator(program).emit(*root);
+  if (depth < 0 || depth > MAX_STACK)
+  {
+    error = "Expression is too complex";
+    return false;
+  }
+  // The result is always a truth value
+  program.code.push_back({TriggerOp::toBool, TriggerLoadType::uint32, 0});
+  return true;
+}
+
+void TriggerReadCache::clear()
+{
+  m_entries.clear();
+  m_missing.clear();
+}
+
+TriggerReadCache::Lookup TriggerReadCache::lookup(u32 address, u8 size, u64& raw)
+{
+  auto it = m_entries.find(key(address, size));
+  if (it == m_entries.end() || it->second.pending)
+    return Lookup::miss;
+  if (!it->second.ok)
+    return Lookup::failed;
+  raw = it->second.raw;
+  return Lookup::hit;
+}
+
+void TriggerReadCache::request(u32 address, u8 size)
+{
+  if (m_entries.emplace(key(address, size), Entry{0, false, true}).second)
+    m_missing.push_back({address, size});
+}
+
+size_t TriggerReadCache::fetch(IDolphinProcess& process)
+{
+  const size_t count = m_missing.size();
+  m_buffer.resize(count * 8);
+  m_reads.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    m_reads[i] = {m_missing[i].address, m_missing[i].size, reinterpret_cast<char*>(m_buffer.data() + i * 8),
+                  GuestAccess::failed, 0};
+  }
+  process.readGuestBatch(m_reads.data(), count);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    Entry& entry = m_entries[key(m_missing[i].address, m_missing[i].size)];
+    entry.pending = false;
+    entry.ok = m_reads[i].result == GuestAccess::ok;
+    // Guest memory is big endian
+    entry.raw = 0;
+    for (u8 b = 0; b < m_missing[i].size; ++b)
+      entry.raw = (entry.raw << 8) | m_buffer[i * 8 + b];
+  }
+  m_missing.clear();
+  return count;
+}
+
+TriggerResult evaluateTrigger(const TriggerProgram& program, TriggerState& state, TriggerReadCache& cache)
+{
+  state.current.resize(program.slotCount);
+  state.previous.resize(program.slotCount);
+
+  double stack[MAX_STACK];
+  int sp = 0;
+  const size_t codeSize = program.code.size();
+  for (size_t pc = 0; pc < codeSize; ++pc)
+  {
+    const TriggerInstruction& instruction = program.code[pc];
+    switch (instruction.op)
+    {
+    case TriggerOp::constant:
+      stack[sp++] = program.constants[instruction.operand];
+      continue;
+    case TriggerOp::load:
+    case TriggerOp::loadPrevious:
+    {
+      const u32 address = toU32(stack[sp - 1]);
+      const u8 size = loadSize(instruction.loadType);
+      u64 raw;
+      switch (cache.lookup(address, size, raw))
+      {
+      case TriggerReadCache::Lookup::miss:
+        cache.request(address, size);
+        return TriggerResult::incomplete;
+      case TriggerReadCache::Lookup::failed:
+        return TriggerResult::failed;
+      default:
+        break;
+      }
+      const double value = decodeLoad(raw, instruction.loadType);
+      state.current[instruction.operand] = value;
+      stack[sp - 1] = instruction.op == TriggerOp::loadPrevious && state.hasPrevious ?
+                          state.previous[instruction.operand] :
+                          value;
+      continue;
+    }
+    case TriggerOp::negate:
+      stack[sp - 1] = -stack[sp - 1];
+      continue;
+    case TriggerOp::logicalNot:
+      stack[sp - 1] = !isTrue(stack[sp - 1]);
+      continue;
+    case TriggerOp::bitNot:
+      stack[sp - 1] = ~toU32(stack[sp - 1]);
+      continue;
+    case TriggerOp::toBool:
+      stack[sp - 1] = isTrue(stack[sp - 1]);
+      continue;
+    case TriggerOp::jumpIfFalse:
+    case TriggerOp::jumpIfTrue:
+      if (isTrue(stack[sp - 1]) == (instruction.op == TriggerOp::jumpIfTrue))
+        pc = instruction.operand - 1;
+      else
+        --sp;
+      continue;
+    default:
+      break;
+    }
+
+    const double b = stack[--sp];
+    double& a = stack[sp - 1];
+    switch (instruction.op)
+    {
+    case TriggerOp::add:
+      a = a + b;
+      break;
+    case TriggerOp::subtract:
+      a = a - b;
+      break;
+    case TriggerOp::multiply:
+      a = a * b;
+      break;
+    case TriggerOp::divide:
+      a = a / b;
+      break;
+    case TriggerOp::modulo:
+      a = std::fmod(a, b);
+      break;
+    case TriggerOp::bitAnd:
+      a = toU32(a) & toU32(b);
+      break;
+    case TriggerOp::bitOr:
+      a = toU32(a) | toU32(b);
+      break;
+    case TriggerOp::bitXor:
+      a = toU32(a) ^ toU32(b);
+      break;
+    case TriggerOp::shiftLeft:
+      a = static_cast<u32>(toU32(a) << (toU32(b) & 31));
+      break;
+    case TriggerOp::shiftRight:
+      a = toU32(a) >> (toU32(b) & 31);
+      break;
+    case TriggerOp::equal:
+      a = a == b;
+      break;
+    case TriggerOp::notEqual:
+      a = a != b;
+      break;
+    case TriggerOp::less:
+      a = a < b;
+      break;
+    case TriggerOp::lessEqual:
+      a = a <= b;
+      break;
+    case TriggerOp::greater:
+      a = a > b;
+      break;
+    default:
+      a = a >= b;
+      break;
+    }
+  }
+
+  // Only a complete evaluation moves the prev() values forward
+  state.previous = state.current;
+  state.hasPrevious = true;
+  return isTrue(stack[0]) ? TriggerResult::isTrue : TriggerResult::isFalse;
+}
+}  // namespace DolphinComm
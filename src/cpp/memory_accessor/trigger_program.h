@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common_types.h"
+#include "dolphin_process.h"
+
+// Conditions over emulated memory, compiled to bytecode for a native evaluation loop.
+//
+// Expressions use C operators over numbers and typed big-endian loads from guest addresses:
+//   u32[0x803F1200] < 20
+//   u16[u32[0x80400000] + 0x1C] == 0x2A && (u8[0x80401000] & 0x04) != 0
+//   u32[0x80300010] != prev(u32[0x80300010])
+// Load types are u8, u16, u32, s8, s16, s32, f32 and f64; the address inside [] may itself contain
+// loads (pointer dereference). prev(load) is the value that load had at the previous evaluation.
+// Values are doubles; bit operators and shifts work on them as 32-bit integers. && and || short
+// circuit, so a null check can guard a dereference.
+namespace DolphinComm
+{
+enum class TriggerLoadType : u8
+{
+  uint8,
+  uint16,
+  uint32,
+  int8,
+  int16,
+  int32,
+  float32,
+  float64
+};
+
+enum class TriggerOp : u8
+{
+  constant,  // operand: constant index
+  load,      // operand: slot; pops the address
+  loadPrevious,
+  negate,
+  logicalNot,
+  bitNot,
+  add,
+  subtract,
+  multiply,
+  divide,
+  modulo,
+  bitAnd,
+  bitOr,
+  bitXor,
+  shiftLeft,
+  shiftRight,
+  equal,
+  notEqual,
+  less,
+  lessEqual,
+  greater,
+  greaterEqual,
+  // operand: target instruction. Jumps if the top of the stack is false/true, else pops it.
+  jumpIfFalse,
+  jumpIfTrue,
+  toBool
+};
+
+struct TriggerInstruction
+{
+  TriggerOp op;
+  TriggerLoadType loadType;
+  u16 operand;
+};
+
+struct TriggerLoad
+{
+  u32 address;
+  u8 size;
+};
+
+struct TriggerProgram
+{
+  std::vector<TriggerInstruction> code;
+  std::vector<double> constants;
+  // One slot per load in the source, in source order
+  u16 slotCount = 0;
+  // Loads whose address is a constant, read ahead of the first evaluation round
+  std::vector<TriggerLoad> staticLoads;
+};
+
+// False with a message pointing at the offending character if the expression doesn't compile
+bool compileTrigger(const std::string& source, TriggerProgram& program, std::string& error);
+
+// Guest reads for one evaluation tick. Evaluations that need a value not read yet record it as
+// missing; fetch() then reads everything missing as one batch, so each level of pointer
+// dereference costs one batch per tick, however many triggers there are.
+class TriggerReadCache
+{
+public:
+  enum class Lookup
+  {
+    hit,
+    miss,
+    failed
+  };
+
+  void clear();
+  Lookup lookup(u32 address, u8 size, u64& raw);
+  void request(u32 address, u8 size);
+  bool hasMisses() const { return !m_missing.empty(); }
+  // Returns how many reads went out
+  size_t fetch(IDolphinProcess& process);
+
+private:
+  struct Entry
+  {
+    u64 raw;
+    bool ok;
+    bool pending;
+  };
+
+  static u64 key(u32 address, u8 size) { return (static_cast<u64>(address) << 8) | size; }
+
+  std::unordered_map<u64, Entry> m_entries;
+  std::vector<TriggerLoad> m_missing;
+  std::vector<GuestRead> m_reads;
+  std::vector<u8> m_buffer;
+};
+
+// Per-trigger values carried between evaluations
+struct TriggerState
+{
+  std::vector<double> current;
+  std::vector<double> previous;
+  bool hasPrevious = false;
+};
+
+enum class TriggerResult
+{
+  isFalse,
+  isTrue,
+  // A value wasn't in the cache yet; fetch and evaluate again
+  incomplete,
+  // A load hit unmapped or unreadable memory
+  failed
+};
+
+TriggerResult evaluateTrigger(const TriggerProgram& program, TriggerState& state, TriggerReadCache& cache);
+}  // namespace DolphinComm
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "common_types.h"
+
+namespace Common
+{
+// LEB128-style unsigned varint, at most 10 bytes for a u64
+inline void putVarint(std::vector<u8>& out, u64 value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back(static_cast<u8>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<u8>(value));
+}
+
+// Returns false on a truncated or overlong varint
+inline bool getVarint(const u8*& cursor, const u8* end, u64& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 64 && cursor < end; shift += 7)
+  {
+    u8 byte = *cursor++;
+    value |= static_cast<u64>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+inline u64 zigzagEncode(s64 value)
+{
+  return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63);
+}
+
+inline s64 zigzagDecode(u64 value)
+{
+  return static_cast<s64>(value >> 1) ^ -static_cast<s64>(value & 1);
+}
+
+class BitWriter
+{
+public:
+  explicit BitWriter(std::vector<u8>& out) : m_out(out) {}
+  ~BitWriter() { flush(); }
+
+  // Writes the low `count` bits of `bits`, most significant first
+  void write(u64 bits, int count)
+  {
+    while (count > 0)
+    {
+      int take = count < (8 - m_used) ? count : (8 - m_used);
+      u8 chunk = static_cast<u8>((bits >> (count - take)) & ((1u << take) - 1));
+      m_current |= chunk << (8 - m_used - take);
+      m_used += take;
+      count -= take;
+      if (m_used == 8)
+      {
+        m_out.push_back(m_current);
+        m_current = 0;
+        m_used = 0;
+      }
+    }
+  }
+
+  void flush()
+  {
+    if (m_used > 0)
+    {
+      m_out.push_back(m_current);
+      m_current = 0;
+      m_used = 0;
+    }
+  }
+
+private:
+  std::vector<u8>& m_out;
+  u8 m_current = 0;
+  int m_used = 0;
+};
+
+class BitReader
+{
+public:
+  BitReader(const u8* data, size_t size) : m_data(data), m_size(size) {}
+
+  bool read(int count, u64& bits)
+  {
+    bits = 0;
+    if (m_bitPos + count > m_size * 8)
+      return false;
+    while (count > 0)
+    {
+      size_t byteIndex = m_bitPos >> 3;
+      int bitInByte = static_cast<int>(m_bitPos & 7);
+      int take = count < (8 - bitInByte) ? count : (8 - bitInByte);
+      u8 chunk = (m_data[byteIndex] >> (8 - bitInByte - take)) & ((1u << take) - 1);
+      bits = (bits << take) | chunk;
+      m_bitPos += take;
+      count -= take;
+    }
+    return true;
+  }
+
+  size_t bytesConsumed() const { return (m_bitPos + 7) >> 3; }
+
+private:
+  const u8* m_data;
+  size_t m_size;
+  size_t m_bitPos = 0;
+};
+
+// Gorilla-style XOR compression for float bit patterns (Pelkonen et al., VLDB 2015). `Bits` is 32
+// for floats and 64 for doubles; identical consecutive values cost a single bit.
+template <int Bits>
+class XorEncoder
+{
+public:
+  void encode(BitWriter& writer, u64 value)
+  {
+    if (m_first)
+    {
+      writer.write(value, Bits);
+      m_first = false;
+      m_previous = value;
+      return;
+    }
+
+    u64 diff = value ^ m_previous;
+    m_previous = value;
+    if (diff == 0)
+    {
+      writer.write(0, 1);
+      return;
+    }
+
+    int leading = countLeadingZeros(diff);
+    int trailing = countTrailingZeros(diff);
+    // The leading count is stored in 5 (or 6) bits
+    constexpr int maxLeading = Bits == 32 ? 31 : 63;
+    if (leading > maxLeading)
+      leading = maxLeading;
+
+    if (m_leading >= 0 && leading >= m_leading && trailing >= m_trailing)
+    {
+      writer.write(0b10, 2);
+      writer.write(diff >> m_trailing, Bits - m_leading - m_trailing);
+      return;
+    }
+
+    int meaningful = Bits - leading - trailing;
+    writer.write(0b11, 2);
+    writer.write(leading, Bits == 32 ? 5 : 6);
+    // meaningful is in [1, Bits]; store it minus one so it fits
+    writer.write(meaningful - 1, Bits == 32 ? 5 : 6);
+    writer.write(diff >> trailing, meaningful);
+    m_leading = leading;
+    m_trailing = trailing;
+  }
+
+private:
+  static int countLeadingZeros(u64 value)
+  {
+    return __builtin_clzll(value) - (64 - Bits);
+  }
+  static int countTrailingZeros(u64 value) { return __builtin_ctzll(value); }
+
+  bool m_first = true;
+  u64 m_previous = 0;
+  int m_leading = -1;
+  int m_trailing = 0;
+};
+
+template <int Bits>
+class XorDecoder
+{
+public:
+  bool decode(BitReader& reader, u64& value)
+  {
+    if (m_first)
+    {
+      if (!reader.read(Bits, m_previous))
+        return false;
+      m_first = false;
+      value = m_previous;
+      return true;
+    }
+
+    u64 control = 0;
+    if (!reader.read(1, control))
+      return false;
+    if (control == 0)
+    {
+      value = m_previous;
+      return true;
+    }
+
+    if (!reader.read(1, control))
+      return false;
+    if (control == 1)
+    {
+      u64 leading = 0;
+      u64 meaningful = 0;
+      if (!reader.read(Bits == 32 ? 5 : 6, leading) || !reader.read(Bits == 32 ? 5 : 6, meaningful))
+        return false;
+      m_leading = static_cast<int>(leading);
+      m_trailing = Bits - m_leading - static_cast<int>(meaningful + 1);
+      if (m_trailing < 0)
+        return false;
+    }
+
+    u64 bits = 0;
+    if (!reader.read(Bits - m_leading - m_trailing, bits))
+      return false;
+    m_previous ^= bits << m_trailing;
+    value = m_previous;
+    return true;
+  }
+
+private:
+  bool m_first = true;
+  u64 m_previous = 0;
+  int m_leading = 0;
+  int m_trailing = 0;
+};
+}  // namespace Common
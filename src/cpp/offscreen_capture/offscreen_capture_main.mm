@@ -0,0 +1,146 @@
+#include <napi.h>
+#include <thread>
+#include "executor_abi.h"
+#include "offscreen_capture.h"
+
+namespace {
+
+// Set by setExecutor(); until then async captures get a thread of their own
+const DolphinExecutorAbi* g_executor = nullptr;
+
+// Converts a capture result into the object returned to JavaScript
+Napi::Object CaptureResultToJS(Napi::Env env, const offscreen_capture::CaptureResult& result) {
+    Napi::Object returnObj = Napi::Object::New(env);
+    
+    if (result.success) {
+        // Add the image buffer to the return object
+        Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
+            env, 
+            result.buffer.data(), 
+            result.buffer.size()
+        );
+        
+        returnObj.Set("buffer", buffer);
+        returnObj.Set("width", Napi::Number::New(env, result.width));
+        returnObj.Set("height", Napi::Number::New(env, result.height));
+        returnObj.Set("success", Napi::Boolean::New(env, true));
+    } else {
+        // If capture failed, return error information
+        returnObj.Set("success", Napi::Boolean::New(env, false));
+        returnObj.Set("error", Napi::String::New(env, result.error));
+    }
+    
+    return returnObj;
+}
+
+// Node.js addon method to capture a window by PID
+Napi::Value CaptureWindowByPID(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    // Check arguments
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Process ID (number) expected as first argument").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    // Get the PID from the arguments
+    pid_t pid = info[0].As<Napi::Number>().Int32Value();
+    
+    // Get the optional gameId
+    std::string gameId = "";
+    if (info.Length() >= 2 && info[1].IsString()) {
+        gameId = info[1].As<Napi::String>().Utf8Value();
+    }
+    
+    // Capture the window
+    offscreen_capture::CaptureResult result = offscreen_capture::CaptureWindowByPID(pid, gameId);
+    return CaptureResultToJS(env, result);
+}
+
+// A capture running off the JavaScript thread
+struct CaptureJob {
+    explicit CaptureJob(Napi::Env env) : deferred(Napi::Promise::Deferred::New(env)) {}
+
+    pid_t pid;
+    std::string gameId;
+    offscreen_capture::CaptureResult result;
+    Napi::Promise::Deferred deferred;
+    Napi::ThreadSafeFunction done;
+};
+
+// Executor and fallback threads have no autorelease pool of their own, so each job drains one
+void RunCaptureJob(void* argument) {
+    @autoreleasepool {
+        CaptureJob* job = static_cast<CaptureJob*>(argument);
+        job->result = offscreen_capture::CaptureWindowByPID(job->pid, job->gameId);
+        
+        // The JavaScript thread may delete the job as soon as the call is queued
+        Napi::ThreadSafeFunction done = job->done;
+        done.BlockingCall(job, [](Napi::Env env, Napi::Function, CaptureJob* job) {
+            if (env != nullptr) {
+                Napi::HandleScope scope(env);
+                job->deferred.Resolve(CaptureResultToJS(env, job->result));
+            }
+            delete job;
+        });
+        done.Release();
+    }
+}
+
+// Same as captureWindowByPID but returns a promise; the capture and PNG encoding run on the
+// shared executor at capture priority
+Napi::Value CaptureWindowByPIDAsync(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Process ID (number) expected as first argument").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    CaptureJob* job = new CaptureJob(env);
+    job->pid = info[0].As<Napi::Number>().Int32Value();
+    if (info.Length() >= 2 && info[1].IsString()) {
+        job->gameId = info[1].As<Napi::String>().Utf8Value();
+    }
+    job->done = Napi::ThreadSafeFunction::New(
+        env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "captureWindowByPIDAsync", 0, 1);
+    Napi::Promise promise = job->deferred.Promise();
+    
+    if (g_executor != nullptr) {
+        g_executor->submit(g_executor->context, DOLPHIN_EXECUTOR_PRIORITY_CAPTURE, RunCaptureJob, job);
+    } else {
+        std::thread(RunCaptureJob, job).detach();
+    }
+    return promise;
+}
+
+// setExecutor(handle) runs async captures on the executor from dolphin_memory's getExecutorHandle()
+Napi::Value SetExecutor(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsExternal()) {
+        Napi::TypeError::New(env, "Executor handle expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    const DolphinExecutorAbi* executor = info[0].As<Napi::External<DolphinExecutorAbi>>().Data();
+    if (executor->version != DOLPHIN_EXECUTOR_ABI_VERSION) {
+        Napi::Error::New(env, "Executor handle is from an incompatible dolphin_memory build").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    
+    g_executor = executor;
+    return env.Undefined();
+}
+
+// Initialize the addon
+Napi::Object InitModule(Napi::Env env, Napi::Object exports) {
+    exports.Set("captureWindowByPID", Napi::Function::New(env, CaptureWindowByPID));
+    exports.Set("captureWindowByPIDAsync", Napi::Function::New(env, CaptureWindowByPIDAsync));
+    exports.Set("setExecutor", Napi::Function::New(env, SetExecutor));
+    return exports;
+}
+
+NODE_API_MODULE(offscreen_capture, InitModule)
+
+}  // namespace
@@ -3,6 +3,14 @@
 #import <CoreGraphics/CoreGraphics.h>
 #import <Cocoa/Cocoa.h>
 #import <node_api.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "executor_abi.h"
+
+// Set by setExecutor(); until then the queued key presses are run on a thread of their own
+static const DolphinExecutorAbi* g_executor = NULL;
 
 // Helper function to simulate key press and release
 void SimulateKeyEvent(CGKeyCode keyCode, bool keyDown) {
@@ -119,6 +127,32 @@ bool FindWindowByTitleAndPID(pid_t pid, const char* titleSubstring, CGWindowID*
     return found;
 }
 
+// Builds the { success, windowID, windowTitle } or { success, error } result object
+napi_value KeyResultToJS(napi_env env, bool windowFound, CGWindowID windowID, const char* windowTitle) {
+    napi_value result;
+    napi_create_object(env, &result);
+    
+    if (!windowFound) {
+        napi_value successProp, errorValue;
+        napi_get_boolean(env, false, &successProp);
+        napi_create_string_utf8(env, "Window not found", NAPI_AUTO_LENGTH, &errorValue);
+        
+        napi_set_named_property(env, result, "success", successProp);
+        napi_set_named_property(env, result, "error", errorValue);
+        return result;
+    }
+    
+    napi_value successProp, windowIDValue, windowTitleValue;
+    napi_get_boolean(env, true, &successProp);
+    napi_create_int32(env, (int32_t)windowID, &windowIDValue);
+    napi_create_string_utf8(env, windowTitle, NAPI_AUTO_LENGTH, &windowTitleValue);
+    
+    napi_set_named_property(env, result, "success", successProp);
+    napi_set_named_property(env, result, "windowID", windowIDValue);
+    napi_set_named_property(env, result, "windowTitle", windowTitleValue);
+    return result;
+}
+
 // Node.js binding functions
 napi_value SendKeyToWindow(napi_env env, napi_callback_info info) {
     napi_status status;
@@ -148,32 +182,12 @@ napi_value SendKeyToWindow(napi_env env, napi_callback_info info) {
     char windowTitle[512] = {0};
     bool windowFound = FindWindowByTitleAndPID((pid_t)pid, titleSubstring, &windowID, windowTitle, sizeof(windowTitle));
     
-    napi_value result;
-    napi_create_object(env, &result);
-    
-    if (!windowFound) {
-        napi_value successProp, errorValue;
-        napi_get_boolean(env, false, &successProp);
-        napi_create_string_utf8(env, "Window not found", NAPI_AUTO_LENGTH, &errorValue);
-        
-        napi_set_named_property(env, result, "success", successProp);
-        napi_set_named_property(env, result, "error", errorValue);
-        return result;
+    if (windowFound) {
+        // Send the keystroke directly (no window focus needed)
+        TemporarilyFocusWindowAndSendKey(windowID, (CGKeyCode)keyCode);
     }
     
-    // Send the keystroke directly (no window focus needed)
-    TemporarilyFocusWindowAndSendKey(windowID, (CGKeyCode)keyCode);
-    
-    napi_value successProp, windowIDValue, windowTitleValue;
-    napi_get_boolean(env, true, &successProp);
-    napi_create_int32(env, (int32_t)windowID, &windowIDValue);
-    napi_create_string_utf8(env, windowTitle, NAPI_AUTO_LENGTH, &windowTitleValue);
-    
-    napi_set_named_property(env, result, "success", successProp);
-    napi_set_named_property(env, result, "windowID", windowIDValue);
-    napi_set_named_property(env, result, "windowTitle", windowTitleValue);
-    
-    return result;
+    return KeyResultToJS(env, windowFound, windowID, windowTitle);
 }
 
 napi_value SendKeyWithModifiersToWindow(napi_env env, napi_callback_info info) {
@@ -206,31 +220,174 @@ napi_value SendKeyWithModifiersToWindow(napi_env env, napi_callback_info info) {
     char windowTitle[512] = {0};
     bool windowFound = FindWindowByTitleAndPID((pid_t)pid, titleSubstring, &windowID, windowTitle, sizeof(windowTitle));
     
-    napi_value result;
-    napi_create_object(env, &result);
+    if (windowFound) {
+        // Send the keystroke with modifiers directly (no window focus needed)
+        SimulateKeyWithModifiers((CGKeyCode)keyCode, (CGEventFlags)modifierFlags);
+    }
     
-    if (!windowFound) {
-        napi_value successProp, errorValue;
-        napi_get_boolean(env, false, &successProp);
-        napi_create_string_utf8(env, "Window not found", NAPI_AUTO_LENGTH, &errorValue);
+    return KeyResultToJS(env, windowFound, windowID, windowTitle);
+}
+
+// A key press running off the JavaScript thread
+struct KeyJob {
+    pid_t pid;
+    std::string titleSubstring;
+    CGKeyCode keyCode;
+    bool withModifiers;
+    CGEventFlags modifierFlags;
+    bool windowFound;
+    CGWindowID windowID;
+    char windowTitle[512];
+    napi_deferred deferred;
+    napi_threadsafe_function done;
+};
+
+// Resolves the job's promise on the JavaScript thread
+void SettleKeyJob(napi_env env, napi_value jsCallback, void* context, void* data) {
+    KeyJob* job = (KeyJob*)data;
+    if (env != NULL) {
+        napi_resolve_deferred(env, job->deferred, KeyResultToJS(env, job->windowFound, job->windowID, job->windowTitle));
+    }
+    delete job;
+}
+
+// Executor and fallback threads have no autorelease pool of their own, so each job drains one
+void RunKeyJob(void* argument) {
+    @autoreleasepool {
+        KeyJob* job = (KeyJob*)argument;
+        job->windowFound = FindWindowByTitleAndPID(job->pid, job->titleSubstring.c_str(), &job->windowID, job->windowTitle, sizeof(job->windowTitle));
+        if (job->windowFound) {
+            if (job->withModifiers) {
+                SimulateKeyWithModifiers(job->keyCode, job->modifierFlags);
+            } else {
+                TemporarilyFocusWindowAndSendKey(job->windowID, job->keyCode);
+            }
+        }
         
-        napi_set_named_property(env, result, "success", successProp);
-        napi_set_named_property(env, result, "error", errorValue);
+        // The JavaScript thread may delete the job as soon as the call is queued
+        napi_threadsafe_function done = job->done;
+        napi_call_threadsafe_function(done, job, napi_tsfn_blocking);
+        napi_release_threadsafe_function(done, napi_tsfn_release);
+    }
+}
+
+// Key presses run one at a time in the order they were queued: the executor spreads jobs over its
+// workers and a worker takes its newest job first, so jobs submitted separately could reorder or
+// overlap (and a press focuses the window, then restores the previous focus)
+static std::mutex g_keyJobsMutex;
+static std::deque<KeyJob*> g_keyJobs;
+static bool g_keyJobsDraining = false;
+
+// Runs the queued key presses until the queue is empty; only one drain runs at a time
+void DrainKeyJobs(void* argument) {
+    for (;;) {
+        KeyJob* job;
+        {
+            std::lock_guard<std::mutex> lock(g_keyJobsMutex);
+            if (g_keyJobs.empty()) {
+                g_keyJobsDraining = false;
+                return;
+            }
+            job = g_keyJobs.front();
+            g_keyJobs.pop_front();
+        }
+        RunKeyJob(job);
+    }
+}
+
+// Shared by the async bindings: (PID, windowTitleSubstring, keyCode[, modifierFlags]) => Promise
+napi_value QueueKeyJob(napi_env env, napi_callback_info info, bool withModifiers) {
+    size_t argc = 4;
+    napi_value args[4];
+    size_t expected = withModifiers ? 4 : 3;
+    
+    napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    if (status != napi_ok || argc < expected) {
+        napi_throw_error(env, NULL, withModifiers ? "Expected 4 arguments: PID, windowTitleSubstring, keyCode, modifierFlags"
+                                                  : "Expected 3 arguments: PID, windowTitleSubstring, keyCode");
+        napi_value result;
+        napi_get_undefined(env, &result);
         return result;
     }
     
-    // Send the keystroke with modifiers directly (no window focus needed)
-    SimulateKeyWithModifiers((CGKeyCode)keyCode, (CGEventFlags)modifierFlags);
+    int32_t pid;
+    char titleSubstring[256];
+    int32_t keyCode;
+    int32_t modifierFlags = 0;
+    size_t strLen;
     
-    napi_value successProp, windowIDValue, windowTitleValue;
-    napi_get_boolean(env, true, &successProp);
-    napi_create_int32(env, (int32_t)windowID, &windowIDValue);
-    napi_create_string_utf8(env, windowTitle, NAPI_AUTO_LENGTH, &windowTitleValue);
+    napi_get_value_int32(env, args[0], &pid);
+    napi_get_value_string_utf8(env, args[1], titleSubstring, 256, &strLen);
+    napi_get_value_int32(env, args[2], &keyCode);
+    if (withModifiers) {
+        napi_get_value_int32(env, args[3], &modifierFlags);
+    }
     
-    napi_set_named_property(env, result, "success", successProp);
-    napi_set_named_property(env, result, "windowID", windowIDValue);
-    napi_set_named_property(env, result, "windowTitle", windowTitleValue);
+    KeyJob* job = new KeyJob();
+    job->pid = (pid_t)pid;
+    job->titleSubstring = titleSubstring;
+    job->keyCode = (CGKeyCode)keyCode;
+    job->withModifiers = withModifiers;
+    job->modifierFlags = (CGEventFlags)modifierFlags;
+    job->windowFound = false;
+    job->windowTitle[0] = '\0';
+    
+    napi_value promise, resourceName;
+    napi_create_promise(env, &job->deferred, &promise);
+    napi_create_string_utf8(env, "sendKeyToWindowAsync", NAPI_AUTO_LENGTH, &resourceName);
+    napi_create_threadsafe_function(env, NULL, NULL, resourceName, 0, 1, NULL, NULL, NULL, SettleKeyJob, &job->done);
+    
+    bool startDrain;
+    {
+        std::lock_guard<std::mutex> lock(g_keyJobsMutex);
+        g_keyJobs.push_back(job);
+        startDrain = !g_keyJobsDraining;
+        g_keyJobsDraining = true;
+    }
+    if (startDrain) {
+        if (g_executor != NULL) {
+            g_executor->submit(g_executor->context, DOLPHIN_EXECUTOR_PRIORITY_INPUT, DrainKeyJobs, NULL);
+        } else {
+            std::thread(DrainKeyJobs, (void*)NULL).detach();
+        }
+    }
+    return promise;
+}
+
+napi_value SendKeyToWindowAsync(napi_env env, napi_callback_info info) {
+    return QueueKeyJob(env, info, false);
+}
+
+napi_value SendKeyWithModifiersToWindowAsync(napi_env env, napi_callback_info info) {
+    return QueueKeyJob(env, info, true);
+}
+
+// setExecutor(handle) runs async key presses on the executor from dolphin_memory's getExecutorHandle()
+napi_value SetExecutor(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_value result;
+    napi_valuetype type = napi_undefined;
+    napi_get_undefined(env, &result);
     
+    napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    if (status == napi_ok && argc >= 1) {
+        napi_typeof(env, args[0], &type);
+    }
+    if (type != napi_external) {
+        napi_throw_type_error(env, NULL, "Executor handle expected");
+        return result;
+    }
+    
+    void* handle;
+    napi_get_value_external(env, args[0], &handle);
+    const DolphinExecutorAbi* executor = (const DolphinExecutorAbi*)handle;
+    if (executor->version != DOLPHIN_EXECUTOR_ABI_VERSION) {
+        napi_throw_error(env, NULL, "Executor handle is from an incompatible dolphin_memory build");
+        return result;
+    }
+    
+    g_executor = executor;
     return result;
 }
 
@@ -249,6 +406,21 @@ napi_value Init(napi_env env, napi_value exports) {
     status = napi_set_named_property(env, exports, "sendKeyWithModifiersToWindow", fn);
     if (status != napi_ok) return NULL;
     
+    status = napi_create_function(env, NULL, 0, SendKeyToWindowAsync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    status = napi_set_named_property(env, exports, "sendKeyToWindowAsync", fn);
+    if (status != napi_ok) return NULL;
+    
+    status = napi_create_function(env, NULL, 0, SendKeyWithModifiersToWindowAsync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    status = napi_set_named_property(env, exports, "sendKeyWithModifiersToWindowAsync", fn);
+    if (status != napi_ok) return NULL;
+    
+    status = napi_create_function(env, NULL, 0, SetExecutor, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    status = napi_set_named_property(env, exports, "setExecutor", fn);
+    if (status != napi_ok) return NULL;
+    
     return exports;
 }
 
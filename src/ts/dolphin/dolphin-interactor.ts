@@ -52,11 +52,35 @@ export class DolphinInteractor {
     return filename;
   }
 
+  // captureDolphinOffscreen with the capture and PNG encoding on the native executor
+  async captureDolphinOffscreenAsync() {
+    const imageData = await native.dolphinScreenGrab.captureWindowByPIDAsync(this.pid, this.gameId);
+
+    if (!imageData || !imageData.buffer || imageData.buffer.length === 0) {
+      return new Error('Failed to capture window content');
+    }
+
+    if (!existsSync(SCREENSHOTS_DIR)) mkdirSync(SCREENSHOTS_DIR, { recursive: true });
+    const filename = generateTimestampedFilename('screenshot', 'png');
+    const outputPath = `${SCREENSHOTS_DIR}/${filename}`;
+    writeFileSync(outputPath, imageData.buffer);
+    console.error(`Screenshot saved to: ${outputPath}`);
+
+    return filename;
+  }
+
   sendKeys(key: string, modifier?: string) {
     const result = native.dolphinSendKeys.sendKeyToWindow(this.pid, this.gameId, getKeyCode(key));
     console.log('SendKeys result:', result);
   }
 
+  // Input is the executor's most urgent class, so key presses don't wait behind scans or captures
+  async sendKeysAsync(key: string) {
+    const result = await native.dolphinSendKeys.sendKeyToWindowAsync(this.pid, this.gameId, getKeyCode(key));
+    console.error('SendKeys result:', result);
+    return result;
+  }
+
   // Didn't work rip
   // sendKeysToPID(key: string, modifier?: string): boolean {  
   //   const script = `
@@ -1,4 +1,5 @@
 import native from "@/ts/native-module.js";
+import { encodeShiftJIS } from "@/ts/utils.js";
 
 // TODO
 // Tool: Save memory snapshot
@@ -6,12 +7,269 @@ import native from "@/ts/native-module.js";
 // Tool: "Pointer chain following" hmm
 // Tool/resource: DB of known addresses for games
 
+export type MemTypeName = "byte" | "halfword" | "word" | "float" | "double" | "string" | "byteArray";
+
+export interface Watch {
+  // Offset from the start of MEM1 (MEM2 starts at 0x10000000)
+  offset: number;
+  type: MemTypeName;
+  // Only used for string and byteArray watches
+  length?: number;
+}
+
+export interface DolphinInstance {
+  pid: number;
+  gameId: string;
+  hooked: boolean;
+}
+
+export interface BatchRead {
+  offset: number;
+  size: number;
+}
+
+export type MemoryLayoutName = "gamecube" | "wii" | "extended";
+
+export interface MemoryLayout {
+  // Bytes; mem2Size is 0 for GameCube
+  mem1Size: number;
+  mem2Size: number;
+}
+
+export interface GuestRead {
+  // Dolphin virtual address: 0x80... (MEM1), 0x90... (MEM2) or 0x7E... (ARAM)
+  address: number;
+  size: number;
+}
+
+// Signature string ("3C 60 ?? ?? 38 6?") or exact bytes
+export type SearchPattern = string | Uint8Array;
+
+export interface SearchOptions {
+  regions?: ("mem1" | "mem2" | "aram")[];
+  align?: number;
+  // Per pattern
+  maxMatches?: number;
+}
+
+export interface SearchResult {
+  // Guest addresses, ascending; patterns[i] indexes the pattern list
+  addresses: Uint32Array;
+  patterns: Uint32Array;
+  truncated: boolean;
+  millis: number;
+  failedChunks: number;
+}
+
+export type RegionKind = "data" | "zero" | "pointers" | "floats" | "integers" | "text" | "code";
+
+export interface ClassifiedRegion {
+  // Guest address
+  start: number;
+  size: number;
+  kind: RegionKind;
+}
+
+export interface RamDumpResult {
+  bytes: number;
+  chunks: number;
+  millis: number;
+  // Only reported by dumpToFile
+  ioUring?: boolean;
+  direct?: boolean;
+}
+
+// Executor priority classes, most urgent first
+export type JobPriorityName = "input" | "read" | "capture" | "scan";
+
+export interface ExecutorClassStats {
+  queued: number;
+  running: number;
+  completed: number;
+  // Dropped before they started
+  cancelled: number;
+  // From queueing to start
+  meanWaitMicros: number;
+  maxWaitMicros: number;
+}
+
+export interface ExecutorStats {
+  workers: number;
+  steals: number;
+  classes: Record<JobPriorityName, ExecutorClassStats>;
+}
+
+export interface PauseStats {
+  pauses: number;
+  failedPauses: number;
+  // Pauses that hit maxPauseMs
+  overruns: number;
+  lastPauseMicros: number;
+  maxPauseMicros: number;
+  totalPauseMicros: number;
+}
+
+export interface TriggerMatch {
+  id: number;
+  timestamp: number;
+  // Every load of the expression in source order
+  values: number[];
+}
+
+// Action Replay codes must be decrypted, as Dolphin shows them
+export type CheatFormat = "gecko" | "actionReplay";
+
+export interface CheatCodeStats {
+  id: number;
+  name: string;
+  enabled: boolean;
+  // Frames the code wrote anything in
+  hits: number;
+  writes: number;
+  failures: number;
+  lastMicros: number;
+  totalMicros: number;
+}
+
+export interface SavestateSource {
+  savestate: string;
+  // Offsets of the sections in the decompressed state, for states where they aren't found
+  mem1Offset?: number;
+  mem2Offset?: number;
+  aramOffset?: number;
+}
+
+export type WalkFieldType = "u8" | "u16" | "u32" | "s8" | "s16" | "s32" | "f32" | "f64";
+
+// One of head (first node), headPointer (where the pointer to the first node is stored) or array
+export interface StructureWalk {
+  head?: number;
+  headPointer?: number;
+  // count entries stride bytes apart; with pointers they hold pointers to the nodes
+  array?: { base: number; count: number; stride?: number; pointers?: boolean };
+  // Offsets of the pointers to further nodes: one for a list, two for a binary tree
+  links?: number | number[];
+  // How far into a node the pointers to it point (intrusive lists)
+  pointerBias?: number;
+  fields?: { offset: number; type: WalkFieldType }[];
+  maxNodes?: number;
+}
+
+export interface StructureWalkResult {
+  addresses: Uint32Array;
+  // Index of the node each node was reached from, -1 for start nodes
+  parents: Int32Array;
+  // fieldCount values per node, in node order
+  values: Float64Array;
+  fieldCount: number;
+  levels: number;
+  batches: number;
+  revisits: number;
+  invalidPointers: number;
+  unreadableNodes: number;
+  truncated: boolean;
+  direct: boolean;
+}
+
+export interface RegionRenderOptions {
+  view?: "hex" | "columns" | "ascii";
+  // Column type of the columns view
+  type?: WalkFieldType;
+  bytesPerLine?: number;
+  // Notes aligned words that point into MEM1/MEM2 (hex view and u32 columns)
+  pointers?: boolean;
+  // From DolphinMemoryEngine.loadSymbolMap; labels lines and pointer targets
+  symbols?: unknown;
+  // Stops at the last whole line within about this many tokens
+  maxTokens?: number;
+}
+
+export interface RegionRenderResult {
+  text: string;
+  // Bytes from the start of the region the text covers; render from there to continue
+  renderedBytes: number;
+  truncated: boolean;
+  estimatedTokens: number;
+  micros: number;
+}
+
+export interface ScanSessionOptions {
+  type?: WalkFieldType;
+  // Defaults to the size of type
+  alignment?: number;
+  regions?: ("mem1" | "mem2")[];
+  // Start over even if a session is saved at the path
+  reset?: boolean;
+}
+
+// changed through decreasedBy compare against the value of the previous step, the rest against value
+export type ScanCompare =
+  | "changed"
+  | "unchanged"
+  | "increased"
+  | "decreased"
+  | "increasedBy"
+  | "decreasedBy"
+  | "equal"
+  | "notEqual"
+  | "greater"
+  | "less"
+  | "between";
+
+export interface ScanFilter {
+  compare: ScanCompare;
+  value?: number;
+  // between: value <= x <= upper
+  upper?: number;
+}
+
+export interface ScanStepResult {
+  candidates: number;
+  previousCandidates: number;
+  // Pages of previous values the session keeps, and pages of its store file
+  imagePages: number;
+  storePages: number;
+  // 64K-candidate blocks that couldn't be read and were kept as they were
+  unreadableContainers: number;
+  compacted: boolean;
+  millis: number;
+}
+
+export function textPattern(text: string, encoding: "ascii" | "utf8" | "shift-jis" | "utf16be" = "utf8"): Uint8Array {
+  switch (encoding) {
+    case "shift-jis":
+      return encodeShiftJIS(text);
+    case "utf16be":
+      return Buffer.from(text, "utf16le").swap16();
+    case "ascii":
+      return Buffer.from(text, "latin1");
+    default:
+      return Buffer.from(text, "utf8");
+  }
+}
+
+// Native async jobs take a CancellationToken; this one is cancelled when signal aborts
+function cancellationToken(signal?: AbortSignal) {
+  if (!signal) return undefined;
+  const token = new native.dolphinMemory.CancellationToken();
+  if (signal.aborted) token.cancel();
+  else signal.addEventListener("abort", () => token.cancel(), { once: true });
+  return token;
+}
+
 export class DolphinMemoryEngine {
   private static instance: DolphinMemoryEngine;
   private accessor: any;
   private emuRamStartAddress: number = 0;
   
-  constructor() {
+  // With a savestate, the engine reads that file instead of the running Dolphin; any number of
+  // those can be open at once
+  constructor(savestate?: SavestateSource) {
+    if (savestate) {
+      this.accessor = new native.dolphinMemory.MemoryAccessor(savestate);
+      this.emuRamStartAddress = this.hook();
+      return;
+    }
     if (DolphinMemoryEngine.instance) {
       throw new Error("DolphinMemoryEngine is a singleton class");
     }
@@ -21,9 +279,38 @@ export class DolphinMemoryEngine {
 
     console.error("## Start address:", this.emuRamStartAddress.toString(16));
   }
+
+  // Offline engine over a Dolphin .sav file; uses the current memory layout (see setMemoryLayout)
+  static openSavestate(path: string, offsets?: Omit<SavestateSource, "savestate">): DolphinMemoryEngine {
+    return new DolphinMemoryEngine({ savestate: path, ...offsets });
+  }
   
-  private hook(): number {
-    return this.accessor.hook();
+  private hook(pid?: number): number {
+    return this.accessor.hook(pid);
+  }
+
+  static listInstances(): DolphinInstance[] {
+    return native.dolphinMemory.MemoryAccessor.listInstances();
+  }
+
+  // Must be set before hooking; Dolphin's "Emulated Memory Size Override" needs "extended" or custom sizes
+  static setMemoryLayout(layout: MemoryLayoutName | MemoryLayout) {
+    native.dolphinMemory.MemoryAccessor.setMemoryLayout(layout);
+  }
+
+  static getMemoryLayout(): MemoryLayout {
+    return native.dolphinMemory.MemoryAccessor.getMemoryLayout();
+  }
+
+  // Bulk address -> offset translation for the current layout; 0xFFFFFFFF marks unmapped addresses
+  static translateAddresses(addresses: Uint32Array): Uint32Array {
+    return native.dolphinMemory.MemoryAccessor.translateAddresses(addresses);
+  }
+
+  // Switches this engine over to a specific Dolphin process
+  hookInstance(pid: number): boolean {
+    this.emuRamStartAddress = this.hook(pid);
+    return this.isHooked();
   }
   
   isHooked(): boolean {
@@ -34,6 +321,18 @@ export class DolphinMemoryEngine {
     return this.accessor.readAtOffset(this.emuRamStartAddress, offset, size);
   }
 
+  // Reads into memory the caller owns instead of a new Buffer; offset is as for readBatch. Returns
+  // false if the read failed.
+  readInto(target: ArrayBufferView | ArrayBuffer, targetOffset: number, offset: number, size: number): boolean {
+    return this.accessor.readInto(target, targetOffset, offset, size);
+  }
+
+  // Many reads into one preallocated arena as a single batch. requests holds [offset, size,
+  // targetOffset] triples; status (optional) gets 1 or 0 per request. Returns how many succeeded.
+  readBatchInto(target: ArrayBufferView | ArrayBuffer, requests: Uint32Array, status?: Uint8Array): number {
+    return this.accessor.readBatchInto(target, requests, status);
+  }
+
   write(offset: number, buffer: Buffer): boolean {
     return this.accessor.writeAtOffset(this.emuRamStartAddress, offset, buffer, buffer.length);
   }
@@ -41,4 +340,164 @@ export class DolphinMemoryEngine {
   getPID() {
     return this.accessor.getPID();
   }
+
+  // Guest-address access routed to MEM1, MEM2 or ARAM; throws a RangeError on unmapped addresses
+  readGuest(address: number, size: number): Buffer {
+    return this.accessor.readGuest(address, size);
+  }
+
+  writeGuest(address: number, buffer: Buffer): boolean {
+    return this.accessor.writeGuest(address, buffer);
+  }
+
+  // Failed or unmapped reads come back as null
+  readGuestBatch(requests: GuestRead[]): (Uint8Array | null)[] {
+    return this.accessor.readGuestBatch(requests);
+  }
+
+  // Runs fn with Dolphin suspended (SIGSTOP on Linux, task_suspend on macOS) so its reads and writes
+  // see and leave one consistent state. Dolphin is resumed after maxPauseMs regardless, and the call
+  // then throws.
+  withPaused<T>(fn: () => T, options?: { maxPauseMs?: number }): T {
+    return this.accessor.withPaused(fn, options ?? {});
+  }
+
+  // readGuestBatch with Dolphin suspended for the batch, so the results can't tear
+  readConsistent(requests: GuestRead[], options?: { maxPauseMs?: number }): (Uint8Array | null)[] {
+    return this.accessor.readConsistent(requests, options ?? {});
+  }
+
+  getPauseStats(): PauseStats {
+    return this.accessor.getPauseStats();
+  }
+
+  // Map of what MEM1/MEM2 seem to hold, merged into runs of blocks of the same kind
+  classifyRegions(options?: { regions?: ("mem1" | "mem2")[]; blockSize?: number }): ClassifiedRegion[] {
+    const map = this.accessor.classifyRegions(options ?? {});
+    const regions: ClassifiedRegion[] = [];
+    for (let i = 0; i < map.addresses.length; i++) {
+      regions.push({ start: map.addresses[i], size: map.sizes[i], kind: map.kindNames[map.kinds[i]] });
+    }
+    return regions;
+  }
+
+  // Follows a linked list, tree or pointer table natively and returns every node's fields in one go
+  walkStructure(walk: StructureWalk): StructureWalkResult {
+    return this.accessor.walkStructure(walk);
+  }
+
+  // Hexdump, typed columns or text of guest memory at address, annotated with pointers and symbols
+  renderRegion(address: number, size: number, options?: RegionRenderOptions): RegionRenderResult {
+    return this.accessor.renderRegion(address, size, options ?? {});
+  }
+
+  // Raw MEM1 (+ MEM2) image for checkpoints, read in parallel and written asynchronously; direct
+  // bypasses the page cache
+  dumpToFile(path: string, options?: { includeMEM2?: boolean; direct?: boolean }): RamDumpResult {
+    return this.accessor.dumpToFile(path, options ?? {});
+  }
+
+  // dumpToFile on the shared executor at scan priority; aborting only drops a dump that hasn't started
+  dumpToFileAsync(path: string, options?: { includeMEM2?: boolean; direct?: boolean; signal?: AbortSignal }): Promise<RamDumpResult> {
+    const { signal, ...rest } = options ?? {};
+    return this.accessor.dumpToFileAsync(path, { ...rest, token: cancellationToken(signal) });
+  }
+
+  // Writes a dumpToFile image back; the memory layout must be the one it was taken with
+  restoreFromFile(path: string): RamDumpResult {
+    return this.accessor.restoreFromFile(path);
+  }
+
+  // One native call for many reads; failed reads come back as null
+  readBatch(requests: BatchRead[]): (Uint8Array | null)[] {
+    return this.accessor.readBatch(requests);
+  }
+
+  // Independent hooks on several Dolphin instances, read in parallel with readBatch([{ pid, offset, size }])
+  createInstanceGroup() {
+    return new native.dolphinMemory.InstanceGroup();
+  }
+
+  // Append-only columnar recording of the watched values, sampled on tick() or every start(ms)
+  createRecorder(path: string, watches: Watch[], samplesPerBlock?: number) {
+    return new native.dolphinMemory.TimeSeriesRecorder(this.accessor, path, watches, samplesPerBlock);
+  }
+
+  // Compact binary frames of the watched values for socket.io dashboards; decode them with
+  // TelemetryDecoder using getSchema(). start(ms, callback) reads and encodes off the main thread.
+  createTelemetryStream(watches: Watch[], options?: { schemaId?: number; keyframeInterval?: number }) {
+    return new native.dolphinMemory.TelemetryStream(this.accessor, watches, options ?? {});
+  }
+
+  // Keeps the watched values current in an ArrayBuffer at rateHz once started; read it with
+  // new LiveMirrorReader(mirror.getBuffer(), mirror.getLayout()) without calling into the addon
+  createLiveMirror(watches: Watch[], options?: { rateHz?: number }) {
+    return new native.dolphinMemory.LiveMirror(this.accessor, watches, options ?? {});
+  }
+
+  openRecording(path: string) {
+    return new native.dolphinMemory.TimeSeriesRecording(path);
+  }
+
+  // Compiles the patterns once; call run() on the result for every search
+  createSearch(patterns: SearchPattern[]) {
+    return new native.dolphinMemory.MemorySearch(this.accessor, patterns);
+  }
+
+  search(patterns: SearchPattern[], options?: SearchOptions): SearchResult {
+    return this.createSearch(patterns).run(options ?? {});
+  }
+
+  // search() on the shared executor at scan priority, so reads and inputs keep going meanwhile;
+  // aborting stops it between chunks and rejects with "Cancelled"
+  searchAsync(patterns: SearchPattern[], options?: SearchOptions & { signal?: AbortSignal }): Promise<SearchResult> {
+    const { signal, ...rest } = options ?? {};
+    return this.createSearch(patterns).runAsync({ ...rest, token: cancellationToken(signal) });
+  }
+
+  // Queue depth and wait times of the native executor shared by all three addons
+  static getExecutorStats(): ExecutorStats {
+    return native.dolphinMemory.getExecutorStats();
+  }
+
+  // Symbols from a CodeWarrior/Dolphin .map file; with cachePath, later loads come from a binary cache
+  static loadSymbolMap(mapPath: string, cachePath?: string) {
+    return new native.dolphinMemory.SymbolMap(mapPath, cachePath);
+  }
+
+  // Serves guest reads/writes to other processes over shared memory (protocol in ipc_protocol.h);
+  // call start() to create the "/dab-<pid>" object
+  createIpcServer() {
+    return new native.dolphinMemory.IpcServer(this.accessor);
+  }
+
+  // Rolling copy-on-change history of MEM1 (and optionally MEM2); call start() to begin sampling
+  createRamHistory(options?: { rateHz?: number; budgetMB?: number; includeMEM2?: boolean; pageSize?: number; maxSamples?: number }) {
+    return new native.dolphinMemory.RamHistory(this.accessor, options ?? {});
+  }
+
+  // Conditions like "u16[u32[0x80400000] + 0x1C] == 0x2A" evaluated natively; add() them, then
+  // start(callback) gets a TriggerMatch[] only on ticks where one fires
+  createTriggerEngine(options?: { rateHz?: number }) {
+    return new native.dolphinMemory.TriggerEngine(this.accessor, options ?? {});
+  }
+
+  // Gecko and Action Replay codes applied natively; add(code, { format }) them, then apply() once
+  // or start() to apply every frame. getStats().codes has each code's CheatCodeStats.
+  createCheatEngine(options?: { rateHz?: number }) {
+    return new native.dolphinMemory.CheatEngine(this.accessor, options ?? {});
+  }
+
+  // Unknown-initial-value scan kept on disk at path: reopens the session saved there unless reset,
+  // otherwise snapshots every aligned value. narrow(filter) / narrowAsync({ ...filter, token })
+  // return a ScanStepResult; merge(otherPath, { mode }) combines sessions across runs.
+  createScanSession(path: string, options?: ScanSessionOptions) {
+    return new native.dolphinMemory.ScanSession(this.accessor, path, options ?? {});
+  }
+
+  // Which blocks of MEM1 (and optionally MEM2) change and how often; call markInput(label) when
+  // injecting inputs to see which pages react to them. Call start() to begin sampling.
+  createPageActivityProfiler(options?: { rateHz?: number; blockSize?: number; includeMEM2?: boolean; inputWindowMs?: number }) {
+    return new native.dolphinMemory.PageActivityProfiler(this.accessor, options ?? {});
+  }
 }
@@ -0,0 +1,98 @@
+// Reader for a LiveMirror buffer; the layout is described in mirror_table.h. Everything is a typed
+// array access, so polling in a tight loop never calls into the addon. Has no Node dependencies.
+
+export type MirrorFieldType = "byte" | "halfword" | "word" | "float" | "double" | "string" | "byteArray";
+
+export interface MirrorLayout {
+  headerSize: number;
+  bufferSize: number;
+  statusOffset: number;
+  bytesOffset: number;
+  fields: { offset: number; type: MirrorFieldType; length: number; bytesOffset: number }[];
+}
+
+const VALUES_OFFSET = 16;
+const TIMESTAMP_OFFSET = 8;
+// A copy only fails when the writer laps it twice, so a few tries always suffice in practice
+const MAX_ATTEMPTS = 16;
+
+export class LiveMirrorReader {
+  // The last frame read(): one value per field (NaN where its read failed, the length for string
+  // and byteArray fields) and 1/0 read flags
+  readonly values: Float64Array;
+  readonly ok: Uint8Array;
+  frame = 0;
+  // Milliseconds since the epoch
+  timestamp = 0;
+
+  private header: Uint32Array;
+  private frameWords: Uint32Array[] = [];
+  private timestamps: Float64Array[] = [];
+  private valueViews: Float64Array[] = [];
+  private statusViews: Uint8Array[] = [];
+  private byteViews: Uint8Array[] = [];
+  private bytes: Uint8Array;
+  private textDecoder = new TextDecoder("latin1");
+
+  constructor(buffer: ArrayBuffer, private layout: MirrorLayout) {
+    const count = layout.fields.length;
+    const bytesSize = layout.bufferSize - layout.bytesOffset;
+    this.header = new Uint32Array(buffer, 0, 1);
+    for (let b = 0; b < 2; b++) {
+      const start = layout.headerSize + b * layout.bufferSize;
+      this.frameWords.push(new Uint32Array(buffer, start, 1));
+      this.timestamps.push(new Float64Array(buffer, start + TIMESTAMP_OFFSET, 1));
+      this.valueViews.push(new Float64Array(buffer, start + VALUES_OFFSET, count));
+      this.statusViews.push(new Uint8Array(buffer, start + layout.statusOffset, count));
+      this.byteViews.push(new Uint8Array(buffer, start + layout.bytesOffset, bytesSize));
+    }
+    this.values = new Float64Array(count);
+    this.ok = new Uint8Array(count);
+    this.bytes = new Uint8Array(bytesSize);
+  }
+
+  // Copies the newest frame into values/ok. False if nothing was published yet or the copy kept
+  // being overwritten; values then still hold the previous frame.
+  read(): boolean {
+    for (let attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+      const frame = Atomics.load(this.header, 0);
+      if (frame === 0) return false;
+      if (frame === this.frame) return true;
+
+      const b = frame & 1;
+      if (Atomics.load(this.frameWords[b], 0) !== frame) continue;
+      const timestamp = this.timestamps[b][0];
+      this.values.set(this.valueViews[b]);
+      this.ok.set(this.statusViews[b]);
+      if (this.bytes.length > 0) this.bytes.set(this.byteViews[b]);
+      if (Atomics.load(this.frameWords[b], 0) !== frame) continue;
+
+      this.frame = frame;
+      this.timestamp = timestamp;
+      return true;
+    }
+    return false;
+  }
+
+  hasNewFrame(): boolean {
+    return Atomics.load(this.header, 0) !== this.frame;
+  }
+
+  // One field of the newest frame without read(). A single load, so the value itself can't tear,
+  // but two calls may see different frames.
+  latest(index: number): number {
+    return this.valueViews[Atomics.load(this.header, 0) & 1][index];
+  }
+
+  // Raw bytes of a string or byteArray field as of the last read()
+  bytesOf(index: number): Uint8Array {
+    const field = this.layout.fields[index];
+    const start = field.bytesOffset - this.layout.bytesOffset;
+    return this.bytes.subarray(start, start + field.length);
+  }
+
+  // A string field (up to its first NUL) as of the last read()
+  text(index: number): string {
+    return this.textDecoder.decode(this.bytesOf(index).subarray(0, this.values[index] || 0));
+  }
+}
@@ -0,0 +1,127 @@
+// Decoder for TelemetryStream frames; the format is described in telemetry_encoder.h. Has no Node
+// dependencies so dashboards can bundle it as is.
+
+export type TelemetryFieldType = "byte" | "halfword" | "word" | "float" | "double" | "string" | "byteArray";
+
+export interface TelemetrySchema {
+  schemaId: number;
+  fields: { offset: number; type: TelemetryFieldType; length: number }[];
+}
+
+export type TelemetryValue = number | string | Uint8Array;
+
+export interface TelemetryFrame {
+  keyframe: boolean;
+  sequence: number;
+  // Milliseconds since the epoch
+  timestamp: number;
+  // Every field's current value, in schema order
+  values: TelemetryValue[];
+  // Indices of the fields this frame carried
+  changed: number[];
+}
+
+const KEYFRAME = 1;
+
+export class TelemetryDecoder {
+  private values: TelemetryValue[] = [];
+  private sequence = -1;
+  private timestamp = 0;
+  private synced = false;
+  private textDecoder = new TextDecoder("latin1");
+
+  constructor(private schema: TelemetrySchema) {}
+
+  // Returns null for frames of another schema and for delta frames that can't be applied (nothing
+  // decoded yet, or a frame was missed); ask the server for a keyframe then
+  decode(frame: Uint8Array): TelemetryFrame | null {
+    const reader = new FrameReader(frame);
+    const keyframe = (reader.byte() & KEYFRAME) !== 0;
+    if (reader.varint() !== this.schema.schemaId) return null;
+    const sequence = reader.varint();
+    const timestamp = reader.varint();
+
+    if (!keyframe && (!this.synced || sequence !== this.sequence + 1)) {
+      this.synced = false;
+      return null;
+    }
+
+    const fields = this.schema.fields;
+    const changed: number[] = [];
+    if (keyframe) {
+      for (let i = 0; i < fields.length; i++) changed.push(i);
+    } else {
+      const bitmap = reader.bytes(Math.ceil(fields.length / 8));
+      for (let i = 0; i < fields.length; i++) {
+        if (bitmap[i >> 3] & (1 << (i & 7))) changed.push(i);
+      }
+    }
+
+    const values = this.values.slice();
+    for (const index of changed) {
+      const field = fields[index];
+      switch (field.type) {
+        case "byte":
+        case "halfword":
+        case "word":
+          values[index] = keyframe ? reader.varint() : (values[index] as number) + zigzag(reader.varint());
+          break;
+        case "float":
+          values[index] = reader.view(4).getFloat32(0, true);
+          break;
+        case "double":
+          values[index] = reader.view(8).getFloat64(0, true);
+          break;
+        case "string":
+          values[index] = this.textDecoder.decode(reader.bytes(reader.varint()));
+          break;
+        default:
+          values[index] = reader.bytes(field.length).slice();
+          break;
+      }
+    }
+
+    this.values = values;
+    this.sequence = sequence;
+    this.timestamp = keyframe ? timestamp : this.timestamp + timestamp;
+    this.synced = true;
+    return { keyframe, sequence, timestamp: this.timestamp, values, changed };
+  }
+}
+
+function zigzag(value: number): number {
+  // Arithmetic rather than bit operations, which would truncate to 32 bits
+  return value % 2 === 1 ? -(value + 1) / 2 : value / 2;
+}
+
+class FrameReader {
+  private position = 0;
+
+  constructor(private data: Uint8Array) {}
+
+  byte(): number {
+    if (this.position >= this.data.length) throw new RangeError("Truncated telemetry frame");
+    return this.data[this.position++];
+  }
+
+  varint(): number {
+    let value = 0;
+    for (let scale = 1; ; scale *= 128) {
+      const byte = this.byte();
+      value += (byte & 0x7f) * scale;
+      if (!(byte & 0x80)) return value;
+    }
+  }
+
+  bytes(length: number): Uint8Array {
+    if (this.position + length > this.data.length) throw new RangeError("Truncated telemetry frame");
+    const result = this.data.subarray(this.position, this.position + length);
+    this.position += length;
+    return result;
+  }
+
+  view(length: number): DataView {
+    const bytes = this.bytes(length);
+    return new DataView(bytes.buffer, bytes.byteOffset, length);
+  }
+}
@@ -44,6 +44,26 @@ export class DabMcpServer {
         };
       }
     );
+    this.server.tool(
+      "viewMemory",
+      "View emulator memory as an annotated hexdump, typed columns or text. You MUST specify the guest address (as a hex string, e.g. 80001000) and the number of bytes. Aligned words that point into RAM are noted at the end of each line. Output stops at the last whole line within maxTokens; the result says how many bytes were shown.",
+      {
+        address: z.string(),
+        size: z.number().positive(),
+        view: z.enum(["hex", "columns", "ascii"]).optional(),
+        type: z.enum(["u8", "u16", "u32", "s8", "s16", "s32", "f32", "f64"]).optional(),
+        maxTokens: z.number().positive().optional(),
+      },
+      async ({ address, size, view, type, maxTokens }) => {
+        const rendered = this.interactor.dme?.renderRegion(hexToBytes(address), size, { view, type, maxTokens: maxTokens ?? 4000 });
+        return {
+          content: [
+            { type: "text", text: `Showing ${rendered?.renderedBytes ?? 0} of ${size} bytes from ${address}${rendered?.truncated ? " (truncated)" : ""}` },
+            { type: "text", text: rendered?.text ?? "" }
+          ]
+        };
+      }
+    );
     this.server.tool(
       "writeBytes",
       "Write memory directly to the emulator's RAM.  You MUST specify both an offset (as a hex string) from the starting address of the game's RAM, and a hex string representing the bytes to write.",
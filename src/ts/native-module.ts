@@ -5,6 +5,10 @@ const dolphinMemory = require('../build/Release/dolphin_memory.node');
 const dolphinScreenGrab = require('../build/Release/offscreen_capture.node');
 const dolphinSendKeys = require('../build/Release/send_keys.node');
 
+// Every addon is its own shared library, so the executor dolphin_memory owns is handed to the others
+dolphinScreenGrab.setExecutor(dolphinMemory.getExecutorHandle());
+dolphinSendKeys.setExecutor(dolphinMemory.getExecutorHandle());
+
 export default {
   dolphinMemory,
   dolphinScreenGrab,
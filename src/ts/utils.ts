@@ -110,3 +110,39 @@ export function getKeyCode(key: string): number {
   
   return keyCodes[key] || 0;
 }
+
+let shiftJISTable: Map<string, number[]> | undefined;
+
+// Node can decode Shift-JIS but not encode it, so the encoder is the decoder's table inverted
+export function encodeShiftJIS(text: string): Uint8Array {
+  if (!shiftJISTable) {
+    shiftJISTable = new Map();
+    const decoder = new TextDecoder("shift_jis");
+    for (let lead = 0x81; lead <= 0xfc; lead++) {
+      if (lead >= 0xa0 && lead < 0xe0) continue;
+      for (let trail = 0x40; trail <= 0xfc; trail++) {
+        if (trail === 0x7f) continue;
+        const char = decoder.decode(new Uint8Array([lead, trail]));
+        if (char.length === 1 && char !== "\ufffd" && !shiftJISTable.has(char)) {
+          shiftJISTable.set(char, [lead, trail]);
+        }
+      }
+    }
+  }
+
+  const bytes: number[] = [];
+  for (const char of text) {
+    const code = char.codePointAt(0)!;
+    if (code < 0x80) {
+      bytes.push(code);
+    } else if (code >= 0xff61 && code <= 0xff9f) {
+      // Half-width katakana are single bytes
+      bytes.push(code - 0xff61 + 0xa1);
+    } else {
+      const encoded = shiftJISTable.get(char);
+      if (!encoded) throw new Error(`Character ${char} has no Shift-JIS encoding`);
+      bytes.push(...encoded);
+    }
+  }
+  return Uint8Array.from(bytes);
+}